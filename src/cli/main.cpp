@@ -39,6 +39,7 @@
 #include <core/Basics/Song.h>
 #include <core/MidiMap.h>
 #include <core/AudioEngine/AudioEngine.h>
+#include <core/AudioEngine/SongSwitcher.h>
 #include <core/Hydrogen.h>
 #include <core/Basics/Drumkit.h>
 #include <core/Basics/InstrumentList.h>
@@ -50,7 +51,9 @@
 #include <core/Basics/Playlist.h>
 #include <core/Sampler/Interpolation.h>
 #include <core/Helpers/Filesystem.h>
+#include <core/IO/DiskWriterDriver.h>
 
+#include <iomanip>
 #include <iostream>
 #include <signal.h>
 
@@ -67,6 +70,7 @@ static struct option long_opts[] = {
 	{"bits", required_argument, nullptr, 'b'},
 	{"rate", required_argument, nullptr, 'r'},
 	{"outfile", required_argument, nullptr, 'o'},
+	{"stems", 0, nullptr, 'S'},
 	{"interpolation", required_argument, nullptr, 'I'},
 	{"version", 0, nullptr, 'v'},
 	{"verbose", optional_argument, nullptr, 'V'},
@@ -165,6 +169,7 @@ int main(int argc, char *argv[])
 		QString songFilename;
 		QString playlistFilename;
 		QString outFilename = nullptr;
+		bool bExportStems = false;
 		QString sSelectedDriver;
 		bool showVersionOpt = false;
 		const char* logLevelOpt = "Error";
@@ -200,6 +205,9 @@ int main(int argc, char *argv[])
 			case 'o':
 				outFilename = QString::fromLocal8Bit(optarg);
 				break;
+			case 'S':
+				bExportStems = true;
+				break;
 			case 'i':
 				//install h2drumkit
 				drumkitName = makePathAbsolute( optarg );
@@ -420,8 +428,15 @@ int main(int argc, char *argv[])
 			for (auto i = 0; i < pInstrumentList->size(); i++) {
 				pInstrumentList->get(i)->set_currently_exported( true );
 			}
+			std::vector<DiskWriterDriver::Stem> stems;
+			if ( bExportStems ) {
+				stems = DiskWriterDriver::createStems( pSong, outFilename );
+				if ( ! DiskWriterDriver::canRenderStemsInOnePass() ) {
+					std::cout << "Warning: output of effects is only contained in the main mix" << std::endl;
+				}
+			}
 			pHydrogen->startExportSession(rate, bits);
-			pHydrogen->startExportSong( outFilename );
+			pHydrogen->startExportSong( outFilename, stems );
 			std::cout << "Export Progress ... ";
 			ExportMode = true;
 		}
@@ -506,19 +521,34 @@ int main(int argc, char *argv[])
 						std::cout << "\rExport Progress ... " << event.value << "%";
 					}
 					else {
+						auto pDiskWriterDriver = dynamic_cast<DiskWriterDriver*>(
+							pHydrogen->getAudioOutput() );
+						std::cout << "\rExport Progress ... DONE";
+						if ( pDiskWriterDriver != nullptr ) {
+							std::cout << " (" << std::fixed << std::setprecision( 1 )
+									  << pDiskWriterDriver->getExportedSeconds()
+									  << " s of audio at "
+									  << pDiskWriterDriver->getRealtimeFactor()
+									  << "x realtime)";
+						}
+						std::cout << std::endl;
 						pHydrogen->stopExportSession();
-						std::cout << "\rExport Progress ... DONE" << std::endl;
 						quit = true;
 					}
 					break;
 				case EVENT_NONE: /* Sleep if there is no more events */
-					Sleeper::msleep ( 100 );
+					// Exporting runs faster than realtime. Poll more
+					// often to not delay the end of the export.
+					Sleeper::msleep ( ExportMode ? 10 : 100 );
 					break;
 				
 				case EVENT_QUIT: // Shutdown if indicated by a
 					// corresponding OSC message.
 					quit = true;
 					break;
+				case EVENT_SWITCH_COMMITTED:
+					pHydrogen->getSongSwitcher()->finish();
+					break;
 				default:
 					// EVENT_STATE, EVENT_PATTERN_CHANGED, etc are ignored
 					break;
@@ -612,6 +642,8 @@ void showUsage()
 	std::cout << "   -s, --song FILE - Load a song (*.h2song) at startup" << std::endl;
 	std::cout << "   -p, --playlist FILE - Load a playlist (*.h2playlist) at startup" << std::endl;
 	std::cout << "   -o, --outfile FILE - Output to file (export)" << std::endl;
+	std::cout << "   -S, --stems - Export each instrument into a separate file" << std::endl;
+	std::cout << "       FILE-INSTRUMENT in the same pass as FILE" << std::endl;
 	std::cout << "   -r, --rate RATE - Set bitrate while exporting file" << std::endl;
 	std::cout << "   -b, --bits BITS - Set bits depth while exporting file" << std::endl;
 	std::cout << "   -k, --kit drumkit_name - Load a drumkit at startup" << std::endl;
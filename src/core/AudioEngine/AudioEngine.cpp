@@ -21,6 +21,8 @@
  */
 
 #include <core/AudioEngine/AudioEngine.h>
+#include <core/AudioEngine/SongSwitcher.h>
+#include <core/AudioEngine/TempoMap.h>
 #include <core/AudioEngine/TransportPosition.h>
 
 #ifdef WIN32
@@ -91,6 +93,8 @@ inline timeval currentTime2()
 
 AudioEngine::AudioEngine()
 		: m_pSampler( nullptr )
+		, m_pNotePool( nullptr )
+		, m_pCommandQueue( nullptr )
 		, m_pAudioDriver( nullptr )
 		, m_pMidiDriver( nullptr )
 		, m_pMidiDriverOut( nullptr )
@@ -109,11 +113,17 @@ AudioEngine::AudioEngine()
 		, m_fLastTickEnd( 0 )
 		, m_bLookaheadApplied( false )
 		, m_nLoopsDone( 0 )
+		, m_pSwitch( nullptr )
+		, m_nSwitchTick( -1 )
+		, m_bRemapPatternNotes( false )
 {
 	m_pTransportPosition = std::make_shared<TransportPosition>( "Transport" );
 	m_pQueuingPosition = std::make_shared<TransportPosition>( "Queuing" );
 	
 	m_pSampler = new Sampler;
+	m_pNotePool = new NotePool( NotePool::capacityForMaxNotes(
+									Preferences::get_instance()->m_nMaxNotes ) );
+	m_pCommandQueue = new CommandQueue( AudioEngine::nCommandQueueCapacity );
 
 	m_pEventQueue = EventQueue::get_instance();
 	
@@ -212,6 +222,16 @@ AudioEngine::~AudioEngine()
 #endif
 
 	delete m_pSampler;
+	delete m_pNotePool;
+
+	// Release notes of commands never applied.
+	CommandQueue::Command command;
+	while ( m_pCommandQueue->pop( &command ) ) {
+		if ( command.pNote != nullptr ) {
+			delete command.pNote;
+		}
+	}
+	delete m_pCommandQueue;
 }
 
 Sampler* AudioEngine::getSampler() const
@@ -220,6 +240,36 @@ Sampler* AudioEngine::getSampler() const
 	return m_pSampler;
 }
 
+NotePool* AudioEngine::getNotePool() const
+{
+	assert(m_pNotePool);
+	return m_pNotePool;
+}
+
+std::shared_ptr<const TempoMap> AudioEngine::getTempoMap() const
+{
+	return m_pTempoMap.load();
+}
+
+void AudioEngine::updateTempoMap()
+{
+	m_pTempoMap.store( createTempoMap( Hydrogen::get_instance()->getSong() ) );
+}
+
+std::shared_ptr<const TempoMap> AudioEngine::createTempoMap( std::shared_ptr<Song> pSong ) const
+{
+	const auto pAudioDriver = Hydrogen::get_instance()->getAudioOutput();
+	if ( pSong == nullptr || pSong->getTimeline() == nullptr ||
+		 pAudioDriver == nullptr ) {
+		return nullptr;
+	}
+
+	return std::make_shared<const TempoMap>(
+		pSong, pSong->getTimeline(),
+		static_cast<double>( pSong->lengthInTicks() ),
+		pAudioDriver->getSampleRate() );
+}
+
 void AudioEngine::lock( const char* file, unsigned int line, const char* function )
 {
 	#ifdef H2CORE_HAVE_DEBUG
@@ -425,6 +475,9 @@ void AudioEngine::locate( const double fTick, bool bWithJackBroadcast ) {
 
 	resetOffsets();
 	m_fLastTickEnd = fTick;
+	// The boundary of a pending switch is relative to the transport
+	// position.
+	m_nSwitchTick = -1;
 	const long long nNewFrame = TransportPosition::computeFrameFromTick(
 		fTick, &m_pTransportPosition->m_fTickMismatch );
 
@@ -812,6 +865,11 @@ void AudioEngine::clearAudioBuffers( uint32_t nFrames )
 	}
 #endif
 
+	auto pDiskWriterDriver = dynamic_cast<DiskWriterDriver*>(m_pAudioDriver);
+	if ( pDiskWriterDriver != nullptr ) {
+		pDiskWriterDriver->clearStemBuffers( nFrames );
+	}
+
 	m_MutexOutputPointer.unlock();
 
 #ifdef H2CORE_HAVE_LADSPA
@@ -938,7 +996,9 @@ AudioOutput* AudioEngine::createAudioDriver( const QString& sDriver )
 	setupLadspaFX();
 
 	if ( pSong != nullptr ) {
+		this->lock( RIGHT_HERE );
 		handleDriverChange();
+		this->unlock();
 	}
 
 	EventQueue::get_instance()->push_event( EVENT_DRIVER_CHANGED, 0 );
@@ -986,6 +1046,9 @@ void AudioEngine::startAudioDrivers()
 
 	this->lock( RIGHT_HERE );
 	m_MutexOutputPointer.lock();
+
+	// The new driver processes audio in a thread of its own.
+	m_pSampler->invalidateRenderScheduling();
 	
 	if ( pPref->m_sMidiDriver == "ALSA" ) {
 #ifdef H2CORE_HAVE_ALSA
@@ -1029,6 +1092,13 @@ void AudioEngine::stopAudioDrivers()
 {
 	AE_INFOLOG( "" );
 
+	// The export thread acquires the lock for each block it renders.
+	// It has to be stopped before we lock the engine ourselves.
+	if ( auto pDiskWriterDriver =
+		 dynamic_cast<DiskWriterDriver*>(m_pAudioDriver) ) {
+		pDiskWriterDriver->stop();
+	}
+
 	this->lock( RIGHT_HERE );
 
 	if ( m_state == State::Playing ) {
@@ -1253,6 +1323,7 @@ void AudioEngine::processPlayNotes( unsigned long nframes )
 				if ( fNoteProbability < (float) rand() / (float) RAND_MAX ) {
 					m_songNoteQueue.pop();
 					pNote->get_instrument()->dequeue();
+					m_pNotePool->release( pNote );
 					continue;
 				}
 			}
@@ -1263,16 +1334,16 @@ void AudioEngine::processPlayNotes( unsigned long nframes )
 			 */
 			auto pNoteInstrument = pNote->get_instrument();
 			if ( pNoteInstrument->is_stop_notes() ){
-				Note *pOffNote = new Note( pNoteInstrument );
+				Note *pOffNote = m_pNotePool->acquire( pNoteInstrument );
 				pOffNote->set_note_off( true );
 				m_pSampler->noteOn( pOffNote );
-				delete pOffNote;
+				m_pNotePool->release( pOffNote );
 			}
 
 			if ( ! pNote->get_instrument()->hasSamples() ) {
 				m_songNoteQueue.pop();
 				pNote->get_instrument()->dequeue();
-				delete pNote;
+				m_pNotePool->release( pNote );
 				continue;
 			}
 
@@ -1287,7 +1358,7 @@ void AudioEngine::processPlayNotes( unsigned long nframes )
 			
 			const int nInstrument = pSong->getDrumkit()->getInstruments()->index( pNote->get_instrument() );
 			if( pNote->get_note_off() ){
-				delete pNote;
+				m_pNotePool->release( pNote );
 			}
 
 			// Check whether the instrument could be found.
@@ -1308,12 +1379,12 @@ void AudioEngine::clearNoteQueues()
 	// delete all copied notes in the note queues
 	while ( !m_songNoteQueue.empty() ) {
 		m_songNoteQueue.top()->get_instrument()->dequeue();
-		delete m_songNoteQueue.top();
+		m_pNotePool->release( m_songNoteQueue.top() );
 		m_songNoteQueue.pop();
 	}
 
 	for ( unsigned i = 0; i < m_midiNoteQueue.size(); ++i ) {
-		delete m_midiNoteQueue[i];
+		m_pNotePool->release( m_midiNoteQueue[i] );
 	}
 	m_midiNoteQueue.clear();
 }
@@ -1330,7 +1401,6 @@ int AudioEngine::audioEngine_process( uint32_t nframes, void* /*arg*/ )
 		return 0;
 	}
 	timeval startTimeval = currentTime2();
-	const auto sDrivers = pAudioEngine->getDriverNames();
 
 	pAudioEngine->clearAudioBuffers( nframes );
 
@@ -1348,23 +1418,23 @@ int AudioEngine::audioEngine_process( uint32_t nframes, void* /*arg*/ )
 		fSlackTime = 0.0;
 	}
 
+	if ( dynamic_cast<DiskWriterDriver*>(pAudioEngine->m_pAudioDriver) != nullptr ) {
+		// The disk writer driver does not have to keep up with
+		// realtime and renders offline. It waits for the lock as long
+		// as it takes. stopAudioDrivers() stops its thread before
+		// locking the engine, so this can not deadlock.
+		pAudioEngine->lock( RIGHT_HERE );
+	}
 	/*
 	 * The "try_lock" was introduced for Bug #164 (Deadlock after during
 	 * alsa driver shutdown). The try_lock *should* only fail in rare circumstances
 	 * (like shutting down drivers). In such cases, it seems to be ok to interrupt
 	 * audio processing.
 	 */
-	if ( !pAudioEngine->tryLockFor( std::chrono::microseconds( (int)(1000.0*fSlackTime) ),
-							  RIGHT_HERE ) ) {
-		___ERRORLOG( QString( "[%1] Failed to lock audioEngine in allowed %2 ms, missed buffer" )
-					 .arg( sDrivers ).arg( fSlackTime ) );
-
-		if ( dynamic_cast<DiskWriterDriver*>(pAudioEngine->m_pAudioDriver) != nullptr ) {
-			// Returning the special return value "2" enables the disk 
-			// writer driver - which does not require running in
-			// realtime - to repeat the processing of the current data.
-			return 2;
-		}
+	else if ( !pAudioEngine->tryLockFor( std::chrono::microseconds( (int)(1000.0*fSlackTime) ),
+										 RIGHT_HERE ) ) {
+		RT_ERRORLOG( "Failed to lock audioEngine in allowed %1 ms, missed buffer",
+					 fSlackTime );
 
 		return 0;
 	}
@@ -1376,6 +1446,13 @@ int AudioEngine::audioEngine_process( uint32_t nframes, void* /*arg*/ )
 		return 0;
 	}
 
+	// Apply all state changes posted by other threads since the last
+	// cycle.
+	pAudioEngine->processCommands();
+
+	// Swap in songs and drumkits loaded in the background.
+	pAudioEngine->processSwitch();
+
 	Hydrogen* pHydrogen = Hydrogen::get_instance();
 	std::shared_ptr<Song> pSong = pHydrogen->getSong();
 	if ( pSong == nullptr ) {
@@ -1388,8 +1465,7 @@ int AudioEngine::audioEngine_process( uint32_t nframes, void* /*arg*/ )
 	if ( Hydrogen::get_instance()->hasJackTransport() ) {
 		auto pAudioDriver = pHydrogen->getAudioOutput();
 		if ( pAudioDriver == nullptr ) {
-			___ERRORLOG( QString( "[%1] AudioDriver is not ready!" )
-						 .arg( sDrivers ) );
+			RT_ERRORLOG( "AudioDriver is not ready!" );
 			assert( pAudioDriver );
 			return 1;
 		}
@@ -1432,7 +1508,7 @@ int AudioEngine::audioEngine_process( uint32_t nframes, void* /*arg*/ )
 		if ( pAudioEngine->isEndOfSongReached(
 				 pAudioEngine->m_pTransportPosition ) ) {
 
-			___INFOLOG( QString( "[%1] End of song received" ).arg( sDrivers ) );
+			RT_INFOLOG( "End of song received" );
 
 			if ( pHydrogen->getMidiOutput() != nullptr ) {
 				pHydrogen->getMidiOutput()->handleQueueAllNoteOff();
@@ -1449,7 +1525,7 @@ int AudioEngine::audioEngine_process( uint32_t nframes, void* /*arg*/ )
 
 			if ( dynamic_cast<FakeDriver*>(pAudioEngine->m_pAudioDriver) !=
 				 nullptr ) {
-				___INFOLOG( QString( "[%1] End of song." ).arg( sDrivers ) );
+				RT_INFOLOG( "End of song." );
 
 				// TODO This part of the code might not be reached
 				// anymore.
@@ -1470,16 +1546,10 @@ int AudioEngine::audioEngine_process( uint32_t nframes, void* /*arg*/ )
 	
 #ifdef CONFIG_DEBUG
 	if ( pAudioEngine->m_fProcessTime > pAudioEngine->m_fMaxProcessTime ) {
-		___WARNINGLOG( "" );
-		___WARNINGLOG( "----XRUN----" );
-		___WARNINGLOG( QString( "[%1] XRUN of %2 msec (%3 > %4)" )
-					   .arg( sDrivers )
-					   .arg( ( pAudioEngine->m_fProcessTime - pAudioEngine->m_fMaxProcessTime ) )
-					   .arg( pAudioEngine->m_fProcessTime )
-					   .arg( pAudioEngine->m_fMaxProcessTime ) );
-		___WARNINGLOG( QString( "Ladspa process time = %1" ).arg( fLadspaTime ) );
-		___WARNINGLOG( "------------" );
-		___WARNINGLOG( "" );
+		RT_WARNINGLOG( "XRUN of %1 msec (%2 > %3). Ladspa process time = %4",
+					   pAudioEngine->m_fProcessTime - pAudioEngine->m_fMaxProcessTime,
+					   pAudioEngine->m_fProcessTime,
+					   pAudioEngine->m_fMaxProcessTime, pAudioEngine->m_fLadspaTime );
 		
 		EventQueue::get_instance()->push_event( EVENT_XRUN, -1 );
 	}
@@ -1646,6 +1716,10 @@ void AudioEngine::updateSongSize() {
 		return;
 	}
 
+	// Has to be done first since all frames computed below already
+	// refer to the new song size.
+	updateTempoMap();
+
 	auto updatePatternSize = []( std::shared_ptr<TransportPosition> pPos ) {
 		if ( pPos->getPlayingPatterns()->size() > 0 ) {
 			// No virtual pattern resolution in here
@@ -2078,6 +2152,9 @@ void AudioEngine::updateVirtualPatterns() {
 
 void AudioEngine::handleTimelineChange() {
 
+	// The tempo markers or the sample rate changed.
+	updateTempoMap();
+
 	// AE_DEBUGLOG( QString( "before:\n%1\n%2" )
 	// 		 .arg( m_pTransportPosition->toQString() )
 	// 		 .arg( m_pQueuingPosition->toQString() ) );
@@ -2358,17 +2435,13 @@ void AudioEngine::updateNoteQueue( unsigned nIntervalLengthInFrames )
 	// 			.arg( m_pTransportPosition->toQString() )
 	// 			.arg( m_pQueuingPosition->toQString() ) );
 
-	// We loop over integer ticks to ensure that all notes encountered
-	// between two iterations belong to the same pattern.
-	for ( long nnTick = nTickStart; nnTick < nTickEnd; ++nnTick ) {
+	const bool bUseMetronome = Preferences::get_instance()->m_bUseMetronome;
+	const bool bNoPatternsInSong = pSong->getPatternGroupVector()->size() == 0;
 
-		//////////////////////////////////////////////////////////////
-		// Update queuing position and playing patterns.
+	// Moves the queuing position to nnTick. Returns false in case the
+	// end of the song was reached.
+	auto updateQueuingPosition = [&]( long nnTick ) {
 		if ( pHydrogen->getMode() == Song::Mode::Song ) {
-
-			const long nPreviousPosition = m_pQueuingPosition->getPatternStartTick() +
-				m_pQueuingPosition->getPatternTickPosition();
-
 			const long long nNewFrame = TransportPosition::computeFrameFromTick(
 				static_cast<double>(nnTick),
 				&m_pQueuingPosition->m_fTickMismatch );
@@ -2377,7 +2450,7 @@ void AudioEngine::updateNoteQueue( unsigned nIntervalLengthInFrames )
 
 			if ( isEndOfSongReached( m_pQueuingPosition ) ) {
 				// Queueing reached end of the song.
-				return;
+				return false;
 			}
 		}
 		else if ( pHydrogen->getMode() == Song::Mode::Pattern )	{
@@ -2388,16 +2461,94 @@ void AudioEngine::updateNoteQueue( unsigned nIntervalLengthInFrames )
 			updatePatternTransportPosition( static_cast<double>(nnTick),
 											nNewFrame, m_pQueuingPosition );
 		}
-		
+		return true;
+	};
+
+	// Only trigger the metronome at a predefined rate.
+	auto metronomeTickPosition = [&]( long nnTick ) -> long {
+		if ( bNoPatternsInSong ) {
+			return nnTick;
+		}
+		return m_pQueuingPosition->getPatternTickPosition();
+	};
+
+	// Number of ticks - starting at the current queuing position -
+	// until the queuing position enters the next column (song mode)
+	// or the playing patterns are looped (pattern mode). Within this
+	// range the pattern tick position increases in lockstep with the
+	// tick and neither the playing patterns nor the end of the song
+	// can be encountered.
+	auto ticksUntilNextSegment = [&]() -> long {
+		long nSegmentSize;
+		if ( pHydrogen->getMode() == Song::Mode::Song ) {
+			if ( bNoPatternsInSong ) {
+				return nTickEnd - nTickStart;
+			}
+			const int nColumn = m_pQueuingPosition->getColumn();
+			const auto pColumns = pSong->getPatternGroupVector();
+			if ( nColumn < 0 || nColumn >= static_cast<int>(pColumns->size()) ) {
+				return 1;
+			}
+			const auto pColumn = ( *pColumns )[ nColumn ];
+			if ( pColumn->size() != 0 ) {
+				nSegmentSize = pColumn->longest_pattern_length();
+			} else {
+				nSegmentSize = MAX_NOTES;
+			}
+		}
+		else {
+			nSegmentSize = m_pQueuingPosition->getPatternSize();
+		}
+
+		return std::max( nSegmentSize -
+						 m_pQueuingPosition->getPatternTickPosition(), 1L );
+	};
+
+	// Next tick after nnTick holding either a metronome beat or a
+	// note in one of the playing patterns. nSegmentEnd is returned if
+	// there is none within the current segment.
+	auto nextEventTick = [&]( long nnTick, long nSegmentEnd ) {
+		long nNextTick = nSegmentEnd;
+		if ( bUseMetronome ) {
+			const long nMetronomeTickPosition = metronomeTickPosition( nnTick );
+			nNextTick = std::min( nNextTick, nnTick + 48 -
+								  ( nMetronomeTickPosition % 48 ) );
+		}
+
+		const auto pPlayingPatterns = m_pQueuingPosition->getPlayingPatterns();
+		const int nPatternTickPosition =
+			m_pQueuingPosition->getPatternTickPosition();
+		for ( auto nPat = 0; nPat < pPlayingPatterns->size(); ++nPat ) {
+			const Pattern *pPattern = pPlayingPatterns->get( nPat );
+			const int nNextNoteTick =
+				pPattern->getNoteIndex()->nextTick( nPatternTickPosition + 1 );
+			if ( nNextNoteTick < pPattern->get_length() ) {
+				nNextTick = std::min( nNextTick, nnTick +
+									  nNextNoteTick - nPatternTickPosition );
+			}
+		}
+
+		return nNextTick;
+	};
+
+	// Enqueues the metronome and all pattern notes located at nnTick.
+	// The queuing position has to be updated beforehand.
+	auto queueNotesAtTick = [&]( long nnTick ) {
+		if ( m_pSwitch != nullptr && m_nSwitchTick != -1 &&
+			 nnTick >= m_nSwitchTick ) {
+			if ( m_pSwitch->pSong != nullptr ) {
+				// Notes of the current song beyond the boundary will
+				// never be played. The new song takes over in
+				// processSwitch() as soon as the transport position
+				// reaches the boundary.
+				return;
+			}
+			commitSwitch();
+		}
+
 		//////////////////////////////////////////////////////////////
 		// Metronome
-		// Only trigger the metronome at a predefined rate.
-		int nMetronomeTickPosition;
-		if ( pSong->getPatternGroupVector()->size() == 0 ) {
-			nMetronomeTickPosition = nnTick;
-		} else {
-			nMetronomeTickPosition = m_pQueuingPosition->getPatternTickPosition();
-		}
+		const int nMetronomeTickPosition = metronomeTickPosition( nnTick );
 
 		if ( nMetronomeTickPosition % 48 == 0 ) {
 			float fPitch;
@@ -2416,56 +2567,72 @@ void AudioEngine::updateNoteQueue( unsigned nIntervalLengthInFrames )
 			
 			// Only trigger the sounds if the user enabled the
 			// metronome. 
-			if ( Preferences::get_instance()->m_bUseMetronome ) {
-				Note *pMetronomeNote = new Note( m_pMetronomeInstrument,
-												 nnTick,
-												 fVelocity,
-												 0.f, // pan
-												 -1,
-												 fPitch );
+			if ( bUseMetronome ) {
+				Note *pMetronomeNote = m_pNotePool->acquire( m_pMetronomeInstrument,
+															 nnTick,
+															 fVelocity,
+															 0.f, // pan
+															 -1,
+															 fPitch );
 				m_pMetronomeInstrument->enqueue();
 				pMetronomeNote->computeNoteStart();
 				m_songNoteQueue.push( pMetronomeNote );
 			}
 		}
-			
-		if ( pHydrogen->getMode() == Song::Mode::Song &&
-			 pSong->getPatternGroupVector()->size() == 0 ) {
-			// No patterns in song. We let transport roll in case
-			// patterns will be added again and still use metronome.
-			if ( Preferences::get_instance()->m_bUseMetronome ) {
-				continue;
-			} else {
-				return;
-			}
+
+		if ( pHydrogen->getMode() == Song::Mode::Song && bNoPatternsInSong ) {
+			return;
 		}
+		
 		//////////////////////////////////////////////////////////////
 		// Update the notes queue.
 		//
 		// Supporting ticks with float precision:
-		// - make FOREACH_NOTE_CST_IT_BOUND loop over all notes
-		// `(_it)->first >= (_bound) && (_it)->first < (_bound + 1)`
+		// - query all notes within `[nPatternTickPosition,
+		// nPatternTickPosition + 1)` using the note index
 		// - add remainder of pNote->get_position() % 1 when setting
 		// nnTick as new position.
 		//
 		const auto pPlayingPatterns = m_pQueuingPosition->getPlayingPatterns();
 		if ( pPlayingPatterns->size() != 0 ) {
+			const int nPatternTickPosition =
+				m_pQueuingPosition->getPatternTickPosition();
+
+			// The drumkit was replaced but the pattern notes might not
+			// be mapped to it yet.
+			std::shared_ptr<InstrumentList> pRemapInstruments = nullptr;
+			if ( m_bRemapPatternNotes ) {
+				pRemapInstruments = pSong->getDrumkit()->getInstruments();
+			}
+
 			for ( auto nPat = 0; nPat < pPlayingPatterns->size(); ++nPat ) {
 				Pattern *pPattern = pPlayingPatterns->get( nPat );
 				assert( pPattern != nullptr );
-				Pattern::notes_t* notes = (Pattern::notes_t*)pPattern->get_notes();
+				const auto pNoteIndex = pPattern->getNoteIndex();
 
 				// Loop over all notes at tick nPatternTickPosition
 				// (associated tick is determined by Note::__position
-				// at the time of insertion into the Pattern).
-				FOREACH_NOTE_CST_IT_BOUND_LENGTH(notes, it,
-												 m_pQueuingPosition->getPatternTickPosition(),
-												 pPattern ) {
-					Note *pNote = it->second;
+				// at the time of insertion into the Pattern) which
+				// are still contained in the pattern.
+				const auto notes = pNoteIndex->getNotes(
+					nPatternTickPosition,
+					std::min( nPatternTickPosition + 1, pPattern->get_length() ) );
+				for ( Note* pNote : notes ) {
 					if ( pNote != nullptr ) {
 						pNote->set_just_recorded( false );
-						
-						Note *pCopiedNote = new Note( pNote );
+
+						Note *pCopiedNote;
+						if ( pRemapInstruments != nullptr ) {
+							auto pInstrument =
+								pRemapInstruments->find( pNote->get_instrument_id() );
+							if ( pInstrument == nullptr ) {
+								// Not present in the new kit.
+								continue;
+							}
+							pCopiedNote = m_pNotePool->acquire( pNote, pInstrument );
+						} else {
+							pCopiedNote = m_pNotePool->acquire( pNote );
+						}
 
 						// Lead or Lag.
 						// This property is set within the
@@ -2526,6 +2693,53 @@ void AudioEngine::updateNoteQueue( unsigned nIntervalLengthInFrames )
 				}
 			}
 		}
+	};
+
+	// Instead of visiting every single tick within the interval, we
+	// only move the queuing position to ticks holding notes or
+	// metronome beats as well as to the beginning of each column
+	// (song mode) or pattern loop (pattern mode). Since the pattern
+	// tick position increases in lockstep with the tick within each
+	// of these segments, this results in the same notes as looping
+	// over all integer ticks while the cost scales with the number of
+	// events instead of the number of ticks.
+	long nnTick = nTickStart;
+	while ( nnTick < nTickEnd ) {
+		if ( ! updateQueuingPosition( nnTick ) ) {
+			return;
+		}
+
+		if ( pHydrogen->getMode() == Song::Mode::Song && bNoPatternsInSong &&
+			 ! bUseMetronome ) {
+			// No patterns in song. We let transport roll in case
+			// patterns will be added again.
+			return;
+		}
+
+		const long nSegmentEnd = std::min( nTickEnd,
+										   nnTick + ticksUntilNextSegment() );
+		while ( true ) {
+			queueNotesAtTick( nnTick );
+
+			const long nNextTick = nextEventTick( nnTick, nSegmentEnd );
+			if ( nNextTick >= nSegmentEnd ) {
+				break;
+			}
+			nnTick = nNextTick;
+			if ( ! updateQueuingPosition( nnTick ) ) {
+				return;
+			}
+		}
+
+		// Leave the queuing position at the last tick of the segment
+		// as if it was traversed tick by tick.
+		if ( nnTick != nSegmentEnd - 1 ) {
+			nnTick = nSegmentEnd - 1;
+			if ( ! updateQueuingPosition( nnTick ) ) {
+				return;
+			}
+		}
+		nnTick = nSegmentEnd;
 	}
 
 	return;
@@ -2538,13 +2752,274 @@ void AudioEngine::noteOn( Note *note )
 			 getState() == State::Testing ) ) {
 		AE_ERRORLOG( QString( "Error the audio engine is not in State::Ready, State::Playing, or State::Testing but [%1]" )
 					 .arg( static_cast<int>( getState() ) ) );
-		delete note;
+		m_pNotePool->release( note );
 		return;
 	}
 
 	m_midiNoteQueue.push_back( note );
 }
 
+void AudioEngine::pushCommand( const CommandQueue::Command& command ) {
+	// Notes of previous commands discarded by the audio thread.
+	m_pNotePool->freeReturnedNotes();
+
+	if ( ! m_pCommandQueue->push( command ) ) {
+		// The audio thread did not keep up (e.g. because it is not
+		// running at all). Make room by applying the pending commands
+		// ourselves.
+		AE_WARNINGLOG( "Command queue full. Waiting for lock." );
+		lock( RIGHT_HERE );
+		processCommands();
+		m_pCommandQueue->push( command );
+		processCommands();
+		unlock();
+		return;
+	}
+
+	// The audio thread applies the commands in its next cycle. Only
+	// in case there is none we have to do it ourselves.
+	if ( ! isProcessingCommands() ) {
+		lock( RIGHT_HERE );
+		processCommands();
+		unlock();
+	}
+}
+
+bool AudioEngine::isProcessingCommands() const {
+	if ( ! ( getState() == State::Ready || getState() == State::Playing ) ||
+		 m_pAudioDriver == nullptr ) {
+		return false;
+	}
+
+	// Neither of these drivers processes audio on its own. The
+	// DiskWriterDriver does only while exporting.
+	if ( dynamic_cast<NullDriver*>(m_pAudioDriver) != nullptr ||
+		 dynamic_cast<FakeDriver*>(m_pAudioDriver) != nullptr ) {
+		return false;
+	}
+	if ( auto pDiskWriterDriver =
+		 dynamic_cast<DiskWriterDriver*>(m_pAudioDriver) ) {
+		return pDiskWriterDriver->m_bIsRunning;
+	}
+
+	return true;
+}
+
+void AudioEngine::processCommands() {
+	CommandQueue::Command command;
+	bool bNextPatternsChanged = false;
+	bool bRelocated = false;
+
+	while ( m_pCommandQueue->pop( &command ) ) {
+		switch ( command.type ) {
+		case CommandQueue::Command::Type::NoteOn:
+			noteOn( command.pNote );
+			break;
+
+		case CommandQueue::Command::Type::NoteOff:
+			if ( m_pSampler->isInstrumentPlaying( command.pNote->get_instrument() ) ) {
+				noteOn( command.pNote );
+			} else {
+				m_pNotePool->release( command.pNote );
+			}
+			break;
+
+		case CommandQueue::Command::Type::KeyboardNoteOff:
+			m_pSampler->midiKeyboardNoteOff( command.nValue );
+			break;
+
+		case CommandQueue::Command::Type::ToggleNextPattern:
+			toggleNextPattern( command.nValue );
+			bNextPatternsChanged = true;
+			break;
+
+		case CommandQueue::Command::Type::FlushAndAddNextPattern:
+			flushAndAddNextPattern( command.nValue );
+			bNextPatternsChanged = true;
+			break;
+
+		case CommandQueue::Command::Type::SetNextBpm:
+			setNextBpm( static_cast<float>(command.fValue) );
+			break;
+
+		case CommandQueue::Command::Type::Locate:
+			locate( command.fValue, command.bValue );
+			bRelocated = true;
+			break;
+		}
+	}
+
+	if ( bNextPatternsChanged ) {
+		EventQueue::get_instance()->push_event( EVENT_NEXT_PATTERNS_CHANGED, 0 );
+	}
+	if ( bRelocated ) {
+		EventQueue::get_instance()->push_event( EVENT_RELOCATION, 0 );
+	}
+}
+
+void AudioEngine::scheduleSwitch( std::shared_ptr<PendingSwitch> pSwitch ) {
+	this->lock( RIGHT_HERE );
+
+	m_pSwitch = pSwitch;
+	m_nSwitchTick = -1;
+
+	if ( ! ( getState() == State::Ready || getState() == State::Playing ) ) {
+		// audioEngine_process() is not running.
+		commitSwitch();
+	}
+
+	this->unlock();
+}
+
+bool AudioEngine::cancelSwitch( std::shared_ptr<PendingSwitch> pSwitch ) {
+	this->lock( RIGHT_HERE );
+
+	bool bCancelled = false;
+	if ( m_pSwitch == pSwitch ) {
+		m_pSwitch = nullptr;
+		m_nSwitchTick = -1;
+		bCancelled = true;
+	}
+
+	this->unlock();
+
+	return bCancelled;
+}
+
+void AudioEngine::finishDrumkitSwitch() {
+	m_bRemapPatternNotes = false;
+}
+
+void AudioEngine::processSwitch() {
+	if ( m_pSwitch == nullptr ) {
+		return;
+	}
+
+	if ( getState() != State::Playing ||
+		 m_pSwitch->boundary == Preferences::SwitchBoundary::immediately ) {
+		commitSwitch();
+		return;
+	}
+
+	if ( m_nSwitchTick == -1 ) {
+		m_nSwitchTick = computeSwitchTick( m_pTransportPosition );
+	}
+
+	// Drumkits are usually already swapped in by updateNoteQueue()
+	// since the queuing position is ahead of the transport one.
+	if ( m_pTransportPosition->getTick() >= m_nSwitchTick ) {
+		commitSwitch();
+	}
+}
+
+long AudioEngine::computeSwitchTick( std::shared_ptr<TransportPosition> pPos ) const {
+	if ( m_pSwitch == nullptr ) {
+		return -1;
+	}
+
+	const long nTickInPattern = pPos->getPatternTickPosition();
+	const long nPatternSize = static_cast<long>(pPos->getPatternSize());
+
+	long nBoundary;
+	switch ( m_pSwitch->boundary ) {
+	case Preferences::SwitchBoundary::nextBar:
+		nBoundary = std::min( ( nTickInPattern / MAX_NOTES + 1 ) * MAX_NOTES,
+							  nPatternSize );
+		break;
+	case Preferences::SwitchBoundary::patternEnd:
+		nBoundary = nPatternSize;
+		break;
+	default:
+		nBoundary = nTickInPattern;
+	}
+
+	return pPos->getTick() - nTickInPattern +
+		std::max( nBoundary, nTickInPattern );
+}
+
+void AudioEngine::commitSwitch() {
+	if ( m_pSwitch == nullptr ) {
+		return;
+	}
+
+	auto pHydrogen = Hydrogen::get_instance();
+
+	// The objects replaced by the previous switch must be reclaimed
+	// first. Since we must not wait in here, we try again in the
+	// next cycle.
+	if ( m_pSwitch->pSong != nullptr ) {
+		if ( ! pHydrogen->m_pSong.isPublishable() ||
+			 ! pHydrogen->m_pTimeline.isPublishable() ||
+			 ! m_pTempoMap.isPublishable() ) {
+			return;
+		}
+	}
+	else if ( ! pHydrogen->getSong()->publishDrumkit( m_pSwitch->pDrumkit ) ) {
+		return;
+	}
+
+	// Keep a reference till all members of the audio engine are
+	// updated. The SongSwitcher holds another one. Thus, the switch
+	// will not be freed in here.
+	const auto pSwitch = m_pSwitch;
+	m_pSwitch = nullptr;
+	m_nSwitchTick = -1;
+
+	if ( pSwitch->pSong != nullptr ) {
+		const auto pNewSong = pSwitch->pSong;
+		RT_INFOLOG( "Switching song at tick [%1]",
+					m_pTransportPosition->getDoubleTick() );
+
+		pHydrogen->m_pSong.publish( pNewSong );
+		pHydrogen->m_pTimeline.publish( pNewSong->getTimeline() );
+		m_pTempoMap.publish( pSwitch->pTempoMap );
+		m_bRemapPatternNotes = false;
+
+		// Notes already rendered by the Sampler keep playing. Only
+		// the queued ones are discarded.
+		reset( false );
+		setNextBpm( pNewSong->getBpm() );
+		m_fSongSizeInTicks = static_cast<double>( pNewSong->lengthInTicks() );
+
+		pHydrogen->getTimeline()->activate();
+
+		// Also updates the playing patterns and pattern sizes. Since
+		// the size of the new song is already set, there is no need
+		// to call updateSongSize().
+		locate( 0 );
+
+		EventQueue::get_instance()->push_event( EVENT_SONG_SIZE_CHANGED, 0 );
+	}
+	else {
+		RT_INFOLOG( "Switching drumkit at tick [%1]",
+					m_pQueuingPosition->getDoubleTick() );
+		m_bRemapPatternNotes = true;
+	}
+
+	pSwitch->bDone = true;
+}
+
+void AudioEngine::reclaimSwitch( std::shared_ptr<PendingSwitch> pSwitch ) {
+	if ( pSwitch == nullptr || ! pSwitch->bDone ) {
+		return;
+	}
+
+	auto pHydrogen = Hydrogen::get_instance();
+	if ( pSwitch->pSong != nullptr ) {
+		pSwitch->pReplacedSong = pHydrogen->m_pSong.reclaim();
+		pSwitch->pReplacedTimeline = pHydrogen->m_pTimeline.reclaim();
+		pSwitch->pReplacedTempoMap = m_pTempoMap.reclaim();
+	}
+	else {
+		// In case the song was replaced in the meantime, the old kit
+		// is freed along with it.
+		auto pSong = pHydrogen->getSong();
+		if ( pSong != nullptr && pSong->getDrumkit() == pSwitch->pDrumkit ) {
+			pSwitch->pReplacedDrumkit = pSong->reclaimDrumkit();
+		}
+	}
+}
+
 bool AudioEngine::compare_pNotes::operator()(Note* pNote1, Note* pNote2) {
 	return pNote1->getNoteStart() > pNote2->getNoteStart();
 }
@@ -24,6 +24,8 @@
 #define AUDIO_ENGINE_H
 
 #include <core/AudioEngine/AudioEngineTests.h>
+#include <core/AudioEngine/CommandQueue.h>
+#include <core/AudioEngine/NotePool.h>
 
 #include <core/config.h>
 #include <core/Object.h>
@@ -31,12 +33,14 @@
 #include <core/Sampler/Sampler.h>
 #include <core/Basics/Note.h>
 #include <core/CoreActionController.h>
+#include <core/Helpers/SharedSlot.h>
 
 #include <core/IO/AudioOutput.h>
 #include <core/IO/JackAudioDriver.h>
 #include <core/IO/DiskWriterDriver.h>
 #include <core/IO/FakeDriver.h>
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <cassert>
@@ -68,7 +72,9 @@ namespace H2Core
 	class PatternList;
 	class Drumkit;
 	class Song;
+	class TempoMap;
 	class TransportPosition;
+	struct PendingSwitch;
 	
 /**
  * The audio engine deals with two distinct #TransportPosition. The
@@ -161,6 +167,11 @@ public:
 	 * the humanization (lead-lag).
 	 */
 	static constexpr int nMaxTimeHumanize = 2000;
+	/**
+	 * Maximum number of commands which can be posted to the audio
+	 * thread in between two process cycles.
+	 */
+	static constexpr int nCommandQueueCapacity = 1024;
 
 	AudioEngine();
 
@@ -249,6 +260,54 @@ public:
 	void			assertLocked( );
 	void			noteOn( Note *note );
 
+	/**
+	 * Posts @a command to #m_pCommandQueue without waiting for the
+	 * AudioEngine lock.
+	 *
+	 * While the audio thread is processing, it applies all pending
+	 * commands at the beginning of its next cycle and the caller
+	 * does not touch the lock. Else - e.g. while no driver is
+	 * running - the caller applies them right away. Only if the
+	 * queue is full, the caller waits for the lock.
+	 *
+	 * Must not be called while holding the lock.
+	 */
+	void			pushCommand( const CommandQueue::Command& command );
+
+	/**
+	 * Hands a song or drumkit, which samples are already loaded, to
+	 * the audio thread. It will be swapped in by commitSwitch() at
+	 * the boundary specified in @a pSwitch.
+	 *
+	 * In case audioEngine_process() is not called at the moment, the
+	 * switch is committed right away.
+	 *
+	 * Must not be called while holding the lock.
+	 */
+	void			scheduleSwitch( std::shared_ptr<PendingSwitch> pSwitch );
+	/**
+	 * Discards @a pSwitch in case it was not committed yet.
+	 *
+	 * Must not be called while holding the lock.
+	 *
+	 * \return true in case @a pSwitch was discarded and false in
+	 * case it was already committed.
+	 */
+	bool			cancelSwitch( std::shared_ptr<PendingSwitch> pSwitch );
+	/**
+	 * To be called once all pattern notes were mapped to the
+	 * instruments of the drumkit swapped in by commitSwitch(). The
+	 * AudioEngine has to be locked.
+	 */
+	void			finishDrumkitSwitch();
+	/**
+	 * Retrieves the objects replaced by the audio thread when
+	 * committing @a pSwitch and stores them in @a pSwitch. This way
+	 * they can be freed outside of the lock and the next switch can
+	 * be committed. The AudioEngine has to be locked.
+	 */
+	void			reclaimSwitch( std::shared_ptr<PendingSwitch> pSwitch );
+
 	/**
 	 * Main audio processing function called by the audio drivers whenever
 	 * there is work to do.
@@ -269,6 +328,30 @@ public:
 	static double computeDoubleTickSize(const int nSampleRate, const float fBpm, const int nResolution);
 
 	Sampler*		getSampler() const;
+	/** Storage of all notes created and destroyed within the
+	 * realtime thread. */
+	NotePool*		getNotePool() const;
+
+	/**
+	 * Lookup table used by TransportPosition::computeFrameFromTick()
+	 * and TransportPosition::computeTickFromFrame() while the
+	 * #Timeline is active.
+	 *
+	 * The map is rebuilt by updateTempoMap() outside of the audio
+	 * thread. Reading it does neither allocate nor lock.
+	 *
+	 * \return nullptr in case there is no song or audio driver yet.
+	 */
+	std::shared_ptr<const TempoMap> getTempoMap() const;
+	/**
+	 * Builds a tempo map for @a pSong using its own #Timeline, song
+	 * size, and the sample rate of the current audio driver.
+	 *
+	 * Used to prepare a song switch outside of the audio thread.
+	 *
+	 * \return nullptr in case there is no audio driver yet.
+	 */
+	std::shared_ptr<const TempoMap> createTempoMap( std::shared_ptr<Song> pSong ) const;
 
 	/** \return Time passed since the beginning of the song*/
 	float			getElapsedTime() const;	
@@ -443,7 +526,7 @@ public:
 	 * \return String presentation of current object.*/
 	QString toQString( const QString& sPrefix = "", bool bShort = true ) const override;
 
-	/** Is allowed to call setSong().*/
+	/** Is allowed to call setSong() and updateTempoMap().*/
 	friend void Hydrogen::setSong( std::shared_ptr<Song> pSong );
 	/** Is allowed to use locate() to directly set the position in
 		frames as well as to used setColumn and setPatternTickPos to
@@ -557,6 +640,15 @@ private:
 	 * they are in sync again.
 	 */
 	void handleTimelineChange();
+	/**
+	 * Builds the #TempoMap of the current song and publishes it in
+	 * #m_pTempoMap. Called whenever the tempo markers, the song size,
+	 * the song, or the audio driver changed.
+	 *
+	 * The AudioEngine has to be locked. Must not be called from
+	 * within the audio thread.
+	 */
+	void updateTempoMap();
 	
 	/**
 	 * Updates all notes in #m_songNoteQueue to be still valid after a
@@ -583,9 +675,47 @@ private:
 	 */
 	void handleSongModeChanged();
 
+	/**
+	 * Applies all commands pending in #m_pCommandQueue. The
+	 * AudioEngine has to be locked.
+	 */
+	void processCommands();
+	/**
+	 * Whether the audio driver does call audioEngine_process()
+	 * periodically and the audio thread will thus pick up commands
+	 * pushed via pushCommand().
+	 */
+	bool isProcessingCommands() const;
+
+	/**
+	 * Commits #m_pSwitch in case its boundary was reached or
+	 * transport is not rolling. The AudioEngine has to be locked.
+	 *
+	 * Songs are switched at the beginning of the process cycle the
+	 * transport position reached the boundary in. Drumkits are
+	 * usually switched earlier in updateNoteQueue() once the queuing
+	 * position does.
+	 */
+	void processSwitch();
+	/**
+	 * Swaps in the song or drumkit of #m_pSwitch. Neither allocates,
+	 * frees, nor waits. Everything the new song requires - like its
+	 * tempo map - was already prepared by the SongSwitcher. The
+	 * AudioEngine has to be locked.
+	 *
+	 * In case the objects replaced by the previous switch were not
+	 * reclaimed yet (see reclaimSwitch()), the commit is postponed to
+	 * the next process cycle.
+	 */
+	void commitSwitch();
+	/** Tick #m_pSwitch will be committed at with respect to @a pPos. */
+	long computeSwitchTick( std::shared_ptr<TransportPosition> pPos ) const;
+
 	QString getDriverNames() const;
 
 	Sampler* 			m_pSampler;
+	NotePool*			m_pNotePool;
+	CommandQueue*		m_pCommandQueue;
 	AudioOutput *		m_pAudioDriver;
 	MidiInput *			m_pMidiDriver;
 	MidiOutput *		m_pMidiDriverOut;
@@ -648,6 +778,8 @@ private:
 
 	/** Set to the total number of ticks in a Song.*/
 	double				m_fSongSizeInTicks;
+	/** See getTempoMap(). */
+	SharedSlot<const TempoMap> m_pTempoMap;
 
 	/**
 	 * Variable keeping track of the transport position in realtime.
@@ -706,6 +838,19 @@ private:
 	/** Indicates how many loops the transport already did when the user presses
 	 * the Loop button again. */
 	int m_nLoopsDone;
+
+	/** Song or drumkit to be swapped in by commitSwitch(). See
+	 * SongSwitcher. */
+	std::shared_ptr<PendingSwitch> m_pSwitch;
+	/** Tick #m_pSwitch will be committed at. -1 in case it was not
+	 * determined yet or has to be recomputed, e.g. after a
+	 * relocation. */
+	long m_nSwitchTick;
+	/** Whether the pattern notes still refer to the instruments of a
+	 * drumkit replaced in commitSwitch(). In this case
+	 * updateNoteQueue() looks up the new instruments itself till
+	 * finishDrumkitSwitch() is called. */
+	bool m_bRemapPatternNotes;
 };
 
 
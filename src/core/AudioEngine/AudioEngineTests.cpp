@@ -24,8 +24,14 @@
 
 #include <core/AudioEngine/AudioEngineTests.h>
 #include <core/AudioEngine/AudioEngine.h>
+#include <core/AudioEngine/NotePool.h>
+#include <core/AudioEngine/SongSwitcher.h>
+#include <core/AudioEngine/TempoMap.h>
 #include <core/AudioEngine/TransportPosition.h>
+#include <core/Basics/Adsr.h>
 #include <core/Basics/Drumkit.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentList.h>
 #include <core/Basics/InstrumentComponent.h>
 #include <core/Basics/InstrumentLayer.h>
 #include <core/Basics/Pattern.h>
@@ -91,6 +97,41 @@ void AudioEngineTests::testFrameToTickConversion() {
 	checkTick( 1939, 1e-9 );
 	checkTick( 534623409, 1e-6 );
 	checkTick( pAE->m_fSongSizeInTicks * 3, 1e-9 );
+
+	// The tempo map has to be shared as long as the timeline does not
+	// change and rebuilt as soon as it does.
+	const auto pTempoMap = pAE->getTempoMap();
+	if ( pTempoMap == nullptr || pTempoMap != pAE->getTempoMap() ) {
+		AudioEngineTests::throwException(
+			"[testFrameToTickConversion] tempo map not cached" );
+	}
+	CoreActionController::deleteTempoMarker( 7 );
+	if ( pAE->getTempoMap() == pTempoMap ) {
+		AudioEngineTests::throwException(
+			"[testFrameToTickConversion] tempo map not updated" );
+	}
+	CoreActionController::addTempoMarker( 7, 200 );
+
+	// Compare the frame of a tempo marker against the plain sum of
+	// all preceding segments.
+	const int nSampleRate = pHydrogen->getAudioOutput()->getSampleRate();
+	const int nResolution = pHydrogen->getSong()->getResolution();
+	const double fTick3 = static_cast<double>(pHydrogen->getTickForColumn( 3 ));
+	const double fTick5 = static_cast<double>(pHydrogen->getTickForColumn( 5 ));
+	const double fFrame5 =
+		fTick3 * AudioEngine::computeDoubleTickSize( nSampleRate, 120, nResolution ) +
+		( fTick5 - fTick3 ) *
+		AudioEngine::computeDoubleTickSize( nSampleRate, 100, nResolution );
+	double fTickMismatch;
+	const long long nFrame5 =
+		TransportPosition::computeFrameFromTick( fTick5, &fTickMismatch );
+	if ( nFrame5 != static_cast<long long>( std::round( fFrame5 ) ) ||
+		 std::abs( TransportPosition::computeTickFromFrame( nFrame5 ) +
+				   fTickMismatch - fTick5 ) > 1e-9 ) {
+		AudioEngineTests::throwException(
+			QString( "[testFrameToTickConversion] wrong frame at tempo marker: %1, expected: %2" )
+			.arg( nFrame5 ).arg( fFrame5, 0, 'f' ) );
+	}
 }
 
 void AudioEngineTests::testTransportProcessing() {
@@ -1741,6 +1782,387 @@ void AudioEngineTests::checkAudioConsistency( const std::vector<std::shared_ptr<
 	}
 }
 
+void AudioEngineTests::testDrumkitSwitch() {
+	auto pHydrogen = Hydrogen::get_instance();
+	auto pSong = pHydrogen->getSong();
+	auto pPref = Preferences::get_instance();
+	auto pAE = pHydrogen->getAudioEngine();
+	auto pSampler = pAE->getSampler();
+	auto pTransportPos = pAE->getTransportPosition();
+	auto pQueuingPos = pAE->m_pQueuingPosition;
+
+	CoreActionController::activateTimeline( false );
+	CoreActionController::activateLoopMode( false );
+	CoreActionController::activateSongMode( true );
+
+	// Copy of the current kit holding distinct instruments with the
+	// same IDs.
+	auto pOldDrumkit = pSong->getDrumkit();
+	auto pNewDrumkit = std::make_shared<Drumkit>( pOldDrumkit );
+
+	pAE->lock( RIGHT_HERE );
+	pAE->setState( AudioEngine::State::Testing );
+
+	AudioEngineTests::resetSampler( "testDrumkitSwitch" );
+
+	auto pSwitch = std::make_shared<PendingSwitch>();
+	pSwitch->pDrumkit = pNewDrumkit;
+	pSwitch->boundary = Preferences::SwitchBoundary::nextBar;
+	pAE->m_pSwitch = pSwitch;
+	pAE->m_nSwitchTick = pAE->computeSwitchTick( pTransportPos );
+	const long nSwitchTick = pAE->m_nSwitchTick;
+
+	if ( nSwitchTick <= 0 ) {
+		AudioEngineTests::throwException(
+			QString( "[testDrumkitSwitch] Invalid switch tick [%1]" )
+			.arg( nSwitchTick ) );
+	}
+
+	std::vector<std::shared_ptr<Note>> notesInSongQueue;
+	int nn = 0;
+	const int nMaxCycles = 10000;
+	while ( pQueuingPos->getDoubleTick() < nSwitchTick + MAX_NOTES &&
+			pQueuingPos->getDoubleTick() < pAE->m_fSongSizeInTicks ) {
+		const int nFrames = pPref->m_nBufferSize;
+		pAE->updateNoteQueue( nFrames );
+		AudioEngineTests::mergeQueues( &notesInSongQueue,
+									   AudioEngineTests::copySongNoteQueue() );
+		pAE->processAudio( nFrames );
+		pAE->incrementTransportPosition( nFrames );
+
+		++nn;
+		if ( nn > nMaxCycles ) {
+			AudioEngineTests::throwException(
+				"[testDrumkitSwitch] boundary wasn't reached in time" );
+		}
+	}
+
+	// Done by the SongSwitcher after the commit.
+	pAE->reclaimSwitch( pSwitch );
+
+	if ( ! pSwitch->bDone || pSong->getDrumkit() != pNewDrumkit ||
+		 pSwitch->pReplacedDrumkit != pOldDrumkit ) {
+		AudioEngineTests::throwException(
+			"[testDrumkitSwitch] switch was not committed" );
+	}
+
+	int nNotesBefore = 0;
+	int nNotesAfter = 0;
+	for ( const auto& ppNote : notesInSongQueue ) {
+		auto pInstrument = ppNote->get_instrument();
+		if ( pInstrument == nullptr || pInstrument->is_metronome_instrument() ) {
+			continue;
+		}
+
+		const bool bBeforeSwitch = ppNote->get_position() < nSwitchTick;
+		const auto pExpectedKit = bBeforeSwitch ? pOldDrumkit : pNewDrumkit;
+		if ( pExpectedKit->getInstruments()->find( pInstrument->get_id() ) !=
+			 pInstrument ) {
+			AudioEngineTests::throwException(
+				QString( "[testDrumkitSwitch] note [%1] uses instrument of wrong kit. Switch tick: %2" )
+				.arg( ppNote->toQString( "", true ) ).arg( nSwitchTick ) );
+		}
+
+		if ( bBeforeSwitch ) {
+			++nNotesBefore;
+		} else {
+			++nNotesAfter;
+		}
+	}
+
+	if ( nNotesBefore == 0 || nNotesAfter == 0 ) {
+		AudioEngineTests::throwException(
+			QString( "[testDrumkitSwitch] notes before [%1] or after [%2] switch missing" )
+			.arg( nNotesBefore ).arg( nNotesAfter ) );
+	}
+
+	// Restore the original kit. Pattern notes were never mapped to
+	// the new one.
+	AudioEngineTests::resetSampler( "testDrumkitSwitch : cleanup" );
+	pSong->setDrumkit( pOldDrumkit );
+	pAE->finishDrumkitSwitch();
+
+	pAE->setState( AudioEngine::State::Ready );
+	pAE->unlock();
+}
+
+void AudioEngineTests::testVoiceStealing() {
+	auto pHydrogen = Hydrogen::get_instance();
+	auto pSong = pHydrogen->getSong();
+	auto pPref = Preferences::get_instance();
+	auto pAE = pHydrogen->getAudioEngine();
+	auto pSampler = pAE->getSampler();
+	auto pNotePool = pAE->getNotePool();
+
+	// Mute groups would release notes on their own.
+	std::vector<std::shared_ptr<Instrument>> instruments;
+	for ( const auto& ppInstrument : *pSong->getDrumkit()->getInstruments() ) {
+		if ( ppInstrument != nullptr && ppInstrument->get_mute_group() == -1 ) {
+			instruments.push_back( ppInstrument );
+		}
+	}
+	if ( instruments.size() < 2 ) {
+		AudioEngineTests::throwException(
+			"[testVoiceStealing] at least two instruments without mute group required" );
+	}
+	auto pKick = instruments[ 0 ];
+	auto pHat = instruments[ 1 ];
+
+	const auto nOldMaxNotes = pPref->m_nMaxNotes;
+	const auto oldVoiceStealing = pPref->m_voiceStealing;
+	const int nMaxNotes = 4;
+
+	pAE->lock( RIGHT_HERE );
+	pAE->setState( AudioEngine::State::Testing );
+
+	AudioEngineTests::resetSampler( "testVoiceStealing" );
+	pPref->m_nMaxNotes = nMaxNotes;
+
+	auto fail = [&]( const QString& sMsg ) {
+		pSampler->stopPlayingNotes();
+		pKick->set_max_voices( 0 );
+		pPref->m_nMaxNotes = nOldMaxNotes;
+		pPref->m_voiceStealing = oldVoiceStealing;
+		AudioEngineTests::throwException(
+			QString( "[testVoiceStealing] %1" ).arg( sMsg ) );
+	};
+
+	auto noteOn = [&]( std::shared_ptr<Instrument> pInstrument ) {
+		Note* pNote = pNotePool->acquire( pInstrument );
+		pSampler->noteOn( pNote );
+		return pNote;
+	};
+
+	// Walks both the voices of the Sampler and the ones of each
+	// instrument and compares them with the counters and the playing
+	// notes queue.
+	auto checkVoices = [&]( const QString& sContext ) {
+		int nVoices = 0;
+		Note* pPrev = nullptr;
+		for ( Note* pVoice = pSampler->m_pOldestVoice; pVoice != nullptr;
+			  pVoice = pVoice->m_pNextVoice ) {
+			if ( pVoice->m_bStolen || pVoice->m_pPrevVoice != pPrev ) {
+				fail( QString( "[%1] corrupted voice list" ).arg( sContext ) );
+			}
+			pPrev = pVoice;
+			++nVoices;
+		}
+		if ( pPrev != pSampler->m_pNewestVoice ||
+			 nVoices != pSampler->m_nVoices ) {
+			fail( QString( "[%1] voice list of [%2] does not match counter [%3]" )
+				  .arg( sContext ).arg( nVoices ).arg( pSampler->m_nVoices ) );
+		}
+
+		int nUnstolen = 0;
+		for ( const auto& ppNote : pSampler->m_playingNotesQueue ) {
+			if ( ! ppNote->m_bStolen ) {
+				++nUnstolen;
+			}
+		}
+		if ( nUnstolen != nVoices ) {
+			fail( QString( "[%1] [%2] notes not stolen but [%3] voices" )
+				  .arg( sContext ).arg( nUnstolen ).arg( nVoices ) );
+		}
+
+		int nInstrumentVoices = 0;
+		for ( const auto& ppInstrument : instruments ) {
+			int nVoicesOfInstrument = 0;
+			pPrev = nullptr;
+			for ( Note* pVoice = ppInstrument->m_pOldestVoice; pVoice != nullptr;
+				  pVoice = pVoice->m_pNextInstrumentVoice ) {
+				if ( pVoice->m_bStolen || pVoice->get_instrument() != ppInstrument ||
+					 pVoice->m_pPrevInstrumentVoice != pPrev ) {
+					fail( QString( "[%1] corrupted voice list of instrument [%2]" )
+						  .arg( sContext ).arg( ppInstrument->get_name() ) );
+				}
+				pPrev = pVoice;
+				++nVoicesOfInstrument;
+			}
+			if ( pPrev != ppInstrument->m_pNewestVoice ||
+				 nVoicesOfInstrument != ppInstrument->m_nVoices ) {
+				fail( QString( "[%1] voice list of instrument [%2] of size [%3] does not match counter [%4]" )
+					  .arg( sContext ).arg( ppInstrument->get_name() )
+					  .arg( nVoicesOfInstrument ).arg( ppInstrument->m_nVoices ) );
+			}
+			nInstrumentVoices += nVoicesOfInstrument;
+		}
+		if ( nInstrumentVoices != nVoices ) {
+			fail( QString( "[%1] instruments hold [%2] voices but the Sampler [%3]" )
+				  .arg( sContext ).arg( nInstrumentVoices ).arg( nVoices ) );
+		}
+	};
+
+	auto checkStolen = [&]( Note* pNote, const QString& sContext ) {
+		checkVoices( sContext );
+		if ( ! pNote->m_bStolen ||
+			 pNote->get_adsr()->getState() != ADSR::State::Release ) {
+			fail( QString( "[%1] expected note [%2] to be stolen" )
+				  .arg( sContext ).arg( pNote->toQString( "", true ) ) );
+		}
+		if ( pSampler->m_nVoices != nMaxNotes ) {
+			fail( QString( "[%1] [%2] voices instead of [%3]" )
+				  .arg( sContext ).arg( pSampler->m_nVoices ).arg( nMaxNotes ) );
+		}
+	};
+
+	auto clear = [&]( const QString& sContext ) {
+		pSampler->stopPlayingNotes();
+		checkVoices( sContext );
+		if ( pSampler->m_nVoices != 0 || pSampler->m_playingNotesQueue.size() != 0 ) {
+			fail( QString( "[%1] voices left after stopping all notes" )
+				  .arg( sContext ) );
+		}
+	};
+
+	//////////////////////////////////////////////////////////////////
+	// Oldest
+	pPref->m_voiceStealing = Preferences::VoiceStealing::oldest;
+	{
+		Note* pFirst = noteOn( pKick );
+		noteOn( pHat );
+		noteOn( pHat );
+		noteOn( pKick );
+		checkVoices( "oldest : filled" );
+		if ( pSampler->m_nVoices != nMaxNotes || pFirst->m_bStolen ) {
+			fail( "[oldest] stolen before limit was reached" );
+		}
+		noteOn( pHat );
+		checkStolen( pFirst, "oldest" );
+		if ( static_cast<int>(pSampler->m_playingNotesQueue.size()) != nMaxNotes + 1 ) {
+			fail( "[oldest] stolen voice not fading out" );
+		}
+		clear( "oldest : clear" );
+	}
+
+	//////////////////////////////////////////////////////////////////
+	// Same instrument
+	pPref->m_voiceStealing = Preferences::VoiceStealing::sameInstrument;
+	{
+		noteOn( pKick );
+		Note* pFirstHat = noteOn( pHat );
+		noteOn( pHat );
+		noteOn( pKick );
+		noteOn( pHat );
+		checkStolen( pFirstHat, "sameInstrument" );
+		clear( "sameInstrument : clear" );
+
+		// Falls back to the oldest voice if the instrument is not
+		// playing.
+		Note* pFirst = noteOn( pKick );
+		for ( int ii = 1; ii < nMaxNotes; ++ii ) {
+			noteOn( pKick );
+		}
+		noteOn( pHat );
+		checkStolen( pFirst, "sameInstrument : fallback" );
+		clear( "sameInstrument : fallback : clear" );
+	}
+
+	//////////////////////////////////////////////////////////////////
+	// Released
+	pPref->m_voiceStealing = Preferences::VoiceStealing::released;
+	{
+		Note* pFirst = noteOn( pKick );
+		noteOn( pHat );
+		Note* pReleased = noteOn( pKick );
+		noteOn( pHat );
+		pReleased->get_adsr()->release();
+		noteOn( pHat );
+		checkStolen( pReleased, "released" );
+
+		// No other voice was released.
+		noteOn( pKick );
+		checkStolen( pFirst, "released : fallback" );
+		clear( "released : clear" );
+	}
+
+	//////////////////////////////////////////////////////////////////
+	// Quietest
+	pPref->m_voiceStealing = Preferences::VoiceStealing::quietest;
+	{
+		// Not rendered voices are no candidates and the oldest one
+		// is chosen instead.
+		Note* pFirst = noteOn( pKick );
+		for ( int ii = 1; ii < nMaxNotes; ++ii ) {
+			noteOn( pHat );
+		}
+		noteOn( pHat );
+		checkStolen( pFirst, "quietest : fallback" );
+		clear( "quietest : fallback : clear" );
+
+		// Emulate rendering by applying the envelopes directly.
+		const int nFrames = 64;
+		std::vector<float> buffer( nFrames, 1.0 );
+		std::vector<Note*> notes;
+		for ( int ii = 0; ii < nMaxNotes; ++ii ) {
+			notes.push_back( noteOn( ii % 2 == 0 ? pKick : pHat ) );
+		}
+		Note* pQuietest = notes[ 2 ];
+		pQuietest->get_adsr()->release();
+		for ( auto& ppNote : notes ) {
+			for ( auto& [ _, ppLayer ] : ppNote->get_layers_selected() ) {
+				ppLayer->fSamplePosition = nFrames;
+			}
+			ppNote->get_adsr()->applyADSR( buffer.data(), buffer.data(),
+										   nFrames, 2 * nFrames, 1 );
+		}
+		if ( ! pQuietest->isPartiallyRendered() ) {
+			fail( "[quietest] instruments without components" );
+		}
+		noteOn( pKick );
+		checkStolen( pQuietest, "quietest" );
+		clear( "quietest : clear" );
+	}
+
+	//////////////////////////////////////////////////////////////////
+	// Instrument limit
+	pPref->m_voiceStealing = Preferences::VoiceStealing::oldest;
+	{
+		pKick->set_max_voices( 2 );
+		Note* pFirstKick = noteOn( pKick );
+		noteOn( pHat );
+		noteOn( pKick );
+		noteOn( pKick );
+		checkVoices( "maxVoices" );
+		if ( ! pFirstKick->m_bStolen || pKick->m_nVoices != 2 ||
+			 pSampler->m_nVoices != 3 ) {
+			fail( QString( "[maxVoices] instrument limit not applied. Voices of instrument: [%1], overall: [%2]" )
+				  .arg( pKick->m_nVoices ).arg( pSampler->m_nVoices ) );
+		}
+		pKick->set_max_voices( 0 );
+		clear( "maxVoices : clear" );
+	}
+
+	//////////////////////////////////////////////////////////////////
+	// Safety net
+	{
+		// Stolen voices are only removed once faded out. Notes
+		// triggered faster than that are dropped by the Sampler
+		// itself.
+		for ( int ii = 0; ii < 3 * nMaxNotes; ++ii ) {
+			noteOn( ii % 2 == 0 ? pKick : pHat );
+		}
+		checkVoices( "safety net : filled" );
+		if ( static_cast<int>(pSampler->m_playingNotesQueue.size()) != 3 * nMaxNotes ) {
+			fail( "[safety net] notes missing" );
+		}
+		pAE->processAudio( pPref->m_nBufferSize );
+		checkVoices( "safety net" );
+		if ( static_cast<int>(pSampler->m_playingNotesQueue.size()) > 2 * nMaxNotes ) {
+			fail( QString( "[safety net] [%1] notes still playing" )
+				  .arg( pSampler->m_playingNotesQueue.size() ) );
+		}
+		clear( "safety net : clear" );
+	}
+
+	pPref->m_nMaxNotes = nOldMaxNotes;
+	pPref->m_voiceStealing = oldVoiceStealing;
+
+	AudioEngineTests::resetSampler( "testVoiceStealing : cleanup" );
+
+	pAE->setState( AudioEngine::State::Ready );
+	pAE->unlock();
+}
+
 std::vector<std::shared_ptr<Note>> AudioEngineTests::copySongNoteQueue() {
 	auto pAE = Hydrogen::get_instance()->getAudioEngine();
 	std::vector<Note*> rawNotes;
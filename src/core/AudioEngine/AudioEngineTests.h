@@ -94,6 +94,17 @@ public:
 	 * that humanization works as expected.
 	 */
 	static void testHumanization();
+	/**
+	 * Checks whether a drumkit swapped in at the next bar is only
+	 * used for notes located at or after this boundary.
+	 */
+	static void testDrumkitSwitch();
+	/**
+	 * Drives Sampler::noteOn() past Preferences::m_nMaxNotes and
+	 * Instrument::m_nMaxVoices and checks which voices are stolen
+	 * and whether the voice lists stay consistent.
+	 */
+	static void testVoiceStealing();
 	
 private:
 	static int processTransport( const QString& sContext,
@@ -0,0 +1,93 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+#include <core/AudioEngine/CommandQueue.h>
+
+namespace H2Core
+{
+
+CommandQueue::CommandQueue( int nCapacity )
+	: m_nHead( 0 )
+	, m_nTail( 0 )
+	, m_nOverflowCount( 0 )
+{
+	size_t nSize = 1;
+	while ( nSize < static_cast<size_t>(nCapacity) ) {
+		nSize <<= 1;
+	}
+	m_commands.resize( nSize );
+	m_nMask = nSize - 1;
+}
+
+CommandQueue::~CommandQueue() {
+}
+
+bool CommandQueue::push( const Command& command ) {
+	std::lock_guard<std::mutex> lock( m_producerMutex );
+
+	const size_t nTail = m_nTail.load( std::memory_order_relaxed );
+	if ( nTail - m_nHead.load( std::memory_order_acquire ) >=
+		 m_commands.size() ) {
+		++m_nOverflowCount;
+		return false;
+	}
+
+	m_commands[ nTail & m_nMask ] = command;
+	m_nTail.store( nTail + 1, std::memory_order_release );
+
+	return true;
+}
+
+bool CommandQueue::pop( Command* pCommand ) {
+	const size_t nHead = m_nHead.load( std::memory_order_relaxed );
+	if ( nHead == m_nTail.load( std::memory_order_acquire ) ) {
+		return false;
+	}
+
+	*pCommand = m_commands[ nHead & m_nMask ];
+	m_nHead.store( nHead + 1, std::memory_order_release );
+
+	return true;
+}
+
+QString CommandQueue::toQString( const QString& sPrefix, bool bShort ) const {
+	QString s = Base::sPrintIndention;
+	QString sOutput;
+	const int nPending = static_cast<int>( m_nTail - m_nHead );
+	if ( ! bShort ) {
+		sOutput = QString( "%1[CommandQueue]\n" ).arg( sPrefix )
+			.append( QString( "%1%2capacity: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( getCapacity() ) )
+			.append( QString( "%1%2pending: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( nPending ) )
+			.append( QString( "%1%2m_nOverflowCount: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( getOverflowCount() ) );
+	} else {
+		sOutput = QString( "[CommandQueue]" )
+			.append( QString( " capacity: %1" ).arg( getCapacity() ) )
+			.append( QString( ", pending: %1" ).arg( nPending ) )
+			.append( QString( ", m_nOverflowCount: %1" ).arg( getOverflowCount() ) );
+	}
+
+	return sOutput;
+}
+
+};
@@ -0,0 +1,139 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+#ifndef H2C_COMMAND_QUEUE_H
+#define H2C_COMMAND_QUEUE_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <core/Object.h>
+
+namespace H2Core
+{
+
+class Note;
+
+/**
+ * Fixed-size ring buffer used by non-realtime threads - GUI,
+ * #CoreActionController, MIDI, and OSC handlers - to post state
+ * changes to the #AudioEngine without waiting for its lock.
+ *
+ * The queue is drained in AudioEngine::processCommands() while
+ * holding the #AudioEngine lock. This is done by the audio thread at
+ * the beginning of each process cycle and by the posting thread in
+ * case the lock is available right away. Since only the holder of the
+ * lock pops commands, there is a single consumer at any point in time
+ * and pop() does neither lock nor allocate.
+ *
+ * Producers are serialized among each other using a separate mutex
+ * the audio thread never touches.
+ *
+ * \ingroup docCore docAudioEngine
+ */
+class CommandQueue : public H2Core::Object<CommandQueue>
+{
+	H2_OBJECT(CommandQueue)
+public:
+	struct Command {
+		enum class Type {
+			/** Enqueue #pNote using AudioEngine::noteOn(). */
+			NoteOn,
+			/** Enqueue the note-off #pNote using AudioEngine::noteOn()
+			 * in case its instrument is currently playing. Discard it
+			 * otherwise. */
+			NoteOff,
+			/** Release all notes triggered by MIDI key #nValue. */
+			KeyboardNoteOff,
+			/** AudioEngine::toggleNextPattern() for pattern #nValue. */
+			ToggleNextPattern,
+			/** AudioEngine::flushAndAddNextPattern() for pattern
+			 * #nValue. */
+			FlushAndAddNextPattern,
+			/** AudioEngine::setNextBpm() using #fValue. */
+			SetNextBpm,
+			/** AudioEngine::locate() to tick #fValue using #bValue for
+			 * the JACK broadcast. */
+			Locate
+		};
+
+		Type type = Type::NoteOn;
+		Note* pNote = nullptr;
+		int nValue = 0;
+		double fValue = 0;
+		bool bValue = false;
+	};
+
+	/**
+	 * \param nCapacity Maximum number of commands pending at the same
+	 *   time. Rounded up to the next power of two.
+	 */
+	CommandQueue( int nCapacity );
+	~CommandQueue();
+
+	/**
+	 * Appends @a command.
+	 *
+	 * \return false in case the queue is full.
+	 */
+	bool push( const Command& command );
+	/**
+	 * Retrieves the oldest command. Must only be called while holding
+	 * the #AudioEngine lock.
+	 *
+	 * \return false in case the queue is empty.
+	 */
+	bool pop( Command* pCommand );
+
+	int getCapacity() const;
+	/** Number of commands which could not be posted because the queue
+	 * was full. */
+	int getOverflowCount() const;
+
+	QString toQString( const QString& sPrefix = "", bool bShort = true ) const override;
+
+private:
+	std::vector<Command> m_commands;
+	/** #m_commands.size() - 1. */
+	size_t m_nMask;
+
+	/** Position of the next command to pop. Written by the consumer
+	 * only. */
+	std::atomic<size_t> m_nHead;
+	/** Position the next command will be pushed to. Written by the
+	 * producers only. */
+	std::atomic<size_t> m_nTail;
+
+	std::mutex m_producerMutex;
+	std::atomic<int> m_nOverflowCount;
+};
+
+inline int CommandQueue::getCapacity() const {
+	return m_commands.size();
+}
+inline int CommandQueue::getOverflowCount() const {
+	return m_nOverflowCount;
+}
+
+};
+
+#endif
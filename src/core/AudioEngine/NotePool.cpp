@@ -0,0 +1,216 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+
+#include <core/AudioEngine/NotePool.h>
+
+#include <core/Basics/Adsr.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/Note.h>
+
+#include <algorithm>
+#include <new>
+
+namespace H2Core
+{
+
+NotePool::NotePool( int nCapacity )
+	: m_nReturnedHead( 0 )
+	, m_nReturnedTail( 0 )
+	, m_pFreeList( nullptr )
+	, m_nCapacity( 0 )
+	, m_nInUse( 0 )
+	, m_nHighWaterMark( 0 )
+	, m_nExhaustedCount( 0 )
+{
+	size_t nSize = 1;
+	while ( nSize < static_cast<size_t>( std::max( nCapacity, 64 ) ) ) {
+		nSize <<= 1;
+	}
+	m_returnedNotes.resize( nSize, nullptr );
+	m_nReturnedMask = nSize - 1;
+
+	reserve( nCapacity );
+}
+
+NotePool::~NotePool()
+{
+	if ( m_nInUse > 0 ) {
+		WARNINGLOG( QString( "[%1] pooled notes still in use" ).arg( m_nInUse ) );
+	}
+
+	freeReturnedNotes();
+
+	for ( size_t ii = 0; ii < m_blocks.size(); ++ii ) {
+		Note* pBlock = m_blocks[ ii ];
+		for ( int nn = 0; nn < m_blockSizes[ ii ]; ++nn ) {
+			pBlock[ nn ].~Note();
+		}
+		::operator delete( pBlock );
+	}
+}
+
+int NotePool::capacityForMaxNotes( int nMaxNotes )
+{
+	// Notes are held by the playing notes queue of the Sampler (at
+	// most nMaxNotes), by its queue of pending MIDI note offs, and by
+	// the song and MIDI note queues of the AudioEngine.
+	return std::max( 2 * nMaxNotes, 64 );
+}
+
+void NotePool::reserve( int nCapacity )
+{
+	const int nAdditional = nCapacity - m_nCapacity;
+	if ( nAdditional <= 0 ) {
+		return;
+	}
+
+	Note* pBlock = static_cast<Note*>( ::operator new( sizeof( Note ) * nAdditional ) );
+	for ( int nn = 0; nn < nAdditional; ++nn ) {
+		Note* pNote = new ( &pBlock[ nn ] ) Note( std::shared_ptr<Instrument>( nullptr ) );
+		pNote->m_bPooled = true;
+		// Reused by Note::reinit() so acquiring a note does not
+		// allocate an envelope.
+		pNote->__adsr = std::make_shared<ADSR>();
+		pNote->m_pNextFree = m_pFreeList;
+		m_pFreeList = pNote;
+	}
+
+	m_blocks.push_back( pBlock );
+	m_blockSizes.push_back( nAdditional );
+	m_nCapacity += nAdditional;
+}
+
+Note* NotePool::pop()
+{
+	if ( m_pFreeList == nullptr ) {
+		++m_nExhaustedCount;
+		return nullptr;
+	}
+
+	Note* pNote = m_pFreeList;
+	m_pFreeList = pNote->m_pNextFree;
+	pNote->m_pNextFree = nullptr;
+
+	const int nInUse = ++m_nInUse;
+	if ( nInUse > m_nHighWaterMark ) {
+		m_nHighWaterMark = nInUse;
+	}
+
+	return pNote;
+}
+
+Note* NotePool::acquire( std::shared_ptr<Instrument> pInstrument, int nPosition,
+						 float fVelocity, float fPan, int nLength, float fPitch )
+{
+	Note* pNote = pop();
+	if ( pNote == nullptr ) {
+		return new Note( pInstrument, nPosition, fVelocity, fPan, nLength, fPitch );
+	}
+
+	pNote->reinit( pInstrument, nPosition, fVelocity, fPan, nLength, fPitch );
+	return pNote;
+}
+
+Note* NotePool::acquire( Note* pOther, std::shared_ptr<Instrument> pInstrument )
+{
+	Note* pNote = pop();
+	if ( pNote == nullptr ) {
+		return new Note( pOther, pInstrument );
+	}
+
+	pNote->reinit( pOther, pInstrument );
+	return pNote;
+}
+
+void NotePool::release( Note* pNote )
+{
+	if ( pNote == nullptr ) {
+		return;
+	}
+
+	if ( ! pNote->m_bPooled ) {
+		const size_t nTail = m_nReturnedTail.load( std::memory_order_relaxed );
+		if ( nTail - m_nReturnedHead.load( std::memory_order_acquire ) >=
+			 m_returnedNotes.size() ) {
+			// freeReturnedNotes() was not called for quite a while.
+			delete pNote;
+			return;
+		}
+
+		m_returnedNotes[ nTail & m_nReturnedMask ] = pNote;
+		m_nReturnedTail.store( nTail + 1, std::memory_order_release );
+		return;
+	}
+
+	// Drop the reference to the instrument right away. Else a pooled
+	// note would keep an instrument of an already replaced drumkit
+	// alive.
+	pNote->__instrument = nullptr;
+	pNote->m_pNextFree = m_pFreeList;
+	m_pFreeList = pNote;
+	--m_nInUse;
+}
+
+void NotePool::freeReturnedNotes()
+{
+	std::lock_guard<std::mutex> lock( m_returnedMutex );
+
+	size_t nHead = m_nReturnedHead.load( std::memory_order_relaxed );
+	const size_t nTail = m_nReturnedTail.load( std::memory_order_acquire );
+	for ( ; nHead != nTail; ++nHead ) {
+		delete m_returnedNotes[ nHead & m_nReturnedMask ];
+		m_returnedNotes[ nHead & m_nReturnedMask ] = nullptr;
+		m_nReturnedHead.store( nHead + 1, std::memory_order_release );
+	}
+}
+
+void NotePool::resetStatistics()
+{
+	m_nHighWaterMark = static_cast<int>(m_nInUse);
+	m_nExhaustedCount = 0;
+}
+
+QString NotePool::toQString( const QString& sPrefix, bool bShort ) const {
+	QString s = Base::sPrintIndention;
+	QString sOutput;
+	if ( ! bShort ) {
+		sOutput = QString( "%1[NotePool]\n" ).arg( sPrefix )
+			.append( QString( "%1%2m_nCapacity: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( m_nCapacity ) )
+			.append( QString( "%1%2m_nInUse: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( m_nInUse ) )
+			.append( QString( "%1%2m_nHighWaterMark: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( m_nHighWaterMark ) )
+			.append( QString( "%1%2m_nExhaustedCount: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( m_nExhaustedCount ) );
+	} else {
+		sOutput = QString( "[NotePool]" )
+			.append( QString( " m_nCapacity: %1" ).arg( m_nCapacity ) )
+			.append( QString( ", m_nInUse: %1" ).arg( m_nInUse ) )
+			.append( QString( ", m_nHighWaterMark: %1" ).arg( m_nHighWaterMark ) )
+			.append( QString( ", m_nExhaustedCount: %1" ).arg( m_nExhaustedCount ) );
+	}
+
+	return sOutput;
+}
+
+};
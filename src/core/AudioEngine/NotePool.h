@@ -0,0 +1,175 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+#ifndef H2C_NOTE_POOL_H
+#define H2C_NOTE_POOL_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <core/Object.h>
+
+namespace H2Core
+{
+
+class Instrument;
+class Note;
+
+/**
+ * Preallocated storage for all notes created and destroyed by the
+ * realtime part of the #AudioEngine and #Sampler.
+ *
+ * Copying notes from patterns into the song note queue, creating
+ * metronome and stop notes, and discarding notes once rendered used
+ * to hit the heap in every process cycle. The pool instead holds a
+ * fixed number of #Note objects chained in an intrusive free list
+ * (Note::m_pNextFree) so that acquire() and release() are O(1) and
+ * do not allocate.
+ *
+ * In case the pool is exhausted, acquire() falls back to a regular
+ * heap allocation. This is counted in getExhaustedCount() and
+ * displayed in the AudioEngineInfoForm in order to help the user
+ * tweak the polyphony setting.
+ *
+ * Notes allocated on the heap - either by the fallback or by other
+ * threads, like the GUI, MIDI, or OSC handlers - are not deleted by
+ * release() but handed back to freeReturnedNotes(). This way the audio
+ * thread does not free any of them.
+ *
+ * All methods except the statistics getters and freeReturnedNotes()
+ * must be called while holding the #AudioEngine lock.
+ *
+ * \ingroup docCore docAudioEngine
+ */
+class NotePool : public H2Core::Object<NotePool>
+{
+	H2_OBJECT(NotePool)
+public:
+	/**
+	 * \param nCapacity Number of notes allocated up front.
+	 */
+	NotePool( int nCapacity );
+	~NotePool();
+
+	/** Capacity required to cover @a nMaxNotes playing notes in the
+	 * #Sampler as well as the notes enqueued in the #AudioEngine
+	 * and awaiting their MIDI note off. */
+	static int capacityForMaxNotes( int nMaxNotes );
+
+	/**
+	 * Pool counterpart of Note( std::shared_ptr<Instrument>, int,
+	 * float, float, int, float ).
+	 */
+	Note* acquire( std::shared_ptr<Instrument> pInstrument, int nPosition = 0,
+				   float fVelocity = 0.8, float fPan = 0.0, int nLength = -1,
+				   float fPitch = 0.0 );
+	/**
+	 * Pool counterpart of Note( Note*, std::shared_ptr<Instrument> ).
+	 */
+	Note* acquire( Note* pOther, std::shared_ptr<Instrument> pInstrument = nullptr );
+
+	/**
+	 * Hands @a pNote back to the pool.
+	 *
+	 * Notes not created by the pool - e.g. the ones passed to
+	 * AudioEngine::noteOn() by the GUI or the MIDI handler - are
+	 * queued for freeReturnedNotes() instead. It is thus safe to call
+	 * this function for every note passing through the realtime
+	 * path.
+	 */
+	void release( Note* pNote );
+	/**
+	 * Deletes all heap allocated notes handed to release().
+	 *
+	 * Called by EventQueue::pop_event() and
+	 * AudioEngine::pushCommand().
+	 *
+	 * Must not be called from within the realtime thread. Does not
+	 * require the #AudioEngine lock.
+	 */
+	void freeReturnedNotes();
+
+	/**
+	 * Grows the pool to hold at least @a nCapacity notes. The pool
+	 * never shrinks.
+	 *
+	 * Allocates memory and must not be called from within the
+	 * realtime thread.
+	 */
+	void reserve( int nCapacity );
+
+	int getCapacity() const;
+	/** Number of pooled notes currently handed out. */
+	int getInUse() const;
+	/** Maximum of getInUse() since the pool was created or
+	 * resetStatistics() was called. */
+	int getHighWaterMark() const;
+	/** Number of acquire() calls which had to fall back to the heap
+	 * since the pool was created or resetStatistics() was
+	 * called. */
+	int getExhaustedCount() const;
+	void resetStatistics();
+
+	QString toQString( const QString& sPrefix = "", bool bShort = true ) const override;
+
+private:
+	/** Pops the next unused note or returns nullptr if exhausted. */
+	Note* pop();
+
+	/** Ring of heap allocated notes awaiting freeReturnedNotes(). It
+	 * is filled by the holder of the #AudioEngine lock and drained by
+	 * the holder of #m_returnedMutex only. */
+	std::vector<Note*> m_returnedNotes;
+	/** #m_returnedNotes.size() - 1. */
+	size_t m_nReturnedMask;
+	std::atomic<size_t> m_nReturnedHead;
+	std::atomic<size_t> m_nReturnedTail;
+	std::mutex m_returnedMutex;
+
+	/** Raw memory blocks holding the pooled notes. */
+	std::vector<Note*> m_blocks;
+	std::vector<int> m_blockSizes;
+	Note* m_pFreeList;
+
+	std::atomic<int> m_nCapacity;
+	std::atomic<int> m_nInUse;
+	std::atomic<int> m_nHighWaterMark;
+	std::atomic<int> m_nExhaustedCount;
+};
+
+inline int NotePool::getCapacity() const {
+	return m_nCapacity;
+}
+inline int NotePool::getInUse() const {
+	return m_nInUse;
+}
+inline int NotePool::getHighWaterMark() const {
+	return m_nHighWaterMark;
+}
+inline int NotePool::getExhaustedCount() const {
+	return m_nExhaustedCount;
+}
+
+};
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+
+#include <core/AudioEngine/RubberbandWorker.h>
+
+#include <core/AudioEngine/AudioEngine.h>
+#include <core/Basics/Drumkit.h>
+#include <core/Basics/Song.h>
+#include <core/Hydrogen.h>
+#include <core/Preferences/Preferences.h>
+
+#include <chrono>
+
+namespace H2Core
+{
+
+RubberbandWorker::RubberbandWorker()
+	: m_fBpm( 0 )
+	, m_nRequests( 0 )
+	, m_nHandled( 0 )
+	, m_bShutdown( false )
+{
+	m_thread = std::thread( &RubberbandWorker::run, this );
+}
+
+RubberbandWorker::~RubberbandWorker()
+{
+	stop();
+}
+
+void RubberbandWorker::request( float fBpm )
+{
+	m_fBpm = fBpm;
+	++m_nRequests;
+}
+
+void RubberbandWorker::wake()
+{
+	if ( m_nRequests == m_nHandled ) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	m_condition.notify_one();
+}
+
+void RubberbandWorker::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_bShutdown = true;
+	}
+	m_condition.notify_one();
+	if ( m_thread.joinable() ) {
+		m_thread.join();
+	}
+}
+
+void RubberbandWorker::run()
+{
+	while ( true ) {
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_condition.wait( lock, [&]() {
+				return m_bShutdown || m_nRequests != m_nHandled; } );
+		}
+		if ( m_bShutdown ) {
+			break;
+		}
+		const int nRequest = m_nRequests;
+		m_nHandled = nRequest;
+		const float fBpm = m_fBpm;
+
+		if ( ! Preferences::get_instance()->getRubberBandBatchMode() ) {
+			continue;
+		}
+
+		auto pHydrogen = Hydrogen::get_instance();
+		auto pSong = pHydrogen->getSong();
+		if ( pSong == nullptr ) {
+			continue;
+		}
+		auto pDrumkit = pSong->getDrumkit();
+		if ( pDrumkit == nullptr || pDrumkit->getInstruments() == nullptr ) {
+			continue;
+		}
+
+		auto samples = pDrumkit->stretchSamples( fBpm, [&]() {
+			return m_bShutdown || m_nRequests != nRequest; } );
+		if ( samples.empty() ) {
+			continue;
+		}
+
+		// Hydrogen might be shut down by a thread holding the lock.
+		// We must not block it.
+		auto pAudioEngine = pHydrogen->getAudioEngine();
+		bool bLocked = false;
+		while ( ! m_bShutdown && ! bLocked ) {
+			bLocked = pAudioEngine->tryLockFor(
+				std::chrono::microseconds( 10000 ), RIGHT_HERE );
+		}
+		if ( ! bLocked ) {
+			break;
+		}
+		if ( m_nRequests == nRequest ) {
+			Drumkit::swapStretchedSamples( samples );
+		}
+		pAudioEngine->unlock();
+
+		// Each tempo adds a new set of stretched samples to the
+		// SampleRegistry and SampleCache. Once the ones replaced are
+		// released, they can be dropped.
+		samples.clear();
+		pDrumkit = nullptr;
+		Drumkit::pruneSampleCaches();
+	}
+}
+
+};
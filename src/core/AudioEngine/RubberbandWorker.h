@@ -0,0 +1,106 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+#ifndef H2C_RUBBERBAND_WORKER_H
+#define H2C_RUBBERBAND_WORKER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <core/Object.h>
+
+namespace H2Core
+{
+
+/**
+ * Stretches the samples of the current drumkit using RubberBand in
+ * the background whenever the tempo changes.
+ *
+ * Tempo changes happen within the audio thread, which must neither
+ * spawn nor join threads nor wait for samples to be stretched. It
+ * only stores the requested tempo in request(). A single persistent
+ * worker thread - sleeping on a condition variable in between - is
+ * woken up by wake() from a thread allowed to block, stretches the
+ * samples of the kit of the current song, and swaps them in - while
+ * locking the #AudioEngine - once all of them are ready. A subsequent
+ * request supersedes one still in progress.
+ *
+ * Since signalling a condition variable requires a mutex, the audio
+ * thread itself does not wake the worker. EventQueue::pop_event()
+ * does so instead whenever it runs out of events.
+ *
+ * Since the worker holds a reference to the kit while stretching, a
+ * kit replaced in the meantime is never destructed while one of its
+ * samples is still being loaded.
+ *
+ * \ingroup docCore docAudioEngine
+ */
+class RubberbandWorker : public H2Core::Object<RubberbandWorker>
+{
+	H2_OBJECT(RubberbandWorker)
+public:
+	RubberbandWorker();
+	~RubberbandWorker();
+
+	/**
+	 * Requests the samples of the current drumkit to be stretched to
+	 * @a fBpm.
+	 *
+	 * Does neither allocate nor lock and is thus safe to be called
+	 * from within the audio thread.
+	 */
+	void request( float fBpm );
+
+	/**
+	 * Wakes up the worker thread in case there is a request not
+	 * handled yet.
+	 *
+	 * Locks a mutex and must thus not be called from within the
+	 * audio thread.
+	 */
+	void wake();
+
+	/** Aborts the current stretch and waits for the worker thread to
+	 * finish. Must not be called while holding the #AudioEngine
+	 * lock. */
+	void stop();
+
+private:
+	void run();
+
+	std::thread m_thread;
+	/** Tempo of the latest request. */
+	std::atomic<float> m_fBpm;
+	/** Incremented by each call to request(). */
+	std::atomic<int> m_nRequests;
+	/** Value of #m_nRequests picked up last by the worker thread. */
+	std::atomic<int> m_nHandled;
+	std::atomic<bool> m_bShutdown;
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+};
+
+};
+
+#endif
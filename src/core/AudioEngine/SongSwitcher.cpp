@@ -0,0 +1,371 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+
+#include <core/AudioEngine/SongSwitcher.h>
+
+#include <core/AudioEngine/AudioEngine.h>
+#include <core/AudioEngine/TransportPosition.h>
+#include <core/Basics/Drumkit.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Note.h>
+#include <core/Basics/Pattern.h>
+#include <core/Basics/PatternList.h>
+#include <core/Basics/Song.h>
+#include <core/CoreActionController.h>
+#include <core/EventQueue.h>
+#include <core/Hydrogen.h>
+#include <core/Sampler/Sampler.h>
+
+#include <algorithm>
+#include <chrono>
+#include <set>
+
+namespace H2Core
+{
+
+SongSwitcher::SongSwitcher()
+	: m_bBusy( false )
+	, m_bCancelled( false )
+{
+}
+
+SongSwitcher::~SongSwitcher()
+{
+	cancel();
+}
+
+bool SongSwitcher::isApplicable() const
+{
+	return isApplicable( Preferences::get_instance()->m_switchBoundary );
+}
+
+bool SongSwitcher::isApplicable( Preferences::SwitchBoundary boundary ) const
+{
+	auto pHydrogen = Hydrogen::get_instance();
+	if ( pHydrogen == nullptr || pHydrogen->getSong() == nullptr ) {
+		return false;
+	}
+
+	return boundary != Preferences::SwitchBoundary::stop &&
+		pHydrogen->getAudioEngine()->getState() == AudioEngine::State::Playing &&
+		! pHydrogen->isUnderSessionManagement();
+}
+
+bool SongSwitcher::switchSong( std::shared_ptr<Song> pSong )
+{
+	return switchSong( pSong, Preferences::get_instance()->m_switchBoundary );
+}
+
+bool SongSwitcher::switchSong( std::shared_ptr<Song> pSong,
+							   Preferences::SwitchBoundary boundary )
+{
+	if ( pSong == nullptr ) {
+		ERRORLOG( "Invalid song" );
+		return false;
+	}
+
+	auto pSwitch = std::make_shared<PendingSwitch>();
+	pSwitch->pSong = pSong;
+	pSwitch->boundary = boundary;
+
+	return start( pSwitch );
+}
+
+bool SongSwitcher::switchDrumkit( std::shared_ptr<Drumkit> pDrumkit )
+{
+	if ( pDrumkit == nullptr ) {
+		ERRORLOG( "Invalid drumkit" );
+		return false;
+	}
+
+	auto pSwitch = std::make_shared<PendingSwitch>();
+	pSwitch->pDrumkit = pDrumkit;
+	pSwitch->boundary = Preferences::get_instance()->m_switchBoundary;
+
+	return start( pSwitch );
+}
+
+bool SongSwitcher::isBusy() const
+{
+	return m_bBusy;
+}
+
+void SongSwitcher::cancel()
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+
+	if ( m_bBusy ) {
+		// Aborts the loading of samples as well.
+		m_bCancelled = true;
+	}
+
+	if ( m_thread.joinable() ) {
+		m_thread.join();
+	}
+	m_bCancelled = false;
+}
+
+bool SongSwitcher::start( std::shared_ptr<PendingSwitch> pSwitch )
+{
+	// The most recent request wins.
+	cancel();
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	m_bBusy = true;
+	m_thread = std::thread( &SongSwitcher::run, this, pSwitch );
+
+	return true;
+}
+
+void SongSwitcher::run( std::shared_ptr<PendingSwitch> pSwitch )
+{
+	auto pHydrogen = Hydrogen::get_instance();
+	auto pAudioEngine = pHydrogen->getAudioEngine();
+
+	bool bLoaded;
+	if ( pSwitch->pSong != nullptr ) {
+		INFOLOG( QString( "Loading song [%1] in the background" )
+				 .arg( pSwitch->pSong->getName() ) );
+		bLoaded = pSwitch->pSong->getDrumkit()->loadSamples(
+			pSwitch->pSong->getBpm(), [&]() { return m_bCancelled.load(); } );
+
+		// Prepared in here since the audio thread must neither
+		// allocate nor free while committing the switch.
+		pSwitch->pTempoMap = pAudioEngine->createTempoMap( pSwitch->pSong );
+	}
+	else {
+		INFOLOG( QString( "Loading drumkit [%1] in the background" )
+				 .arg( pSwitch->pDrumkit->getName() ) );
+		// Use a cloned version of the kit - just as
+		// CoreActionController::setDrumkit() does - in order to not
+		// overwrite the original when altering the current one.
+		pSwitch->pDrumkit = std::make_shared<Drumkit>( pSwitch->pDrumkit );
+		pSwitch->pDrumkit->setType( Drumkit::Type::Song );
+		bLoaded = pSwitch->pDrumkit->loadSamples(
+			pAudioEngine->getTransportPosition()->getBpm(),
+			[&]() { return m_bCancelled.load(); } );
+	}
+
+	if ( ! bLoaded || m_bCancelled ) {
+		INFOLOG( "Switch cancelled" );
+		m_bBusy = false;
+		return;
+	}
+
+	pAudioEngine->scheduleSwitch( pSwitch );
+
+	while ( ! pSwitch->bDone ) {
+		if ( m_bCancelled ) {
+			// The switch might have been committed while we were
+			// waiting for the lock.
+			if ( ! pAudioEngine->cancelSwitch( pSwitch ) ) {
+				break;
+			}
+			INFOLOG( "Switch cancelled" );
+			m_bBusy = false;
+			return;
+		}
+		std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+	}
+
+	if ( pSwitch->pSong != nullptr ) {
+		prepareSong( pSwitch );
+	} else {
+		prepareDrumkit( pSwitch );
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_committedMutex );
+		m_pCommitted = pSwitch;
+	}
+	EventQueue::get_instance()->push_event( EVENT_SWITCH_COMMITTED, 0 );
+
+	reclaim( pSwitch );
+
+	m_bBusy = false;
+}
+
+void SongSwitcher::finish()
+{
+	std::shared_ptr<PendingSwitch> pSwitch;
+	{
+		std::lock_guard<std::mutex> lock( m_committedMutex );
+		std::swap( pSwitch, m_pCommitted );
+	}
+	if ( pSwitch == nullptr ) {
+		return;
+	}
+
+	// The song or kit might have been replaced again - e.g. by
+	// loading another song the legacy way - before the event was
+	// handled.
+	auto pSong = Hydrogen::get_instance()->getSong();
+	if ( pSwitch->pSong != nullptr ) {
+		if ( pSong == pSwitch->pSong ) {
+			finishSong( pSwitch );
+		}
+	}
+	else if ( pSong != nullptr && pSong->getDrumkit() == pSwitch->pDrumkit ) {
+		finishDrumkit( pSwitch );
+	}
+}
+
+void SongSwitcher::prepareSong( std::shared_ptr<PendingSwitch> pSwitch )
+{
+	auto pHydrogen = Hydrogen::get_instance();
+	auto pAudioEngine = pHydrogen->getAudioEngine();
+	auto pSong = pSwitch->pSong;
+
+	INFOLOG( QString( "Switched to song [%1]" ).arg( pSong->getName() ) );
+
+	pAudioEngine->lock( RIGHT_HERE );
+	if ( pAudioEngine->getAudioDriver() != nullptr ) {
+		pAudioEngine->setupLadspaFX();
+	}
+	pHydrogen->renameJackPorts( pSong );
+	pAudioEngine->unlock();
+}
+
+void SongSwitcher::finishSong( std::shared_ptr<PendingSwitch> pSwitch )
+{
+	auto pHydrogen = Hydrogen::get_instance();
+	auto pAudioEngine = pHydrogen->getAudioEngine();
+	auto pSong = pSwitch->pSong;
+
+	pHydrogen->setSelectedPatternNumber( 0 );
+
+	// Ensure the selected instrument is within the range of new
+	// instrument list.
+	const int nInstruments = pSong->getDrumkit()->getInstruments()->size();
+	if ( pHydrogen->getSelectedInstrumentNumber() >= nInstruments ) {
+		pHydrogen->setSelectedInstrumentNumber(
+			std::max( nInstruments - 1, 0 ), false );
+	}
+
+	pAudioEngine->getSampler()->reinitializePlaybackTrack();
+
+	CoreActionController::initExternalControlInterfaces();
+	CoreActionController::finishSetSong( pSong );
+}
+
+void SongSwitcher::prepareDrumkit( std::shared_ptr<PendingSwitch> pSwitch )
+{
+	auto pHydrogen = Hydrogen::get_instance();
+	auto pAudioEngine = pHydrogen->getAudioEngine();
+	auto pDrumkit = pSwitch->pDrumkit;
+
+	INFOLOG( QString( "Switched to drumkit [%1]" ).arg( pDrumkit->getName() ) );
+
+	// Remap the instruments of all pattern notes to the new kit. This
+	// is done one pattern at a time in order to not block the audio
+	// thread for too long. Until all patterns are processed, the
+	// AudioEngine looks up the new instruments itself.
+	std::set<Pattern*> processedPatterns;
+	while ( true ) {
+		pAudioEngine->lock( RIGHT_HERE );
+
+		auto pSong = pHydrogen->getSong();
+		Pattern* pPattern = nullptr;
+		if ( pSong != nullptr && pSong->getDrumkit() == pDrumkit ) {
+			for ( const auto& ppPattern : *pSong->getPatternList() ) {
+				if ( processedPatterns.find( ppPattern ) ==
+					 processedPatterns.end() ) {
+					pPattern = ppPattern;
+					break;
+				}
+			}
+		}
+
+		if ( pPattern == nullptr ) {
+			pAudioEngine->finishDrumkitSwitch();
+			if ( pSong != nullptr ) {
+				pHydrogen->renameJackPorts( pSong );
+			}
+			pAudioEngine->unlock();
+			break;
+		}
+
+		for ( auto& [ _, ppNote ] : *pPattern->get_notes() ) {
+			ppNote->map_instrument( pDrumkit->getInstruments() );
+		}
+		processedPatterns.insert( pPattern );
+
+		pAudioEngine->unlock();
+	}
+}
+
+void SongSwitcher::finishDrumkit( std::shared_ptr<PendingSwitch> pSwitch )
+{
+	CoreActionController::finishSetDrumkit( pSwitch->pDrumkit );
+}
+
+void SongSwitcher::reclaim( std::shared_ptr<PendingSwitch> pSwitch )
+{
+	auto pAudioEngine = Hydrogen::get_instance()->getAudioEngine();
+
+	// Retrieve the objects replaced by the audio thread. This has to
+	// be done even when shutting down in order to allow for the next
+	// switch.
+	pAudioEngine->lock( RIGHT_HERE );
+	pAudioEngine->reclaimSwitch( pSwitch );
+	pAudioEngine->unlock();
+
+	std::shared_ptr<Drumkit> pReplacedDrumkit;
+	if ( pSwitch->pReplacedSong != nullptr ) {
+		pReplacedDrumkit = pSwitch->pReplacedSong->getDrumkit();
+	} else {
+		pReplacedDrumkit = pSwitch->pReplacedDrumkit;
+	}
+
+	if ( pReplacedDrumkit != nullptr ) {
+		// Notes still rendered by the Sampler hold references to the
+		// instruments of the replaced kit. As long as we do hold one
+		// as well, the audio thread will never be the one freeing
+		// them. When shutting down we do not wait, as the notes
+		// themselves are keeping the instruments valid.
+		while ( ! m_bCancelled ) {
+			bool bQueued = false;
+			pAudioEngine->lock( RIGHT_HERE );
+			for ( const auto& ppInstrument : *pReplacedDrumkit->getInstruments() ) {
+				if ( ppInstrument != nullptr && ppInstrument->is_queued() ) {
+					bQueued = true;
+					break;
+				}
+			}
+			pAudioEngine->unlock();
+
+			if ( ! bQueued ) {
+				break;
+			}
+			std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+		}
+	}
+
+	pReplacedDrumkit = nullptr;
+	pSwitch->pReplacedSong = nullptr;
+	pSwitch->pReplacedDrumkit = nullptr;
+	pSwitch->pReplacedTimeline = nullptr;
+	pSwitch->pReplacedTempoMap = nullptr;
+}
+
+};
@@ -0,0 +1,193 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+#ifndef H2C_SONG_SWITCHER_H
+#define H2C_SONG_SWITCHER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <core/Object.h>
+#include <core/Preferences/Preferences.h>
+
+namespace H2Core
+{
+
+class Drumkit;
+class Song;
+class TempoMap;
+class Timeline;
+
+/**
+ * Song or drumkit handed from the #SongSwitcher to the #AudioEngine.
+ *
+ * All its samples and its tempo map are already prepared. The audio
+ * thread publishes it at the requested boundary in
+ * AudioEngine::commitSwitch(). The replaced objects are kept in their
+ * #SharedSlot till the SongSwitcher retrieves them using
+ * AudioEngine::reclaimSwitch(). This way the audio thread does
+ * neither load, build, nor free any of them.
+ *
+ * \ingroup docCore docAudioEngine
+ */
+struct PendingSwitch {
+	/** Song replacing the current one. */
+	std::shared_ptr<Song> pSong;
+	/** Drumkit replacing the one of the current song. Only used in
+	 * case #pSong is not set. */
+	std::shared_ptr<Drumkit> pDrumkit;
+	/** Tempo map of #pSong. */
+	std::shared_ptr<const TempoMap> pTempoMap;
+	Preferences::SwitchBoundary boundary =
+		Preferences::SwitchBoundary::immediately;
+
+	/** Set by AudioEngine::reclaimSwitch(). */
+	std::shared_ptr<Song> pReplacedSong;
+	/** Set by AudioEngine::reclaimSwitch(). */
+	std::shared_ptr<Timeline> pReplacedTimeline;
+	/** Set by AudioEngine::reclaimSwitch(). */
+	std::shared_ptr<const TempoMap> pReplacedTempoMap;
+	/** Set by AudioEngine::reclaimSwitch(). */
+	std::shared_ptr<Drumkit> pReplacedDrumkit;
+	/** Whether the audio thread did swap in the new song or kit. */
+	std::atomic<bool> bDone{ false };
+};
+
+/**
+ * Replaces the current song or drumkit without stopping transport.
+ *
+ * Instead of stopping playback and loading the new song or kit in
+ * the caller's thread - what results in a gap in the audio output -
+ * all samples are loaded in a separate worker thread while the
+ * current one keeps playing. The #AudioEngine swaps in the new
+ * objects at the boundary specified in
+ * Preferences::m_switchBoundary and the worker thread takes care of
+ * the follow-up work within the #AudioEngine not suitable for the
+ * audio thread. Once all notes of the replaced song or kit finished
+ * rendering, it is released in the worker thread too.
+ *
+ * Updating the selection, the playback track, and the frontend is
+ * left to the thread polling the #EventQueue. The worker pushes
+ * #EVENT_SWITCH_COMMITTED and the frontend calls finish() in
+ * response.
+ *
+ * Only one switch can be in progress at a time. Requesting a new one
+ * cancels the previous one in case it was not committed yet.
+ *
+ * \ingroup docCore docAudioEngine
+ */
+class SongSwitcher : public H2Core::Object<SongSwitcher>
+{
+	H2_OBJECT(SongSwitcher)
+public:
+	SongSwitcher();
+	~SongSwitcher();
+
+	/**
+	 * Whether songs and drumkits should be switched using this class
+	 * instead of stopping transport.
+	 *
+	 * This is the case while transport is rolling and the user
+	 * chose a boundary other than Preferences::SwitchBoundary::stop.
+	 * Under session management the legacy behavior is used
+	 * regardless.
+	 */
+	bool isApplicable() const;
+	/** Same as isApplicable() but using @a boundary instead of
+	 * Preferences::m_switchBoundary. */
+	bool isApplicable( Preferences::SwitchBoundary boundary ) const;
+
+	/**
+	 * Loads @a pSong in the background and replaces the current one
+	 * once done.
+	 *
+	 * \return false in case @a pSong is invalid.
+	 */
+	bool switchSong( std::shared_ptr<Song> pSong );
+	/** Same as switchSong() but replacing the current song at
+	 * @a boundary instead of Preferences::m_switchBoundary. */
+	bool switchSong( std::shared_ptr<Song> pSong,
+					 Preferences::SwitchBoundary boundary );
+	/**
+	 * Loads a copy of @a pDrumkit in the background and uses it to
+	 * replace the kit of the current song once done.
+	 *
+	 * \return false in case @a pDrumkit is invalid.
+	 */
+	bool switchDrumkit( std::shared_ptr<Drumkit> pDrumkit );
+
+	/** Whether a switch is in progress. */
+	bool isBusy() const;
+
+	/**
+	 * Completes the switch committed last - in case it was not
+	 * superseded in the meantime - by updating the selected pattern
+	 * and instrument, the playback track, and notifying the
+	 * frontend.
+	 *
+	 * To be called by the thread polling the #EventQueue in response
+	 * to #EVENT_SWITCH_COMMITTED.
+	 */
+	void finish();
+
+	/**
+	 * Aborts the current switch - in case it was not committed by
+	 * the #AudioEngine yet - and waits for the worker thread to
+	 * finish.
+	 *
+	 * Must not be called while holding the #AudioEngine lock.
+	 */
+	void cancel();
+
+private:
+	bool start( std::shared_ptr<PendingSwitch> pSwitch );
+	void run( std::shared_ptr<PendingSwitch> pSwitch );
+	/** Follow-up of a song switch committed by the audio thread
+	 * done within the worker thread. */
+	void prepareSong( std::shared_ptr<PendingSwitch> pSwitch );
+	/** Follow-up of a drumkit switch committed by the audio thread
+	 * done within the worker thread. */
+	void prepareDrumkit( std::shared_ptr<PendingSwitch> pSwitch );
+	/** Follow-up of a song switch done by finish(). */
+	void finishSong( std::shared_ptr<PendingSwitch> pSwitch );
+	/** Follow-up of a drumkit switch done by finish(). */
+	void finishDrumkit( std::shared_ptr<PendingSwitch> pSwitch );
+	/** Waits till all notes of the replaced song or kit are rendered
+	 * and releases it. */
+	void reclaim( std::shared_ptr<PendingSwitch> pSwitch );
+
+	/** Serializes start() and cancel(). */
+	std::mutex m_mutex;
+	std::thread m_thread;
+	std::atomic<bool> m_bBusy;
+	std::atomic<bool> m_bCancelled;
+
+	/** Guards #m_pCommitted. */
+	std::mutex m_committedMutex;
+	/** Switch committed by the audio thread but not finished yet. */
+	std::shared_ptr<PendingSwitch> m_pCommitted;
+};
+
+};
+
+#endif
@@ -0,0 +1,332 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+#include <core/AudioEngine/TempoMap.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <core/AudioEngine/AudioEngine.h>
+#include <core/Basics/PatternList.h>
+#include <core/Basics/Song.h>
+#include <core/Timeline.h>
+#include <core/config.h>
+
+namespace H2Core
+{
+
+TempoMap::TempoMap( std::shared_ptr<Song> pSong,
+					std::shared_ptr<Timeline> pTimeline,
+					double fSongSizeInTicks, int nSampleRate )
+	: m_fFirstMarkerTick( 0 )
+	, m_fSongSizeInTicks( fSongSizeInTicks )
+	, m_nSampleRate( nSampleRate )
+	, m_nResolution( pSong->getResolution() )
+	, m_bHasTempoMarkers( false )
+{
+	const auto pColumns = pSong->getPatternGroupVector();
+	const int nColumns = pColumns->size();
+	const auto& tempoMarkers = pTimeline->getAllTempoMarkers();
+	const int nMarkers = tempoMarkers.size();
+
+	m_bHasTempoMarkers = nMarkers > 0 && nColumns > 0 &&
+		! ( nMarkers == 1 && pTimeline->isFirstTempoMarkerSpecial() );
+
+	if ( ! m_bHasTempoMarkers || m_nSampleRate == 0 || m_nResolution == 0 ) {
+		return;
+	}
+
+	// Same computation as done in Hydrogen::getTickForColumn() but
+	// for all columns at once.
+	std::vector<long> columnTicks( nColumns );
+	long nTick = 0;
+	for ( int ii = 0; ii < nColumns; ++ii ) {
+		columnTicks[ ii ] = nTick;
+		const auto pColumn = ( *pColumns )[ ii ];
+		if ( pColumn->size() > 0 ) {
+			nTick += pColumn->longest_pattern_length();
+		} else {
+			nTick += MAX_NOTES;
+		}
+	}
+
+	if ( tempoMarkers[ 0 ]->nColumn < nColumns ) {
+		m_fFirstMarkerTick =
+			static_cast<double>( columnTicks[ tempoMarkers[ 0 ]->nColumn ] );
+	}
+
+	m_segmentStartTicks.resize( nMarkers + 1 );
+	m_segmentStartFrames.resize( nMarkers + 1 );
+	m_tickSizes.resize( nMarkers );
+	m_bpms.resize( nMarkers );
+
+	m_segmentStartTicks[ 0 ] = 0;
+	m_segmentStartFrames[ 0 ] = 0;
+	for ( int ii = 1; ii <= nMarkers; ++ii ) {
+		double fNextTick;
+		if ( ii == nMarkers || tempoMarkers[ ii ]->nColumn >= nColumns ) {
+			fNextTick = fSongSizeInTicks;
+		} else {
+			fNextTick = static_cast<double>(
+				columnTicks[ tempoMarkers[ ii ]->nColumn ] );
+		}
+
+		m_bpms[ ii - 1 ] = tempoMarkers[ ii - 1 ]->fBpm;
+		m_tickSizes[ ii - 1 ] = AudioEngine::computeDoubleTickSize(
+			nSampleRate, tempoMarkers[ ii - 1 ]->fBpm, m_nResolution );
+
+		m_segmentStartTicks[ ii ] = fNextTick;
+		m_segmentStartFrames[ ii ] = m_segmentStartFrames[ ii - 1 ] +
+			( fNextTick - m_segmentStartTicks[ ii - 1 ] ) * m_tickSizes[ ii - 1 ];
+	}
+}
+
+TempoMap::~TempoMap() {
+}
+
+double TempoMap::getTickSize( int nSegment, int nSampleRate ) const {
+	if ( nSampleRate == m_nSampleRate ) {
+		return m_tickSizes[ nSegment ];
+	}
+	return AudioEngine::computeDoubleTickSize( nSampleRate, m_bpms[ nSegment ],
+											   m_nResolution );
+}
+
+long long TempoMap::computeFrameFromTick( const double fTick,
+										  double* fTickMismatch,
+										  int nSampleRate ) const {
+	const int nSegments = m_bpms.size();
+	if ( ! m_bHasTempoMarkers || nSegments == 0 || fTick <= 0 ||
+		 m_fSongSizeInTicks <= 0 ) {
+		*fTickMismatch = 0;
+		return 0;
+	}
+
+	// Exactly 1 in case the sample rates match and the stored
+	// offsets are used as they are.
+	const double fFrameScale = static_cast<double>(nSampleRate) /
+		static_cast<double>(m_nSampleRate);
+
+	long long nNewFrame = 0;
+
+	// The target tick is located within the segment starting at
+	// fPassedTicks and ending at fNextTick.
+	auto handleEnd = [&]( double fNewFrame, double fPassedTicks,
+						  double fRemainingTicks, double fNextTick,
+						  double fNextTickSize, int nNextSegment ) {
+		fNewFrame += fRemainingTicks * fNextTickSize;
+
+		nNewFrame = static_cast<long long>( std::round( fNewFrame ) );
+
+		// Keep track of the rounding error to be able to switch
+		// between fTick and its frame counterpart later on.  In case
+		// fTick is located close to a tempo marker we will only
+		// cover the part up to the tempo marker in here as only this
+		// region is governed by fNextTickSize.
+		const double fRoundingErrorInTicks =
+			( fNewFrame - static_cast<double>( nNewFrame ) ) /
+			fNextTickSize;
+
+		// Compares the negative distance between current position
+		// (fNewFrame) and the one resulting from rounding -
+		// fRoundingErrorInTicks - with the negative distance between
+		// current position (fNewFrame) and location of next tempo
+		// marker.
+		if ( fRoundingErrorInTicks >
+			 fPassedTicks + fRemainingTicks - fNextTick ) {
+			// Whole mismatch located within the current tempo
+			// interval.
+			*fTickMismatch = fRoundingErrorInTicks;
+		}
+		else {
+			// Mismatch at this side of the tempo marker.
+			*fTickMismatch = fPassedTicks + fRemainingTicks - fNextTick;
+
+			const double fFinalFrame = fNewFrame +
+				( fNextTick - fPassedTicks - fRemainingTicks ) * fNextTickSize;
+
+			// Mismatch located beyond the tempo marker.
+			const double fFinalTickSize = getTickSize(
+				nNextSegment < nSegments ? nNextSegment : 0, nSampleRate );
+
+			*fTickMismatch += ( fFinalFrame - static_cast<double>(nNewFrame) ) /
+				fFinalTickSize;
+		}
+	};
+
+	double fBaseFrame = 0;
+	double fSegmentTick = fTick;
+	if ( fTick > m_fSongSizeInTicks ) {
+		// The provided fTick is larger than the song.
+		const int nRepetitions = std::floor( fTick / m_fSongSizeInTicks );
+		const double fSongSizeInFrames =
+			m_segmentStartFrames[ nSegments ] * fFrameScale;
+
+		fBaseFrame = fSongSizeInFrames * static_cast<double>(nRepetitions);
+		fSegmentTick = std::fmod( fTick, m_fSongSizeInTicks );
+
+		if ( std::isinf( fBaseFrame ) ||
+			 static_cast<long long>(fBaseFrame) >
+			 std::numeric_limits<long long>::max() ) {
+			ERRORLOG( QString( "Provided ticks [%1] are too large." ).arg( fTick ) );
+			*fTickMismatch = 0;
+			return 0;
+		}
+
+		// The target tick matches a multiple of the song size. We
+		// need to reproduce the context within the last tempo marker
+		// in order to get the mismatch right.
+		if ( fSegmentTick == 0 ) {
+			handleEnd( fBaseFrame, 0, 0, m_fFirstMarkerTick,
+					   getTickSize( nSegments - 1, nSampleRate ), nSegments );
+			return nNewFrame;
+		}
+	}
+
+	// First segment ending at or after the target tick. Since all
+	// segment boundaries are integer-valued, this is the same segment
+	// the linear walk over all tempo markers would end up in.
+	const int nSegment = std::min(
+		static_cast<int>( std::lower_bound( m_segmentStartTicks.begin() + 1,
+											m_segmentStartTicks.end(),
+											fSegmentTick ) -
+						  m_segmentStartTicks.begin() ) - 1,
+		nSegments - 1 );
+
+	handleEnd( fBaseFrame + m_segmentStartFrames[ nSegment ] * fFrameScale,
+			   m_segmentStartTicks[ nSegment ],
+			   fSegmentTick - m_segmentStartTicks[ nSegment ],
+			   m_segmentStartTicks[ nSegment + 1 ],
+			   getTickSize( nSegment, nSampleRate ), nSegment + 1 );
+
+	return nNewFrame;
+}
+
+double TempoMap::computeTickFromFrame( const long long nFrame,
+									   int nSampleRate ) const {
+	const int nSegments = m_bpms.size();
+	if ( ! m_bHasTempoMarkers || nSegments == 0 || nFrame <= 0 ) {
+		return 0;
+	}
+
+	const double fFrameScale = static_cast<double>(nSampleRate) /
+		static_cast<double>(m_nSampleRate);
+	const double fSongSizeInFrames =
+		m_segmentStartFrames[ nSegments ] * fFrameScale;
+	if ( fSongSizeInFrames <= 0 ) {
+		return 0;
+	}
+
+	// We are using double precision in here to avoid rounding
+	// errors.
+	const double fTargetFrame = static_cast<double>(nFrame);
+	double fBaseFrame = 0;
+	double fBaseTick = 0;
+
+	// Whether the segment nSegment is located completely left of the
+	// target frame.
+	auto isPassed = [&]( int nSegment ) {
+		const double fSegmentFrames =
+			( m_segmentStartTicks[ nSegment + 1 ] -
+			  m_segmentStartTicks[ nSegment ] ) *
+			getTickSize( nSegment, nSampleRate );
+		return fSegmentFrames < fTargetFrame -
+			( fBaseFrame + m_segmentStartFrames[ nSegment ] * fFrameScale );
+	};
+
+	auto findSegment = [&]() {
+		int nFirst = 0;
+		int nCount = nSegments;
+		while ( nCount > 0 ) {
+			const int nStep = nCount / 2;
+			if ( isPassed( nFirst + nStep ) ) {
+				nFirst += nStep + 1;
+				nCount -= nStep + 1;
+			} else {
+				nCount = nStep;
+			}
+		}
+		return nFirst;
+	};
+
+	int nSegment = findSegment();
+	if ( nSegment == nSegments ) {
+		// The provided nFrame is larger than the song.
+		const int nRepetitions = std::floor( fTargetFrame / fSongSizeInFrames );
+		if ( m_fSongSizeInTicks * nRepetitions >
+			 std::numeric_limits<double>::max() ) {
+			ERRORLOG( QString( "Provided frames [%1] are too large." ).arg( nFrame ) );
+			return 0;
+		}
+		fBaseTick = m_fSongSizeInTicks * nRepetitions;
+		fBaseFrame = static_cast<double>(nRepetitions) * fSongSizeInFrames;
+
+		// Due to rounding the remainder might still reach beyond the
+		// last tempo marker. It is then attributed to the last
+		// segment.
+		nSegment = std::min( findSegment(), nSegments - 1 );
+	}
+
+	// The target frame is located within a segment.
+	const double fNewTick = ( fTargetFrame -
+							  ( fBaseFrame + m_segmentStartFrames[ nSegment ] *
+								fFrameScale ) ) /
+		getTickSize( nSegment, nSampleRate );
+
+	return fBaseTick + m_segmentStartTicks[ nSegment ] + fNewTick;
+}
+
+QString TempoMap::toQString( const QString& sPrefix, bool bShort ) const {
+	QString s = Base::sPrintIndention;
+	QString sOutput;
+	if ( ! bShort ) {
+		sOutput = QString( "%1[TempoMap]\n" ).arg( sPrefix )
+			.append( QString( "%1%2m_nSampleRate: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( m_nSampleRate ) )
+			.append( QString( "%1%2m_nResolution: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( m_nResolution ) )
+			.append( QString( "%1%2m_fSongSizeInTicks: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( m_fSongSizeInTicks, 0, 'f' ) )
+			.append( QString( "%1%2m_bHasTempoMarkers: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( m_bHasTempoMarkers ) )
+			.append( QString( "%1%2segments:\n" ).arg( sPrefix ).arg( s ) );
+		for ( int ii = 0; ii < static_cast<int>(m_bpms.size()); ++ii ) {
+			sOutput.append( QString( "%1%2%2[%3] tick: %4, frame: %5, bpm: %6, tick size: %7\n" )
+							.arg( sPrefix ).arg( s ).arg( ii )
+							.arg( m_segmentStartTicks[ ii ], 0, 'f' )
+							.arg( m_segmentStartFrames[ ii ], 0, 'f' )
+							.arg( m_bpms[ ii ] )
+							.arg( m_tickSizes[ ii ], 0, 'f' ) );
+		}
+	} else {
+		sOutput = QString( "[TempoMap]" )
+			.append( QString( " m_nSampleRate: %1" ).arg( m_nSampleRate ) )
+			.append( QString( ", m_nResolution: %1" ).arg( m_nResolution ) )
+			.append( QString( ", m_fSongSizeInTicks: %1" ).arg( m_fSongSizeInTicks, 0, 'f' ) )
+			.append( QString( ", m_bHasTempoMarkers: %1" ).arg( m_bHasTempoMarkers ) )
+			.append( QString( ", segments: %1" ).arg( m_bpms.size() ) );
+	}
+
+	return sOutput;
+}
+
+};
@@ -0,0 +1,138 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+#ifndef H2C_TEMPO_MAP_H
+#define H2C_TEMPO_MAP_H
+
+#include <memory>
+#include <vector>
+
+#include <core/Object.h>
+
+namespace H2Core
+{
+
+class Song;
+class Timeline;
+
+/**
+ * Immutable lookup table for converting ticks into frames and vice
+ * versa while the #Timeline is active.
+ *
+ * Each tempo marker starts a segment of constant tick size. The map
+ * stores the tick and the (unrounded) frame each segment starts at,
+ * accumulated in the very same order the former linear walk in
+ * TransportPosition::computeFrameFromTick() and
+ * TransportPosition::computeTickFromFrame() did. This way conversions
+ * are answered by a binary search without allocating and without
+ * altering the results.
+ *
+ * Instances are created by AudioEngine::updateTempoMap() whenever
+ * the tempo markers, the song size, the song, or the audio driver
+ * changed and are shared via a SharedSlot so readers never see a
+ * partially built map and never have to lock.
+ *
+ * \ingroup docCore docAudioEngine
+ */
+class TempoMap : public H2Core::Object<TempoMap>
+{
+	H2_OBJECT(TempoMap)
+public:
+	/**
+	 * \param pSong Song providing the pattern group vector and the
+	 *   resolution.
+	 * \param pTimeline Timeline providing the tempo markers.
+	 * \param fSongSizeInTicks As stored in the #AudioEngine.
+	 * \param nSampleRate Sample rate of the audio driver.
+	 */
+	TempoMap( std::shared_ptr<Song> pSong,
+			  std::shared_ptr<Timeline> pTimeline,
+			  double fSongSizeInTicks, int nSampleRate );
+	~TempoMap();
+
+	/**
+	 * Whether the tempo markers do govern the conversion. This is
+	 * not the case if there is only the special tempo marker (see
+	 * Timeline::isFirstTempoMarkerSpecial()) or the song does not
+	 * contain any columns.
+	 */
+	bool hasTempoMarkers() const;
+
+	/**
+	 * Timeline counterpart of TransportPosition::computeFrameFromTick().
+	 *
+	 * @a nSampleRate may differ from the one the map was built
+	 * for. The frame offsets are rescaled in this case.
+	 */
+	long long computeFrameFromTick( double fTick, double* fTickMismatch,
+									int nSampleRate ) const;
+	/**
+	 * Timeline counterpart of TransportPosition::computeTickFromFrame().
+	 *
+	 * @a nSampleRate may differ from the one the map was built
+	 * for. The frame offsets are rescaled in this case.
+	 */
+	double computeTickFromFrame( long long nFrame, int nSampleRate ) const;
+
+	int getSampleRate() const;
+	int getResolution() const;
+	int getNumberOfSegments() const;
+
+	QString toQString( const QString& sPrefix = "", bool bShort = true ) const override;
+
+private:
+	double getTickSize( int nSegment, int nSampleRate ) const;
+
+	/** Tick at which each segment starts. The last element holds the
+	 * song size. */
+	std::vector<double> m_segmentStartTicks;
+	/** Frame at which each segment starts. The last element holds the
+	 * song size in frames. */
+	std::vector<double> m_segmentStartFrames;
+	std::vector<double> m_tickSizes;
+	std::vector<float> m_bpms;
+
+	/** Tick of the column of the first tempo marker. Used when
+	 * reproducing the context of a tick matching a multiple of the
+	 * song size. */
+	double m_fFirstMarkerTick;
+	double m_fSongSizeInTicks;
+	int m_nSampleRate;
+	int m_nResolution;
+	bool m_bHasTempoMarkers;
+};
+
+inline bool TempoMap::hasTempoMarkers() const {
+	return m_bHasTempoMarkers;
+}
+inline int TempoMap::getSampleRate() const {
+	return m_nSampleRate;
+}
+inline int TempoMap::getResolution() const {
+	return m_nResolution;
+}
+inline int TempoMap::getNumberOfSegments() const {
+	return m_bpms.size();
+}
+
+};
+
+#endif
@@ -21,6 +21,8 @@
  */
 #include <core/AudioEngine/TransportPosition.h>
 #include <core/AudioEngine/AudioEngine.h>
+#include <core/AudioEngine/RubberbandWorker.h>
+#include <core/AudioEngine/TempoMap.h>
 
 #include <core/Basics/Drumkit.h>
 #include <core/Basics/Pattern.h>
@@ -118,6 +120,15 @@ void TransportPosition::setBpm( float fNewBpm ) {
 
 	if ( Preferences::get_instance()->getRubberBandBatchMode() ) {
 		auto pHydrogen = Hydrogen::get_instance();
+		if ( ! pHydrogen->getIsExportSessionActive() ) {
+			// Stretching the samples takes a while and must not stall
+			// the audio thread.
+			pHydrogen->getRubberbandWorker()->request( getBpm() );
+			return;
+		}
+
+		// During export the samples must match the new tempo right
+		// away.
 		auto pSong = pHydrogen->getSong();
 		if ( pSong == nullptr ) {
 			return;
@@ -126,7 +137,6 @@ void TransportPosition::setBpm( float fNewBpm ) {
 		if ( pDrumkit == nullptr ) {
 			return;
 		}
-
 		pDrumkit->recalculateRubberband( getBpm() );
 	}
 }
@@ -244,8 +254,6 @@ long long TransportPosition::computeFrameFromTick( const double fTick, double* f
 		nSampleRate = pAudioDriver->getSampleRate();
 	}
 	const int nResolution = pSong->getResolution();
-	const double fSongSizeInTicks = pAudioEngine->getSongSizeInTicks();
-	
 	if ( nSampleRate == 0 || nResolution == 0 ) {
 		ERRORLOG( "Not properly initialized yet" );
 		*fTickMismatch = 0;
@@ -257,193 +265,19 @@ long long TransportPosition::computeFrameFromTick( const double fTick, double* f
 		return 0;
 	}
 		
-	const auto tempoMarkers = pTimeline->getAllTempoMarkers();
+	// The map takes care of treating song mode like pattern mode in
+	// case there are no patterns in the current song.
+	std::shared_ptr<const TempoMap> pTempoMap = nullptr;
+	if ( pHydrogen->isTimelineEnabled() &&
+		 pHydrogen->getMode() == Song::Mode::Song ) {
+		pTempoMap = pAudioEngine->getTempoMap();
+	}
 
-	// If there are no patterns in the current, we treat song mode
-	// like pattern mode.
 	long long nNewFrame = 0;
-	if ( pHydrogen->isTimelineEnabled() &&
-		 ! ( tempoMarkers.size() == 1 &&
-			 pTimeline->isFirstTempoMarkerSpecial() ) &&
-		 pHydrogen->getMode() == Song::Mode::Song &&
-		 pSong->getPatternGroupVector()->size() > 0 )  {
-
-		double fNewTick = fTick;
-		double fRemainingTicks = fTick;
-		double fNextTick, fPassedTicks = 0;
-		double fNextTickSize;
-		double fNewFrame = 0;
-		int ii;
-
-		const int nColumns = pSong->getPatternGroupVector()->size();
-		
-		auto handleEnd = [&]() {
-			// The next frame is within this segment.
-			fNewFrame += fRemainingTicks * fNextTickSize;
-
-			nNewFrame = static_cast<long long>( std::round( fNewFrame ) );
-
-			// Keep track of the rounding error to be able to switch
-			// between fTick and its frame counterpart later on.  In
-			// case fTick is located close to a tempo marker we will
-			// only cover the part up to the tempo marker in here as
-			// only this region is governed by fNextTickSize.
-			const double fRoundingErrorInTicks =
-				( fNewFrame - static_cast<double>( nNewFrame ) ) /
-				fNextTickSize;
-
-			// Compares the negative distance between current position
-			// (fNewFrame) and the one resulting from rounding -
-			// fRoundingErrorInTicks - with the negative distance
-			// between current position (fNewFrame) and location of
-			// next tempo marker.
-			if ( fRoundingErrorInTicks >
-				 fPassedTicks + fRemainingTicks - fNextTick ) {
-				// Whole mismatch located within the current tempo
-				// interval.
-				*fTickMismatch = fRoundingErrorInTicks;
-						
-			}
-			else {
-				// Mismatch at this side of the tempo marker.
-				*fTickMismatch = fPassedTicks + fRemainingTicks - fNextTick;
-
-				const double fFinalFrame = fNewFrame +
-					( fNextTick - fPassedTicks - fRemainingTicks ) * fNextTickSize;
-
-				// Mismatch located beyond the tempo marker.
-				double fFinalTickSize;
-				if ( ii < tempoMarkers.size() ) {
-					fFinalTickSize = AudioEngine::computeDoubleTickSize(
-						nSampleRate, tempoMarkers[ ii ]->fBpm, nResolution );
-				}
-				else {
-					fFinalTickSize = AudioEngine::computeDoubleTickSize(
-						nSampleRate, tempoMarkers[ 0 ]->fBpm, nResolution );
-				}
-
-				// DEBUGLOG( QString( "[::computeFrameFromTick mismatch : 2] fTickMismatch: [%1 + %2], static_cast<double>(nNewFrame): %3, fNewFrame: %4, fFinalFrame: %5, fNextTickSize: %6, fPassedTicks: %7, fRemainingTicks: %8, fFinalTickSize: %9" )
-				// 		  .arg( fPassedTicks + fRemainingTicks - fNextTick )
-				// 		  .arg( ( fFinalFrame - static_cast<double>(nNewFrame) ) / fNextTickSize )
-				// 		  .arg( nNewFrame )
-				// 		  .arg( fNewFrame, 0, 'f' )
-				// 		  .arg( fFinalFrame, 0, 'f' )
-				// 		  .arg( fNextTickSize, 0, 'f' )
-				// 		  .arg( fPassedTicks, 0, 'f' )
-				// 		  .arg( fRemainingTicks, 0, 'f' )
-				// 		  .arg( fFinalTickSize, 0, 'f' ));
-						
-				*fTickMismatch += ( fFinalFrame - static_cast<double>(nNewFrame) ) /
-					fFinalTickSize;
-			}
-
-			// DEBUGLOG( QString( "[::computeFrameFromTick end] fTick: %1, fNewFrame: %2, fNextTick: %3, fRemainingTicks: %4, fPassedTicks: %5, fNextTickSize: %6, tempoMarkers[ ii - 1 ]->nColumn: %7, tempoMarkers[ ii - 1 ]->fBpm: %8, nNewFrame: %9, fTickMismatch: %10, frame increment (fRemainingTicks * fNextTickSize): %11, fRoundingErrorInTicks: %12" )
-			// 		  .arg( fTick, 0, 'f' )
-			// 		  .arg( fNewFrame, 0, 'g', 30 )
-			// 		  .arg( fNextTick, 0, 'f' )
-			// 		  .arg( fRemainingTicks, 0, 'f' )
-			// 		  .arg( fPassedTicks, 0, 'f' )
-			// 		  .arg( fNextTickSize, 0, 'f' )
-			// 		  .arg( tempoMarkers[ ii - 1 ]->nColumn )
-			// 		  .arg( tempoMarkers[ ii - 1 ]->fBpm )
-			// 		  .arg( nNewFrame )
-			// 		  .arg( *fTickMismatch, 0, 'g', 30 )
-			// 		  .arg( fRemainingTicks * fNextTickSize, 0, 'g', 30 )
-			// 		  .arg( fRoundingErrorInTicks, 0, 'f' )
-			// 	);
-
-			fRemainingTicks -= fNewTick - fPassedTicks;
-		};
-
-		while ( fRemainingTicks > 0 ) {
-		
-			for ( ii = 1; ii <= tempoMarkers.size(); ++ii ) {
-				if ( ii == tempoMarkers.size() ||
-					 tempoMarkers[ ii ]->nColumn >= nColumns ) {
-					fNextTick = fSongSizeInTicks;
-				} else {
-					fNextTick =
-						static_cast<double>(pHydrogen->getTickForColumn( tempoMarkers[ ii ]->nColumn ) );
-				}
-
-				fNextTickSize =
-					AudioEngine::computeDoubleTickSize( nSampleRate,
-														tempoMarkers[ ii - 1 ]->fBpm,
-														nResolution );
-				
-				if ( fRemainingTicks > ( fNextTick - fPassedTicks ) ) {
-					// The whole segment of the timeline covered by tempo
-					// marker ii is left of the current transport position.
-					fNewFrame += ( fNextTick - fPassedTicks ) * fNextTickSize;
-
-					// DEBUGLOG( QString( "[segment] fTick: %1, fNewFrame: %2, fNextTick: %3, fRemainingTicks: %4, fPassedTicks: %5, fNextTickSize: %6, tempoMarkers[ ii - 1 ]->nColumn: %7, tempoMarkers[ ii - 1 ]->fBpm: %8, tick increment (fNextTick - fPassedTicks): %9, frame increment (fRemainingTicks * fNextTickSize): %10" )
-					// 		  .arg( fTick, 0, 'f' )
-					// 		  .arg( fNewFrame, 0, 'g', 30 )
-					// 		  .arg( fNextTick, 0, 'f' )
-					// 		  .arg( fRemainingTicks, 0, 'f' )
-					// 		  .arg( fPassedTicks, 0, 'f' )
-					// 		  .arg( fNextTickSize, 0, 'f' )
-					// 		  .arg( tempoMarkers[ ii - 1 ]->nColumn )
-					// 		  .arg( tempoMarkers[ ii - 1 ]->fBpm )
-					// 		  .arg( fNextTick - fPassedTicks, 0, 'f' )
-					// 		  .arg( ( fNextTick - fPassedTicks ) * fNextTickSize, 0, 'g', 30 )
-					// 		  );
-					
-					fRemainingTicks -= fNextTick - fPassedTicks;
-					
-					fPassedTicks = fNextTick;
-
-				}
-				else {
-					handleEnd();
-					break;
-				}
-			}
-
-			if ( fRemainingTicks > 0 ) {
-				// The provided fTick is larger than the song. But,
-				// luckily, we just calculated the song length in
-				// frames (fNewFrame).
-				const int nRepetitions = std::floor(fTick / fSongSizeInTicks);
-				const double fSongSizeInFrames = fNewFrame;
-				
-				fNewFrame *= static_cast<double>(nRepetitions);
-				fNewTick = std::fmod( fTick, fSongSizeInTicks );
-				fRemainingTicks = fNewTick;
-				fPassedTicks = 0;
-
-				// DEBUGLOG( QString( "[repeat] fTick: %1, fNewFrames: %2, fNewTick: %3, fRemainingTicks: %4, nRepetitions: %5, fSongSizeInTicks: %6, fSongSizeInFrames: %7" )
-				// 		  .arg( fTick, 0, 'g',30 )
-				// 		  .arg( fNewFrame, 0, 'g', 30 )
-				// 		  .arg( fNewTick, 0, 'g', 30 )
-				// 		  .arg( fRemainingTicks, 0, 'g', 30 )
-				// 		  .arg( nRepetitions )
-				// 		  .arg( fSongSizeInTicks, 0, 'g', 30 )
-				// 		  .arg( fSongSizeInFrames, 0, 'g', 30 )
-				// 		  );
-
-				if ( std::isinf( fNewFrame ) ||
-					 static_cast<long long>(fNewFrame) >
-					 std::numeric_limits<long long>::max() ) {
-					ERRORLOG( QString( "Provided ticks [%1] are too large." ).arg( fTick ) );
-					return 0;
-				}
-
-				// The target tick matches a multiple of the song
-				// size. We need to reproduce the context within the
-				// last tempo marker in order to get the mismatch
-				// right.
-				if ( fRemainingTicks == 0 ) {
-					ii = tempoMarkers.size();
-					fNextTick = static_cast<double>(pHydrogen->getTickForColumn(
-														tempoMarkers[ 0 ]->nColumn ) );
-					fNextTickSize = AudioEngine::computeDoubleTickSize(
-						nSampleRate, tempoMarkers[ ii - 1 ]->fBpm, nResolution );
-
-					handleEnd();
-				}
-			}
-		}
+	if ( pTempoMap != nullptr && pTempoMap->hasTempoMarkers() ) {
+
+		nNewFrame = pTempoMap->computeFrameFromTick( fTick, fTickMismatch,
+													 nSampleRate );
 	} else {
 
 		// As the timeline is not activate, the column passed is of no
@@ -501,8 +335,6 @@ double TransportPosition::computeTickFromFrame( const long long nFrame, int nSam
 	const int nResolution = pSong->getResolution();
 	double fTick = 0;
 
-	const double fSongSizeInTicks = pAudioEngine->getSongSizeInTicks();
-	
 	if ( nSampleRate == 0 || nResolution == 0 ) {
 		ERRORLOG( "Not properly initialized yet" );
 		return fTick;
@@ -512,126 +344,17 @@ double TransportPosition::computeTickFromFrame( const long long nFrame, int nSam
 		return fTick;
 	}
 		
-	const auto tempoMarkers = pTimeline->getAllTempoMarkers();
-	
-	// If there are no patterns in the current, we treat song mode
-	// like pattern mode.
+	// The map takes care of treating song mode like pattern mode in
+	// case there are no patterns in the current song.
+	std::shared_ptr<const TempoMap> pTempoMap = nullptr;
 	if ( pHydrogen->isTimelineEnabled() &&
-		 ! ( tempoMarkers.size() == 1 &&
-			 pTimeline->isFirstTempoMarkerSpecial() ) &&
-		 pHydrogen->getMode() == Song::Mode::Song &&
-		 pSong->getPatternGroupVector()->size() ) {
-
-		// We are using double precision in here to avoid rounding
-		// errors.
-		const double fTargetFrame = static_cast<double>(nFrame);
-		double fPassedFrames = 0;
-		double fNextFrame = 0;
-		double fNextTicks, fPassedTicks = 0;
-		double fNextTickSize;
-		long long nRemainingFrames;
-
-		const int nColumns = pSong->getPatternGroupVector()->size();
-
-		while ( fPassedFrames < fTargetFrame ) {
-		
-			for ( int ii = 1; ii <= tempoMarkers.size(); ++ii ) {
-
-				fNextTickSize =
-					AudioEngine::computeDoubleTickSize( nSampleRate,
-														tempoMarkers[ ii - 1 ]->fBpm,
-														nResolution );
-
-				if ( ii == tempoMarkers.size() ||
-					 tempoMarkers[ ii ]->nColumn >= nColumns ) {
-					fNextTicks = fSongSizeInTicks;
-				} else {
-					fNextTicks =
-						static_cast<double>(pHydrogen->getTickForColumn( tempoMarkers[ ii ]->nColumn ));
-				}
-				fNextFrame = (fNextTicks - fPassedTicks) * fNextTickSize;
-		
-				if ( fNextFrame < ( fTargetFrame -
-									 fPassedFrames ) ) {
-				   
-					// DEBUGLOG(QString( "[segment] nFrame: %1, fTick: %2, nSampleRate: %3, fNextTickSize: %4, fNextTicks: %5, fNextFrame: %6, tempoMarkers[ ii -1 ]->nColumn: %7, tempoMarkers[ ii -1 ]->fBpm: %8, fPassedTicks: %9, fPassedFrames: %10, fNewTick (tick increment): %11, fNewTick * fNextTickSize (frame increment): %12" )
-					// 		 .arg( nFrame )
-					// 		 .arg( fTick, 0, 'f' )
-					// 		 .arg( nSampleRate )
-					// 		 .arg( fNextTickSize, 0, 'f' )
-					// 		 .arg( fNextTicks, 0, 'f' )
-					// 		 .arg( fNextFrame, 0, 'f' )
-					// 		 .arg( tempoMarkers[ ii -1 ]->nColumn )
-					// 		 .arg( tempoMarkers[ ii -1 ]->fBpm )
-					// 		 .arg( fPassedTicks, 0, 'f' )
-					// 		 .arg( fPassedFrames, 0, 'f' )
-					// 		 .arg( fNextTicks - fPassedTicks, 0, 'f' )
-					// 		 .arg( (fNextTicks - fPassedTicks) * fNextTickSize, 0, 'g', 30 )
-					// 		 );
-					
-					// The whole segment of the timeline covered by tempo
-					// marker ii is left of the transport position.
-					fTick += fNextTicks - fPassedTicks;
-
-					fPassedFrames += fNextFrame;
-					fPassedTicks = fNextTicks;
-
-				} else {
-					// The target frame is located within a segment.
-					const double fNewTick = (fTargetFrame - fPassedFrames ) /
-						fNextTickSize;
-
-					fTick += fNewTick;
-					
-					// DEBUGLOG(QString( "[end] nFrame: %1, fTick: %2, nSampleRate: %3, fNextTickSize: %4, fNextTicks: %5, fNextFrame: %6, tempoMarkers[ ii -1 ]->nColumn: %7, tempoMarkers[ ii -1 ]->fBpm: %8, fPassedTicks: %9, fPassedFrames: %10, fNewTick (tick increment): %11, fNewTick * fNextTickSize (frame increment): %12" )
-					// 		 .arg( nFrame )
-					// 		 .arg( fTick, 0, 'f' )
-					// 		 .arg( nSampleRate )
-					// 		 .arg( fNextTickSize, 0, 'f' )
-					// 		 .arg( fNextTicks, 0, 'f' )
-					// 		 .arg( fNextFrame, 0, 'f' )
-					// 		 .arg( tempoMarkers[ ii -1 ]->nColumn )
-					// 		 .arg( tempoMarkers[ ii -1 ]->fBpm )
-					// 		 .arg( fPassedTicks, 0, 'f' )
-					// 		 .arg( fPassedFrames, 0, 'f' )
-					// 		 .arg( fNewTick, 0, 'f' )
-					// 		 .arg( fNewTick * fNextTickSize, 0, 'g', 30 )
-					// 		 );
-											
-					fPassedFrames = fTargetFrame;
-					
-					break;
-				}
-			}
-
-			if ( fPassedFrames != fTargetFrame ) {
-				// The provided nFrame is larger than the song. But,
-				// luckily, we just calculated the song length in
-				// frames.
-				const double fSongSizeInFrames = fPassedFrames;
-				const int nRepetitions = std::floor(fTargetFrame / fSongSizeInFrames);
-				if ( fSongSizeInTicks * nRepetitions >
-					 std::numeric_limits<double>::max() ) {
-					ERRORLOG( QString( "Provided frames [%1] are too large." ).arg( nFrame ) );
-					return 0;
-				}
-				fTick = fSongSizeInTicks * nRepetitions;
-
-				fPassedFrames = static_cast<double>(nRepetitions) *
-					fSongSizeInFrames;
-				fPassedTicks = 0;
-
-				// DEBUGLOG( QString( "[repeat] frames covered: %1, frames remaining: %2, ticks covered: %3,  nRepetitions: %4, fSongSizeInFrames: %5, fSongSizeInTicks: %6" )
-				// 		  .arg( fPassedFrames, 0, 'g', 30 )
-				// 		  .arg( fTargetFrame - fPassedFrames, 0, 'g', 30 )
-				// 		  .arg( fTick, 0, 'g', 30 )
-				// 		  .arg( nRepetitions )
-				// 		  .arg( fSongSizeInFrames, 0, 'g', 30 )
-				// 		  .arg( fSongSizeInTicks, 0, 'g', 30 )
-				// 		  );
-				
-			}
-		}
+		 pHydrogen->getMode() == Song::Mode::Song ) {
+		pTempoMap = pAudioEngine->getTempoMap();
+	}
+
+	if ( pTempoMap != nullptr && pTempoMap->hasTempoMarkers() ) {
+
+		fTick = pTempoMap->computeTickFromFrame( nFrame, nSampleRate );
 	}
 	else {
 		// As the timeline is not activate, the column passed is of no
@@ -105,6 +105,8 @@ public:
 	 * passed tempo markers into account in order to determine the
 	 * number of frames passed when letting the #AudioEngine roll for
 	 * @a fTick ticks.
+	 * The lookup itself is done using the #TempoMap provided by
+	 * AudioEngine::getTempoMap().
 	 *
 	 * It depends on the sample rate @a nSampleRate and assumes that
 	 * it as well as the resolution to be constant over the whole
@@ -22,6 +22,8 @@
 
 #include <core/Basics/Adsr.h>
 
+#include <algorithm>
+
 namespace H2Core
 {
 
@@ -295,6 +297,21 @@ float ADSR::release()
 	return m_fReleaseValue;
 }
 
+void ADSR::fadeOut( unsigned int nFrames )
+{
+	if ( m_state == State::Idle ) {
+		return;
+	}
+
+	// Bypasses normalise() on purpose. The limits in there only apply
+	// to envelopes set by the user.
+	m_nRelease = std::max( nFrames, static_cast<unsigned int>(1) );
+	m_fReleaseValue = m_fValue;
+	m_state = State::Release;
+	m_fFramesInState = 0;
+	m_fQ = fDecayInit;
+}
+
 QString ADSR::StateToQString( const State& state ) {
 	switch( state ) {
 	case State::Attack:
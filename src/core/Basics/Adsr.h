@@ -75,6 +75,15 @@ class ADSR : public Object<ADSR>
 		 * State setting is only applied if the ADSR is not in #State::Idle.
 		 * */
 		float release();
+		/**
+		 * Enters #State::Release from the current #m_fValue and
+		 * brings the envelope down to zero within @a nFrames frames
+		 * regardless of #m_nRelease.
+		 *
+		 * Used by the #Sampler to silence stolen voices without
+		 * clicks. Has no effect in #State::Idle.
+		 */
+		void fadeOut( unsigned int nFrames );
 
 		/**
 		 * Compute and apply successive ADSR values to stereo buffers.
@@ -117,6 +126,9 @@ class ADSR : public Object<ADSR>
 	static QString StateToQString( const State& state );
 
 		const State& getState() const;
+		/** Envelope value reached in the most recently rendered
+		 * frame. */
+		float getValue() const;
 
 		/** Formatted string version for debugging purposes.
 		 * \param sPrefix String prefix which will be added in front of
@@ -198,6 +210,9 @@ inline unsigned int ADSR::getRelease() const
 inline const ADSR::State& ADSR::getState() const {
 	return m_state;
 }
+inline float ADSR::getValue() const {
+	return m_fValue;
+}
 
 };
 
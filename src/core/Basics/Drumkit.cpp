@@ -35,6 +35,8 @@
 #endif
 
 #include <core/Basics/Sample.h>
+#include <core/Basics/SampleCache.h>
+#include <core/Basics/SampleRegistry.h>
 #include <core/Basics/DrumkitComponent.h>
 #include <core/Basics/DrumkitMap.h>
 #include <core/Basics/Instrument.h>
@@ -45,12 +47,15 @@
 #include <core/Helpers/Filesystem.h>
 #include <core/Helpers/Xml.h>
 #include <core/Helpers/Legacy.h>
+#include <core/Helpers/ParallelFor.h>
 
 #include <core/Hydrogen.h>
 #include <core/Preferences/Preferences.h>
 #include <core/NsmClient.h>
 #include <core/SoundLibrary/SoundLibraryDatabase.h>
 
+#include <algorithm>
+
 namespace H2Core
 {
 
@@ -136,28 +141,28 @@ std::shared_ptr<Drumkit> Drumkit::load( const QString& sDrumkitPath, bool bUpgra
 
 	QString sDrumkitFile = Filesystem::drumkit_file( sDrumkitPath );
 	
-	bool bReadingSuccessful = true;
-	
-	XMLDoc doc;
-	if ( !doc.read( sDrumkitFile, Filesystem::drumkit_xsd_path(), true ) ) {
-		// Drumkit does not comply with the XSD schema
-		// definition. It's probably an old one. load_from() will try
-		// to handle it regardlessly but we should upgrade it in order
-		// to avoid this in future loads.
-		doc.read( sDrumkitFile, nullptr, bSilent );
-		
-		bReadingSuccessful = false;
-	}
-	
-	XMLNode root = doc.firstChildElement( "drumkit_info" );
-	if ( root.isNull() ) {
+	// Drumkits not complying with the XSD schema definition are
+	// probably old ones. loadFrom() will try to handle them
+	// regardlessly but we should upgrade them in order to avoid this
+	// in future loads.
+	const bool bReadingSuccessful =
+		XMLDoc::validate( sDrumkitFile, Filesystem::drumkit_xsd_path(), true );
+
+	XMLStreamReader reader;
+	if ( ! reader.open( sDrumkitFile, bSilent ) ||
+		 reader.name() != "drumkit_info" ) {
 		ERRORLOG( "drumkit_info node not found" );
 		return nullptr;
 	}
 
 	auto pDrumkit =
-		Drumkit::loadFrom( root, sDrumkitFile.left( sDrumkitFile.lastIndexOf( "/" ) ),
+		Drumkit::loadFrom( reader, sDrumkitFile.left( sDrumkitFile.lastIndexOf( "/" ) ),
 						   "", false, bSilent );
+	if ( reader.hasError() ) {
+		ERRORLOG( QString( "Unable to read XML document [%1]: %2" )
+				  .arg( sDrumkitFile ).arg( reader.errorString() ) );
+		return nullptr;
+	}
 	
 	if ( pDrumkit == nullptr ) {
 		ERRORLOG( QString( "Unable to load drumkit [%1]" ).arg( sDrumkitFile ) );
@@ -207,6 +212,72 @@ std::shared_ptr<Drumkit> Drumkit::loadFrom( const XMLNode& node,
 											const QString& sSongPath,
 											bool bSongKit,
 											bool bSilent )
+{
+	auto pDrumkit = loadPropertiesFrom( node, sDrumkitPath, bSilent );
+	if ( pDrumkit == nullptr ) {
+		return nullptr;
+	}
+
+	auto pInstrumentList = InstrumentList::load_from(
+		node, sDrumkitPath, pDrumkit->m_sName, sSongPath,
+		pDrumkit->m_license, bSongKit, false );
+	pDrumkit->setLoadedInstruments( pInstrumentList, bSongKit );
+
+	return pDrumkit;
+
+}
+
+std::shared_ptr<Drumkit> Drumkit::loadFrom( XMLStreamReader& reader,
+											const QString& sDrumkitPath,
+											const QString& sSongPath,
+											bool bSongKit,
+											bool bSilent )
+{
+	// All elements except of the instruments are small. They are
+	// gathered in a DOM in order to share their parsing with the
+	// XMLNode version.
+	XMLDoc doc;
+	XMLNode node = reader.createRoot( doc );
+
+	std::shared_ptr<Drumkit> pDrumkit = nullptr;
+	std::shared_ptr<InstrumentList> pInstrumentList = nullptr;
+	bool bInstrumentListRead = false;
+	while ( reader.readNextChild() ) {
+		if ( reader.name() == "instrumentList" && ! bInstrumentListRead ) {
+			bInstrumentListRead = true;
+			// Instruments require the name and license of the
+			// kit. Hydrogen writes both in front of them.
+			pDrumkit = loadPropertiesFrom( node, sDrumkitPath, bSilent );
+			if ( pDrumkit != nullptr ) {
+				pInstrumentList = InstrumentList::load_from(
+					reader, sDrumkitPath, pDrumkit->m_sName, sSongPath,
+					pDrumkit->m_license, bSongKit, false );
+			}
+			else {
+				reader.skip();
+			}
+		}
+		else {
+			reader.readSubtree( node );
+		}
+	}
+
+	if ( ! bInstrumentListRead ) {
+		// Legacy handling and error reporting are done in there.
+		return loadFrom( node, sDrumkitPath, sSongPath, bSongKit, bSilent );
+	}
+	else if ( pDrumkit == nullptr ) {
+		return nullptr;
+	}
+
+	pDrumkit->setLoadedInstruments( pInstrumentList, bSongKit );
+
+	return pDrumkit;
+}
+
+std::shared_ptr<Drumkit> Drumkit::loadPropertiesFrom( const XMLNode& node,
+													  const QString& sDrumkitPath,
+													  bool bSilent )
 {
 	QString sDrumkitName = node.read_string( "name", "", false, false, bSilent );
 	if ( sDrumkitName.isEmpty() ) {
@@ -255,34 +326,49 @@ std::shared_ptr<Drumkit> Drumkit::loadFrom( const XMLNode& node,
 		pDrumkit->getComponents()->push_back(pDrumkitComponent);
 	}
 
-	auto pInstrumentList = InstrumentList::load_from(
-		node, sDrumkitPath, sDrumkitName, sSongPath, license, bSongKit, false );
+	return pDrumkit;
+}
+
+void Drumkit::setLoadedInstruments( std::shared_ptr<InstrumentList> pInstrumentList,
+									bool bSongKit )
+{
 	// Required to assure backward compatibility.
 	if ( pInstrumentList == nullptr ) {
 		WARNINGLOG( "instrument list could not be loaded. Using empty one." );
 		pInstrumentList = std::make_shared<InstrumentList>();
 	}
 		
-	pDrumkit->setInstruments( pInstrumentList );
+	setInstruments( pInstrumentList );
 
 	if ( ! bSongKit ) {
 		// Instead of making the *::load_from() functions more complex by
 		// passing the license down to each sample, we will make the
 		// drumkit assign its license to each sample in here.
-		pDrumkit->propagateLicense();
+		propagateLicense();
 	}
-
-	return pDrumkit;
-
 }
 
-void Drumkit::loadSamples( float fBpm )
+bool Drumkit::loadSamples( float fBpm, std::function<bool()> isCancelled )
 {
 	INFOLOG( QString( "Loading drumkit %1 instrument samples" ).arg( m_sName ) );
 	if( !m_bSamplesLoaded ) {
-		m_pInstruments->load_samples( fBpm );
+		if ( ! m_pInstruments->load_samples( fBpm, isCancelled ) ) {
+			return false;
+		}
 		m_bSamplesLoaded = true;
+
+		pruneSampleCaches();
+	}
+
+	return true;
+}
+
+void Drumkit::pruneSampleCaches()
+{
+	if ( SampleCache::isEnabled() ) {
+		SampleCache::prune();
 	}
+	SampleRegistry::prune();
 }
 
 void Drumkit::upgrade( bool bSilent ) {
@@ -1438,43 +1524,69 @@ void Drumkit::recalculateRubberband( float fBpm ) {
 		return;
 	}
 
-	if ( m_pInstruments != nullptr ) {
-		for ( unsigned nnInstr = 0; nnInstr < m_pInstruments->size(); ++nnInstr ) {
-			auto pInstr = m_pInstruments->get( nnInstr );
-			if ( pInstr == nullptr ) {
-				continue;
-			}
-			if ( pInstr != nullptr ){
-				for ( int nnComponent = 0; nnComponent < pInstr->get_components()->size();
-					  ++nnComponent ) {
-					auto pInstrumentComponent = pInstr->get_component( nnComponent );
-					if ( pInstrumentComponent == nullptr ) {
-						continue; // regular case when you have a new component empty
-					}
+	if ( m_pInstruments == nullptr ) {
+		ERRORLOG( "No InstrumentList present" );
+		return;
+	}
 
-					for ( int nnLayer = 0; nnLayer < InstrumentComponent::getMaxLayers(); nnLayer++ ) {
-						auto pLayer = pInstrumentComponent->get_layer( nnLayer );
-						if ( pLayer != nullptr ) {
-							auto pSample = pLayer->get_sample();
-							if ( pSample != nullptr ) {
-								if( pSample->get_rubberband().use ) {
-									auto pNewSample = std::make_shared<Sample>( pSample );
+	swapStretchedSamples( stretchSamples( fBpm, nullptr ) );
 
-									if ( ! pNewSample->load( fBpm ) ){
-										continue;
-									}
+	// The samples replaced are unused now. Pruning the sample cache
+	// involves disk access and is left to the next call of
+	// pruneSampleCaches() outside of the #AudioEngine lock.
+	SampleRegistry::prune();
+}
 
-									// insert new sample from newInstrument
-									pLayer->set_sample( pNewSample );
-								}
-							}
-						}
-					}
+std::vector<Drumkit::StretchedSample> Drumkit::stretchSamples(
+	float fBpm, std::function<bool()> isCancelled ) const {
+
+	std::vector<StretchedSample> samples;
+	for ( const auto& pInstrument : *m_pInstruments ) {
+		if ( pInstrument == nullptr ) {
+			continue;
+		}
+		for ( const auto& pComponent : *pInstrument->get_components() ) {
+			if ( pComponent == nullptr ) {
+				continue; // regular case when you have a new component empty
+			}
+			for ( int nnLayer = 0; nnLayer < InstrumentComponent::getMaxLayers();
+				  ++nnLayer ) {
+				auto pLayer = pComponent->get_layer( nnLayer );
+				if ( pLayer == nullptr ) {
+					continue;
+				}
+				auto pSample = pLayer->get_sample();
+				if ( pSample != nullptr && pSample->get_rubberband().use ) {
+					samples.push_back( { pLayer, pSample, nullptr } );
 				}
 			}
 		}
-	} else {
-		ERRORLOG( "No InstrumentList present" );
+	}
+	if ( samples.empty() ) {
+		return samples;
+	}
+
+	const bool bStretched = parallelFor( samples.size(), [&]( int nSample ) {
+		auto pNewSample = std::make_shared<Sample>( samples[ nSample ].pOldSample );
+		if ( pNewSample->load( fBpm ) ) {
+			samples[ nSample ].pNewSample = pNewSample;
+		}
+	}, isCancelled );
+
+	if ( ! bStretched ) {
+		return std::vector<StretchedSample>();
+	}
+
+	return samples;
+}
+
+void Drumkit::swapStretchedSamples( const std::vector<StretchedSample>& samples ) {
+	for ( const auto& sample : samples ) {
+		// Samples replaced by the user in the meantime are kept.
+		if ( sample.pNewSample != nullptr &&
+			 sample.pLayer->get_sample() == sample.pOldSample ) {
+			sample.pLayer->set_sample( sample.pNewSample );
+		}
 	}
 }
 
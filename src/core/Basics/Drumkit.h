@@ -23,8 +23,11 @@
 #ifndef H2C_DRUMKIT_H
 #define H2C_DRUMKIT_H
 
+#include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
+#include <vector>
 
 #include <core/Object.h>
 #include <core/License.h>
@@ -35,8 +38,12 @@ namespace H2Core
 
 class XMLDoc;
 class XMLNode;
+class XMLStreamReader;
 class DrumkitComponent;
 class DrumkitMap;
+class InstrumentLayer;
+class RubberbandWorker;
+class Sample;
 
 /**
  * Drumkit info
@@ -128,6 +135,16 @@ class Drumkit : public H2Core::Object<Drumkit>
 												  const QString& sSongPath,
 												  bool bSongKit = false,
 												  bool bSilent = false );
+		/**
+		 * load a drumkit from an XMLStreamReader located at a
+		 * drumkit_info element. Instruments are read one at a time.
+		 * See loadFrom() for a description of the remaining arguments.
+		 */
+		static std::shared_ptr<Drumkit> loadFrom( XMLStreamReader& reader,
+												  const QString& sPath,
+												  const QString& sSongPath,
+												  bool bSongKit = false,
+												  bool bSilent = false );
 
 		/*
 		 * save the drumkit within the given XMLNode
@@ -175,8 +192,18 @@ class Drumkit : public H2Core::Object<Drumkit>
 
 		/** Calls the InstrumentList::load_samples() member
 		 * function of #m_pInstruments.
+		 *
+		 * \param fBpm Tempo used for Rubberband.
+		 * \param isCancelled Optional callback allowing to abort this
+		 *   particular call without affecting other ones. Samples
+		 *   already loaded will be kept but the kit is not marked as
+		 *   loaded.
+		 *
+		 * \return false in case loading was cancelled using
+		 *   @a isCancelled.
 		 */
-		void loadSamples( float fBpm = 120 );
+		bool loadSamples( float fBpm = 120,
+						  std::function<bool()> isCancelled = nullptr );
 		/** Calls the InstrumentList::unload_samples() member
 		 * function of #m_pInstruments.
 		 */
@@ -327,10 +354,26 @@ class Drumkit : public H2Core::Object<Drumkit>
 		/** Recalculates all Samples using RubberBand for a specific
 		* tempo @a fBpm.
 		*
+		* All samples are stretched in parallel. Since the results
+		* are shared via SampleRegistry, only tempi not encountered
+		* before require actual stretching.
+		*
 		* This function requires the calling function to lock the
-		* #AudioEngine first.
+		* #AudioEngine first. Use RubberbandWorker::request() to
+		* stretch the samples of the current kit in the background
+		* instead.
+		*
+		* \param fBpm Target tempo.
 		*/
 		void recalculateRubberband( float fBpm );
+		/**
+		 * Drops the least recently used entries of SampleRegistry and
+		 * - if enabled - SampleCache exceeding their size limits.
+		 *
+		 * Must not be called while holding the #AudioEngine lock
+		 * since it accesses the disk.
+		 */
+		static void pruneSampleCaches();
 
 
 		/** Formatted string version for debugging purposes.
@@ -344,6 +387,8 @@ class Drumkit : public H2Core::Object<Drumkit>
 		QString toQString( const QString& sPrefix = "", bool bShort = true ) const override;
 
 	private:
+		friend class RubberbandWorker;
+
 		QString m_sPath;					///< absolute drumkit path
 		QString m_sName;					///< drumkit name
 		QString m_sAuthor;				///< drumkit author
@@ -356,6 +401,24 @@ class Drumkit : public H2Core::Object<Drumkit>
 		Type m_type;
 
 		bool m_bSamplesLoaded;			///< true if the instrument samples are loaded
+
+		/** Sample stretched by recalculateRubberband() and the one it
+		 * replaces in #pLayer. */
+		struct StretchedSample {
+			std::shared_ptr<InstrumentLayer> pLayer;
+			std::shared_ptr<Sample> pOldSample;
+			std::shared_ptr<Sample> pNewSample;
+		};
+		/** Stretches all samples using RubberBand to @a fBpm.
+		 *
+		 * \return empty vector in case @a isCancelled returned
+		 *   true. */
+		std::vector<StretchedSample> stretchSamples(
+			float fBpm, std::function<bool()> isCancelled ) const;
+		/** Swaps in all samples returned by stretchSamples() not
+		 * altered in the meantime. */
+		static void swapStretchedSamples(
+			const std::vector<StretchedSample>& samples );
 		std::shared_ptr<InstrumentList> m_pInstruments;  ///< the list of instruments
 	std::shared_ptr<std::vector<std::shared_ptr<DrumkitComponent>>> m_pComponents;  ///< list of drumkit component
 
@@ -424,6 +487,22 @@ class Drumkit : public H2Core::Object<Drumkit>
 	 */
 	void propagateLicense();
 
+		/**
+		 * Reads all properties of a drumkit except of its instruments.
+		 *
+		 * \return nullptr in case the kit has no name.
+		 */
+		static std::shared_ptr<Drumkit> loadPropertiesFrom( const XMLNode& node,
+															const QString& sDrumkitPath,
+															bool bSilent );
+		/**
+		 * Assigns the instruments loaded for the kit. If @a
+		 * pInstrumentList is nullptr, an empty list will be used
+		 * instead.
+		 */
+		void setLoadedInstruments( std::shared_ptr<InstrumentList> pInstrumentList,
+								   bool bSongKit );
+
 		int findUnusedComponentId() const;
 
 };
@@ -70,6 +70,10 @@ Instrument::Instrument( const int id, const QString& name, std::shared_ptr<ADSR>
 	, __hihat_grp( -1 )
 	, __lower_cc( 0 )
 	, __higher_cc( 127 )
+	, m_nMaxVoices( 0 )
+	, m_pOldestVoice( nullptr )
+	, m_pNewestVoice( nullptr )
+	, m_nVoices( 0 )
 	, __components( nullptr )
 	, __is_preview_instrument(false)
 	, __is_metronome_instrument(false)
@@ -121,6 +125,10 @@ Instrument::Instrument( std::shared_ptr<Instrument> other )
 	, __hihat_grp( other->get_hihat_grp() )
 	, __lower_cc( other->get_lower_cc() )
 	, __higher_cc( other->get_higher_cc() )
+	, m_nMaxVoices( other->get_max_voices() )
+	, m_pOldestVoice( nullptr )
+	, m_pNewestVoice( nullptr )
+	, m_nVoices( 0 )
 	, __components( nullptr )
 	, __is_preview_instrument(false)
 	, __is_metronome_instrument(false)
@@ -346,6 +354,8 @@ std::shared_ptr<Instrument> Instrument::load_from( const XMLNode& node,
 											   true, true, bSilent ) );
 	pInstrument->set_higher_cc( node.read_int( "higher_cc", 127,
 												true, true, bSilent ) );
+	pInstrument->set_max_voices( node.read_int( "maxVoices", 0,
+												 true, true, bSilent ) );
 
 	for ( int i=0; i<MAX_FX; i++ ) {
 		pInstrument->set_fx_level( node.read_float( QString( "FX%1Level" ).arg( i+1 ), 0.0,
@@ -537,6 +547,11 @@ void Instrument::save_to( XMLNode& node,
 	InstrumentNode.write_int( "isHihat", __hihat_grp );
 	InstrumentNode.write_int( "lower_cc", __lower_cc );
 	InstrumentNode.write_int( "higher_cc", __higher_cc );
+	if ( m_nMaxVoices > 0 ) {
+		// Only written when set to keep the files readable by older
+		// versions of Hydrogen.
+		InstrumentNode.write_int( "maxVoices", m_nMaxVoices );
+	}
 
 	for ( int i=0; i<MAX_FX; i++ ) {
 		InstrumentNode.write_float( QString( "FX%1Level" )
@@ -625,6 +640,7 @@ QString Instrument::toQString( const QString& sPrefix, bool bShort ) const {
 			.append( QString( "%1%2hihat_grp: %3\n" ).arg( sPrefix ).arg( s ).arg( __hihat_grp ) )
 			.append( QString( "%1%2lower_cc: %3\n" ).arg( sPrefix ).arg( s ).arg( __lower_cc ) )
 			.append( QString( "%1%2higher_cc: %3\n" ).arg( sPrefix ).arg( s ).arg( __higher_cc ) )
+			.append( QString( "%1%2max_voices: %3\n" ).arg( sPrefix ).arg( s ).arg( m_nMaxVoices ) )
 			.append( QString( "%1%2is_preview_instrument: %3\n" ).arg( sPrefix ).arg( s ).arg( __is_preview_instrument ) )
 			.append( QString( "%1%2is_metronome_instrument: %3\n" ).arg( sPrefix ).arg( s ).arg( __is_metronome_instrument ) )
 			.append( QString( "%1%2apply_velocity: %3\n" ).arg( sPrefix ).arg( s ).arg( __apply_velocity ) )
@@ -671,6 +687,7 @@ QString Instrument::toQString( const QString& sPrefix, bool bShort ) const {
 			.append( QString( ", hihat_grp: %1" ).arg( __hihat_grp ) )
 			.append( QString( ", lower_cc: %1" ).arg( __lower_cc ) )
 			.append( QString( ", higher_cc: %1" ).arg( __higher_cc ) )
+			.append( QString( ", max_voices: %1" ).arg( m_nMaxVoices ) )
 			.append( QString( ", is_preview_instrument: %1" ).arg( __is_preview_instrument ) )
 			.append( QString( ", is_metronome_instrument: %1" ).arg( __is_metronome_instrument ) )
 			.append( QString( ", apply_velocity: %1" ).arg( __apply_velocity ) )
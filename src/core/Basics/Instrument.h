@@ -23,6 +23,7 @@
 #ifndef H2C_INSTRUMENT_H
 #define H2C_INSTRUMENT_H
 
+#include <algorithm>
 #include <cassert>
 #include <memory>
 
@@ -45,6 +46,7 @@ class Drumkit;
 class DrumkitComponent;
 class InstrumentLayer;
 class InstrumentComponent;
+class Note;
 
 
 /**
@@ -270,6 +272,11 @@ class Instrument : public H2Core::Object<Instrument>
 		void set_higher_cc( int message );
 		int get_higher_cc() const;
 
+		/** Set the maximum number of notes of the instrument rendered
+		 * at once. 0 means unlimited. */
+		void set_max_voices( int nMaxVoices );
+		int get_max_voices() const;
+
 		///< set the path of the related drumkit
 		void set_drumkit_path( const QString& sPath );
 		///< get the path of the related drumkits
@@ -313,6 +320,9 @@ class Instrument : public H2Core::Object<Instrument>
 		QString toQString( const QString& sPrefix = "", bool bShort = true ) const override;
 
 	private:
+		friend class Sampler;
+		friend class AudioEngineTests;
+
 	        /** Identifier of an instrument, which should be
 		    unique. It is set by set_id() and accessed via
 	        get_id().*/
@@ -366,6 +376,24 @@ class Instrument : public H2Core::Object<Instrument>
 		int						__hihat_grp;			///< the instrument is part of a hihat
 		int						__lower_cc;				///< lower cc level
 		int						__higher_cc;			///< higher cc level
+	/**
+	 * Maximum number of notes of this instrument rendered by the
+	 * #Sampler at once. Once reached, the oldest one is faded out in
+	 * favor of a new note. This keeps e.g. fast hi-hat rolls from
+	 * taking away all voices of the remaining instruments.
+	 *
+	 * 0 means unlimited.
+	 */
+		int						m_nMaxVoices;
+	/** Oldest and newest note of this instrument currently rendered
+	 * by the #Sampler and not stolen. The notes in between are linked
+	 * via Note::m_pNextInstrumentVoice. Only accessed by the
+	 * #Sampler. */
+		Note*					m_pOldestVoice;
+		Note*					m_pNewestVoice;
+	/** Number of notes linked in between #m_pOldestVoice and
+	 * #m_pNewestVoice. */
+		int						m_nVoices;
 		bool					__is_preview_instrument;		///< is the instrument an hydrogen preview instrument?
 		bool					__is_metronome_instrument;		///< is the instrument an metronome instrument?
 		std::shared_ptr<std::vector<std::shared_ptr<InstrumentComponent>>> __components;		///< InstrumentLayer array
@@ -664,6 +692,16 @@ inline int Instrument::get_higher_cc() const
 	return __higher_cc;
 }
 
+inline void Instrument::set_max_voices( int nMaxVoices )
+{
+	m_nMaxVoices = std::max( nMaxVoices, 0 );
+}
+
+inline int Instrument::get_max_voices() const
+{
+	return m_nMaxVoices;
+}
+
 inline void Instrument::set_drumkit_path( const QString& sPath )
 {
 	__drumkit_path = sPath;
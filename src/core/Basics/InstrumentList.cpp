@@ -28,10 +28,14 @@
 #include <core/Basics/Note.h>
 #include <core/Basics/Sample.h>
 
+#include <core/EventQueue.h>
+#include <core/Helpers/ParallelFor.h>
 #include <core/Helpers/Xml.h>
 #include <core/IO/MidiCommon.h>
 #include <core/License.h>
 
+#include <algorithm>
+#include <atomic>
 #include <set>
 
 namespace H2Core
@@ -54,11 +58,49 @@ InstrumentList::~InstrumentList()
 {
 }
 
-void InstrumentList::load_samples( float fBpm )
+bool InstrumentList::load_samples( float fBpm,
+								   std::function<bool()> isCancelled )
 {
-	for( int i=0; i<__instruments.size(); i++ ) {
-		__instruments[i]->load_samples( fBpm );
+	std::vector<std::shared_ptr<InstrumentLayer>> layers;
+	for ( const auto& pInstrument : __instruments ) {
+		for ( const auto& pComponent : *pInstrument->get_components() ) {
+			for ( int i = 0; i < InstrumentComponent::getMaxLayers(); i++ ) {
+				auto pLayer = pComponent->get_layer( i );
+				if ( pLayer != nullptr ) {
+					layers.push_back( pLayer );
+				}
+			}
+		}
+	}
+	if ( layers.size() == 0 ) {
+		return true;
+	}
+
+	auto pEventQueue = EventQueue::get_instance();
+	pEventQueue->push_event( EVENT_SAMPLE_LOADING_PROGRESS, 0 );
+
+	std::atomic<int> nLoadedLayers( 0 );
+	const int nLayers = layers.size();
+
+	const bool bLoaded = parallelFor( nLayers, [&]( int nLayer ) {
+		layers[ nLayer ]->load_sample( fBpm );
+
+		const int nLoaded = ++nLoadedLayers;
+		const int nPercent = nLoaded * 100 / nLayers;
+		if ( nPercent != ( nLoaded - 1 ) * 100 / nLayers ) {
+			pEventQueue->push_event( EVENT_SAMPLE_LOADING_PROGRESS,
+									 nPercent );
+		}
+	}, isCancelled );
+
+	if ( ! bLoaded ) {
+		INFOLOG( QString( "Loading samples cancelled after [%1/%2] samples" )
+				 .arg( nLoadedLayers ).arg( nLayers ) );
+		pEventQueue->push_event( EVENT_SAMPLE_LOADING_PROGRESS, -1 );
+		return false;
 	}
+
+	return true;
 }
 
 void InstrumentList::unload_samples()
@@ -117,6 +159,60 @@ std::shared_ptr<InstrumentList> InstrumentList::load_from(
 	return pInstrumentList;
 }
 
+std::shared_ptr<InstrumentList> InstrumentList::load_from(
+	XMLStreamReader& reader,
+	const QString& sDrumkitPath,
+	const QString& sDrumkitName,
+	const QString& sSongPath,
+	const License& license,
+	bool bSongKit,
+	bool bSilent )
+{
+	auto pInstrumentList = std::make_shared<InstrumentList>();
+	int nCount = 0;
+	while ( reader.readNextChild() ) {
+		if ( reader.name() != "instrument" ) {
+			reader.skip();
+			continue;
+		}
+
+		nCount++;
+		if ( nCount > MAX_INSTRUMENTS ) {
+			ERRORLOG( QString( "instrument nCount >= %1 (MAX_INSTRUMENTS), stop reading instruments" )
+					  .arg( MAX_INSTRUMENTS ) );
+			// Move to the end of the instrument list.
+			do {
+				reader.skip();
+			} while ( reader.readNextChild() );
+			break;
+		}
+
+		// Each instrument is converted into a DOM of its own which is
+		// discarded right after loading.
+		XMLDoc doc;
+		XMLNode docNode( doc );
+		XMLNode instrumentNode = reader.readSubtree( docNode );
+		auto pInstrument = Instrument::load_from(
+			instrumentNode, sDrumkitPath, sDrumkitName, sSongPath,
+			license, bSongKit, bSilent );
+		if ( pInstrument != nullptr ) {
+			( *pInstrumentList ) << pInstrument;
+		}
+		else {
+			ERRORLOG( QString( "Unable to load instrument [%1]. The drumkit is corrupted. Skipping instrument" )
+					  .arg( nCount ) );
+			nCount--;
+		}
+	}
+
+	if ( nCount == 0 ) {
+		ERRORLOG( "Newly created instrument list does not contain any instruments. Aborting." );
+		return nullptr;
+	}
+
+	return pInstrumentList;
+}
+
 void InstrumentList::save_to( XMLNode& node,
 							  int component_id,
 							  bool bRecentVersion,
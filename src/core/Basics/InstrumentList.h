@@ -23,6 +23,7 @@
 #ifndef H2C_INSTRUMENT_LIST_H
 #define H2C_INSTRUMENT_LIST_H
 
+#include <functional>
 #include <vector>
 #include <memory>
 #include <core/License.h>
@@ -32,6 +33,7 @@ namespace H2Core
 {
 
 class XMLNode;
+class XMLStreamReader;
 class Instrument;
 class DrumkitComponent;
 
@@ -161,10 +163,23 @@ class InstrumentList : public H2Core::Object<InstrumentList>
 		 */
 		void move( int idx_a, int idx_b );
 
-		/** Calls the Instrument::load_samples() member
-		 * function of all Instruments in #__instruments.
+		/**
+		 * Loads the samples of all layers of all Instruments in
+		 * #__instruments.
+		 *
+		 * The samples are decoded in parallel by a pool of worker
+		 * threads. Progress is reported in percent using
+		 * #H2Core::EVENT_SAMPLE_LOADING_PROGRESS.
+		 *
+		 * \param fBpm Tempo used for Rubberband.
+		 * \param isCancelled Optional callback checked before loading
+		 *   each sample. If it returns true, all samples not loaded yet
+		 *   are skipped.
+		 *
+		 * \return false in case loading was cancelled.
 		 */
-		void load_samples( float fBpm = 120 );
+		bool load_samples( float fBpm = 120,
+						   std::function<bool()> isCancelled = nullptr );
 		/** Calls the Instrument::unload_samples() member
 		 * function of all Instruments in #__instruments.
 		 */
@@ -217,6 +232,19 @@ class InstrumentList : public H2Core::Object<InstrumentList>
 													  const License& license = License(),
 													  bool bSongKit = false,
 													  bool bSilent = false );
+		/**
+		 * load an instrument list from an XMLStreamReader located at
+		 * an instrumentList element. Instruments are read one at a
+		 * time. See load_from() for a description of the remaining
+		 * arguments.
+		 */
+	static std::shared_ptr<InstrumentList> load_from( XMLStreamReader& reader,
+													  const QString& sDrumkitPath,
+													  const QString& sDrumkitName,
+													  const QString& sSongPath = "",
+													  const License& license = License(),
+													  bool bSongKit = false,
+													  bool bSilent = false );
 	/**
 	 * Returns vector of lists containing instrument name, component
 	 * name, file name, the license of all associated samples.
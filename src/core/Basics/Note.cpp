@@ -67,7 +67,14 @@ Note::Note( std::shared_ptr<Instrument> pInstrument, int nPosition, float fVeloc
 	  __just_recorded( false ),
 	  __probability( 1.0f ),
 	  m_nNoteStart( 0 ),
-	  m_fUsedTickSize( std::nan("") )
+	  m_fUsedTickSize( std::nan("") ),
+	  m_bPooled( false ),
+	  m_pNextFree( nullptr ),
+	  m_pPrevVoice( nullptr ),
+	  m_pNextVoice( nullptr ),
+	  m_pPrevInstrumentVoice( nullptr ),
+	  m_pNextInstrumentVoice( nullptr ),
+	  m_bStolen( false )
 {
 	if ( pInstrument != nullptr ) {
 		__adsr = pInstrument->copy_adsr();
@@ -113,7 +120,14 @@ Note::Note( Note* other, std::shared_ptr<Instrument> instrument )
 	  __just_recorded( other->get_just_recorded() ),
 	  __probability( other->get_probability() ),
 	  m_nNoteStart( other->getNoteStart() ),
-	  m_fUsedTickSize( other->getUsedTickSize() )
+	  m_fUsedTickSize( other->getUsedTickSize() ),
+	  m_bPooled( false ),
+	  m_pNextFree( nullptr ),
+	  m_pPrevVoice( nullptr ),
+	  m_pNextVoice( nullptr ),
+	  m_pPrevInstrumentVoice( nullptr ),
+	  m_pNextInstrumentVoice( nullptr ),
+	  m_bStolen( false )
 {
 	if ( instrument != nullptr ) __instrument = instrument;
 	if ( __instrument != nullptr ) {
@@ -121,6 +135,11 @@ Note::Note( Note* other, std::shared_ptr<Instrument> instrument )
 		__instrument_id = __instrument->get_id();
 	}
 
+	if ( instrument != nullptr && instrument != other->get_instrument() ) {
+		resetLayersSelected( instrument );
+		return;
+	}
+
 	for ( const auto& mm : other->__layers_selected ) {
 		std::shared_ptr<SelectedLayerInfo> pSampleInfo = std::make_shared<SelectedLayerInfo>();
 		pSampleInfo->nSelectedLayer = mm.second->nSelectedLayer;
@@ -135,6 +154,187 @@ Note::~Note()
 {
 }
 
+void Note::reinitAdsr( std::shared_ptr<Instrument> pInstrument )
+{
+	if ( pInstrument->get_adsr() == nullptr ) {
+		__adsr = nullptr;
+		return;
+	}
+
+	// Pooled notes own an envelope allocated along with the pool,
+	// which is overwritten in place. Other notes only do so in case
+	// the envelope is not referenced elsewhere.
+	if ( __adsr != nullptr && ( m_bPooled || __adsr.use_count() == 1 ) ) {
+		*__adsr = *pInstrument->get_adsr();
+	} else {
+		__adsr = pInstrument->copy_adsr();
+	}
+}
+
+void Note::resetLayersSelected( std::shared_ptr<Instrument> pInstrument )
+{
+	const auto pComponents = pInstrument->get_components();
+
+	bool bSameLayout = pComponents->size() == __layers_selected.size();
+	if ( bSameLayout ) {
+		for ( const auto& ppCompo : *pComponents ) {
+			if ( __layers_selected.find( ppCompo->get_drumkit_componentID() ) ==
+				 __layers_selected.end() ) {
+				bSameLayout = false;
+				break;
+			}
+		}
+	}
+	if ( ! bSameLayout ) {
+		__layers_selected.clear();
+		for ( const auto& ppCompo : *pComponents ) {
+			__layers_selected[ ppCompo->get_drumkit_componentID() ] =
+				std::make_shared<SelectedLayerInfo>();
+		}
+	}
+	for ( const auto& [ _, pSampleInfo ] : __layers_selected ) {
+		pSampleInfo->nSelectedLayer = -1;
+		pSampleInfo->fSamplePosition = 0;
+		pSampleInfo->nNoteLength = -1;
+	}
+}
+
+void Note::reinit( std::shared_ptr<Instrument> pInstrument, int nPosition,
+				   float fVelocity, float fPan, int nLength, float fPitch )
+{
+	__instrument = pInstrument;
+	__instrument_id = 0;
+	__specific_compo_id = -1;
+	__position = nPosition;
+	__velocity = fVelocity;
+	__length = nLength;
+	__pitch = fPitch;
+	__key = C;
+	__octave = P8;
+	__lead_lag = 0.0;
+	__cut_off = 1.0;
+	__resonance = 0.0;
+	__humanize_delay = 0;
+	__bpfb_l = 0.0;
+	__bpfb_r = 0.0;
+	__lpfb_l = 0.0;
+	__lpfb_r = 0.0;
+	__pattern_idx = 0;
+	__midi_msg = -1;
+	__note_off = false;
+	__just_recorded = false;
+	__probability = 1.0f;
+	m_nNoteStart = 0;
+	m_fUsedTickSize = std::nan("");
+
+	if ( pInstrument != nullptr ) {
+		reinitAdsr( pInstrument );
+		__instrument_id = pInstrument->get_id();
+
+		// Reuse the layer infos in case the note was used for a
+		// instrument with the same component layout before.
+		const auto pComponents = pInstrument->get_components();
+		bool bSameLayout = pComponents->size() == __layers_selected.size();
+		if ( bSameLayout ) {
+			for ( const auto& pCompo : *pComponents ) {
+				if ( __layers_selected.find( pCompo->get_drumkit_componentID() ) ==
+					 __layers_selected.end() ) {
+					bSameLayout = false;
+					break;
+				}
+			}
+		}
+		if ( ! bSameLayout ) {
+			__layers_selected.clear();
+			for ( const auto& pCompo : *pComponents ) {
+				__layers_selected[ pCompo->get_drumkit_componentID() ] =
+					std::make_shared<SelectedLayerInfo>();
+			}
+		}
+		for ( auto& [ _, pSampleInfo ] : __layers_selected ) {
+			pSampleInfo->nSelectedLayer = -1;
+			pSampleInfo->fSamplePosition = 0;
+			pSampleInfo->nNoteLength = -1;
+		}
+	}
+	else {
+		// The preallocated envelope of pooled notes is kept for
+		// later use.
+		if ( ! m_bPooled ) {
+			__adsr = nullptr;
+		}
+		__layers_selected.clear();
+	}
+
+	setPan( fPan );
+}
+
+void Note::reinit( Note* pOther, std::shared_ptr<Instrument> pInstrument )
+{
+	__instrument = pOther->get_instrument();
+	__instrument_id = 0;
+	__specific_compo_id = -1;
+	__position = pOther->get_position();
+	__velocity = pOther->get_velocity();
+	m_fPan = pOther->getPan();
+	__length = pOther->get_length();
+	__pitch = pOther->get_pitch();
+	__key = pOther->get_key();
+	__octave = pOther->get_octave();
+	__lead_lag = pOther->get_lead_lag();
+	__cut_off = pOther->get_cut_off();
+	__resonance = pOther->get_resonance();
+	__humanize_delay = pOther->get_humanize_delay();
+	__bpfb_l = pOther->get_bpfb_l();
+	__bpfb_r = pOther->get_bpfb_r();
+	__lpfb_l = pOther->get_lpfb_l();
+	__lpfb_r = pOther->get_lpfb_r();
+	__pattern_idx = pOther->get_pattern_idx();
+	__midi_msg = pOther->get_midi_msg();
+	__note_off = pOther->get_note_off();
+	__just_recorded = pOther->get_just_recorded();
+	__probability = pOther->get_probability();
+	m_nNoteStart = pOther->getNoteStart();
+	m_fUsedTickSize = pOther->getUsedTickSize();
+
+	if ( pInstrument != nullptr ) {
+		__instrument = pInstrument;
+	}
+	if ( __instrument != nullptr ) {
+		reinitAdsr( __instrument );
+		__instrument_id = __instrument->get_id();
+	} else if ( ! m_bPooled ) {
+		__adsr = nullptr;
+	}
+
+	if ( pInstrument != nullptr && pInstrument != pOther->get_instrument() ) {
+		resetLayersSelected( pInstrument );
+		return;
+	}
+
+	bool bSameLayout = pOther->__layers_selected.size() == __layers_selected.size();
+	if ( bSameLayout ) {
+		for ( const auto& [ nId, _ ] : pOther->__layers_selected ) {
+			if ( __layers_selected.find( nId ) == __layers_selected.end() ) {
+				bSameLayout = false;
+				break;
+			}
+		}
+	}
+	if ( ! bSameLayout ) {
+		__layers_selected.clear();
+		for ( const auto& [ nId, _ ] : pOther->__layers_selected ) {
+			__layers_selected[ nId ] = std::make_shared<SelectedLayerInfo>();
+		}
+	}
+	for ( const auto& [ nId, pOtherInfo ] : pOther->__layers_selected ) {
+		const auto& pSampleInfo = __layers_selected[ nId ];
+		pSampleInfo->nSelectedLayer = pOtherInfo->nSelectedLayer;
+		pSampleInfo->fSamplePosition = pOtherInfo->fSamplePosition;
+		pSampleInfo->nNoteLength = pOtherInfo->nNoteLength;
+	}
+}
+
 static inline float check_boundary( float fValue, float fMin, float fMax )
 {
 	return std::clamp( fValue, fMin, fMax );
@@ -485,6 +685,29 @@ void Note::swing() {
 	}
 }
 
+bool Note::isEquivalent( const Note* pNote ) const
+{
+	if ( pNote == nullptr ||
+		 ( __instrument == nullptr ) != ( pNote->__instrument == nullptr ) ) {
+		return false;
+	}
+	if ( __instrument != nullptr &&
+		 __instrument->get_id() != pNote->__instrument->get_id() ) {
+		return false;
+	}
+
+	return __position == pNote->__position &&
+		__lead_lag == pNote->__lead_lag &&
+		__velocity == pNote->__velocity &&
+		m_fPan == pNote->m_fPan &&
+		__pitch == pNote->__pitch &&
+		__key == pNote->__key &&
+		__octave == pNote->__octave &&
+		__length == pNote->__length &&
+		__note_off == pNote->__note_off &&
+		__probability == pNote->__probability;
+}
+
 void Note::save_to( XMLNode& node ) const
 {
 	node.write_int( "position", __position );
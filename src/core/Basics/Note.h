@@ -328,6 +328,10 @@ class Note : public H2Core::Object<Note>
 		bool match( const Note *pNote ) const;
 		bool match( const std::shared_ptr<Note> pNote ) const;
 
+		/** Whether @a pNote would be saved using the very same
+		 * properties as this note, see save_to(). */
+		bool isEquivalent( const Note* pNote ) const;
+
 		/**
 		 * compute left and right output based on filters
 		 * \param val_l the left channel value
@@ -417,6 +421,35 @@ class Note : public H2Core::Object<Note>
 	std::shared_ptr<Sample> getSample( int nComponentID, int nSelectedLayer = -1 ) const;
 
 	private:
+		friend class NotePool;
+		friend class Sampler;
+		friend class AudioEngineTests;
+
+		/**
+		 * Resets all members as if the note was freshly constructed
+		 * using Note( std::shared_ptr<Instrument>, int, float, float,
+		 * int, float ).
+		 *
+		 * Contrary to the constructor the ADSR and the
+		 * #SelectedLayerInfo already owned by the note are reused
+		 * whenever possible. This way a note handed out by the
+		 * #NotePool does not require any heap allocation.
+		 */
+		void reinit( std::shared_ptr<Instrument> pInstrument, int nPosition,
+					 float fVelocity, float fPan, int nLength, float fPitch );
+		/**
+		 * Counterpart of reinit() mirroring the copy constructor
+		 * Note( Note*, std::shared_ptr<Instrument> ).
+		 */
+		void reinit( Note* pOther, std::shared_ptr<Instrument> pInstrument );
+		/** Copies the envelope of @a pInstrument into #__adsr. */
+		void reinitAdsr( std::shared_ptr<Instrument> pInstrument );
+		/** Lays out #__layers_selected according to the components of
+		 * @a pInstrument and resets all of them. Required in case the
+		 * note is copied onto another instrument, e.g. one of a
+		 * freshly loaded drumkit. */
+		void resetLayersSelected( std::shared_ptr<Instrument> pInstrument );
+
 		std::shared_ptr<Instrument>		__instrument;   ///< the instrument to be played by this note
 		int				__instrument_id;        ///< the id of the instrument played by this note
 		int				__specific_compo_id;    ///< play a specific component, -1 if playing all
@@ -483,6 +516,27 @@ class Note : public H2Core::Object<Note>
 	 * during processing and not written to disk.
 	 */
 	float m_fUsedTickSize;
+
+	/** Whether the note is owned by the #NotePool and must be handed
+	 * back to it using NotePool::release() instead of being deleted. */
+	bool m_bPooled;
+	/** Intrusive link of the #NotePool free list. Only valid while
+	 * the note is not in use. */
+	Note* m_pNextFree;
+
+	/** Intrusive links of the voices of the #Sampler ordered from the
+	 * oldest to the newest one. Only valid while the note is rendered
+	 * and not stolen. */
+	Note* m_pPrevVoice;
+	Note* m_pNextVoice;
+	/** Same as #m_pPrevVoice and #m_pNextVoice but only covering the
+	 * voices of #__instrument. */
+	Note* m_pPrevInstrumentVoice;
+	Note* m_pNextInstrumentVoice;
+	/** Whether the #Sampler took the voice away from the note in
+	 * order to make room for a new one. The note is still fading out
+	 * but no longer linked. */
+	bool m_bStolen;
 };
 
 // DEFINITIONS
@@ -42,6 +42,7 @@ Pattern::Pattern( const QString& name, const QString& info, const QString& categ
 	, __info( info )
 	, __category( category )
 {
+	updateNoteIndex();
 }
 
 Pattern::Pattern( Pattern* other )
@@ -54,6 +55,7 @@ Pattern::Pattern( Pattern* other )
 	FOREACH_NOTE_CST_IT_BEGIN_END( other->get_notes(),it ) {
 		__notes.insert( std::make_pair( it->first, new Note( it->second ) ) );
 	}
+	updateNoteIndex();
 }
 
 Pattern::~Pattern()
@@ -63,59 +65,34 @@ Pattern::~Pattern()
 	}
 }
 
-bool Pattern::loadDoc( const QString& sPatternPath, std::shared_ptr<InstrumentList> pInstrumentList, XMLDoc* pDoc, bool bSilent )
+Pattern* Pattern::load_file( const QString& sPatternPath, std::shared_ptr<InstrumentList> pInstrumentList )
 {
-	if ( ! Filesystem::file_readable( sPatternPath, bSilent ) ) {
-		return false;
-	}
+	INFOLOG( QString( "Load pattern %1" ).arg( sPatternPath ) );
 
-	bool bReadingSuccessful = true;
-	
-	if ( ! pDoc->read( sPatternPath, Filesystem::pattern_xsd_path() ) ) {
-		if ( ! pDoc->read( sPatternPath, nullptr ) ) {
-			ERRORLOG( QString( "Unable to read pattern [%1]" )
-					  .arg( sPatternPath ) );
-			return false;
-		}
-		else {
-			if ( ! bSilent ) {
-				WARNINGLOG( QString( "Pattern [%1] does not validate the current pattern schema. Loading might fail." )
-							.arg( sPatternPath ) );
-			}
-			bReadingSuccessful = false;
-		}
+	if ( ! Filesystem::file_readable( sPatternPath, false ) ||
+		 ! XMLDoc::validate( sPatternPath, Filesystem::pattern_xsd_path() ) ) {
+		// Try former pattern version
+		return Legacy::load_drumkit_pattern( sPatternPath, pInstrumentList );
 	}
-	
-	XMLNode root = pDoc->firstChildElement( "drumkit_pattern" );
-	if ( root.isNull() ) {
+
+	XMLStreamReader reader;
+	if ( ! reader.open( sPatternPath ) ||
+		 reader.name() != "drumkit_pattern" ) {
 		ERRORLOG( QString( "'drumkit_pattern' node not found in [%1]" )
 				  .arg( sPatternPath ) );
-		return false;
-	}
-	
-	XMLNode pattern_node = root.firstChildElement( "pattern" );
-	if ( pattern_node.isNull() ) {
-		ERRORLOG( QString( "'pattern' node not found in [%1]" )
-				  .arg( sPatternPath ) );
-		return false;
+		return Legacy::load_drumkit_pattern( sPatternPath, pInstrumentList );
 	}
 
-	return bReadingSuccessful;
-}
-
-Pattern* Pattern::load_file( const QString& sPatternPath, std::shared_ptr<InstrumentList> pInstrumentList )
-{
-	INFOLOG( QString( "Load pattern %1" ).arg( sPatternPath ) );
-
-	XMLDoc doc;
-	if ( ! loadDoc( sPatternPath, pInstrumentList, &doc, false ) ) {
-		// Try former pattern version
-		return Legacy::load_drumkit_pattern( sPatternPath, pInstrumentList );
+	while ( reader.readNextChild() ) {
+		if ( reader.name() == "pattern" ) {
+			return load_from( reader, pInstrumentList );
+		}
+		reader.skip();
 	}
 
-	XMLNode root = doc.firstChildElement( "drumkit_pattern" );
-	XMLNode pattern_node = root.firstChildElement( "pattern" );
-	return load_from( pattern_node, pInstrumentList );
+	ERRORLOG( QString( "'pattern' node not found in [%1]" )
+			  .arg( sPatternPath ) );
+	return Legacy::load_drumkit_pattern( sPatternPath, pInstrumentList );
 }
 
 Pattern* Pattern::load_from( const XMLNode& node,
@@ -137,20 +114,63 @@ Pattern* Pattern::load_from( const XMLNode& node,
 	
 	XMLNode note_list_node = node.firstChildElement( "noteList" );
 	if ( !note_list_node.isNull() ) {
+		std::vector<Note*> notes;
 		XMLNode note_node = note_list_node.firstChildElement( "note" );
 		while ( !note_node.isNull() ) {
 			Note* pNote = Note::load_from( note_node, pInstrumentList, bSilent );
 			assert( pNote );
 			if ( pNote != nullptr ) {
-				pPattern->insert_note( pNote );
+				notes.push_back( pNote );
 			}
 			note_node = note_node.nextSiblingElement( "note" );
 		}
+		pPattern->insert_notes( notes );
 	}
 	
 	return pPattern;
 }
 
+Pattern* Pattern::load_from( XMLStreamReader& reader,
+							 std::shared_ptr<InstrumentList> pInstrumentList,
+							 bool bSilent )
+{
+	// All elements except of the notes are small. They are gathered
+	// in a DOM in order to share their parsing with the XMLNode
+	// version. Notes are converted and discarded one at a time.
+	XMLDoc doc;
+	XMLNode node = reader.createRoot( doc );
+
+	std::vector<Note*> notes;
+	bool bNoteListRead = false;
+	while ( reader.readNextChild() ) {
+		if ( reader.name() == "noteList" && ! bNoteListRead ) {
+			bNoteListRead = true;
+			while ( reader.readNextChild() ) {
+				if ( reader.name() != "note" || pInstrumentList == nullptr ) {
+					reader.skip();
+					continue;
+				}
+
+				XMLNode noteNode = reader.readSubtree( node );
+				Note* pNote = Note::load_from( noteNode, pInstrumentList, bSilent );
+				assert( pNote );
+				if ( pNote != nullptr ) {
+					notes.push_back( pNote );
+				}
+				node.removeChild( noteNode );
+			}
+		}
+		else {
+			reader.readSubtree( node );
+		}
+	}
+
+	Pattern* pPattern = load_from( node, pInstrumentList, bSilent );
+	pPattern->insert_notes( notes );
+
+	return pPattern;
+}
+
 bool Pattern::save_file( const QString& drumkit_name, const QString& author, const License& license, const QString& pattern_path, bool overwrite ) const
 {
 	INFOLOG( QString( "Saving pattern into %1" ).arg( pattern_path ) );
@@ -158,24 +178,30 @@ bool Pattern::save_file( const QString& drumkit_name, const QString& author, con
 		ERRORLOG( QString( "pattern %1 already exists" ).arg( pattern_path ) );
 		return false;
 	}
+	XMLStreamWriter writer;
+	if ( ! writer.open( pattern_path ) ) {
+		return false;
+	}
+	writer.writeStartDocument( "drumkit_pattern", "drumkit_pattern" );
+
 	XMLDoc doc;
-	XMLNode root = doc.set_root( "drumkit_pattern", "drumkit_pattern" );
+	XMLNode root = doc.createElement( "drumkit_pattern" );
 	root.write_string( "drumkit_name", drumkit_name );
 	root.write_string( "author", author );							// FIXME this is never loaded back
 	root.write_string( "license", license.getLicenseString() );
 	// FIXME this is never loaded back
-	save_to( root );
-	return doc.write( pattern_path );
+	writer.writeChildren( root );
+
+	save_to( writer );
+	writer.writeEndElement();
+
+	return writer.commit();
 }
 
 void Pattern::save_to( XMLNode& node, const std::shared_ptr<Instrument> pInstrumentOnly ) const
 {
 	XMLNode pattern_node =  node.createNode( "pattern" );
-	pattern_node.write_string( "name", __name );
-	pattern_node.write_string( "info", __info );
-	pattern_node.write_string( "category", __category );
-	pattern_node.write_int( "size", __length );
-	pattern_node.write_int( "denominator", __denominator );
+	save_properties_to( pattern_node );
 	
 	int nId = ( pInstrumentOnly == nullptr ? -1 : pInstrumentOnly->get_id() );
 	
@@ -191,6 +217,63 @@ void Pattern::save_to( XMLNode& node, const std::shared_ptr<Instrument> pInstrum
 	}
 }
 
+void Pattern::save_to( XMLStreamWriter& writer, const std::shared_ptr<Instrument> pInstrumentOnly ) const
+{
+	XMLDoc doc;
+	XMLNode pattern_node = doc.createElement( "pattern" );
+	save_properties_to( pattern_node );
+
+	writer.writeStartElement( "pattern" );
+	writer.writeChildren( pattern_node );
+
+	int nId = ( pInstrumentOnly == nullptr ? -1 : pInstrumentOnly->get_id() );
+
+	writer.writeStartElement( "noteList" );
+	for( auto it = __notes.cbegin(); it != __notes.cend(); ++it ) {
+		auto pNote = it->second;
+		if ( pNote != nullptr &&
+			 ( pInstrumentOnly == nullptr ||
+			   pNote->get_instrument()->get_id() == nId ) ) {
+			XMLNode note_node = doc.createElement( "note" );
+			pNote->save_to( note_node );
+			writer.writeNode( note_node );
+		}
+	}
+	writer.writeEndElement();
+
+	writer.writeEndElement();
+}
+
+bool Pattern::isEquivalent( const Pattern* pOther ) const
+{
+	if ( pOther == nullptr ||
+		 __name != pOther->__name || __info != pOther->__info ||
+		 __category != pOther->__category || __length != pOther->__length ||
+		 __denominator != pOther->__denominator ||
+		 __notes.size() != pOther->__notes.size() ) {
+		return false;
+	}
+
+	for ( auto it = __notes.cbegin(), itOther = pOther->__notes.cbegin();
+		  it != __notes.cend(); ++it, ++itOther ) {
+		if ( it->first != itOther->first ||
+			 ! it->second->isEquivalent( itOther->second ) ) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Pattern::save_properties_to( XMLNode& node ) const
+{
+	node.write_string( "name", __name );
+	node.write_string( "info", __info );
+	node.write_string( "category", __category );
+	node.write_int( "size", __length );
+	node.write_int( "denominator", __denominator );
+}
+
 Note* Pattern::find_note( int idx_a, int idx_b, std::shared_ptr<Instrument> instrument, Note::Key key, Note::Octave octave, bool strict ) const
 {
 	for( notes_cst_it_t it=__notes.lower_bound( idx_a ); it!=__notes.upper_bound( idx_a ); it++ ) {
@@ -249,11 +332,107 @@ void Pattern::remove_note( Note* note )
 	for( notes_it_t it=__notes.lower_bound( pos ); it!=__notes.end() && it->first == pos; ++it ) {
 		if( it->second==note ) {
 			__notes.erase( it );
+			updateNoteIndex();
 			break;
 		}
 	}
 }
 
+void Pattern::insert_notes( const std::vector<Note*>& notes )
+{
+	if ( notes.empty() ) {
+		return;
+	}
+	for ( const auto& pNote : notes ) {
+		__notes.insert( std::make_pair( pNote->get_position(), pNote ) );
+	}
+	updateNoteIndex();
+}
+
+void Pattern::remove_notes( const std::vector<Note*>& notes )
+{
+	bool bRemoved = false;
+	for ( const auto& pNote : notes ) {
+		const int nPosition = pNote->get_position();
+		for ( notes_it_t it = __notes.lower_bound( nPosition );
+			  it != __notes.end() && it->first == nPosition; ++it ) {
+			if ( it->second == pNote ) {
+				__notes.erase( it );
+				bRemoved = true;
+				break;
+			}
+		}
+	}
+	if ( bRemoved ) {
+		updateNoteIndex();
+	}
+}
+
+void Pattern::updateNoteIndex()
+{
+	// The previous snapshot is freed in here and not by the audio
+	// thread.
+	m_pNoteIndex = std::make_unique<const NoteIndex>( __notes );
+}
+
+Pattern::NoteIndex::NoteIndex( const notes_t& notes )
+	: m_nFirstTick( 0 )
+{
+	m_notes.reserve( notes.size() );
+	m_positions.reserve( notes.size() );
+	for ( const auto& [ nPosition, pNote ] : notes ) {
+		m_notes.push_back( pNote );
+		m_positions.push_back( nPosition );
+	}
+	if ( notes.empty() ) {
+		return;
+	}
+
+	m_nFirstTick = notes.begin()->first;
+	const int nLastTick = notes.rbegin()->first;
+	m_offsets.resize( nLastTick - m_nFirstTick + 1 );
+
+	// Since the multimap is sorted, a single pass is sufficient.
+	auto it = notes.begin();
+	int nIndex = 0;
+	for ( int nTick = m_nFirstTick; nTick <= nLastTick; ++nTick ) {
+		while ( it != notes.end() && it->first < nTick ) {
+			++it;
+			++nIndex;
+		}
+		m_offsets[ nTick - m_nFirstTick ] = nIndex;
+	}
+}
+
+int Pattern::NoteIndex::firstNoteAt( int nTick ) const
+{
+	if ( nTick <= m_nFirstTick ) {
+		return 0;
+	}
+	else if ( nTick - m_nFirstTick >= static_cast<int>(m_offsets.size()) ) {
+		return m_notes.size();
+	}
+	return m_offsets[ nTick - m_nFirstTick ];
+}
+
+int Pattern::NoteIndex::nextTick( int nTick ) const
+{
+	const int nIndex = firstNoteAt( nTick );
+	if ( nIndex >= static_cast<int>(m_positions.size()) ) {
+		return std::numeric_limits<int>::max();
+	}
+	return m_positions[ nIndex ];
+}
+
+Pattern::NoteIndex::Range Pattern::NoteIndex::getNotes( int nStartTick, int nEndTick ) const
+{
+	if ( nEndTick <= nStartTick ) {
+		return { m_notes.data(), m_notes.data() };
+	}
+	return { m_notes.data() + firstNoteAt( nStartTick ),
+			 m_notes.data() + firstNoteAt( nEndTick ) };
+}
+
 bool Pattern::references( std::shared_ptr<Instrument> instr ) const
 {
 	for( notes_cst_it_t it=__notes.begin(); it!=__notes.end(); it++ ) {
@@ -284,6 +463,9 @@ void Pattern::purge_instrument( std::shared_ptr<Instrument> instr, bool bRequire
 			++it;
 		}
 	}
+	if ( slate.size() > 0 ) {
+		updateNoteIndex();
+	}
 	if ( locked ) {
 		Hydrogen::get_instance()->getAudioEngine()->unlock();
 	}
@@ -306,6 +488,7 @@ void Pattern::clear( bool bRequiresLock )
 		slate.push_back( note );
 		__notes.erase( it++ );
 	}
+	updateNoteIndex();
 	if ( bRequiresLock ) {
 		pAudioEngine->unlock();
 	}
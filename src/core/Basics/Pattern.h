@@ -23,8 +23,10 @@
 #ifndef H2C_PATTERN_H
 #define H2C_PATTERN_H
 
+#include <limits>
 #include <set>
 #include <memory>
+#include <vector>
 #include <core/License.h>
 #include <core/Object.h>
 #include <core/Basics/Note.h>
@@ -34,6 +36,8 @@ namespace H2Core
 {
 
 class XMLNode;
+class XMLStreamReader;
+class XMLStreamWriter;
 class Instrument;
 class InstrumentList;
 class PatternList;
@@ -59,6 +63,58 @@ class Pattern : public H2Core::Object<Pattern>
 		///< note set const iterator type;
 		typedef virtual_patterns_t::const_iterator virtual_patterns_cst_it_t;
 
+	/**
+	 * Read-only snapshot of all notes of a pattern stored in a flat
+	 * array sorted by position.
+	 *
+	 * An additional offset table maps each tick to the first note
+	 * located at or after it. This allows the #AudioEngine to
+	 * retrieve all notes within a tick range using a single
+	 * contiguous scan instead of walking the #notes_t multimap.
+	 *
+	 * The snapshot only stores pointers to the notes owned by the
+	 * pattern. Changing the properties of a note is reflected
+	 * immediately while inserting or removing notes results in a new
+	 * snapshot built right away by the thread altering the pattern
+	 * (see Pattern::getNoteIndex()).
+	 */
+	class NoteIndex {
+	public:
+		/** Contiguous range of notes as returned by getNotes(). */
+		struct Range {
+			Note* const* pBegin;
+			Note* const* pEnd;
+
+			Note* const* begin() const { return pBegin; }
+			Note* const* end() const { return pEnd; }
+			bool empty() const { return pBegin == pEnd; }
+			int size() const { return static_cast<int>( pEnd - pBegin ); }
+		};
+
+		NoteIndex( const notes_t& notes );
+
+		/** All notes located within [@a nStartTick, @a nEndTick). */
+		Range getNotes( int nStartTick, int nEndTick ) const;
+		/** Position of the first note located at or after @a nTick or
+		 * std::numeric_limits<int>::max() if there is none. */
+		int nextTick( int nTick ) const;
+		/** Number of notes in the snapshot. */
+		int size() const;
+
+	private:
+		/** Index within #m_notes of the first note located at or
+		 * after @a nTick. */
+		int firstNoteAt( int nTick ) const;
+
+		std::vector<Note*> m_notes;
+		/** Positions of the notes in #m_notes. */
+		std::vector<int> m_positions;
+		/** Element ii holds the index of the first note located at or
+		 * after tick #m_nFirstTick + ii. */
+		std::vector<int> m_offsets;
+		int m_nFirstTick;
+	};
+
 	/** allow iteration of all contained virtual patterns.*/
 	std::set<Pattern*>::iterator begin();
 	std::set<Pattern*>::iterator end();
@@ -95,6 +151,19 @@ class Pattern : public H2Core::Object<Pattern>
 	static Pattern* load_from( const XMLNode& node,
 							   std::shared_ptr<InstrumentList> instruments,
 							   bool bSilent = false );
+		/**
+		 * load a pattern from an XMLStreamReader located at a
+		 * pattern element. Notes are read one at a time.
+		 * \param reader the reader to read from
+		 * \param instruments the current instrument list to search
+		 * instrument into
+		 * \param bSilent Whether infos, warnings, and errors should
+		 * be logged.
+		 * \return a new Pattern instance
+		 */
+	static Pattern* load_from( XMLStreamReader& reader,
+							   std::shared_ptr<InstrumentList> instruments,
+							   bool bSilent = false );
 		/**
 		 * save a pattern into an xml file
 		 * \param drumkit_name the name of the drumkit it is supposed to play with
@@ -158,11 +227,31 @@ class Pattern : public H2Core::Object<Pattern>
 		 * \return the note if found, 0 otherwise
 		 */
 		Note* find_note( int idx_a, int idx_b, std::shared_ptr<Instrument> instrument, Note::Key key, Note::Octave octave, bool strict=true) const;
+		/**
+		 * Flat snapshot of #__notes.
+		 *
+		 * It is rebuilt whenever notes are inserted or removed by the
+		 * thread doing so. For patterns of the current song this
+		 * happens while holding the #AudioEngine lock. The audio
+		 * thread does thus only read the snapshot and must not keep
+		 * it past the lock either.
+		 */
+		const NoteIndex* getNoteIndex() const;
 		/**
 		 * removes a given note from __notes, it's not deleted
 		 * \param note the note to be removed
 		 */
 		void remove_note( Note* note );
+		/**
+		 * Inserts all @a notes and rebuilds the #NoteIndex only once.
+		 * Ownership of the notes is transferred to the pattern.
+		 */
+		void insert_notes( const std::vector<Note*>& notes );
+		/**
+		 * Removes all @a notes and rebuilds the #NoteIndex only once.
+		 * The notes are not deleted.
+		 */
+		void remove_notes( const std::vector<Note*>& notes );
 
 		/**
 		 * check if this pattern contains a note referencing the given instrument
@@ -231,6 +320,17 @@ class Pattern : public H2Core::Object<Pattern>
 		 */
 		void save_to( XMLNode& node,
 					  const std::shared_ptr<Instrument> instrumentOnly = nullptr ) const;
+		/**
+		 * write the pattern as a child of the current element of
+		 * \a writer. Notes are written one at a time.
+		 * \param writer the XMLStreamWriter to feed
+		 * \param instrumentOnly export only the notes of that instrument if given
+		 */
+		void save_to( XMLStreamWriter& writer,
+					  const std::shared_ptr<Instrument> instrumentOnly = nullptr ) const;
+		/** Whether @a pOther would be saved using the very same
+		 * properties and notes as this pattern, see save_to(). */
+		bool isEquivalent( const Pattern* pOther ) const;
 		/** Formatted string version for debugging purposes.
 		 * \param sPrefix String prefix which will be added in front of
 		 * every new line
@@ -242,6 +342,14 @@ class Pattern : public H2Core::Object<Pattern>
 		QString toQString( const QString& sPrefix = "", bool bShort = true ) const override;
 
 	private:
+		/** Writes all properties of the pattern except of its notes
+		 * into @a node. */
+		void save_properties_to( XMLNode& node ) const;
+		/** Replaces #m_pNoteIndex by a snapshot of the current
+		 * #__notes. To be called whenever a note is inserted into or
+		 * removed from #__notes. */
+		void updateNoteIndex();
+
 	/**
 	 * Determines the accessible range or notes within the
 	 * pattern.
@@ -260,13 +368,8 @@ class Pattern : public H2Core::Object<Pattern>
 		notes_t __notes;                                        ///< a multimap (hash with possible multiple values for one key) of note
 		virtual_patterns_t __virtual_patterns;                  ///< a list of patterns directly referenced by this one
 		virtual_patterns_t __flattened_virtual_patterns;        ///< the complete list of virtual patterns
-	/**
-	 * Loads the pattern stored in @a sPatternPath into @a pDoc and
-	 * takes care of all the error handling.
-	 *
-	 * \return true on success.
-	 */
-	static bool loadDoc( const QString& sPatternPath, std::shared_ptr<InstrumentList> pInstrumentList, XMLDoc* pDoc, bool bSilent = false );
+	/** Never nullptr. See getNoteIndex(). */
+	std::unique_ptr<const NoteIndex> m_pNoteIndex;
 };
 
 /** Iterate over all provided notes in an immutable way. */
@@ -375,6 +478,17 @@ inline const Pattern::virtual_patterns_t* Pattern::get_flattened_virtual_pattern
 inline void Pattern::insert_note( Note* note )
 {
 	__notes.insert( std::make_pair( note->get_position(), note ) );
+	updateNoteIndex();
+}
+
+inline const Pattern::NoteIndex* Pattern::getNoteIndex() const
+{
+	return m_pNoteIndex.get();
+}
+
+inline int Pattern::NoteIndex::size() const
+{
+	return m_notes.size();
 }
 
 inline bool Pattern::virtual_patterns_empty() const
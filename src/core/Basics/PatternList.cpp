@@ -86,6 +86,36 @@ PatternList* PatternList::load_from( const XMLNode& node,
 	return pPatternList;
 }
 
+PatternList* PatternList::load_from( XMLStreamReader& reader,
+									 std::shared_ptr<InstrumentList> pInstrumentList,
+									 bool bSilent ) {
+	PatternList* pPatternList = new PatternList();
+	int nPatternCount = 0;
+
+	while ( reader.readNextChild() ) {
+		if ( reader.name() != "pattern" ) {
+			reader.skip();
+			continue;
+		}
+
+		nPatternCount++;
+		Pattern* pPattern = Pattern::load_from( reader, pInstrumentList, bSilent );
+		if ( pPattern != nullptr ) {
+			pPatternList->add( pPattern );
+		}
+		else {
+			ERRORLOG( "Error loading pattern" );
+			delete pPatternList;
+			return nullptr;
+		}
+	}
+	if ( nPatternCount == 0 && ! bSilent ) {
+		WARNINGLOG( "0 patterns?" );
+	}
+
+	return pPatternList;
+}
+
 void PatternList::save_to( XMLNode& node, const std::shared_ptr<Instrument> pInstrumentOnly ) const {
 	XMLNode patternListNode = node.createNode( "patternList" );
 	
@@ -96,6 +126,18 @@ void PatternList::save_to( XMLNode& node, const std::shared_ptr<Instrument> pIns
 	}
 }
 	
+void PatternList::save_to( XMLStreamWriter& writer, const std::shared_ptr<Instrument> pInstrumentOnly ) const {
+	writer.writeStartElement( "patternList" );
+
+	for ( const auto& pPattern : __patterns ) {
+		if ( pPattern != nullptr ) {
+			pPattern->save_to( writer, pInstrumentOnly );
+		}
+	}
+
+	writer.writeEndElement();
+}
+
 void PatternList::add( Pattern* pPattern, bool bAddVirtuals )
 {
 	assertAudioEngineLocked();
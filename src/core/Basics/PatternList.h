@@ -34,6 +34,8 @@ class Pattern;
 class AudioEngineLocking;
 class InstrumentList;
 class XMLNode;
+class XMLStreamReader;
+class XMLStreamWriter;
 
 /**
  * PatternList is a collection of patterns
@@ -64,8 +66,24 @@ class XMLNode;
 	static PatternList* load_from( const XMLNode& pNode,
 								   std::shared_ptr<InstrumentList> pInstrumentList,
 								   bool bSilent = false );
+		/**
+		 * load a #PatternList from an XMLStreamReader located at a
+		 * patternList element
+		 * \param reader the reader to read from
+		 * \param pInstrumentList the current instrument list to search instrument into
+		 * \param bSilent Whether infos, warnings, and errors should
+		 * be logged.
+		 * \return a new PatternList instance
+		 */
+	static PatternList* load_from( XMLStreamReader& reader,
+								   std::shared_ptr<InstrumentList> pInstrumentList,
+								   bool bSilent = false );
 	void save_to( XMLNode& pNode,
 				  const std::shared_ptr<Instrument> pInstrumentOnly = nullptr ) const;
+	/** Writes the list as a child of the current element of @a
+	 * writer one pattern at a time. */
+	void save_to( XMLStreamWriter& writer,
+				  const std::shared_ptr<Instrument> pInstrumentOnly = nullptr ) const;
 
 		/** returns the numbers of patterns */
 		int size() const;
@@ -0,0 +1,327 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+
+#include <core/Basics/PlaylistPrefetcher.h>
+
+#include <core/Basics/Drumkit.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentComponent.h>
+#include <core/Basics/InstrumentLayer.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Playlist.h>
+#include <core/Basics/Sample.h>
+#include <core/Basics/Song.h>
+#include <core/Helpers/Filesystem.h>
+#include <core/Hydrogen.h>
+#include <core/Preferences/Preferences.h>
+
+#include <QFileInfo>
+
+namespace H2Core
+{
+
+PlaylistPrefetcher::PlaylistPrefetcher()
+	: m_nBudget( 0 )
+	, m_bPending( false )
+	, m_nGeneration( 0 )
+	, m_bShutdown( false )
+{
+	m_thread = std::thread( &PlaylistPrefetcher::run, this );
+}
+
+PlaylistPrefetcher::~PlaylistPrefetcher()
+{
+	stop();
+}
+
+void PlaylistPrefetcher::update()
+{
+	auto pPreferences = Preferences::get_instance();
+	auto pPlaylist = Hydrogen::get_instance()->getPlaylist();
+
+	QStringList paths;
+	if ( pPlaylist != nullptr ) {
+		for ( int ii = pPlaylist->getActiveSongNumber() + 1;
+			  ii < pPlaylist->size() &&
+				  paths.size() < pPreferences->m_nPlaylistPrefetchSongs; ++ii ) {
+			const auto pEntry = pPlaylist->get( ii );
+			if ( pEntry != nullptr && pEntry->getSongExists() ) {
+				paths << Filesystem::absolute_path( pEntry->getSongPath(), true );
+			}
+		}
+	}
+
+	// Songs no longer required are released outside of the lock.
+	std::vector<Entry> discarded;
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		// Songs loaded for the previous list are not stored anymore.
+		++m_nGeneration;
+
+		for ( auto it = m_entries.begin(); it != m_entries.end(); ) {
+			if ( ! paths.contains( it->sPath ) ) {
+				INFOLOG( QString( "Discarding prefetched song [%1]" )
+						 .arg( it->sPath ) );
+				discarded.push_back( std::move( *it ) );
+				it = m_entries.erase( it );
+			} else {
+				++it;
+			}
+		}
+
+		m_bPending = static_cast<size_t>(paths.size()) != m_entries.size();
+		m_paths = paths;
+		m_nBudget = static_cast<qint64>(pPreferences->m_nPlaylistPrefetchMemory)
+			* 1024 * 1024;
+	}
+	m_condition.notify_one();
+}
+
+std::shared_ptr<Song> PlaylistPrefetcher::take( const QString& sPath )
+{
+	const QString sAbsolutePath = Filesystem::absolute_path( sPath, true );
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	for ( auto it = m_entries.begin(); it != m_entries.end(); ++it ) {
+		if ( it->sPath == sAbsolutePath ) {
+			auto entry = std::move( *it );
+			m_entries.erase( it );
+
+			if ( QFileInfo( sAbsolutePath ).lastModified() != entry.lastModified ) {
+				INFOLOG( QString( "Prefetched song [%1] was altered on disk" )
+						 .arg( sAbsolutePath ) );
+				return nullptr;
+			}
+
+			// Loaded from the original file path as Song::load() would.
+			entry.pSong->setFilename( sPath );
+			INFOLOG( QString( "Using prefetched song [%1]" ).arg( sPath ) );
+			return entry.pSong;
+		}
+	}
+
+	return nullptr;
+}
+
+bool PlaylistPrefetcher::isPrefetched( const QString& sPath ) const
+{
+	const QString sAbsolutePath = Filesystem::absolute_path( sPath, true );
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+	for ( const auto& entry : m_entries ) {
+		if ( entry.sPath == sAbsolutePath ) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void PlaylistPrefetcher::clear()
+{
+	std::vector<Entry> discarded;
+	std::lock_guard<std::mutex> lock( m_mutex );
+	++m_nGeneration;
+	m_bPending = false;
+	discarded.swap( m_entries );
+}
+
+void PlaylistPrefetcher::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_bShutdown = true;
+	}
+	m_condition.notify_one();
+	if ( m_thread.joinable() ) {
+		m_thread.join();
+	}
+
+	clear();
+}
+
+bool PlaylistPrefetcher::isCancelled( int nGeneration ) const
+{
+	return m_bShutdown || m_nGeneration != nGeneration;
+}
+
+void PlaylistPrefetcher::run()
+{
+	while ( true ) {
+		QStringList paths;
+		qint64 nBudget;
+		int nGeneration;
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_condition.wait( lock, [&]() {
+				return m_bShutdown || m_bPending; } );
+			if ( m_bShutdown ) {
+				return;
+			}
+			m_bPending = false;
+			paths = m_paths;
+			nBudget = m_nBudget;
+			nGeneration = m_nGeneration;
+		}
+
+		prefetch( paths, nBudget, nGeneration );
+	}
+}
+
+void PlaylistPrefetcher::prefetch( const QStringList& paths, qint64 nBudget,
+								   int nGeneration )
+{
+	for ( const auto& sPath : paths ) {
+		qint64 nUsed = 0;
+		bool bPresent = false;
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			for ( const auto& entry : m_entries ) {
+				nUsed += entry.nBytes;
+				if ( entry.sPath == sPath ) {
+					bPresent = true;
+				}
+			}
+		}
+		if ( bPresent ) {
+			continue;
+		}
+
+		if ( isCancelled( nGeneration ) ) {
+			return;
+		}
+
+		const auto lastModified = QFileInfo( sPath ).lastModified();
+		auto pSong = Song::load( sPath, true );
+		if ( pSong == nullptr || pSong->getDrumkit() == nullptr ) {
+			WARNINGLOG( QString( "Unable to prefetch song [%1]" ).arg( sPath ) );
+			continue;
+		}
+
+		// Loading the samples is the expensive part. Bail out before
+		// reading them in case the song won't fit anyway.
+		const qint64 nEstimate = estimateSampleMemory( pSong->getDrumkit() );
+		if ( nUsed + nEstimate > nBudget ) {
+			INFOLOG( QString( "Song [%1] would require about [%2] MiB of sample data and exceeds the prefetch budget" )
+					 .arg( sPath ).arg( nEstimate / 1024 / 1024 ) );
+			return;
+		}
+
+		if ( ! pSong->getDrumkit()->loadSamples(
+				 pSong->getBpm(), [&]() { return isCancelled( nGeneration ); } ) ) {
+			// Either aborted by us or by a song or drumkit switch
+			// requiring the disk bandwidth. We will catch up on the
+			// next update().
+			return;
+		}
+
+		const qint64 nBytes = sampleMemory( pSong->getDrumkit() );
+		if ( nUsed + nBytes > nBudget ) {
+			// Songs later on in the playlist are not prefetched
+			// either. The next one to be played is the most
+			// important and we do not want to skip it.
+			INFOLOG( QString( "Song [%1] requires [%2] MiB of sample data and exceeds the prefetch budget" )
+					 .arg( sPath ).arg( nBytes / 1024 / 1024 ) );
+			return;
+		}
+
+		INFOLOG( QString( "Prefetched song [%1] using [%2] MiB" )
+				 .arg( sPath ).arg( nBytes / 1024 / 1024 ) );
+
+		std::lock_guard<std::mutex> lock( m_mutex );
+		// The playlist might have changed while loading.
+		if ( isCancelled( nGeneration ) ) {
+			return;
+		}
+		m_entries.push_back( { sPath, lastModified, pSong, nBytes } );
+	}
+}
+
+/** Calls @a fn for all samples of @a pDrumkit. */
+template<typename F>
+static void forEachSample( std::shared_ptr<Drumkit> pDrumkit, F fn )
+{
+	if ( pDrumkit == nullptr ) {
+		return;
+	}
+
+	for ( const auto& pInstrument : *pDrumkit->getInstruments() ) {
+		if ( pInstrument == nullptr ) {
+			continue;
+		}
+		for ( const auto& pComponent : *pInstrument->get_components() ) {
+			if ( pComponent == nullptr ) {
+				continue;
+			}
+			for ( const auto& pLayer : pComponent->get_layers() ) {
+				if ( pLayer == nullptr ) {
+					continue;
+				}
+				const auto pSample = pLayer->get_sample();
+				if ( pSample != nullptr ) {
+					fn( pSample );
+				}
+			}
+		}
+	}
+}
+
+qint64 PlaylistPrefetcher::sampleMemory( std::shared_ptr<Drumkit> pDrumkit )
+{
+	qint64 nBytes = 0;
+	forEachSample( pDrumkit, [&]( std::shared_ptr<Sample> pSample ) {
+		if ( pSample->isLoaded() ) {
+			nBytes += static_cast<qint64>(pSample->get_frames()) *
+				sizeof( float ) * 2;
+		}
+	} );
+
+	return nBytes;
+}
+
+qint64 PlaylistPrefetcher::estimateSampleMemory( std::shared_ptr<Drumkit> pDrumkit )
+{
+	qint64 nBytes = 0;
+	forEachSample( pDrumkit, [&]( std::shared_ptr<Sample> pSample ) {
+		qint64 nFrames = 0;
+		if ( pSample->isLoaded() ) {
+			nFrames = pSample->get_frames();
+		}
+		else {
+			// Only the header of the file is read.
+			SF_INFO info = {0};
+			SNDFILE* pFile = sf_open( pSample->get_filepath().toLocal8Bit(),
+									  SFM_READ, &info );
+			if ( pFile == nullptr ) {
+				return;
+			}
+			nFrames = info.frames;
+			sf_close( pFile );
+		}
+		// Both channels are stored regardless of the file's layout.
+		nBytes += nFrames * sizeof( float ) * 2;
+	} );
+
+	return nBytes;
+}
+
+};
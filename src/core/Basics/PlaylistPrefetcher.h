@@ -0,0 +1,144 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+#ifndef H2C_PLAYLIST_PREFETCHER_H
+#define H2C_PLAYLIST_PREFETCHER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <QDateTime>
+#include <QStringList>
+
+#include <core/Object.h>
+
+namespace H2Core
+{
+
+class Drumkit;
+class Song;
+
+/**
+ * Loads the songs following the active one in the current #Playlist
+ * - including all their samples - in the background.
+ *
+ * Moving on to the next song of a set usually results in a gap of
+ * several seconds while its drumkit is read from disk. Instead, the
+ * next Preferences::m_nPlaylistPrefetchSongs songs are kept in memory
+ * as long as their sample data does not exceed
+ * Preferences::m_nPlaylistPrefetchMemory. CoreActionController::loadSong()
+ * picks them up and only has to hand over the already loaded song.
+ *
+ * Songs are loaded by a single persistent worker thread. update() and
+ * clear() are called by the GUI, MIDI, and OSC handlers and must not
+ * block these. They only hand the new list of songs to the worker,
+ * abort a load in progress, and return right away.
+ *
+ * \ingroup docCore
+ */
+class PlaylistPrefetcher : public H2Core::Object<PlaylistPrefetcher>
+{
+	H2_OBJECT(PlaylistPrefetcher)
+public:
+	PlaylistPrefetcher();
+	~PlaylistPrefetcher();
+
+	/**
+	 * Discards all prefetched songs no longer following the active
+	 * one of the current playlist and starts loading the missing ones.
+	 *
+	 * Has to be called whenever the active song or the content of
+	 * the playlist changed. It does not wait for a load in progress
+	 * to be aborted.
+	 */
+	void update();
+
+	/**
+	 * Hands over the prefetched song stored in @a sPath.
+	 *
+	 * The song is removed from the cache. In case it is not
+	 * completely loaded yet or the file was altered in the meantime,
+	 * nullptr is returned.
+	 */
+	std::shared_ptr<Song> take( const QString& sPath );
+
+	/** Whether the song stored in @a sPath is completely loaded and
+	 * ready to be handed over. */
+	bool isPrefetched( const QString& sPath ) const;
+
+	/** Aborts loading and discards all prefetched songs. */
+	void clear();
+
+	/** Aborts loading and waits for the worker thread to finish. */
+	void stop();
+
+	/** \return Amount of memory in bytes used by all loaded samples
+	 * of @a pDrumkit. */
+	static qint64 sampleMemory( std::shared_ptr<Drumkit> pDrumkit );
+
+	/** \return Amount of memory in bytes all samples of @a pDrumkit
+	 * will use once loaded. For samples not loaded yet, only the
+	 * headers of their files are read. */
+	static qint64 estimateSampleMemory( std::shared_ptr<Drumkit> pDrumkit );
+
+private:
+	struct Entry {
+		QString sPath;
+		QDateTime lastModified;
+		std::shared_ptr<Song> pSong;
+		qint64 nBytes;
+	};
+
+	void run();
+	/** Loads all songs in @a paths not prefetched yet as long as
+	 * they fit into @a nBudget. */
+	void prefetch( const QStringList& paths, qint64 nBudget,
+				   int nGeneration );
+	/** Whether the work handed over with @a nGeneration was
+	 * superseded by a later call to update() or clear(). */
+	bool isCancelled( int nGeneration ) const;
+
+	/** Guards #m_entries and the work handed over to the worker
+	 * thread. */
+	mutable std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::vector<Entry> m_entries;
+
+	/** Songs to be prefetched. */
+	QStringList m_paths;
+	qint64 m_nBudget;
+	/** Whether #m_paths was not picked up by the worker yet. */
+	bool m_bPending;
+	/** Incremented by each update() and clear() to abort the load in
+	 * progress. */
+	std::atomic<int> m_nGeneration;
+	std::atomic<bool> m_bShutdown;
+
+	std::thread m_thread;
+};
+
+};
+
+#endif
@@ -22,14 +22,30 @@
 
 
 
+#include <algorithm>
+#include <cstdint>
 #include <limits>
 #include <memory>
+#include <vector>
 
 #include <core/Hydrogen.h>
 #include <core/Preferences/Preferences.h>
 #include <core/Helpers/Filesystem.h>
 #include <core/Basics/Sample.h>
 #include <core/Basics/Note.h>
+#include <core/Basics/SampleCache.h>
+#include <core/Basics/SampleRegistry.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryFile>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #if defined(H2CORE_HAVE_RUBBERBAND) || _DOXYGEN_
 #include <rubberband/RubberBandStretcher.h>
@@ -62,43 +78,204 @@ EnvelopePoint::EnvelopePoint( const EnvelopePoint& other ) : Object(other), fram
 }
 /* EnvelopePoint */
 
+/* Buffer */
+Sample::Buffer::Buffer()
+	: m_pStorage( nullptr )
+	, m_pLeft( nullptr )
+	, m_pRight( nullptr )
+	, m_nFrames( 0 )
+	, m_bMapped( false )
+{
+}
+
+size_t Sample::Buffer::paddedFrames( int nFrames )
+{
+	const size_t nAlignmentFrames = nAlignment / sizeof( float );
+	return ( static_cast<size_t>(nFrames) + nAlignmentFrames - 1 ) /
+		nAlignmentFrames * nAlignmentFrames;
+}
+
+size_t Sample::Buffer::bytesFor( int nFrames )
+{
+	if ( nFrames <= 0 ) {
+		return 0;
+	}
+	return ( 3 * nGuardFrames + 2 * paddedFrames( nFrames ) ) * sizeof( float );
+}
+
+Sample::Buffer::Buffer( int nFrames )
+	: m_pStorage( nullptr )
+	, m_pLeft( nullptr )
+	, m_pRight( nullptr )
+	, m_nFrames( 0 )
+	, m_bMapped( false )
+{
+	if ( nFrames <= 0 ) {
+		return;
+	}
+
+	// Pad each channel to a multiple of the alignment so the second
+	// one starts aligned as well. nGuardFrames is a multiple of the
+	// alignment too.
+	static_assert( nGuardFrames * sizeof( float ) % nAlignment == 0,
+				   "guard frames must preserve the alignment" );
+	const size_t nAlignmentFrames = nAlignment / sizeof( float );
+	const size_t nPaddedFrames = paddedFrames( nFrames );
+	const size_t nTotalFrames = bytesFor( nFrames ) / sizeof( float );
+
+	// Allocate some extra space to align the data manually. All of it
+	// is zero-initialized.
+	float* pRaw = new float[ nTotalFrames + nAlignmentFrames ]();
+	m_pStorage = std::shared_ptr<void>(
+		pRaw, []( void* p ) { delete[] static_cast<float*>( p ); } );
+	const uintptr_t nAddress = reinterpret_cast<uintptr_t>(pRaw);
+	float* pAligned = reinterpret_cast<float*>(
+		( nAddress + nAlignment - 1 ) / nAlignment * nAlignment );
+
+	m_pLeft = pAligned + nGuardFrames;
+	m_pRight = m_pLeft + nPaddedFrames + nGuardFrames;
+	m_nFrames = nFrames;
+}
+
+Sample::Buffer Sample::Buffer::map( const QString& sPath, qint64 nOffset, int nFrames )
+{
+	Buffer buffer;
+	if ( nFrames <= 0 || nOffset < 0 || nOffset % nAlignment != 0 ) {
+		return buffer;
+	}
+
+	const size_t nBytes = bytesFor( nFrames );
+
+#ifndef WIN32
+	const int fd = ::open( sPath.toLocal8Bit().data(), O_RDONLY );
+	if ( fd < 0 ) {
+		return buffer;
+	}
+
+	struct stat fileStat;
+	if ( fstat( fd, &fileStat ) != 0 ||
+		 static_cast<size_t>( fileStat.st_size ) < nOffset + nBytes ) {
+		::close( fd );
+		return buffer;
+	}
+
+	// Prefaulting only avoids the initial page faults. It does not pin
+	// the pages in memory.
+	int nFlags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+	nFlags |= MAP_POPULATE;
+#endif
+	const size_t nMappingBytes = nOffset + nBytes;
+	void* pMapping = mmap( nullptr, nMappingBytes, PROT_READ | PROT_WRITE,
+						   nFlags, fd, 0 );
+	// The mapping stays valid after closing the file.
+	::close( fd );
+	if ( pMapping == MAP_FAILED ) {
+		return buffer;
+	}
+
+	buffer.m_pStorage = std::shared_ptr<void>(
+		pMapping, [nMappingBytes]( void* p ) { munmap( p, nMappingBytes ); } );
+	buffer.m_bMapped = true;
+	buffer.m_pLeft = reinterpret_cast<float*>(
+		static_cast<char*>( pMapping ) + nOffset ) + nGuardFrames;
+#else
+	QFile file( sPath );
+	if ( ! file.open( QIODevice::ReadOnly ) ||
+		 file.size() < static_cast<qint64>( nOffset + nBytes ) ||
+		 ! file.seek( nOffset ) ) {
+		return buffer;
+	}
+
+	buffer = Buffer( nFrames );
+	if ( file.read( reinterpret_cast<char*>( buffer.m_pLeft - nGuardFrames ),
+					nBytes ) != static_cast<qint64>( nBytes ) ) {
+		return Buffer();
+	}
+#endif
+
+	buffer.m_pRight = buffer.m_pLeft + paddedFrames( nFrames ) + nGuardFrames;
+	buffer.m_nFrames = nFrames;
+	return buffer;
+}
+
+Sample::Buffer Sample::Buffer::share() const
+{
+	Buffer buffer;
+	buffer.m_pStorage = m_pStorage;
+	buffer.m_pLeft = m_pLeft;
+	buffer.m_pRight = m_pRight;
+	buffer.m_nFrames = m_nFrames;
+	buffer.m_bMapped = m_bMapped;
+	return buffer;
+}
+
+Sample::Buffer::Buffer( Buffer&& other )
+	: m_pStorage( std::move( other.m_pStorage ) )
+	, m_pLeft( other.m_pLeft )
+	, m_pRight( other.m_pRight )
+	, m_nFrames( other.m_nFrames )
+	, m_bMapped( other.m_bMapped )
+{
+	other.m_pLeft = other.m_pRight = nullptr;
+	other.m_nFrames = 0;
+	other.m_bMapped = false;
+}
+
+Sample::Buffer& Sample::Buffer::operator=( Buffer&& other )
+{
+	if ( this != &other ) {
+		m_pStorage = std::move( other.m_pStorage );
+		m_pLeft = other.m_pLeft;
+		m_pRight = other.m_pRight;
+		m_nFrames = other.m_nFrames;
+		m_bMapped = other.m_bMapped;
+		other.m_pLeft = other.m_pRight = nullptr;
+		other.m_nFrames = 0;
+		other.m_bMapped = false;
+	}
+	return *this;
+}
+
+Sample::Buffer::~Buffer()
+{
+}
+/* Buffer */
+
 
 Sample::Sample( const QString& filepath, const License& license, int frames, int sample_rate, float* data_l, float* data_r ) 
   : __filepath( filepath ),
 	__frames( frames ),
 	__sample_rate( sample_rate ),
-	__data_l( data_l ),
-	__data_r( data_r ),
 	__is_modified( false ),
 	m_license( license )
 {
 	if ( filepath.lastIndexOf( "/" ) <= 0 ) {
 		WARNINGLOG( QString( "Provided filepath [%1] does not seem like an absolute path. Sample will most probably be unable to load." ) );
 	}
+
+	if ( data_l != nullptr && data_r != nullptr && frames > 0 ) {
+		m_buffer = Buffer( frames );
+		memcpy( m_buffer.left(), data_l, frames * sizeof( float ) );
+		memcpy( m_buffer.right(), data_r, frames * sizeof( float ) );
+	}
+	delete[] data_l;
+	delete[] data_r;
 }
 
 Sample::Sample( std::shared_ptr<Sample> pOther ): Object( *pOther ),
 	__filepath( pOther->get_filepath() ),
 	__frames( pOther->get_frames() ),
 	__sample_rate( pOther->get_sample_rate() ),
-	__data_l( nullptr ),
-	__data_r( nullptr ),
+	m_buffer( pOther->m_buffer.share() ),
 	__is_modified( pOther->get_is_modified() ),
 	__loops( pOther->__loops ),
 	__rubberband( pOther->__rubberband ),
 	m_license( pOther->m_license )
 {
+	// The audio data itself is shared. It is never altered in place
+	// but replaced by load().
 
-	__data_l = new float[__frames];
-	__data_r = new float[__frames];
-	
-	// Since the third argument of memcpy takes the number of bytes,
-	// which are about to be copied, and the data is given in float,
-	// which are  four bytes each, the number of copied frames
-	// `__frames` has to be multiplied by four.
-	memcpy( __data_l, pOther->get_data_l(), __frames * 4 );
-	memcpy( __data_r, pOther->get_data_r(), __frames * 4 );
-	
 	auto pPan = pOther->get_pan_envelope();
 	for( int i=0; i<pPan.size(); i++ ) {
 		__pan_envelope.push_back( pPan.at(i) );
@@ -112,12 +289,6 @@ Sample::Sample( std::shared_ptr<Sample> pOther ): Object( *pOther ),
 
 Sample::~Sample()
 {
-	if ( __data_l != nullptr ) {
-		delete[] __data_l;
-	}
-	if ( __data_r != nullptr ) {
-		delete[] __data_r;
-	}
 }
 
 void Sample::set_filename( const QString& filename )
@@ -155,6 +326,19 @@ std::shared_ptr<Sample> Sample::load( const QString& sFilepath, const License& l
 
 bool Sample::load( float fBpm )
 {
+	// Processed data already used by another sample - or stored by
+	// a previous run or another Hydrogen instance - can be used right
+	// away.
+	const QString sKey = SampleCache::getKey( this, fBpm );
+	const bool bUseCache = SampleCache::isEnabled() && ! sKey.isEmpty();
+	if ( ! sKey.isEmpty() && SampleRegistry::acquire( this, sKey ) ) {
+		return true;
+	}
+	if ( bUseCache && SampleCache::load( this, sKey ) ) {
+		SampleRegistry::insert( this, sKey );
+		return true;
+	}
+
 	// Will contain a bunch of metadata about the loaded sample.
 	SF_INFO sound_info = {0};
 
@@ -167,6 +351,7 @@ bool Sample::load( float fBpm )
 	
 	// Sanity check. SAMPLE_CHANNELS is defined in
 	// core/include/hydrogen/globals.h and set to 2.
+	const int nFileChannels = sound_info.channels;
 	if ( sound_info.channels > SAMPLE_CHANNELS ) {
 		WARNINGLOG( QString( "can't handle %1 channels, only 2 will be used" ).arg( sound_info.channels ) );
 		sound_info.channels = SAMPLE_CHANNELS;
@@ -176,54 +361,69 @@ bool Sample::load( float fBpm )
 		sound_info.frames = ( std::numeric_limits<int>::max()/sound_info.channels );
 	}
 
-	// Create an array, which will hold the block of samples read
-	// from file.
-	float* buffer = new float[ sound_info.frames * sound_info.channels ];
-	
-	//memset( buffer, 0, sound_info.frames *sound_info.channels );
-	
-	// Read all frames into `buffer'. Libsndfile does seamlessly
-	// convert the format of the underlying data on the fly. The
-	// output will be an array of floats regardless of file's
-	// encoding (e.g. 16 bit PCM).
-	sf_count_t count = sf_read_float( file, buffer, sound_info.frames * sound_info.channels );
-	if( count==0 ){
-		WARNINGLOG( QString( "%1 is an empty sample" ).arg( get_filepath() ) );
-	}
-	
-	// Deallocate the handler.
-	if ( sf_close( file ) != 0 ){
-		WARNINGLOG( QString( "Unable to close sample file %1" ).arg( get_filepath() ) );
-	}
-	
 	// Flush the current content of the left and right channel and
 	// the current metadata.
 	unload();
-	
+
 	// Save the metadata of the loaded file into private members
 	// of the Sample class.
 	__frames = sound_info.frames;
 	__sample_rate = sound_info.samplerate;
 
-	// Split the loaded frames into left and right channel. 
-	// If only one channels was present in the underlying data,
-	// duplicate its content.
-	__data_l = new float[ sound_info.frames ];
-	__data_r = new float[ sound_info.frames ];
-	if ( sound_info.channels == 1 ) {
-		memcpy( __data_l, buffer, __frames * sizeof( float ) );
-		memcpy( __data_r, buffer, __frames * sizeof( float ) );
-	} else if ( sound_info.channels == SAMPLE_CHANNELS ) {
-		for ( int i = 0; i < __frames; i++ ) {
-			__data_l[i] = buffer[i * SAMPLE_CHANNELS ];
-			__data_r[i] = buffer[i * SAMPLE_CHANNELS + 1 ];
+	// Read the frames chunk by chunk and split them into left and
+	// right channel right away. This way no interleaved copy of the
+	// whole file is required. Libsndfile does seamlessly convert the
+	// format of the underlying data on the fly. The output will be
+	// floats regardless of file's encoding (e.g. 16 bit PCM). If only
+	// one channels was present in the underlying data, duplicate its
+	// content.
+	m_buffer = Buffer( __frames );
+	float* pData_L = data_l();
+	float* pData_R = data_r();
+	sf_count_t nFramesRead = 0;
+	if ( nFileChannels == 1 ) {
+		nFramesRead = sf_readf_float( file, pData_L, __frames );
+		memcpy( pData_R, pData_L, __frames * sizeof( float ) );
+	}
+	else if ( __frames > 0 ) {
+		const int nChunkFrames = std::min( Sample::nLoadChunkFrames, __frames );
+		std::vector<float> chunk( nChunkFrames * nFileChannels );
+		while ( nFramesRead < __frames ) {
+			const sf_count_t nCount = sf_readf_float(
+				file, chunk.data(),
+				std::min( static_cast<sf_count_t>(nChunkFrames),
+						  __frames - nFramesRead ) );
+			if ( nCount <= 0 ) {
+				break;
+			}
+			for ( sf_count_t ii = 0; ii < nCount; ++ii ) {
+				pData_L[ nFramesRead + ii ] = chunk[ ii * nFileChannels ];
+				pData_R[ nFramesRead + ii ] = chunk[ ii * nFileChannels + 1 ];
+			}
+			nFramesRead += nCount;
 		}
 	}
-	delete[] buffer;
+	if( nFramesRead == 0 ){
+		WARNINGLOG( QString( "%1 is an empty sample" ).arg( get_filepath() ) );
+	}
+	else if ( nFramesRead != __frames ) {
+		WARNINGLOG( QString( "Only [%1/%2] frames of %3 could be read" )
+					.arg( nFramesRead ).arg( __frames ).arg( get_filepath() ) );
+	}
+
+	// Only data processed completely can be shared with other
+	// samples and instances via SampleRegistry and SampleCache.
+	bool bComplete = nFramesRead > 0 && nFramesRead == __frames;
+
+	// Deallocate the handler.
+	if ( sf_close( file ) != 0 ){
+		WARNINGLOG( QString( "Unable to close sample file %1" ).arg( get_filepath() ) );
+	}
 
 	// Apply modifiers (if present/altered).
 	if ( ! apply_loops() ) {
 		WARNINGLOG( "Unable to apply loops" );
+		bComplete = false;
 	}
 	apply_velocity();
 	apply_pan();
@@ -232,9 +432,17 @@ bool Sample::load( float fBpm )
 #else
 	if ( ! exec_rubberband_cli( fBpm ) ) {
 		WARNINGLOG( "Unable to apply rubberband" );
+		bComplete = false;
 	}
 #endif
 
+	if ( ! sKey.isEmpty() && bComplete ) {
+		if ( bUseCache ) {
+			SampleCache::store( this, sKey );
+		}
+		SampleRegistry::insert( this, sKey );
+	}
+
 	return true;
 }
 
@@ -274,36 +482,42 @@ bool Sample::apply_loops()
 	int loop_length =  __loops.end_frame - __loops.loop_frame;
 	int new_length = full_length + loop_length * __loops.count;
 
-	float* new_data_l = new float[ new_length ];
-	float* new_data_r = new float[ new_length ];
+	// The guard frames of the buffer make reading at end_frame, which
+	// is one past the last frame of the sample if both are equal,
+	// safe.
+	const float* pData_L = m_buffer.left();
+	const float* pData_R = m_buffer.right();
+	Buffer newBuffer( new_length );
+	float* new_data_l = newBuffer.left();
+	float* new_data_r = newBuffer.right();
 
 	// copy full_length frames to new_data
 	if ( __loops.mode==Loops::REVERSE && ( __loops.count==0 || full_loop ) ) {
 		if( full_loop ) {
 			// copy end => start
 			for( int i=0, j=__loops.end_frame; i<full_length; i++, j-- ) {
-				new_data_l[i]=__data_l[j];
+				new_data_l[i]=pData_L[j];
 			}
 			for( int i=0, j=__loops.end_frame; i<full_length; i++, j-- ) {
-				new_data_r[i]=__data_r[j];
+				new_data_r[i]=pData_R[j];
 			}
 		} else {
 			// copy start => loop
 			int to_loop = __loops.loop_frame - __loops.start_frame;
-			memcpy( new_data_l, __data_l+__loops.start_frame, sizeof( float )*to_loop );
-			memcpy( new_data_r, __data_r+__loops.start_frame, sizeof( float )*to_loop );
+			memcpy( new_data_l, pData_L+__loops.start_frame, sizeof( float )*to_loop );
+			memcpy( new_data_r, pData_R+__loops.start_frame, sizeof( float )*to_loop );
 			// copy end => loop
 			for( int i=to_loop, j=__loops.end_frame; i<full_length; i++, j-- ) {
-				new_data_l[i]=__data_l[j];
+				new_data_l[i]=pData_L[j];
 			}
 			for( int i=to_loop, j=__loops.end_frame; i<full_length; i++, j-- ) {
-				new_data_r[i]=__data_r[j];
+				new_data_r[i]=pData_R[j];
 			}
 		}
 	} else {
 		// copy start => end
-		memcpy( new_data_l, __data_l+__loops.start_frame, sizeof( float )*full_length );
-		memcpy( new_data_r, __data_r+__loops.start_frame, sizeof( float )*full_length );
+		memcpy( new_data_l, pData_L+__loops.start_frame, sizeof( float )*full_length );
+		memcpy( new_data_r, pData_R+__loops.start_frame, sizeof( float )*full_length );
 	}
 	// copy the loops
 	if( __loops.count>0 ) {
@@ -313,15 +527,15 @@ bool Sample::apply_loops()
 		for( int i=0; i<__loops.count; i++ ) {
 			if ( forward ) {
 				// copy loop => end
-				memcpy( &new_data_l[x], __data_l+__loops.loop_frame, sizeof( float )*loop_length );
-				memcpy( &new_data_r[x], __data_r+__loops.loop_frame, sizeof( float )*loop_length );
+				memcpy( &new_data_l[x], pData_L+__loops.loop_frame, sizeof( float )*loop_length );
+				memcpy( &new_data_r[x], pData_R+__loops.loop_frame, sizeof( float )*loop_length );
 			} else {
 				// copy end => loop
 				for( int i=__loops.end_frame, y=x; i>__loops.loop_frame; i--, y++ ) {
-					new_data_l[y]=__data_l[i];
+					new_data_l[y]=pData_L[i];
 				}
 				for( int i=__loops.end_frame, y=x; i>__loops.loop_frame; i--, y++ ) {
-					new_data_r[y]=__data_r[i];
+					new_data_r[y]=pData_R[i];
 				}
 			}
 			x+=loop_length;
@@ -331,10 +545,7 @@ bool Sample::apply_loops()
 		}
 		assert( x==new_length );
 	}
-	delete[] __data_l;
-	delete[] __data_r;
-	__data_l = new_data_l;
-	__data_r = new_data_r;
+	m_buffer = std::move( newBuffer );
 	__frames = new_length;
 	__is_modified = true;
 	
@@ -351,6 +562,8 @@ void Sample::apply_velocity()
 		return;
 	}
 	
+	float* pData_L = data_l();
+	float* pData_R = data_r();
 	float inv_resolution = __frames / 841.0F;
 	for ( int i = 1; i < __velocity_envelope.size(); i++ ) {
 		float y = ( 91 - __velocity_envelope[i - 1].value ) / 91.0F;
@@ -363,8 +576,8 @@ void Sample::apply_velocity()
 		int length = end_frame - start_frame ;
 		float step = ( y - k ) / length;;
 		for ( int z = start_frame ; z < end_frame; z++ ) {
-			__data_l[z] = __data_l[z] * y;
-			__data_r[z] = __data_r[z] * y;
+			pData_L[z] = pData_L[z] * y;
+			pData_R[z] = pData_R[z] * y;
 			y-=step;
 		}
 	}
@@ -378,6 +591,8 @@ void Sample::apply_pan()
 		return;
 	}
 	
+	float* pData_L = data_l();
+	float* pData_R = data_r();
 	float inv_resolution = __frames / 841.0F;
 	for ( int i = 1; i < __pan_envelope.size(); i++ ) {
 		float y = ( 45 - __pan_envelope[i - 1].value ) / 45.0F;
@@ -393,15 +608,15 @@ void Sample::apply_pan()
 			// seems wrong to modify only one channel ?!?!
 			if( y < 0 ) {
 				float k = 1 + y;
-				__data_l[z] = __data_l[z] * k;
-				__data_r[z] = __data_r[z];
+				pData_L[z] = pData_L[z] * k;
+				pData_R[z] = pData_R[z];
 			} else if ( y > 0 ) {
 				float k = 1 - y;
-				__data_l[z] = __data_l[z];
-				__data_r[z] = __data_r[z] * k;
+				pData_L[z] = pData_L[z];
+				pData_R[z] = pData_R[z] * k;
 			} else if( y==0 ) {
-				__data_l[z] = __data_l[z];
-				__data_r[z] = __data_r[z];
+				pData_L[z] = pData_L[z];
+				pData_R[z] = pData_R[z];
 			}
 			y-=step;
 		}
@@ -456,8 +671,8 @@ void Sample::apply_rubberband( float fBpm ) {
 	// when encountering tempo changes, we will use Rubber Band's
 	// real-time processing mode.
 	if ( !Preferences::get_instance()->getRubberBandBatchMode() ) {
-		ibuf[0] = __data_l;
-		ibuf[1] = __data_r;
+		ibuf[0] = data_l();
+		ibuf[1] = data_r();
 		rubber.study( ibuf, __frames, true );
 	} else {
 		rubber.setMaxProcessSize( block_size );
@@ -480,14 +695,8 @@ void Sample::apply_rubberband( float fBpm ) {
 		}
 		bool final = (processed + nRequired >= __frames);
 		int ibs = (final ? (__frames-processed) : nRequired );
-		float tempIbufL[ibs];
-		float tempIbufR[ibs];
-		for(int i = 0 ; i < ibs; i++) {
-			tempIbufL[i] = __data_l[i + processed];
-			tempIbufR[i] = __data_r[i + processed];
-		}
-		ibuf[0] = tempIbufL;
-		ibuf[1] = tempIbufR;
+		ibuf[0] = &data_l()[ processed ];
+		ibuf[1] = &data_r()[ processed ];
 		rubber.process( ibuf, ibs, final );
 		processed += ibs;
 
@@ -563,12 +772,10 @@ void Sample::apply_rubberband( float fBpm ) {
 		retrieved += n;
 	}
 	
-	delete [] __data_l;
-	delete [] __data_r;
-	__data_l = new float[ retrieved ];
-	__data_r = new float[ retrieved ];
-	memcpy( __data_l, out_data_l, retrieved*sizeof( float ) );
-	memcpy( __data_r, out_data_r, retrieved*sizeof( float ) );
+	Buffer newBuffer( retrieved );
+	memcpy( newBuffer.left(), out_data_l, retrieved*sizeof( float ) );
+	memcpy( newBuffer.right(), out_data_r, retrieved*sizeof( float ) );
+	m_buffer = std::move( newBuffer );
 	delete [] out_data_l;
 	delete [] out_data_r;
 
@@ -584,7 +791,7 @@ bool Sample::exec_rubberband_cli( float fBpm )
 		// Default behavior
 		return true;
 	}
-	
+
 	//set the path to rubberband-cli
 	QString program = Preferences::get_instance()->m_rubberBandCLIexecutable;
 	//test the path. if test fails return NULL
@@ -593,7 +800,18 @@ bool Sample::exec_rubberband_cli( float fBpm )
 		return false;
 	}
 
-	QString outfilePath =  QDir::tempPath() + "/tmp_rb_outfile.wav";
+	// Samples are stretched in parallel. Each one requires its own
+	// set of intermediate files.
+	QTemporaryFile outfile( QDir::tempPath() + "/tmp_rb_outfile_XXXXXX.wav" );
+	QTemporaryFile resultFile( QDir::tempPath() + "/tmp_rb_result_file_XXXXXX.wav" );
+	if ( ! outfile.open() || ! resultFile.open() ) {
+		ERRORLOG( "Unable to create temporary files for rubberband" );
+		return false;
+	}
+	outfile.close();
+	resultFile.close();
+
+	QString outfilePath = outfile.fileName();
 	if( !write( outfilePath ) ) {
 		ERRORLOG( "unable to write sample" );
 		return false;
@@ -617,7 +835,7 @@ bool Sample::exec_rubberband_cli( float fBpm )
 	QString rCs = QString( " %1" ).arg( __rubberband.c_settings );
 	float fFrequency = Note::pitchToFrequency( ( double )__rubberband.pitch );
 	QString rFs = QString( " %1" ).arg( fFrequency );
-	QString rubberResultPath = QDir::tempPath() + "/tmp_rb_result_file.wav";
+	QString rubberResultPath = resultFile.fileName();
 
 	arguments << "-D" << QString( " %1" ).arg( durationtime ) 	//stretch or squash to make output file X seconds long
 			  << "--threads"					//assume multi-CPU even if only one CPU is identified
@@ -635,26 +853,20 @@ bool Sample::exec_rubberband_cli( float fBpm )
 	}
 
 	delete pRubberbandProc;
-	if ( QFile( rubberResultPath ).exists() == false ) {
+	if ( QFileInfo( rubberResultPath ).size() == 0 ) {
 		_ERRORLOG( QString( "Rubberband reimporter File %1 not found" ).arg( rubberResultPath ) );
 		return false;
 	}
 
+	// Both intermediate files are removed by QTemporaryFile.
 	auto p_Rubberbanded = Sample::load( rubberResultPath );
 	if( p_Rubberbanded == nullptr ) {
 		return false;
 	}
 
-	QFile( outfilePath ).remove();
-
-	QFile( rubberResultPath ).remove();
-
 	__frames = p_Rubberbanded->get_frames();
 
-	__data_l = p_Rubberbanded->get_data_l();
-	__data_r = p_Rubberbanded->get_data_r();
-	p_Rubberbanded->__data_l = nullptr;
-	p_Rubberbanded->__data_r = nullptr;
+	m_buffer = std::move( p_Rubberbanded->m_buffer );
 
 	__is_modified = true;
 	
@@ -676,10 +888,12 @@ Sample::Loops::LoopMode Sample::parse_loop_mode( const QString& sMode )
 
 bool Sample::write( const QString& path, int format ) const
 {
+	const float* pData_L = m_buffer.left();
+	const float* pData_R = m_buffer.right();
 	float* obuf = new float[ SAMPLE_CHANNELS * __frames ];
 	for ( int i = 0; i < __frames; ++i ) {
-		float value_l = __data_l[i];
-		float value_r = __data_r[i];
+		float value_l = pData_L[i];
+		float value_r = pData_R[i];
 		
 		if ( value_l > 1.f ) {
 			value_l = 1.f;
@@ -67,6 +67,9 @@ class EnvelopePoint : public H2Core::Object<EnvelopePoint>
 class Sample : public H2Core::Object<Sample>
 {
 		H2_OBJECT(Sample)
+		/** Restore and store the processed data. */
+		friend class SampleCache;
+		friend class SampleRegistry;
 	public:
 
 		/** define the type used to store pan envelope points */
@@ -129,6 +132,100 @@ class Sample : public H2Core::Object<Sample>
 				QString toQString( const QString& sPrefix = "", bool bShort = true ) const;
 		};
 
+	/**
+	 * Storage of the audio data of both channels.
+	 *
+	 * Both channels share a single allocation. Each of them starts at
+	 * a boundary of #nAlignment bytes and is surrounded by
+	 * #nGuardFrames frames of silence. Code reading the data - like
+	 * the interpolation in the #Sampler - may thus access up to
+	 * #nGuardFrames frames before the first and after the last one
+	 * without any bounds checking. The guard frames must never be
+	 * written to.
+	 *
+	 * The data can either be allocated on the heap or be mapped from
+	 * a file, see map(). It can be shared among several buffers using
+	 * share() and is released along with the last of them. Shared
+	 * data must not be written to.
+	 */
+	class Buffer
+		{
+			public:
+				/** Number of zero frames in front of and after each
+				 * channel. */
+				static constexpr int nGuardFrames = 16;
+				/** Alignment of the first frame of each channel in
+				 * bytes. */
+				static constexpr int nAlignment = 64;
+
+				/** Empty buffer. Both left() and right() are nullptr. */
+				Buffer();
+				/** Allocates a buffer holding @a nFrames frames of
+				 * silence. */
+				explicit Buffer( int nFrames );
+				Buffer( Buffer&& other );
+				Buffer& operator=( Buffer&& other );
+				Buffer( const Buffer& other ) = delete;
+				Buffer& operator=( const Buffer& other ) = delete;
+				~Buffer();
+
+				/**
+				 * Provides @a nFrames frames stored at byte @a nOffset of
+				 * the file @a sPath. The data has to be laid out like
+				 * data() and @a nOffset must be a multiple of
+				 * #nAlignment.
+				 *
+				 * On POSIX systems the file is mapped copy-on-write. Its
+				 * pages are shared with all other processes mapping the
+				 * same file as long as they are not written to. All of
+				 * them are read in right away. But in contrast to heap
+				 * memory, clean file-backed pages may be evicted under
+				 * memory pressure and read from disk again on the next
+				 * access, e.g. while rendering. On other systems the data
+				 * is read into a regular buffer.
+				 *
+				 * \return Empty buffer in case the file could not be
+				 *   read or is too small.
+				 */
+				static Buffer map( const QString& sPath, qint64 nOffset, int nFrames );
+
+				/** Number of bytes spanned by data() in a buffer of
+				 * @a nFrames frames. */
+				static size_t bytesFor( int nFrames );
+
+				/** Another buffer referring to the same data. */
+				Buffer share() const;
+				/** Number of buffers referring to the data of this
+				 * one - including itself. */
+				long shareCount() const;
+
+				float* left() const;
+				float* right() const;
+				int frames() const;
+				/** Leading guard frame of the left channel. The
+				 * frames of both channels - including all guard
+				 * frames and padding - follow contiguously and span
+				 * bytesFor( frames() ) bytes. */
+				const float* data() const;
+				bool isMapped() const;
+
+			private:
+				/** Number of frames each channel is padded to in
+				 * order to keep the second one aligned. */
+				static size_t paddedFrames( int nFrames );
+
+				/** Owner of the whole allocation or mapping.
+				 * #m_pLeft and #m_pRight point into it. */
+				std::shared_ptr<void> m_pStorage;
+				float* m_pLeft;
+				float* m_pRight;
+				int m_nFrames;
+				bool m_bMapped;
+		};
+
+		/** Number of frames read from disk at once in load(). */
+		static constexpr int nLoadChunkFrames = 65536;
+
 		/**
 		 * Sample constructor
 		 * \param filepath the path to the sample
@@ -137,6 +234,10 @@ class Sample : public H2Core::Object<Sample>
 		 * \param sample_rate the sample rate of the sample
 		 * \param data_l the left channel array of data
 		 * \param data_r the right channel array of data
+		 *
+		 * Both @a data_l and @a data_r have to be allocated using
+		 * `new float[]`. Their content is moved into a #Buffer and
+		 * the arrays are deleted.
 		 */
 		Sample( const QString& filepath, const License& license = License(), int frames=0, int sample_rate=0, float* data_l=nullptr, float* data_r=nullptr );
 		/** copy constructor */
@@ -173,7 +274,7 @@ class Sample : public H2Core::Object<Sample>
 
 		/**
 		 * Load the sample stored in #__filepath into
-		 * #__data_l and #__data_r.
+		 * #m_buffer.
 		 *
 		 * It uses libsndfile for reading both the content and
 		 * the metadata of the sample file. The latter is
@@ -185,7 +286,7 @@ class Sample : public H2Core::Object<Sample>
 		 * content but simply extract the first two channels
 		 * and display a warning message. For mono file the
 		 * same content will be assigned to both the left
-		 * (#__data_l) and right channel (#__data_r).
+		 * and right channel of #m_buffer.
 		 *
 		 * If the total number of frames in the file is larger
 		 * than the maximum value of an `int', the content is
@@ -234,10 +335,16 @@ class Sample : public H2Core::Object<Sample>
 		 * #__frames time sizeof( float ) * 2 
 		 */
 		int get_size() const;
-		/** \return #__data_l*/
-		float* get_data_l() const;
-		/** \return #__data_r*/
-		float* get_data_r() const;
+		/** \return Audio data of both channels */
+		const Buffer& getBuffer() const;
+		/** \return left channel of #m_buffer. The data might be
+		 * shared with other samples and instances and must not be
+		 * written to. */
+		const float* get_data_l() const;
+		/** \return right channel of #m_buffer. The data might be
+		 * shared with other samples and instances and must not be
+		 * written to. */
+		const float* get_data_r() const;
 		/**
 		 * #__is_modified setter
 		 * \param value the new value for #__is_modified
@@ -278,6 +385,12 @@ class Sample : public H2Core::Object<Sample>
 		 * \return String presentation of current object.*/
 		QString toQString( const QString& sPrefix = "", bool bShort = true ) const override;
 	private:
+		/** Writable left channel of #m_buffer. Only to be used by
+		 * load() and the modifiers before the data is shared. */
+		float* data_l();
+		/** Writable right channel of #m_buffer. Only to be used by
+		 * load() and the modifiers before the data is shared. */
+		float* data_r();
 		/**
 		 * apply #__loops transformation to the sample
 		 */
@@ -305,8 +418,7 @@ class Sample : public H2Core::Object<Sample>
 		QString				__filepath;          ///< filepath of the sample
 		int					__frames;            ///< number of frames in this sample
 		int					__sample_rate;       ///< samplerate for this sample
-		float*				__data_l;            ///< left channel data
-		float*				__data_r;            ///< right channel data
+		Buffer				m_buffer;            ///< audio data of both channels
 		bool				__is_modified;       ///< true if sample is modified
 		PanEnvelope			__pan_envelope;      ///< pan envelope vector
 		VelocityEnvelope	__velocity_envelope; ///< velocity envelope vector
@@ -332,20 +444,42 @@ class Sample : public H2Core::Object<Sample>
 
 // DEFINITIONS
 
+inline float* Sample::Buffer::left() const
+{
+	return m_pLeft;
+}
+
+inline float* Sample::Buffer::right() const
+{
+	return m_pRight;
+}
+
+inline int Sample::Buffer::frames() const
+{
+	return m_nFrames;
+}
+
+inline const float* Sample::Buffer::data() const
+{
+	return m_pLeft != nullptr ? m_pLeft - nGuardFrames : nullptr;
+}
+
+inline bool Sample::Buffer::isMapped() const
+{
+	return m_bMapped;
+}
+
+inline long Sample::Buffer::shareCount() const
+{
+	return m_pStorage.use_count();
+}
+
 inline void Sample::unload()
 {
-	if ( __data_l != nullptr ) {
-		delete [] __data_l;
-	}
-	
-	if ( __data_r != nullptr ) {
-		delete [] __data_r;
-	}
+	m_buffer = Buffer();
 	__frames = __sample_rate = 0;
 	/** #__is_modified = false; leave this unchanged as pan,
 	    velocity, loop and rubberband are kept unchanged */
-
-	__data_l = __data_r = nullptr;
 }
 
 inline bool Sample::isLoaded() const {
@@ -392,14 +526,29 @@ inline int Sample::get_size() const
 	return __frames * sizeof( float ) * 2;
 }
 
-inline float* Sample::get_data_l() const
+inline const Sample::Buffer& Sample::getBuffer() const
+{
+	return m_buffer;
+}
+
+inline const float* Sample::get_data_l() const
+{
+	return m_buffer.left();
+}
+
+inline const float* Sample::get_data_r() const
+{
+	return m_buffer.right();
+}
+
+inline float* Sample::data_l()
 {
-	return __data_l;
+	return m_buffer.left();
 }
 
-inline float* Sample::get_data_r() const
+inline float* Sample::data_r()
 {
-	return __data_r;
+	return m_buffer.right();
 }
 
 inline void Sample::set_is_modified( bool is_modified )
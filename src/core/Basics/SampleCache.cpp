@@ -0,0 +1,237 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+#include <core/Basics/SampleCache.h>
+
+#include <core/Basics/Sample.h>
+#include <core/Helpers/Filesystem.h>
+#include <core/Preferences/Preferences.h>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <cstdint>
+#include <cstring>
+
+namespace H2Core
+{
+
+/** Has to be incremented whenever the file layout or the processing
+ * of samples changes. */
+static constexpr uint32_t nCacheVersion = 1;
+static const char sCacheMagic[] = "H2SAMPLE";
+static const QString sCacheSuffix = ".h2cache";
+
+/** Header preceding the sample data. It is padded to nHeaderBytes so
+ * the data starts at an aligned offset. */
+struct CacheHeader {
+	char sMagic[ 8 ];
+	uint32_t nVersion;
+	int32_t nFrames;
+	int32_t nSampleRate;
+	int32_t nIsModified;
+	/** SHA-1 of the key in hex. */
+	char sKey[ 40 ];
+};
+static constexpr int nHeaderBytes = 256;
+static_assert( sizeof( CacheHeader ) <= nHeaderBytes, "header too large" );
+static_assert( nHeaderBytes % Sample::Buffer::nAlignment == 0,
+			   "sample data has to be aligned" );
+
+bool SampleCache::isEnabled()
+{
+	const auto pPref = Preferences::get_instance();
+	return pPref != nullptr && pPref->m_bUseSampleCache;
+}
+
+QString SampleCache::getKey( const Sample* pSample, float fBpm )
+{
+	const QFileInfo info( pSample->get_filepath() );
+	if ( ! info.exists() ) {
+		return "";
+	}
+
+	QString sKey = QString( "%1|%2|%3|%4" )
+		.arg( nCacheVersion )
+		.arg( info.canonicalFilePath() )
+		.arg( info.lastModified().toMSecsSinceEpoch() )
+		.arg( info.size() );
+
+	const auto& loops = pSample->get_loops();
+	sKey.append( QString( "|loops:%1,%2,%3,%4,%5" )
+				 .arg( loops.start_frame ).arg( loops.loop_frame )
+				 .arg( loops.end_frame ).arg( loops.count )
+				 .arg( static_cast<int>( loops.mode ) ) );
+
+	sKey.append( "|velocity:" );
+	for ( const auto& point : pSample->get_velocity_envelope() ) {
+		sKey.append( QString( "%1:%2," ).arg( point.frame ).arg( point.value ) );
+	}
+	sKey.append( "|pan:" );
+	for ( const auto& point : pSample->get_pan_envelope() ) {
+		sKey.append( QString( "%1:%2," ).arg( point.frame ).arg( point.value ) );
+	}
+
+	const auto& rubberband = pSample->get_rubberband();
+	if ( rubberband.use ) {
+		// Only the stretched sample depends on the tempo.
+		sKey.append( QString( "|rubberband:%1,%2,%3,%4" )
+					 .arg( rubberband.divider, 0, 'g', 9 )
+					 .arg( rubberband.pitch, 0, 'g', 9 )
+					 .arg( rubberband.c_settings )
+					 .arg( fBpm, 0, 'g', 9 ) );
+#ifdef H2CORE_HAVE_RUBBERBAND
+		sKey.append( ",lib" );
+#else
+		sKey.append( QString( ",%1" )
+					 .arg( Preferences::get_instance()->m_rubberBandCLIexecutable ) );
+#endif
+	}
+
+	return QString( QCryptographicHash::hash(
+						sKey.toUtf8(), QCryptographicHash::Sha1 ).toHex() );
+}
+
+QString SampleCache::getPath( const QString& sKey )
+{
+	return Filesystem::sample_cache_dir() + sKey + sCacheSuffix;
+}
+
+bool SampleCache::load( Sample* pSample, const QString& sKey )
+{
+	if ( sKey.isEmpty() ) {
+		return false;
+	}
+
+	const QString sPath = getPath( sKey );
+	QFile file( sPath );
+	if ( ! file.open( QIODevice::ReadOnly ) ) {
+		return false;
+	}
+
+	CacheHeader header;
+	if ( file.read( reinterpret_cast<char*>( &header ), sizeof( header ) ) !=
+		 sizeof( header ) ||
+		 memcmp( header.sMagic, sCacheMagic, sizeof( header.sMagic ) ) != 0 ||
+		 header.nVersion != nCacheVersion ||
+		 memcmp( header.sKey, sKey.toLatin1().constData(),
+				 sizeof( header.sKey ) ) != 0 ||
+		 header.nFrames <= 0 ||
+		 file.size() != nHeaderBytes +
+		 static_cast<qint64>( Sample::Buffer::bytesFor( header.nFrames ) ) ) {
+		WARNINGLOG( QString( "Invalid cache entry [%1] of [%2]" )
+					.arg( sPath ).arg( pSample->get_filepath() ) );
+		file.close();
+		Filesystem::rm( sPath, false, true );
+		return false;
+	}
+
+	auto buffer = Sample::Buffer::map( sPath, nHeaderBytes, header.nFrames );
+	if ( buffer.frames() != header.nFrames ) {
+		ERRORLOG( QString( "Unable to map cache entry [%1]" ).arg( sPath ) );
+		return false;
+	}
+
+	// Mark the entry as recently used.
+	file.close();
+	if ( file.open( QIODevice::ReadWrite ) ) {
+		file.setFileTime( QDateTime::currentDateTime(),
+						  QFileDevice::FileModificationTime );
+	}
+
+	pSample->m_buffer = std::move( buffer );
+	pSample->__frames = header.nFrames;
+	pSample->__sample_rate = header.nSampleRate;
+	pSample->__is_modified = header.nIsModified != 0;
+
+	return true;
+}
+
+bool SampleCache::store( const Sample* pSample, const QString& sKey )
+{
+	const auto& buffer = pSample->getBuffer();
+	if ( buffer.frames() <= 0 || buffer.frames() != pSample->get_frames() ) {
+		return false;
+	}
+
+	if ( sKey.isEmpty() ||
+		 ! Filesystem::path_usable( Filesystem::sample_cache_dir(), true, true ) ) {
+		return false;
+	}
+
+	char header[ nHeaderBytes ] = { 0 };
+	CacheHeader* pHeader = reinterpret_cast<CacheHeader*>( header );
+	memcpy( pHeader->sMagic, sCacheMagic, sizeof( pHeader->sMagic ) );
+	pHeader->nVersion = nCacheVersion;
+	pHeader->nFrames = buffer.frames();
+	pHeader->nSampleRate = pSample->get_sample_rate();
+	pHeader->nIsModified = pSample->get_is_modified() ? 1 : 0;
+	memcpy( pHeader->sKey, sKey.toLatin1().constData(), sizeof( pHeader->sKey ) );
+
+	const QString sPath = getPath( sKey );
+	const qint64 nBytes = Sample::Buffer::bytesFor( buffer.frames() );
+	QSaveFile file( sPath );
+	if ( ! file.open( QIODevice::WriteOnly ) ||
+		 file.write( header, nHeaderBytes ) != nHeaderBytes ||
+		 file.write( reinterpret_cast<const char*>( buffer.data() ),
+					 nBytes ) != nBytes ||
+		 ! file.commit() ) {
+		WARNINGLOG( QString( "Unable to write cache entry [%1] of [%2]" )
+					.arg( sPath ).arg( pSample->get_filepath() ) );
+		return false;
+	}
+
+	return true;
+}
+
+void SampleCache::prune( qint64 nMaxBytes )
+{
+	QDir dir( Filesystem::sample_cache_dir() );
+	if ( ! dir.exists() ) {
+		return;
+	}
+
+	// Most recently used entries first.
+	const auto entries = dir.entryInfoList(
+		QStringList( "*" + sCacheSuffix ), QDir::Files, QDir::Time );
+
+	qint64 nTotalBytes = 0;
+	int nRemoved = 0;
+	for ( const auto& entry : entries ) {
+		nTotalBytes += entry.size();
+		if ( nTotalBytes > nMaxBytes ) {
+			// Instances still mapping the entry are not affected.
+			if ( Filesystem::rm( entry.absoluteFilePath(), false, true ) ) {
+				++nRemoved;
+			}
+		}
+	}
+
+	if ( nRemoved > 0 ) {
+		INFOLOG( QString( "Removed [%1] entries from sample cache" ).arg( nRemoved ) );
+	}
+}
+
+};
@@ -0,0 +1,90 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+#ifndef H2C_SAMPLE_CACHE_H
+#define H2C_SAMPLE_CACHE_H
+
+#include <core/Object.h>
+
+namespace H2Core
+{
+
+class Sample;
+
+/**
+ * Persistent cache of fully processed sample data.
+ *
+ * Decoding a sample and applying its loops, envelopes, and
+ * Rubberband settings is costly. Sample::load() therefore stores the
+ * result in Filesystem::sample_cache_dir() and maps it right into
+ * memory on subsequent loads, see Sample::Buffer::map().
+ *
+ * Each entry is keyed by the canonical path, modification time, and
+ * size of the audio file, all modifiers of the Sample, and - in case
+ * Rubberband is used - the target tempo. Entries which are not used
+ * anymore are removed by prune().
+ *
+ * \ingroup docCore
+ */
+class SampleCache : public H2Core::Object<SampleCache>
+{
+	H2_OBJECT(SampleCache)
+public:
+	/** Size the cache is reduced to by prune(). */
+	static constexpr qint64 nMaxSizeMegabytes = 2048;
+
+	/** Whether Preferences::m_bUseSampleCache is set. */
+	static bool isEnabled();
+
+	/**
+	 * Restores the processed data of @a pSample from the entry
+	 * corresponding to @a sKey.
+	 *
+	 * \return false in case there is no valid entry.
+	 */
+	static bool load( Sample* pSample, const QString& sKey );
+	/**
+	 * Stores the processed data of @a pSample as entry corresponding
+	 * to @a sKey.
+	 *
+	 * The entry is written to a temporary file first and renamed
+	 * afterwards. Instances mapping a previous version continue to
+	 * work.
+	 */
+	static bool store( const Sample* pSample, const QString& sKey );
+
+	/** Removes the least recently used entries until the cache is
+	 * smaller than @a nMaxBytes. */
+	static void prune( qint64 nMaxBytes = nMaxSizeMegabytes * 1024 * 1024 );
+
+	/** Identifies the processed data of @a pSample loaded for a
+	 * tempo of @a fBpm. It is used by the SampleRegistry as well.
+	 *
+	 * \return Empty string in case the audio file of @a pSample
+	 * does not exist. */
+	static QString getKey( const Sample* pSample, float fBpm );
+	/** Path of the cache entry corresponding to @a sKey. */
+	static QString getPath( const QString& sKey );
+};
+
+};
+
+#endif
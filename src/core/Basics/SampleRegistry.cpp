@@ -0,0 +1,168 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+#include <core/Basics/SampleRegistry.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace H2Core
+{
+
+std::mutex SampleRegistry::m_mutex;
+std::map<QString, SampleRegistry::Entry> SampleRegistry::m_entries;
+uint64_t SampleRegistry::m_nUses = 0;
+
+bool SampleRegistry::isUnused( const Entry& entry )
+{
+	// Only the registry itself refers to the data.
+	return entry.buffer.shareCount() <= 1;
+}
+
+qint64 SampleRegistry::bytes( const Entry& entry )
+{
+	return static_cast<qint64>(
+		Sample::Buffer::bytesFor( entry.buffer.frames() ) );
+}
+
+bool SampleRegistry::acquire( Sample* pSample, const QString& sKey )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+
+	auto it = m_entries.find( sKey );
+	if ( it == m_entries.end() ) {
+		return false;
+	}
+
+	auto& entry = it->second;
+	entry.nLastUse = ++m_nUses;
+	pSample->m_buffer = entry.buffer.share();
+	pSample->__frames = entry.buffer.frames();
+	pSample->__sample_rate = entry.nSampleRate;
+	pSample->__is_modified = entry.bIsModified;
+
+	return true;
+}
+
+void SampleRegistry::insert( Sample* pSample, const QString& sKey )
+{
+	if ( sKey.isEmpty() || pSample->getBuffer().frames() <= 0 ||
+		 pSample->getBuffer().frames() != pSample->get_frames() ) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock( m_mutex );
+
+	auto it = m_entries.find( sKey );
+	if ( it != m_entries.end() ) {
+		// Another thread was faster.
+		auto& entry = it->second;
+		entry.nLastUse = ++m_nUses;
+		pSample->m_buffer = entry.buffer.share();
+		pSample->__frames = entry.buffer.frames();
+		pSample->__sample_rate = entry.nSampleRate;
+		pSample->__is_modified = entry.bIsModified;
+		return;
+	}
+
+	Entry entry;
+	entry.buffer = pSample->getBuffer().share();
+	entry.nSampleRate = pSample->get_sample_rate();
+	entry.bIsModified = pSample->get_is_modified();
+	entry.nLastUse = ++m_nUses;
+	m_entries.emplace( sKey, std::move( entry ) );
+}
+
+void SampleRegistry::prune( qint64 nMaxBytes )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+
+	std::vector<std::map<QString, Entry>::iterator> unused;
+	qint64 nTotalBytes = 0;
+	qint64 nUnusedBytes = 0;
+	for ( auto it = m_entries.begin(); it != m_entries.end(); ++it ) {
+		nTotalBytes += bytes( it->second );
+		if ( isUnused( it->second ) ) {
+			unused.push_back( it );
+			nUnusedBytes += bytes( it->second );
+		}
+	}
+
+	if ( nUnusedBytes <= nMaxBytes ) {
+		return;
+	}
+
+	// Least recently used entries first.
+	std::sort( unused.begin(), unused.end(),
+			   []( const auto& a, const auto& b ) {
+				   return a->second.nLastUse < b->second.nLastUse; } );
+
+	int nRemoved = 0;
+	for ( auto& it : unused ) {
+		if ( nUnusedBytes <= nMaxBytes ) {
+			break;
+		}
+		nUnusedBytes -= bytes( it->second );
+		nTotalBytes -= bytes( it->second );
+		m_entries.erase( it );
+		++nRemoved;
+	}
+
+	INFOLOG( QString( "Released [%1] unused samples. [%2] samples using [%3] MB remain registered" )
+			 .arg( nRemoved ).arg( m_entries.size() )
+			 .arg( nTotalBytes / 1024 / 1024 ) );
+}
+
+void SampleRegistry::clear()
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	m_entries.clear();
+}
+
+int SampleRegistry::getEntries()
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	return static_cast<int>( m_entries.size() );
+}
+
+qint64 SampleRegistry::getMemoryUsage()
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	qint64 nBytes = 0;
+	for ( const auto& [ _, entry ] : m_entries ) {
+		nBytes += bytes( entry );
+	}
+	return nBytes;
+}
+
+qint64 SampleRegistry::getUnusedMemory()
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+	qint64 nBytes = 0;
+	for ( const auto& [ _, entry ] : m_entries ) {
+		if ( isUnused( entry ) ) {
+			nBytes += bytes( entry );
+		}
+	}
+	return nBytes;
+}
+
+};
@@ -0,0 +1,108 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+#ifndef H2C_SAMPLE_REGISTRY_H
+#define H2C_SAMPLE_REGISTRY_H
+
+#include <core/Basics/Sample.h>
+#include <core/Object.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+namespace H2Core
+{
+
+/**
+ * Process-wide store of processed sample data.
+ *
+ * Whenever several Samples - e.g. of different instruments, kits,
+ * songs, or the preview - are loaded from the same file using the
+ * same modifiers, they share a single copy of the audio data instead
+ * of decoding and storing it again. Entries are identified by
+ * SampleCache::getKey().
+ *
+ * The data stays registered after the last Sample using it was
+ * released. This allows switching back and forth between kits
+ * without loading their samples again. prune() drops the least
+ * recently used of these unused entries.
+ *
+ * All members are thread-safe.
+ *
+ * \ingroup docCore
+ */
+class SampleRegistry : public H2Core::Object<SampleRegistry>
+{
+	H2_OBJECT(SampleRegistry)
+public:
+	/** Amount of data not used by any Sample kept by prune(). */
+	static constexpr qint64 nMaxUnusedMegabytes = 512;
+
+	/**
+	 * Hands the data registered for @a sKey to @a pSample.
+	 *
+	 * \return false in case no data is registered for @a sKey.
+	 */
+	static bool acquire( Sample* pSample, const QString& sKey );
+	/**
+	 * Registers the processed data of @a pSample for @a sKey.
+	 *
+	 * In case data was registered for @a sKey in the meantime -
+	 * e.g. by another thread loading the same sample - @a pSample is
+	 * switched to the registered data and its own is released.
+	 */
+	static void insert( Sample* pSample, const QString& sKey );
+
+	/** Removes the least recently used entries not used by any
+	 * Sample until those take less than @a nMaxBytes. */
+	static void prune( qint64 nMaxBytes = nMaxUnusedMegabytes * 1024 * 1024 );
+	/** Removes all entries. Data still used by Samples stays valid
+	 * but is not shared with subsequently loaded ones anymore. */
+	static void clear();
+
+	static int getEntries();
+	/** Amount of data held by all entries in bytes. */
+	static qint64 getMemoryUsage();
+	/** Amount of data held by entries not used by any Sample in
+	 * bytes. */
+	static qint64 getUnusedMemory();
+
+private:
+	struct Entry {
+		Sample::Buffer buffer;
+		int nSampleRate;
+		bool bIsModified;
+		/** Value of #m_nUses at the last access. */
+		uint64_t nLastUse;
+	};
+
+	static bool isUnused( const Entry& entry );
+	static qint64 bytes( const Entry& entry );
+
+	static std::mutex m_mutex;
+	static std::map<QString, Entry> m_entries;
+	static uint64_t m_nUses;
+};
+
+};
+
+#endif
@@ -22,6 +22,7 @@
 
 #include "Version.h"
 
+#include <atomic>
 #include <cassert>
 #include <memory>
 
@@ -57,7 +58,8 @@
 
 namespace
 {
-
+/** Source of Song::m_nRevision. */
+std::atomic<long> nLastRevision( 0 );
 }//anonymous namespace
 namespace H2Core
 {
@@ -81,6 +83,7 @@ Song::Song( const QString& sName, const QString& sAuthor, float fBpm, float fVol
 	, m_fHumanizeVelocityValue( 0.0 )
 	, m_fSwingFactor( 0.0 )
 	, m_bIsModified( false )
+	, m_nRevision( ++nLastRevision )
 	, m_mode( Mode::Pattern )
 	, m_sPlaybackTrackFilename( "" )
 	, m_bPlaybackTrackEnabled( false )
@@ -126,8 +129,20 @@ Song::~Song()
 }
 
 void Song::setDrumkit( std::shared_ptr<Drumkit> pDrumkit ) {
-	m_pDrumkit = pDrumkit;
-	m_pDrumkit->setType( Drumkit::Type::Song );
+	pDrumkit->setType( Drumkit::Type::Song );
+	m_pDrumkit.store( pDrumkit );
+}
+
+bool Song::publishDrumkit( std::shared_ptr<Drumkit> pDrumkit ) {
+	if ( ! m_pDrumkit.isPublishable() ) {
+		return false;
+	}
+	m_pDrumkit.publish( pDrumkit );
+	return true;
+}
+
+std::shared_ptr<Drumkit> Song::reclaimDrumkit() {
+	return m_pDrumkit.reclaim();
 }
 
 void Song::setBpm( float fBpm ) {
@@ -196,16 +211,46 @@ std::shared_ptr<Song> Song::load( const QString& sFilename, bool bSilent )
 		INFOLOG( "Reading " + sPath );
 	}
 
-	XMLDoc doc;
-	if ( ! doc.read( sFilename ) && ! bSilent ) {
-		ERRORLOG( QString( "Something went wrong while loading song [%1]" )
-				  .arg( sFilename ) );
+	XMLStreamReader reader;
+	if ( ! reader.open( sFilename, bSilent ) || reader.name() != "song" ) {
+		ERRORLOG( "Error reading song: 'song' node not found" );
+		return nullptr;
 	}
 
-	XMLNode songNode = doc.firstChildElement( "song" );
+	// The drumkit and the patterns make up the bulk of a song. They
+	// are loaded straight from the reader. All remaining elements are
+	// gathered in a DOM and handled by loadFrom(). Songs of the older
+	// format (< 1.3.0) store the drumkit at root level and are
+	// entirely read into the DOM.
+	const auto sSongPath = Filesystem::absolute_path( sFilename );
+	XMLDoc doc;
+	XMLNode songNode = reader.createRoot( doc );
+	std::shared_ptr<Drumkit> pDrumkit = nullptr;
+	PatternList* pPatternList = nullptr;
+	bool bPatternListRead = false;
+	while ( reader.readNextChild() ) {
+		if ( reader.name() == "drumkit_info" && pDrumkit == nullptr ) {
+			pDrumkit = Drumkit::loadFrom( reader, "", sSongPath, true, bSilent );
+			if ( pDrumkit == nullptr ) {
+				ERRORLOG( "Unable to load drumkit. Falling back to default kit." );
+				pDrumkit = std::make_shared<Drumkit>();
+			}
+		}
+		else if ( reader.name() == "patternList" && pDrumkit != nullptr &&
+				  ! bPatternListRead ) {
+			bPatternListRead = true;
+			pPatternList = PatternList::load_from(
+				reader, pDrumkit->getInstruments(), bSilent );
+		}
+		else {
+			reader.readSubtree( songNode );
+		}
+	}
 
-	if ( songNode.isNull() ) {
-		ERRORLOG( "Error reading song: 'song' node not found" );
+	if ( reader.hasError() ) {
+		ERRORLOG( QString( "Something went wrong while loading song [%1]: %2" )
+				  .arg( sFilename ).arg( reader.errorString() ) );
+		delete pPatternList;
 		return nullptr;
 	}
 
@@ -219,7 +264,8 @@ std::shared_ptr<Song> Song::load( const QString& sFilename, bool bSilent )
 		}
 	}
 
-	auto pSong = Song::loadFrom( songNode, sFilename, bSilent );
+	auto pSong = Song::loadFrom( songNode, sFilename, bSilent, pDrumkit,
+								 pPatternList );
 	if ( pSong != nullptr ) {
 		pSong->setFilename( sFilename );
 	}
@@ -227,7 +273,9 @@ std::shared_ptr<Song> Song::load( const QString& sFilename, bool bSilent )
 	return pSong;
 }
 
-std::shared_ptr<Song> Song::loadFrom( const XMLNode& rootNode, const QString& sFilename, bool bSilent )
+std::shared_ptr<Song> Song::loadFrom( const XMLNode& rootNode, const QString& sFilename, bool bSilent,
+									  std::shared_ptr<Drumkit> pDrumkit,
+									  PatternList* pPatternList )
 {
 	auto pPreferences = Preferences::get_instance();
 
@@ -375,28 +423,32 @@ std::shared_ptr<Song> Song::loadFrom( const XMLNode& rootNode, const QString& sF
 	}
 	pSong->setPanLawKNorm( fPanLawKNorm );
 
-	std::shared_ptr<Drumkit> pDrumkit;
-	XMLNode drumkitNode = rootNode.firstChildElement( "drumkit_info");
-	if ( ! drumkitNode.isNull() ) {
-		// Current format (>= 1.3.0) storing a proper Drumkit
-		pDrumkit = Drumkit::loadFrom( drumkitNode, "", sSongPath, true, bSilent );
-	}
-	else {
-		// Older format (< 1.3.0) storing only selected elements
-		pDrumkit = Legacy::loadEmbeddedSongDrumkit( rootNode, sSongPath, bSilent );
-	}
-
 	if ( pDrumkit == nullptr ) {
-		ERRORLOG( "Unable to load drumkit. Falling back to default kit." );
-		// Load default kit
-		pDrumkit = std::make_shared<Drumkit>();
+		XMLNode drumkitNode = rootNode.firstChildElement( "drumkit_info");
+		if ( ! drumkitNode.isNull() ) {
+			// Current format (>= 1.3.0) storing a proper Drumkit
+			pDrumkit = Drumkit::loadFrom( drumkitNode, "", sSongPath, true, bSilent );
+		}
+		else {
+			// Older format (< 1.3.0) storing only selected elements
+			pDrumkit = Legacy::loadEmbeddedSongDrumkit( rootNode, sSongPath, bSilent );
+		}
+
+		if ( pDrumkit == nullptr ) {
+			ERRORLOG( "Unable to load drumkit. Falling back to default kit." );
+			// Load default kit
+			pDrumkit = std::make_shared<Drumkit>();
+		}
 	}
 	pSong->setDrumkit( pDrumkit );
 
 	// Pattern list
-	pSong->setPatternList( PatternList::load_from( rootNode,
-												   pSong->getDrumkit()->getInstruments(),
-												   bSilent ) );
+	if ( pPatternList == nullptr ) {
+		pPatternList = PatternList::load_from( rootNode,
+											   pSong->getDrumkit()->getInstruments(),
+											   bSilent );
+	}
+	pSong->setPatternList( pPatternList );
 
 	// Virtual Patterns
 	pSong->loadVirtualPatternsFrom( rootNode, bSilent );
@@ -542,21 +594,27 @@ bool Song::save( const QString& sFilename, bool bLegacy, bool bSilent )
 		INFOLOG( QString( "Saving song to [%1]" ).arg( sFilename ) );
 	}
 
-	XMLDoc doc;
-	XMLNode rootNode = doc.set_root( "song" );
+	XMLStreamWriter writer;
+	if ( ! writer.open( sFilename ) ) {
+		ERRORLOG( QString( "Error writing song to [%1]" ).arg( sFilename ) );
+		return false;
+	}
+
+	writer.writeStartDocument( "song" );
+	saveTo( writer, bLegacy, bSilent );
+	writer.writeEndElement();
 
 	// In order to comply with the GPL license we have to add a
 	// license notice to the file.
 	if ( getLicense().getType() == License::GPL ) {
-		doc.appendChild( doc.createComment( License::getGPLLicenseNotice( getAuthor() ) ) );
+		XMLDoc doc;
+		writer.writeNode( doc.createComment( License::getGPLLicenseNotice( getAuthor() ) ) );
 	}
 
-	saveTo( rootNode, bLegacy, bSilent );
-
 	setFilename( sFilename );
 	setIsModified( false );
 
-	if ( ! doc.write( sFilename ) ) {
+	if ( ! writer.commit() ) {
 		ERRORLOG( QString( "Error writing song to [%1]" ).arg( sFilename ) );
 		return false;
 	}
@@ -704,7 +762,29 @@ void Song::savePatternGroupVectorTo( XMLNode& node, bool bSilent ) const {
 	}
 }
 
+void Song::saveTo( XMLStreamWriter& writer, bool bLegacy, bool bSilent ) const {
+	// All elements are assembled in small DOM fragments except of the
+	// patterns, which make up the bulk of a song and are written one
+	// at a time.
+	XMLDoc doc;
+	XMLNode rootNode = doc.createElement( "song" );
+	saveHeaderTo( rootNode, bLegacy, bSilent );
+	writer.writeChildren( rootNode );
+
+	m_pPatternList->save_to( writer, nullptr );
+
+	rootNode = doc.createElement( "song" );
+	saveTrailerTo( rootNode, bSilent );
+	writer.writeChildren( rootNode );
+}
+
 void Song::saveTo( XMLNode& rootNode, bool bLegacy, bool bSilent ) const {
+	saveHeaderTo( rootNode, bLegacy, bSilent );
+	m_pPatternList->save_to( rootNode, nullptr );
+	saveTrailerTo( rootNode, bSilent );
+}
+
+void Song::saveHeaderTo( XMLNode& rootNode, bool bLegacy, bool bSilent ) const {
 	rootNode.write_string( "version", QString( get_version().c_str() ) );
 	rootNode.write_float( "bpm", m_fBpm );
 	rootNode.write_float( "volume", m_fVolume );
@@ -789,17 +869,17 @@ void Song::saveTo( XMLNode& rootNode, bool bLegacy, bool bSilent ) const {
 		// "drumkit_info" instead of "drumkit" seem unintuitive but is dictated
 		// by a ancient design desicion and we will stick to it.
 		auto drumkitNode = rootNode.createNode( "drumkit_info" );
-		m_pDrumkit->saveTo( drumkitNode,
+		getDrumkit()->saveTo( drumkitNode,
 							-1, // All components
 							true, // Use the most-recent format
 							true, // Enable per-instrument sample loading
 							bSilent );
 	} else {
-		Legacy::saveEmbeddedSongDrumkit( rootNode, m_pDrumkit, bSilent );
+		Legacy::saveEmbeddedSongDrumkit( rootNode, getDrumkit(), bSilent );
 	}
+}
 
-	m_pPatternList->save_to( rootNode, nullptr );
-
+void Song::saveTrailerTo( XMLNode& rootNode, bool bSilent ) const {
 	saveVirtualPatternsTo( rootNode, bSilent );
 
 	savePatternGroupVectorTo( rootNode, bSilent );
@@ -880,6 +960,86 @@ void Song::saveTo( XMLNode& rootNode, bool bLegacy, bool bSilent ) const {
 	}
 }
 
+std::shared_ptr<SongSnapshot> Song::createSnapshot( bool bSilent ) const {
+	std::shared_ptr<SongSnapshot> pSnapshot( new SongSnapshot() );
+
+	pSnapshot->m_headerNode = pSnapshot->m_doc.createElement( "song" );
+	saveHeaderTo( pSnapshot->m_headerNode, false, bSilent );
+
+	// Copying all patterns on each autosave would be expensive for
+	// large songs. Only the ones altered since the last snapshot are
+	// copied.
+	std::map<const Pattern*, std::shared_ptr<const Pattern>> snapshotPatterns;
+	for ( const auto& pPattern : *m_pPatternList ) {
+		if ( pPattern == nullptr ) {
+			continue;
+		}
+		std::shared_ptr<const Pattern> pCopy;
+		const auto it = m_snapshotPatterns.find( pPattern );
+		if ( it != m_snapshotPatterns.end() &&
+			 it->second->isEquivalent( pPattern ) ) {
+			pCopy = it->second;
+		} else {
+			pCopy = std::make_shared<Pattern>( pPattern );
+		}
+		snapshotPatterns[ pPattern ] = pCopy;
+		pSnapshot->m_patterns.push_back( pCopy );
+	}
+	m_snapshotPatterns.swap( snapshotPatterns );
+
+	pSnapshot->m_trailerNode = pSnapshot->m_doc.createElement( "song" );
+	saveTrailerTo( pSnapshot->m_trailerNode, bSilent );
+
+	if ( m_license.getType() == License::GPL ) {
+		pSnapshot->m_sLicenseNotice = License::getGPLLicenseNotice( m_sAuthor );
+	}
+	pSnapshot->m_nRevision = m_nRevision;
+
+	return pSnapshot;
+}
+
+SongSnapshot::SongSnapshot()
+	: m_nRevision( 0 )
+{
+}
+
+SongSnapshot::~SongSnapshot() {
+}
+
+bool SongSnapshot::save( const QString& sFilename, bool bSilent ) const {
+	if ( ! bSilent ) {
+		INFOLOG( QString( "Saving song snapshot to [%1]" ).arg( sFilename ) );
+	}
+
+	XMLStreamWriter writer;
+	if ( ! writer.open( sFilename ) ) {
+		ERRORLOG( QString( "Error writing song to [%1]" ).arg( sFilename ) );
+		return false;
+	}
+
+	writer.writeStartDocument( "song" );
+	writer.writeChildren( m_headerNode );
+	writer.writeStartElement( "patternList" );
+	for ( const auto& pPattern : m_patterns ) {
+		pPattern->save_to( writer, nullptr );
+	}
+	writer.writeEndElement();
+	writer.writeChildren( m_trailerNode );
+	writer.writeEndElement();
+
+	if ( ! m_sLicenseNotice.isEmpty() ) {
+		XMLDoc doc;
+		writer.writeNode( doc.createComment( m_sLicenseNotice ) );
+	}
+
+	if ( ! writer.commit() ) {
+		ERRORLOG( QString( "Error writing song to [%1]" ).arg( sFilename ) );
+		return false;
+	}
+
+	return true;
+}
+
 std::shared_ptr<Song> Song::getEmptySong( std::shared_ptr<SoundLibraryDatabase> pDB )
 {
 	std::shared_ptr<Song> pSong =
@@ -932,12 +1092,12 @@ std::shared_ptr<Song> Song::getEmptySong( std::shared_ptr<SoundLibraryDatabase>
 	const QString sDefaultDrumkitPath = Filesystem::drumkit_default_kit();
 	auto pDrumkit = pSoundLibraryDatabase->getDrumkit( sDefaultDrumkitPath );
 	if ( pDrumkit == nullptr ) {
-		for ( const auto& pEntry : pSoundLibraryDatabase->getDrumkitDatabase() ) {
-			if ( pEntry.second != nullptr ) {
+		for ( const auto& [ ssPath, _ ] : pSoundLibraryDatabase->getDrumkitInfos() ) {
+			pDrumkit = pSoundLibraryDatabase->getDrumkit( ssPath );
+			if ( pDrumkit != nullptr ) {
 				WARNINGLOG( QString( "Unable to retrieve default drumkit [%1]. Using kit [%2] instead." )
 							.arg( sDefaultDrumkitPath )
-							.arg( pEntry.first ) );
-				pDrumkit = pEntry.second;
+							.arg( ssPath ) );
 				break;
 			}
 		}
@@ -979,6 +1139,9 @@ void Song::setIsModified( bool bIsModified )
 	}
 
 	m_bIsModified = bIsModified;
+	if ( bIsModified ) {
+		m_nRevision = ++nLastRevision;
+	}
 
 	if( Notify ) {
 		EventQueue::get_instance()->push_event( EVENT_SONG_MODIFIED, -1 );
@@ -1138,6 +1301,7 @@ bool Song::pasteInstrumentLineFromString( const QString& sSerialized,
 				XMLNode pNoteListNode = patternNode.firstChildElement( "noteList" );
 				if ( ! pNoteListNode.isNull() )
 				{
+					std::vector<Note*> notes;
 					// Parse note-by-note
 					XMLNode noteNode = pNoteListNode.firstChildElement( "note" );
 					while ( ! noteNode.isNull() )
@@ -1148,10 +1312,12 @@ bool Song::pasteInstrumentLineFromString( const QString& sSerialized,
 						instrumentText.setNodeValue( QString::number( pInstr->get_id() ) );
 						Note *pNote = Note::load_from( noteNode, getDrumkit()->getInstruments() );
 
-						pat->insert_note( pNote ); // Add note to created pattern
+						notes.push_back( pNote );
 
 						noteNode = noteNode.nextSiblingElement( "note" );
 					}
+					// Add notes to created pattern
+					pat->insert_notes( notes );
 				}
 
 				// Add loaded pattern to apply-list
@@ -1177,7 +1343,7 @@ void Song::setPanLawKNorm( float fKNorm ) {
 
 void Song::removeInstrument( int nInstrumentNumber ) {
 	auto pHydrogen = Hydrogen::get_instance();
-	auto pInstr = m_pDrumkit->getInstruments()->get( nInstrumentNumber );
+	auto pInstr = getDrumkit()->getInstruments()->get( nInstrumentNumber );
 	if ( pInstr == nullptr ) {
 		// Error log is already printed by get().
 		return;
@@ -1188,11 +1354,11 @@ void Song::removeInstrument( int nInstrumentNumber ) {
 	}
 
 	// delete the instrument from the instruments list
-	m_pDrumkit->removeInstrument( nInstrumentNumber );
+	getDrumkit()->removeInstrument( nInstrumentNumber );
 
 	// Ensure there is always one instrument left.
-	if ( m_pDrumkit->getInstruments()->size() < 1 ) {
-		m_pDrumkit->addInstrument( std::make_shared<Instrument>() );
+	if ( getDrumkit()->getInstruments()->size() < 1 ) {
+		getDrumkit()->addInstrument( std::make_shared<Instrument>() );
 	}
 
 	// At this point the instrument has been removed from both the
@@ -1270,7 +1436,7 @@ QString Song::toQString( const QString& sPrefix, bool bShort ) const {
 				sOutput.append( QString( "%1" ).arg( pp->toQString( sPrefix + s + s, bShort ) ) );
 			}
 		}
-		sOutput.append( QString( "%1" ).arg( m_pDrumkit->toQString( sPrefix + s, bShort ) ) )
+		sOutput.append( QString( "%1" ).arg( getDrumkit()->toQString( sPrefix + s, bShort ) ) )
 			.append( QString( "%1%2m_sFilename: %3\n" ).arg( sPrefix ).arg( s ).arg( m_sFilename ) )
 			.append( QString( "%1%2m_loopMode: %3\n" ).arg( sPrefix ).arg( s ).arg( static_cast<int>(m_loopMode) ) )
 			.append( QString( "%1%2m_fHumanizeTimeValue: %3\n" ).arg( sPrefix ).arg( s ).arg( m_fHumanizeTimeValue ) )
@@ -1317,7 +1483,7 @@ QString Song::toQString( const QString& sPrefix, bool bShort ) const {
 				sOutput.append( QString( "%1" ).arg( pp->toQString( sPrefix + s + s, bShort ) ) );
 			}
 		}
-		sOutput.append( QString( "%1" ).arg( m_pDrumkit->toQString( sPrefix + s, bShort ) ) )
+		sOutput.append( QString( "%1" ).arg( getDrumkit()->toQString( sPrefix + s, bShort ) ) )
 			.append( QString( ", m_sFilename: %1" ).arg( m_sFilename ) )
 			.append( QString( ", m_loopMode: %1" ).arg( static_cast<int>(m_loopMode) ) )
 			.append( QString( ", m_fHumanizeTimeValue: %1" ).arg( m_fHumanizeTimeValue ) )
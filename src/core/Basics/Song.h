@@ -33,6 +33,7 @@
 #include <core/License.h>
 #include <core/Object.h>
 #include <core/Helpers/Filesystem.h>
+#include <core/Helpers/SharedSlot.h>
 #include <core/Helpers/Xml.h>
 
 class TiXmlNode;
@@ -49,6 +50,7 @@ class Drumkit;
 class PatternList;
 class AutomationPath;
 class SoundLibraryDatabase;
+class SongSnapshot;
 class Timeline;
 
 /**
@@ -154,6 +156,14 @@ class Song : public H2Core::Object<Song>, public std::enable_shared_from_this<So
 	 */
 	bool 			save( const QString& sFilename, bool bLegacy = false,
 						  bool bSilent = false );
+	/**
+	 * Adds all children of the song's root element to @a rootNode.
+	 *
+	 * DOM counterpart of the streamed output of save(). Both have to
+	 * produce the same document.
+	 */
+	void			saveTo( XMLNode& rootNode, bool bLegacy,
+							bool bSilent = false ) const;
 
 	bool getIsTimelineActivated() const;
 	void setIsTimelineActivated( bool bIsTimelineActivated );
@@ -183,7 +193,21 @@ class Song : public H2Core::Object<Song>, public std::enable_shared_from_this<So
 		void setPatternList( PatternList* pList );
 
 		std::shared_ptr<Drumkit> getDrumkit() const;
+		/** Must be called while holding the #AudioEngine lock in
+		 * case the song is the current one. */
 		void setDrumkit( std::shared_ptr<Drumkit> pDrumkit );
+		/**
+		 * Counterpart of setDrumkit() used within the audio thread.
+		 * Neither waits nor frees anything.
+		 *
+		 * \return false in case the kit replaced by the last call
+		 *   was not retrieved by reclaimDrumkit() yet or is still
+		 *   accessed by another thread. The caller has to try again
+		 *   later.
+		 */
+		bool publishDrumkit( std::shared_ptr<Drumkit> pDrumkit );
+		/** \return The kit replaced by publishDrumkit(). */
+		std::shared_ptr<Drumkit> reclaimDrumkit();
 
 		/** Return a pointer to a vector storing all Pattern
 		 * present in the Song.
@@ -236,6 +260,23 @@ class Song : public H2Core::Object<Song>, public std::enable_shared_from_this<So
 							
 		bool			getIsModified() const;
 		void			setIsModified( bool bIsModified);
+		/**
+		 * Copies everything required to write the song to disk.
+		 *
+		 * Only the patterns, which make up the bulk of a song, are
+		 * copied. All remaining parts are small and assembled in a
+		 * DOM fragment right away. The returned snapshot does not
+		 * reference the song anymore and can be written by another
+		 * thread while the song is edited further.
+		 *
+		 * Has to be called from the thread modifying the song.
+		 */
+		std::shared_ptr<SongSnapshot> createSnapshot( bool bSilent = false ) const;
+		/** Changes each time the song is marked as modified. Revisions
+		 * are unique across all songs created during a session and
+		 * allow to tell whether a song changed since it was last
+		 * written. */
+		long			getRevision() const;
 
 		AutomationPath*	getVelocityAutomationPath() const;
 
@@ -302,10 +343,26 @@ class Song : public H2Core::Object<Song>, public std::enable_shared_from_this<So
 	
 private:
 
+	/**
+	 * \param pDrumkit If not nullptr, it will be used instead of the
+	 *   drumkit stored in @a pNode.
+	 * \param pPatternList If not nullptr, it will be used instead
+	 *   of the patterns stored in @a pNode. It must have been
+	 *   loaded using the instruments of @a pDrumkit.
+	 */
 	static std::shared_ptr<Song> loadFrom( const XMLNode& pNode,
 										   const QString& sFilename,
-										   bool bSilent = false );
-	void saveTo( XMLNode& pNode, bool bLegacy, bool bSilent = false ) const;
+										   bool bSilent = false,
+										   std::shared_ptr<Drumkit> pDrumkit = nullptr,
+										   PatternList* pPatternList = nullptr );
+	/** Writes all children of the song's root element. */
+	void saveTo( XMLStreamWriter& writer, bool bLegacy, bool bSilent = false ) const;
+	/** Adds all children of the song's root element preceding the
+	 * pattern list to @a rootNode. */
+	void saveHeaderTo( XMLNode& rootNode, bool bLegacy, bool bSilent = false ) const;
+	/** Adds all children of the song's root element following the
+	 * pattern list to @a rootNode. */
+	void saveTrailerTo( XMLNode& rootNode, bool bSilent = false ) const;
 
 	void loadVirtualPatternsFrom( const XMLNode& pNode, bool bSilent = false );
 	void loadPatternGroupVectorFrom( const XMLNode& pNode, bool bSilent = false );
@@ -345,8 +402,12 @@ private:
 		/** Current drumkit
 		 *
 		 * This one is either based on the last kit loaded from the
-		 * `SoundLibraryDatabase` or is a brand new kit. */
-		std::shared_ptr<Drumkit> m_pDrumkit;
+		 * `SoundLibraryDatabase` or is a brand new kit.
+		 *
+		 * Held in a #SharedSlot since it is read by the audio thread
+		 * without locking and might be replaced by it. See
+		 * SongSwitcher. */
+		SharedSlot<Drumkit> m_pDrumkit;
 
 		QString			m_sFilename;
 
@@ -374,6 +435,12 @@ private:
 		float			m_fHumanizeVelocityValue;
 		float			m_fSwingFactor;
 		bool			m_bIsModified;
+		long			m_nRevision;
+		/** Copies of the patterns created by the last call to
+		 * createSnapshot(). They are shared by all snapshots and
+		 * reused as long as the corresponding pattern did not
+		 * change. */
+		mutable std::map<const Pattern*, std::shared_ptr<const Pattern>> m_snapshotPatterns;
 		std::map< float, int> 	m_latestRoundRobins;
 		Mode			m_mode;
 		
@@ -529,9 +596,14 @@ inline bool Song::getIsModified() const
 	return m_bIsModified;
 }
 
+inline long Song::getRevision() const
+{
+	return m_nRevision;
+}
+
 inline std::shared_ptr<Drumkit> Song::getDrumkit() const
 {
-	return m_pDrumkit;
+	return m_pDrumkit.load();
 }
 
 inline PatternList* Song::getPatternList() const
@@ -732,6 +804,44 @@ inline int Song::getPanLawType() const {
 inline float Song::getPanLawKNorm() const {
 	return m_fPanLawKNorm;
 }
+
+/**
+ * Frozen copy of a #Song created by Song::createSnapshot().
+ */
+class SongSnapshot : public H2Core::Object<SongSnapshot>
+{
+	H2_OBJECT(SongSnapshot)
+	friend class Song;
+public:
+	~SongSnapshot();
+
+	/**
+	 * Writes the snapshot to @a sFilename. In contrast to
+	 * Song::save() this does neither alter the song the snapshot was
+	 * taken from nor require to be called from a particular thread.
+	 *
+	 * \return true on success
+	 */
+	bool save( const QString& sFilename, bool bSilent = false ) const;
+
+	long getRevision() const;
+
+private:
+	SongSnapshot();
+
+	XMLDoc m_doc;
+	XMLNode m_headerNode;
+	/** Immutable copies of the patterns of the song. Shared with
+	 * other snapshots. */
+	std::vector<std::shared_ptr<const Pattern>> m_patterns;
+	XMLNode m_trailerNode;
+	QString m_sLicenseNotice;
+	long m_nRevision;
+};
+
+inline long SongSnapshot::getRevision() const {
+	return m_nRevision;
+}
 };
 
 #endif
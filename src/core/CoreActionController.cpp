@@ -21,6 +21,7 @@
  */
 
 #include <core/AudioEngine/AudioEngine.h>
+#include <core/AudioEngine/SongSwitcher.h>
 #include <core/AudioEngine/TransportPosition.h>
 #include <core/CoreActionController.h>
 #include <core/EventQueue.h>
@@ -31,6 +32,7 @@
 #include <core/Basics/PatternList.h>
 #include <core/Basics/Pattern.h>
 #include <core/Basics/Playlist.h>
+#include <core/Basics/PlaylistPrefetcher.h>
 #include "core/OscServer.h"
 #include <core/MidiAction.h>
 #include "core/MidiMap.h"
@@ -48,6 +50,8 @@
 namespace H2Core
 {
 
+std::atomic<int> CoreActionController::m_nDrumkitRequests( 0 );
+
 #define ASSERT_HYDROGEN assert( pHydrogen ); \
 	if ( pHydrogen == nullptr ) {            \
 		ERRORLOG( "Core not ready yet!" );   \
@@ -552,6 +556,12 @@ std::shared_ptr<Song> CoreActionController::loadSong( const QString& sPath,
 		}
 	}
 
+	if ( pSong == nullptr ) {
+		// Upcoming songs of the current playlist might already be
+		// loaded in the background.
+		pSong = pHydrogen->getPlaylistPrefetcher()->take( sPath );
+	}
+
 	if ( pSong == nullptr ) {
 		pSong = Song::load( sPath );
 	}
@@ -572,6 +582,15 @@ bool CoreActionController::setSong( std::shared_ptr<Song> pSong ) {
 		return false;
 	}
 
+	auto pSongSwitcher = pHydrogen->getSongSwitcher();
+	if ( pSongSwitcher->isApplicable() ) {
+		// Samples are loaded in the background and the song will be
+		// replaced without stopping transport.
+		return pSongSwitcher->switchSong( pSong );
+	}
+	// Discard songs and kits still loaded in the background.
+	pSongSwitcher->cancel();
+
 	if ( pHydrogen->getAudioEngine()->getState() == AudioEngine::State::Playing ) {
 		// Stops recording, all queued MIDI notes, and the playback of
 		// the audio driver.
@@ -580,7 +599,15 @@ bool CoreActionController::setSong( std::shared_ptr<Song> pSong ) {
 
 	// Update the Song.
 	pHydrogen->setSong( pSong );
-		
+
+	finishSetSong( pSong );
+
+	return true;
+}
+
+void CoreActionController::finishSetSong( std::shared_ptr<Song> pSong ) {
+	auto pHydrogen = Hydrogen::get_instance();
+
 	if ( pHydrogen->isUnderSessionManagement() ) {
 		pHydrogen->restartDrivers();
 	}
@@ -615,8 +642,6 @@ bool CoreActionController::setSong( std::shared_ptr<Song> pSong ) {
 
 	// As we just set a fresh song, we can mark it not modified
 	pHydrogen->setIsModified( false );
-	
-	return true;
 }
 
 bool CoreActionController::saveSong() {
@@ -1070,18 +1095,39 @@ bool CoreActionController::setDrumkit( std::shared_ptr<Drumkit> pDrumkit, bool b
 			.arg( pDrumkit->getName() )
 			.arg( pDrumkit->getPath() ) );
 
+	auto pSongSwitcher = pHydrogen->getSongSwitcher();
+	if ( pSongSwitcher->isApplicable() ) {
+		// Samples are loaded in the background and the kit will be
+		// replaced without stopping transport.
+		return pSongSwitcher->switchDrumkit( pDrumkit );
+	}
+	// Discard songs and kits still loaded in the background.
+	pSongSwitcher->cancel();
+
 	// Use a cloned version of the kit from e.g. the SoundLibrary in
 	// order to not overwrite the original when altering the properties
 	// of the current kit.
 	auto pNewDrumkit = std::make_shared<Drumkit>(pDrumkit);
 
+	// The most recent kit wins. Kits still loading - e.g. requested
+	// via OSC or MIDI while the GUI set another one - are abandoned
+	// and their calls to setDrumkit() return without altering the song.
+	// Loads of other components, like the PlaylistPrefetcher, are not
+	// affected.
+	const int nRequest = ++m_nDrumkitRequests;
+
 	// It would be more clean to lock the audio engine _before_ loading
 	// the samples. We might pass a tempo marker while loading and users
 	// of Rubberband end up with a wrong sample length. But this is an
 	// edge-case and the regular user will benefit from a load prior to
 	// the locking resulting in lesser XRUNs.
-	pNewDrumkit->loadSamples(
-		pAudioEngine->getTransportPosition()->getBpm());
+	if ( ! pNewDrumkit->loadSamples(
+			 pAudioEngine->getTransportPosition()->getBpm(),
+			 [&]() { return m_nDrumkitRequests != nRequest; } ) ) {
+		INFOLOG( QString( "Loading drumkit [%1] cancelled" )
+				 .arg( pDrumkit->getName() ) );
+		return false;
+	}
 
 	pAudioEngine->lock(RIGHT_HERE);
 
@@ -1099,10 +1145,18 @@ bool CoreActionController::setDrumkit( std::shared_ptr<Drumkit> pDrumkit, bool b
 
 	pAudioEngine->unlock();
 
+	finishSetDrumkit( pNewDrumkit );
+
+	return true;
+}
+
+void CoreActionController::finishSetDrumkit( std::shared_ptr<Drumkit> pDrumkit ) {
+	auto pHydrogen = Hydrogen::get_instance();
+
 	if ( pHydrogen->getSelectedInstrumentNumber() >=
-		 pNewDrumkit->getInstruments()->size() ) {
+		 pDrumkit->getInstruments()->size() ) {
 		pHydrogen->setSelectedInstrumentNumber(
-			std::max( 0, pNewDrumkit->getInstruments()->size() - 1 ), false);
+			std::max( 0, pDrumkit->getInstruments()->size() - 1 ), false);
 	}
 
 	initExternalControlInterfaces();
@@ -1110,8 +1164,6 @@ bool CoreActionController::setDrumkit( std::shared_ptr<Drumkit> pDrumkit, bool b
 	pHydrogen->setIsModified( true );
 
 	EventQueue::get_instance()->push_event(EVENT_DRUMKIT_LOADED, 0);
-
-	return true;
 }
 
 bool CoreActionController::upgradeDrumkit(const QString &sDrumkitPath,
@@ -1547,13 +1599,14 @@ bool CoreActionController::locateToTick( long nTick, bool bWithJackBroadcast ) {
 		return false;
 	}
 
-	pAudioEngine->lock( RIGHT_HERE );
-    
-	pAudioEngine->locate( nTick, bWithJackBroadcast );
-	
-	pAudioEngine->unlock();
-	
-	EventQueue::get_instance()->push_event( EVENT_RELOCATION, 0 );
+	// EVENT_RELOCATION is pushed by the audio engine as soon as the
+	// relocation was applied.
+	CommandQueue::Command command;
+	command.type = CommandQueue::Command::Type::Locate;
+	command.fValue = nTick;
+	command.bValue = bWithJackBroadcast;
+	pAudioEngine->pushCommand( command );
+
 	return true;
 }
 
@@ -1989,10 +2042,11 @@ bool CoreActionController::setBpm( float fBpm ) {
 	fBpm = std::clamp( fBpm, static_cast<float>(MIN_BPM),
 						  static_cast<float>(MAX_BPM) );
 
-	pAudioEngine->lock( RIGHT_HERE );
 	// Use tempo in the next process cycle of the audio engine.
-	pAudioEngine->setNextBpm( fBpm );
-	pAudioEngine->unlock();
+	CommandQueue::Command command;
+	command.type = CommandQueue::Command::Type::SetNextBpm;
+	command.fValue = fBpm;
+	pAudioEngine->pushCommand( command );
 
 	// Store it's value in the .h2song file.
 	pHydrogen->getSong()->setBpm( fBpm );
@@ -2055,6 +2109,7 @@ bool CoreActionController::setPlaylist( std::shared_ptr<Playlist> pPlaylist ) {
 		return false;
 	}
 	pHydrogen->setPlaylist( pPlaylist );
+	pHydrogen->getPlaylistPrefetcher()->update();
 
 	if ( pPlaylist->getFilename() ==
 		 Filesystem::empty_path( Filesystem::Type::Playlist ) ) {
@@ -2135,6 +2190,7 @@ bool CoreActionController::addToPlaylist( std::shared_ptr<PlaylistEntry> pEntry,
 	if ( ! pPlaylist->add( pEntry, nIndex ) ) {
 		return false;
 	}
+	pHydrogen->getPlaylistPrefetcher()->update();
 
 	pPlaylist->setIsModified( true );
 	EventQueue::get_instance()->push_event( EVENT_PLAYLIST_CHANGED, 0 );
@@ -2157,6 +2213,7 @@ bool CoreActionController::removeFromPlaylist( std::shared_ptr<PlaylistEntry> pE
 	if ( ! pPlaylist->remove( pEntry, nIndex ) ) {
 		return false;
 	}
+	pHydrogen->getPlaylistPrefetcher()->update();
 
 	pPlaylist->setIsModified( true );
 	EventQueue::get_instance()->push_event( EVENT_PLAYLIST_CHANGED, 0 );
@@ -2180,6 +2237,9 @@ bool CoreActionController::activatePlaylistSong( int nSongNumber ) {
 	EventQueue::get_instance()->push_event( H2Core::EVENT_PLAYLIST_LOADSONG,
 											nSongNumber );
 
+	// Start loading the songs following the new one.
+	pHydrogen->getPlaylistPrefetcher()->update();
+
 	return true;
 }
 }
@@ -23,6 +23,7 @@
 #ifndef CORE_ACTION_CONTROLLER_H
 #define CORE_ACTION_CONTROLLER_H
 
+#include <atomic>
 #include <vector>
 #include <memory>
 
@@ -102,6 +103,10 @@ class CoreActionController : public H2Core::Object<CoreActionController> {
 		 * This will be done immediately and without saving the
 		 * current #H2Core::Song. All unsaved changes will be lost!
 		 *
+		 * In case transport is rolling and SongSwitcher::isApplicable(),
+		 * the song is loaded in the background instead and replaces
+		 * the current one at Preferences::m_switchBoundary.
+		 *
 		 * \param pSong Pointer to the #H2Core::Song to set.
 		 * \return true on success
 		 */
@@ -268,6 +273,10 @@ class CoreActionController : public H2Core::Object<CoreActionController> {
 	 * and also can be used to reset the parameters of the current
 	 * drumkit to its default values.
 	 *
+	 * In case transport is rolling and SongSwitcher::isApplicable(),
+	 * the kit is loaded in the background instead and replaces the
+	 * current one at Preferences::m_switchBoundary.
+	 *
 	 * \param pDrumkit Full-fledged #H2Core::Drumkit to load.
 	 * \param bConditional Whether to remove all redundant
 	 * H2Core::Instrument regardless of their content.
@@ -503,6 +512,20 @@ private:
 	 * \param sFilename New song to be added on top of the list.
 	 */
 	static void insertRecentFile( const QString& sFilename );
+
+	/** Part of setSong() carried out after @a pSong was set. */
+	static void finishSetSong( std::shared_ptr<Song> pSong );
+	/** Part of setDrumkit() carried out after @a pDrumkit was set. */
+	static void finishSetDrumkit( std::shared_ptr<Drumkit> pDrumkit );
+
+	/** Calls finishSetSong() and finishSetDrumkit() once the
+	 * corresponding switch was committed. */
+	friend class SongSwitcher;
+
+	/** Incremented by every call to setDrumkit() loading a kit
+	 * itself. Loads started by previous calls are cancelled once it
+	 * changes. */
+	static std::atomic<int> m_nDrumkitRequests;
 };
 
 }
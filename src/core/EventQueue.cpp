@@ -22,6 +22,10 @@
 
 #include <core/EventQueue.h>
 
+#include <core/AudioEngine/AudioEngine.h>
+#include <core/AudioEngine/RubberbandWorker.h>
+#include <core/Hydrogen.h>
+
 namespace H2Core
 {
 
@@ -111,6 +115,10 @@ QString Event::typeToQString( EventType type ) {
 		return "EVENT_NEXT_SHOT";
 	case EVENT_MIDI_MAP_CHANGED:
 		return "EVENT_MIDI_MAP_CHANGED";
+	case EVENT_SAMPLE_LOADING_PROGRESS:
+		return "EVENT_SAMPLE_LOADING_PROGRESS";
+	case EVENT_SWITCH_COMMITTED:
+		return "EVENT_SWITCH_COMMITTED";
 	default:
 		break;
 	}
@@ -149,13 +157,21 @@ void EventQueue::create_instance()
 EventQueue::EventQueue()
 		: __read_index( 0 )
 		, __write_index( 0 )
+		, m_nDroppedCount( 0 )
+		, m_nCoalescedCount( 0 )
+		, m_nReportedDroppedCount( 0 )
 		, m_bSilent( false )
 {
 	__instance = this;
 
 	for ( int i = 0; i < MAX_EVENTS; ++i ) {
-		__events_buffer[ i ].type = EVENT_NONE;
-		__events_buffer[ i ].value = 0;
+		__events_buffer[ i ].nSequence = i;
+		__events_buffer[ i ].event.type = EVENT_NONE;
+		__events_buffer[ i ].event.value = 0;
+		__events_buffer[ i ].bCoalescing = false;
+	}
+	for ( auto& slot : m_coalescingSlots ) {
+		slot = 0;
 	}
 }
 
@@ -165,101 +181,175 @@ EventQueue::~EventQueue()
 //	infoLog( "DESTROY" );
 }
 
+int EventQueue::coalescingSlot( EventType type ) {
+	switch ( type ) {
+	case EVENT_PLAYING_PATTERNS_CHANGED:
+		return 0;
+	case EVENT_NEXT_PATTERNS_CHANGED:
+		return 1;
+	case EVENT_PATTERN_MODIFIED:
+		return 2;
+	case EVENT_SELECTED_PATTERN_CHANGED:
+		return 3;
+	case EVENT_SELECTED_INSTRUMENT_CHANGED:
+		return 4;
+	case EVENT_INSTRUMENT_PARAMETERS_CHANGED:
+		return 5;
+	case EVENT_MIDI_ACTIVITY:
+		return 6;
+	case EVENT_TEMPO_CHANGED:
+		return 7;
+	case EVENT_TIMELINE_UPDATE:
+		return 8;
+	case EVENT_RELOCATION:
+		return 9;
+	case EVENT_BBT_CHANGED:
+		return 10;
+	case EVENT_SONG_SIZE_CHANGED:
+		return 11;
+	default:
+		return -1;
+	}
+}
 
 void EventQueue::push_event( const EventType type, const int nValue )
 {
-	std::lock_guard< std::mutex > lock( m_mutex );
-	unsigned int nIndex = ++__write_index;
-	nIndex = nIndex % MAX_EVENTS;
-	Event ev;
-	ev.type = type;
-	ev.value = nValue;
-//	INFOLOG( QString( "[pushEvent] %1 : %2 %3" ).arg( nIndex ).arg( ev.type ).arg( ev.value ) );
-
-	/* If the event queue is full, log an error. We could drop the old event, or the new event we're trying to
-	   place. It's preferable to drop the oldest event in the queue, on the basis that many
-	   change-of-state-events are probably no longer relevant or redundant based on newer events in the queue,
-	   so we keep the new event. However, since the new event has overwritten the oldest event in the queue,
-	   we also adjust the read pointer, otherwise pop_event would return this newest event on the next call,
-	   then subsequent calls would get newer entries. */
-
-	if ( ! m_bSilent &&
-		 __write_index > __read_index + MAX_EVENTS ) {
-		ERRORLOG( QString( "Event queue full, lost event type %1 value %2" )
-				  .arg( __events_buffer[nIndex].type )
-				  .arg( __events_buffer[nIndex].value ));
-		__read_index++;
+	const int nCoalescingSlot = coalescingSlot( type );
+	bool bCoalescing = false;
+	if ( nCoalescingSlot != -1 ) {
+		const uint64_t nPending = nCoalescingPending |
+			static_cast<uint32_t>( nValue );
+		uint64_t nCurrent = m_coalescingSlots[ nCoalescingSlot ].load();
+		if ( nCurrent == nPending ) {
+			// An identical event was not handled yet.
+			++m_nCoalescedCount;
+			return;
+		}
+		else if ( nCurrent == 0 ) {
+			// Claim the slot. In case another producer was faster or a
+			// different value is still pending, the event is queued
+			// without being merged.
+			bCoalescing = m_coalescingSlots[ nCoalescingSlot ]
+				.compare_exchange_strong( nCurrent, nPending );
+		}
 	}
 
-	__events_buffer[ nIndex ] = ev;
+	unsigned int nPosition = __write_index.load( std::memory_order_relaxed );
+	Slot* pSlot;
+	while ( true ) {
+		pSlot = &__events_buffer[ nPosition % MAX_EVENTS ];
+		const unsigned int nSequence =
+			pSlot->nSequence.load( std::memory_order_acquire );
+		const int nDiff = static_cast<int>( nSequence - nPosition );
+		if ( nDiff == 0 ) {
+			if ( __write_index.compare_exchange_weak(
+					 nPosition, nPosition + 1, std::memory_order_relaxed ) ) {
+				break;
+			}
+		}
+		else if ( nDiff < 0 ) {
+			// Queue is full. In contrast to an overwrite of the oldest
+			// event this does not require to touch the read index.
+			++m_nDroppedCount;
+			if ( bCoalescing ) {
+				m_coalescingSlots[ nCoalescingSlot ] = 0;
+			}
+			return;
+		}
+		else {
+			nPosition = __write_index.load( std::memory_order_relaxed );
+		}
+	}
 
+	pSlot->event.type = type;
+	pSlot->event.value = nValue;
+	pSlot->bCoalescing = bCoalescing;
+	pSlot->nSequence.store( nPosition + 1, std::memory_order_release );
 }
 
 
 Event EventQueue::pop_event()
 {
-	std::lock_guard< std::mutex > lock( m_mutex );
-	if ( __read_index == __write_index ) {
-		Event ev;
-		ev.type = EVENT_NONE;
-		ev.value = 0;
+	if ( ! m_bSilent && m_nReportedDroppedCount != m_nDroppedCount ) {
+		const int nDroppedCount = m_nDroppedCount;
+		ERRORLOG( QString( "Event queue full, lost [%1] events" )
+				  .arg( nDroppedCount - m_nReportedDroppedCount ) );
+		m_nReportedDroppedCount = nDroppedCount;
+	}
+
+	Event ev;
+	ev.type = EVENT_NONE;
+	ev.value = 0;
+
+	const unsigned int nPosition = __read_index.load( std::memory_order_relaxed );
+	Slot* pSlot = &__events_buffer[ nPosition % MAX_EVENTS ];
+	if ( pSlot->nSequence.load( std::memory_order_acquire ) != nPosition + 1 ) {
+		// The consumer is idle. Free the notes the audio thread is
+		// not allowed to delete itself and wake up the worker for
+		// tempo changes it requested.
+		auto pHydrogen = Hydrogen::get_instance();
+		if ( pHydrogen != nullptr && pHydrogen->getAudioEngine() != nullptr ) {
+			pHydrogen->getAudioEngine()->getNotePool()->freeReturnedNotes();
+		}
+		if ( pHydrogen != nullptr && pHydrogen->getRubberbandWorker() != nullptr ) {
+			pHydrogen->getRubberbandWorker()->wake();
+		}
 		return ev;
 	}
-	unsigned int nIndex = ++__read_index;
-	nIndex = nIndex % MAX_EVENTS;
-//	INFOLOG( QString( "[popEvent] %1 : %2 %3" ).arg( nIndex ).arg( __events_buffer[ nIndex ].type ).arg( __events_buffer[ nIndex ].value ) );
-	return __events_buffer[ nIndex ];
+
+	ev = pSlot->event;
+	if ( pSlot->bCoalescing ) {
+		// Events pushed from here on can not be merged into this one
+		// anymore.
+		m_coalescingSlots[ coalescingSlot( ev.type ) ] = 0;
+	}
+
+	pSlot->nSequence.store( nPosition + MAX_EVENTS, std::memory_order_release );
+	__read_index.store( nPosition + 1, std::memory_order_relaxed );
+
+//	INFOLOG( QString( "[popEvent] %1 : %2 %3" ).arg( nPosition ).arg( ev.type ).arg( ev.value ) );
+	return ev;
 }
 
 QString EventQueue::toQString( const QString& sPrefix, bool bShort ) {
-	std::lock_guard< std::mutex > lock( m_mutex );
-
-	const int nReadIndex =  __read_index % MAX_EVENTS;
-	const int nWriteIndex =  __write_index % MAX_EVENTS;
+	const unsigned int nReadIndex = __read_index;
+	const unsigned int nWriteIndex = __write_index;
 
 	QString s = Base::sPrintIndention;
-	QString sOutput, sIndexPrefix;
+	QString sOutput;
 	if ( ! bShort ) {
 		sOutput = QString( "%1[EventQueue]\n" ).arg( sPrefix )
 			.append( QString( "%1%2__read_index: %3\n" ).arg( sPrefix ).arg( s )
-					 .arg( __read_index ) )
+					 .arg( nReadIndex ) )
 			.append( QString( "%1%2__write_index: %3\n" ).arg( sPrefix ).arg( s )
-					 .arg( __write_index ) )
+					 .arg( nWriteIndex ) )
+			.append( QString( "%1%2m_nDroppedCount: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( getDroppedCount() ) )
+			.append( QString( "%1%2m_nCoalescedCount: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( getCoalescedCount() ) )
 			.append( QString( "%1%2m_bSilent: %3\n" ).arg( sPrefix ).arg( s )
 					 .arg( m_bSilent ) )
 			.append( QString( "%1%2__events_buffer: \n" ).arg( sPrefix ).arg( s ) );
-		for ( int ii = 0; ii < MAX_EVENTS; ii++ ) {
-			sIndexPrefix = "";
-			if ( ii == nReadIndex ) {
-				sIndexPrefix.append( "[READ] " );
-			}
-			if ( ii == nWriteIndex ) {
-				sIndexPrefix.append( "[WRITE] " );
-			}
-
-			sOutput.append( QString( "%1%1%2%3: %4%5\n" ).arg( sPrefix ).arg( s )
-							.arg( ii ).arg( sIndexPrefix )
-							.arg( __events_buffer[ ii ].toQString( "", true ) ) );
+		for ( unsigned int ii = nReadIndex; ii != nWriteIndex; ++ii ) {
+			sOutput.append( QString( "%1%1%2%3: %4\n" ).arg( sPrefix ).arg( s )
+							.arg( ii % MAX_EVENTS )
+							.arg( __events_buffer[ ii % MAX_EVENTS ].event
+								  .toQString( "", true ) ) );
 		}
 		sOutput.append( "\n" );
 	}
 	else {
 		sOutput = QString( "[EventQueue] " )
-			.append( QString( "__read_index: %1" ).arg( __read_index ) )
-			.append( QString( ", __write_index: %1" ).arg( __write_index ) )
+			.append( QString( "__read_index: %1" ).arg( nReadIndex ) )
+			.append( QString( ", __write_index: %1" ).arg( nWriteIndex ) )
+			.append( QString( ", m_nDroppedCount: %1" ).arg( getDroppedCount() ) )
+			.append( QString( ", m_nCoalescedCount: %1" ).arg( getCoalescedCount() ) )
 			.append( QString( ", m_bSilent: %1" ).arg( m_bSilent ) )
 			.append( QString( ", __events_buffer: [" ) );
-		for ( int ii = 0; ii < MAX_EVENTS; ii++ ) {
-			sIndexPrefix = "";
-			if ( ii == nReadIndex ) {
-				sIndexPrefix.append( "[READ] " );
-			}
-			if ( ii == nWriteIndex ) {
-				sIndexPrefix.append( "[WRITE] " );
-			}
-
-			sOutput.append( QString( "%1: %2%3, " ).arg( ii ).arg( sIndexPrefix )
-							.arg( __events_buffer[ ii ].toQString( "", true ) ) );
+		for ( unsigned int ii = nReadIndex; ii != nWriteIndex; ++ii ) {
+			sOutput.append( QString( "%1: %2, " ).arg( ii % MAX_EVENTS )
+							.arg( __events_buffer[ ii % MAX_EVENTS ].event
+								  .toQString( "", true ) ) );
 		}
 		sOutput.append( "]\n" );
 	}
@@ -25,12 +25,16 @@
 
 #include <core/Object.h>
 #include <core/Basics/Note.h>
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <mutex>
 
-/** Maximum number of events to be stored in the
-    H2Core::EventQueue::__events_buffer.*/
-#define MAX_EVENTS 1024
+/** Maximum number of events pending in the
+    H2Core::EventQueue::__events_buffer at the same time. Has to be a
+    power of two.*/
+#define MAX_EVENTS 4096
 
 namespace H2Core
 {
@@ -192,7 +196,18 @@ enum EventType {
 	 *       (updated the title and status bar).
 	 * - 2 - Playlist is not writable (inform the user via a QMessageBox)
 	 */
-	EVENT_PLAYLIST_CHANGED
+	EVENT_PLAYLIST_CHANGED,
+	/**
+	 * Progress of loading the samples of a drumkit in percent. A
+	 * value of -1 indicates loading was cancelled.
+	 */
+	EVENT_SAMPLE_LOADING_PROGRESS,
+	/**
+	 * The #AudioEngine swapped in a song or drumkit loaded by the
+	 * #SongSwitcher. The frontend has to call SongSwitcher::finish()
+	 * in response.
+	 */
+	EVENT_SWITCH_COMMITTED
 };
 
 /** Basic building block for the communication between the core of
@@ -259,17 +274,24 @@ public:/**
 	/**
 	 * Queues the next event into the EventQueue.
 	 *
-	 * The event itself will be constructed inside the function
-	 * and will be two properties: an EventType @a type and a
-	 * value @a nValue. Since the event written to the queue most
-	 * recently is indexed with #__write_index, this variable is
-	 * incremented once and its modulo with respect to #MAX_EVENTS
-	 * is calculated to determine the position of insertion into
-	 * #__events_buffer.
+	 * The event itself will be constructed inside the function and
+	 * will be two properties: an EventType @a type and a value @a
+	 * nValue.
 	 *
-	 * The modulo operation is necessary because #__write_index
-	 * will be only incremented and does not respect the actual
-	 * length of #__events_buffer itself.
+	 * This function neither locks nor allocates and can be called
+	 * from any thread, including the realtime audio thread. Several
+	 * producers claim slots of #__events_buffer concurrently by
+	 * advancing #__write_index.
+	 *
+	 * Events only reporting that some part of the engine state has
+	 * changed (see coalescingSlot()) will not be queued again in case
+	 * an identical one is still pending. Since the GUI queries the
+	 * current state when handling it, no information is lost.
+	 *
+	 * In case #__events_buffer is full, the new event is discarded
+	 * and #m_nDroppedCount is incremented. The error message will be
+	 * printed by the next call to pop_event() to keep this function
+	 * realtime safe.
 	 *
 	 * \param type Type of the event, which will be queued.
 	 * \param nValue Value specifying the content of the new event.
@@ -278,16 +300,15 @@ public:/**
 	/**
 	 * Reads out the next event of the EventQueue.
 	 *
-	 * Since the event read out most recently is indexed with
-	 * #__read_index, this variable is incremented once and its
-	 * modulo with respect to #MAX_EVENTS is calculated to
-	 * determine the event returned from #__events_buffer. 
+	 * Only a single thread is allowed to read at a time.
 	 *
-	 * The modulo operation is necessary because #__read_index
-	 * will be only incremented and does not respect the actual
-	 * length of #__events_buffer itself.
+	 * Once the queue is empty, notes returned by the audio thread are
+	 * freed (see NotePool::freeReturnedNotes()). Since both the GUI
+	 * and the CLI poll the queue, this happens in headless sessions
+	 * as well.
 	 *
-	 * \return Next event in line.
+	 * \return Next event in line or an event of type
+	 * #H2Core::EVENT_NONE in case the queue is empty.
 	 */
 	Event pop_event();
 
@@ -307,6 +328,13 @@ public:/**
 
 	bool getSilent() const;
 	void setSilent( bool bSilent );
+
+	/** Number of events discarded since #__events_buffer was
+	 * full. */
+	int getDroppedCount() const;
+	/** Number of events merged into an identical one already
+	 * pending. */
+	int getCoalescedCount() const;
 	
 	/** Formatted string version for debugging purposes.
 	 * \param sPrefix String prefix which will be added in front of
@@ -335,31 +363,61 @@ private:
 	static EventQueue *__instance;
 
 	/**
-	 * Continuously growing number indexing the event, which has
-	 * been read from the EventQueue most recently.
+	 * Returns the index within #m_coalescingSlots used to merge
+	 * redundant events of type @a type or -1 in case events of this
+	 * type must be delivered one by one.
+	 */
+	static int coalescingSlot( EventType type );
+	static constexpr int nCoalescingSlots = 12;
+
+	/** Element of the ring buffer #__events_buffer. */
+	struct Slot {
+		/** Sequence number used to hand the slot over between
+		 * producers and the consumer. It equals the position the slot
+		 * can be written to next when empty and that position plus
+		 * one when filled. */
+		std::atomic<unsigned int> nSequence;
+		Event event;
+		/** Whether the event occupies its entry in
+		 * #m_coalescingSlots. */
+		bool bCoalescing;
+	};
+
+	/**
+	 * Continuously growing number indexing the next event to be read
+	 * from the EventQueue.
 	 *
 	 * It is incremented with each call to pop_event(). 
 	 */
-	volatile unsigned int __read_index;
+	std::atomic<unsigned int> __read_index;
 	/**
-	 * Continuously growing number indexing the event, which has
-	 * been written to the EventQueue most recently.
+	 * Continuously growing number indexing the next slot to be
+	 * written to.
 	 *
 	 * It is incremented with each call to push_event(). 
 	 */
-	volatile unsigned int __write_index;
+	std::atomic<unsigned int> __write_index;
 	/**
-	 * Array of all events contained in the EventQueue.
+	 * Ring buffer containing all events of the EventQueue.
 	 *
 	 * Its length is set to #MAX_EVENTS and it gets initialized
 	 * with #H2Core::EVENT_NONE in EventQueue().
 	 */
-	Event __events_buffer[ MAX_EVENTS ];
+	Slot __events_buffer[ MAX_EVENTS ];
 
 	/**
-	 * Mutex to lock access to queue.
+	 * For each type of event which can be merged, the value of the
+	 * one currently pending in #__events_buffer combined with
+	 * #nCoalescingPending. 0 if none is pending.
 	 */
-	std::mutex m_mutex;
+	std::array<std::atomic<uint64_t>, nCoalescingSlots> m_coalescingSlots;
+	static constexpr uint64_t nCoalescingPending = uint64_t( 1 ) << 32;
+
+	std::atomic<int> m_nDroppedCount;
+	std::atomic<int> m_nCoalescedCount;
+	/** #m_nDroppedCount at the time of the last error message. Only
+	 * accessed by the reading thread. */
+	int m_nReportedDroppedCount;
 
 	/** Whether or not to push log messages.*/
 	bool m_bSilent;
@@ -371,6 +429,12 @@ inline bool EventQueue::getSilent() const {
 inline void EventQueue::setSilent( bool bSilent ) {
 	m_bSilent = bSilent;
 }
+inline int EventQueue::getDroppedCount() const {
+	return m_nDroppedCount;
+}
+inline int EventQueue::getCoalescedCount() const {
+	return m_nCoalescedCount;
+}
 
 };
 
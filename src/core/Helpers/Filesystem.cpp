@@ -51,6 +51,7 @@
 #define PLAYLISTS       "playlists/"
 #define PLUGINS         "plugins/"
 #define REPOSITORIES    "repositories/"
+#define SAMPLES         "samples/"
 #define SCRIPTS         "scripts/"
 #define SONGS           "songs/"
 #define THEMES          "themes/"
@@ -77,6 +78,7 @@
 #define PLAYLIST_XSD     "playlist.xsd"
 
 #define AUTOSAVE        "autosave"
+#define SOUND_LIBRARY_INDEX "sound_library_index.xml"
 
 #define UNTITLED_SONG		"Untitled Song"
 #define UNTITLED_PLAYLIST	"untitled.h2playlist"
@@ -441,6 +443,7 @@ bool Filesystem::check_sys_paths()
 bool Filesystem::check_usr_paths() {
 	QStringList pathsUsable = { tmp_dir(),			__usr_data_path,
 								cache_dir(),		repositories_cache_dir(),
+								sample_cache_dir(),
 								usr_drumkits_dir(), usr_drumkit_maps_dir(),
 								patterns_dir(),		playlists_dir(),
 								plugins_dir(),		scripts_dir(),
@@ -665,6 +668,14 @@ QString Filesystem::repositories_cache_dir()
 {
 	return __usr_data_path + CACHE + REPOSITORIES;
 }
+QString Filesystem::sample_cache_dir()
+{
+	return __usr_data_path + CACHE + SAMPLES;
+}
+QString Filesystem::sound_library_index_file()
+{
+	return __usr_data_path + CACHE + SOUND_LIBRARY_INDEX;
+}
 QString Filesystem::demos_dir()
 {
 	return __sys_data_path + DEMOS;
@@ -989,6 +1000,8 @@ void Filesystem::info()
 	INFOLOG( QString( "User Click file            : %1" ).arg( usr_click_file_path() ) );
 	INFOLOG( QString( "Cache dir                  : %1" ).arg( cache_dir() ) );
 	INFOLOG( QString( "Reporitories Cache dir     : %1" ).arg( repositories_cache_dir() ) );
+	INFOLOG( QString( "Sample Cache dir           : %1" ).arg( sample_cache_dir() ) );
+	INFOLOG( QString( "Sound library index        : %1" ).arg( sound_library_index_file() ) );
 	INFOLOG( QString( "User drumkit dir           : %1" ).arg( usr_drumkits_dir() ) );
 	INFOLOG( QString( "Patterns dir               : %1" ).arg( patterns_dir() ) );
 	INFOLOG( QString( "Playlist dir               : %1" ).arg( playlists_dir() ) );
@@ -197,6 +197,11 @@ namespace H2Core
 		static QString cache_dir();
 		/** returns user repository cache path */
 		static QString repositories_cache_dir();
+		/** returns user cache path of processed samples */
+		static QString sample_cache_dir();
+		/** returns the file the #SoundLibraryDatabase persists the
+		 * metadata of all drumkits and patterns in */
+		static QString sound_library_index_file();
 		/** returns system demos path */
 		static QString demos_dir();
 		/** returns system xsd path */
@@ -306,6 +306,9 @@ Pattern* Legacy::load_drumkit_pattern( const QString& pattern_path, std::shared_
 		return pPattern;
 	}
 
+	// All notes are inserted at once to build the note index just a
+	// single time.
+	std::vector<Note*> notes;
 	XMLNode note_list_node = pattern_node.firstChildElement( "noteList" );
 
 	if ( ! note_list_node.isNull() ) {
@@ -346,7 +349,7 @@ Pattern* Legacy::load_drumkit_pattern( const QString& pattern_path, std::shared_
 			pNote->set_lead_lag(fLeadLag);
 			pNote->set_note_off( noteoff );
 			pNote->set_probability( fProbability );
-			pPattern->insert_note( pNote );
+			notes.push_back( pNote );
 
 			note_node = note_node.nextSiblingElement( "note" );
 		}
@@ -386,13 +389,14 @@ Pattern* Legacy::load_drumkit_pattern( const QString& pattern_path, std::shared_
 										noteNode.read_float( "pitch", 0.0, false, false ) );
 				pNote->set_lead_lag( noteNode.read_float( "leadlag", 0.0, false, false ) );
 
-				pPattern->insert_note( pNote );
+				notes.push_back( pNote );
 
 				noteNode = noteNode.nextSiblingElement( "note" );
 			}
 			sequenceNode = sequenceNode.nextSiblingElement( "sequence" );
 		}
 	}
+	pPattern->insert_notes( notes );
 	
 	return pPattern;
 }
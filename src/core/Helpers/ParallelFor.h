@@ -0,0 +1,94 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+
+
+#ifndef H2C_PARALLEL_FOR_H
+#define H2C_PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace H2Core
+{
+
+/**
+ * Calls @a fn for each index in [0, @a nCount) using one thread per
+ * core at most.
+ *
+ * Each worker picks the next index not claimed yet. Since the items
+ * processed - like the samples of a kit - usually differ largely in
+ * size, this balances the load better than splitting the range in
+ * advance. The calling thread is part of the pool too and the
+ * function returns once all workers are joined.
+ *
+ * It spawns threads and must thus not be used within the audio
+ * thread.
+ *
+ * \param nCount Number of items to process.
+ * \param fn Callable taking the index of the item to process. It is
+ *   called concurrently.
+ * \param isCancelled Optional callback checked before each item. In
+ *   case it returns true, no further items are processed.
+ *
+ * \return false in case the processing was cancelled.
+ */
+template <typename F>
+bool parallelFor( int nCount, F fn,
+				  const std::function<bool()>& isCancelled = nullptr )
+{
+	std::atomic<int> nNext( 0 );
+	std::atomic<bool> bCancelled( false );
+
+	auto worker = [&]() {
+		while ( ! bCancelled ) {
+			const int nItem = nNext++;
+			if ( nItem >= nCount ) {
+				return;
+			}
+			if ( isCancelled && isCancelled() ) {
+				bCancelled = true;
+				return;
+			}
+			fn( nItem );
+		}
+	};
+
+	const int nWorkers = std::min(
+		nCount, static_cast<int>(
+			std::max( 1u, std::thread::hardware_concurrency() ) ) );
+	std::vector<std::thread> workers;
+	for ( int ii = 1; ii < nWorkers; ++ii ) {
+		workers.push_back( std::thread( worker ) );
+	}
+	worker();
+	for ( auto& thread : workers ) {
+		thread.join();
+	}
+
+	return ! bCancelled;
+}
+
+};
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+
+#ifndef H2C_SHARED_SLOT_H
+#define H2C_SHARED_SLOT_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace H2Core
+{
+
+/**
+ * Holds a std::shared_ptr which can be read by the audio thread
+ * without locking.
+ *
+ * std::atomic_load() and std::atomic_store() of a std::shared_ptr
+ * are implemented using a global pool of mutexes and must thus not be
+ * used within the audio thread. Instead, the slot consists of two
+ * cells and the atomic index of the published one. Readers register
+ * at the cell they are about to copy, check whether the index is
+ * still the same, and copy the pointer. Apart from the reference
+ * count of the object nothing is altered.
+ *
+ * All writers have to be serialized by holding the #AudioEngine
+ * lock. Since the audio thread is holding it too while processing,
+ * all copies it created are released again before a writer can
+ * drop the replaced object. Objects are thus never freed within the
+ * audio thread.
+ *
+ * - store() replaces the object and may wait for readers. It must
+ *   not be used within the audio thread.
+ * - publish() replaces the object without waiting and is safe within
+ *   the audio thread. The replaced one is kept in the slot till it is
+ *   retrieved using reclaim().
+ *
+ * \ingroup docCore
+ */
+template <typename T>
+class SharedSlot
+{
+public:
+	SharedSlot() : m_nIndex( 0 ) {
+		m_nReaders[ 0 ] = 0;
+		m_nReaders[ 1 ] = 0;
+	}
+	SharedSlot( const SharedSlot& ) = delete;
+	SharedSlot& operator=( const SharedSlot& ) = delete;
+
+	/** Returns the published object. Lock-free. */
+	std::shared_ptr<T> load() const {
+		while ( true ) {
+			const int nIndex = m_nIndex.load();
+			++m_nReaders[ nIndex ];
+			if ( m_nIndex.load() == nIndex ) {
+				std::shared_ptr<T> p = m_cells[ nIndex ];
+				--m_nReaders[ nIndex ];
+				return p;
+			}
+			// A writer swapped in another object in the meantime.
+			--m_nReaders[ nIndex ];
+		}
+	}
+
+	/**
+	 * Replaces the published object by @a p.
+	 *
+	 * \return The replaced object. In order to not free it while
+	 *   holding the #AudioEngine lock, callers can drop it after
+	 *   unlocking.
+	 */
+	std::shared_ptr<T> store( std::shared_ptr<T> p ) {
+		const int nOld = m_nIndex.load();
+		const int nNew = 1 - nOld;
+		waitForReaders( nNew );
+		std::swap( m_cells[ nNew ], p );
+		m_nIndex.store( nNew );
+
+		// Readers still copying the replaced object.
+		waitForReaders( nOld );
+		p = std::move( m_cells[ nOld ] );
+		m_cells[ nOld ] = nullptr;
+		return p;
+	}
+
+	/**
+	 * Whether publish() can be called right now.
+	 *
+	 * This is not the case if the object replaced by the last call
+	 * to publish() was not reclaimed yet or a reader is still copying
+	 * it.
+	 */
+	bool isPublishable() const {
+		const int nNew = 1 - m_nIndex.load();
+		return m_cells[ nNew ] == nullptr && m_nReaders[ nNew ] == 0;
+	}
+
+	/**
+	 * Replaces the published object by @a p without waiting or
+	 * freeing anything. isPublishable() must be true.
+	 */
+	void publish( const std::shared_ptr<T>& p ) {
+		const int nNew = 1 - m_nIndex.load();
+		m_cells[ nNew ] = p;
+		m_nIndex.store( nNew );
+	}
+
+	/** \return The object replaced by the last call to publish() in
+	 *   case it was not reclaimed yet. */
+	std::shared_ptr<T> reclaim() {
+		const int nOld = 1 - m_nIndex.load();
+		waitForReaders( nOld );
+		std::shared_ptr<T> p = std::move( m_cells[ nOld ] );
+		m_cells[ nOld ] = nullptr;
+		return p;
+	}
+
+private:
+	void waitForReaders( int nIndex ) const {
+		while ( m_nReaders[ nIndex ] != 0 ) {
+			std::this_thread::yield();
+		}
+	}
+
+	std::shared_ptr<T> m_cells[ 2 ];
+	/** Cell holding the published object. */
+	std::atomic<int> m_nIndex;
+	/** Number of readers currently accessing each cell. */
+	mutable std::atomic<int> m_nReaders[ 2 ];
+};
+
+};
+
+#endif
@@ -23,6 +23,7 @@
 #include <core/Helpers/Xml.h>
 #include <core/Helpers/Legacy.h>
 
+#include <QtCore/QCryptographicHash>
 #include <QtCore/QFile>
 #include <QtCore/QLocale>
 #include <QtCore/QString>
@@ -31,6 +32,12 @@
 #include <QtXmlPatterns/QXmlSchemaValidator>
 #include <QAbstractMessageHandler>
 
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
 #define XMLNS_BASE "http://www.hydrogen-music.org/"
 #define XMLNS_XSI "http://www.w3.org/2001/XMLSchema-instance"
 
@@ -55,7 +62,93 @@ protected:
 
 };
 
+/** A schema compiled from an .xsd file along with the message
+ * handler it reports to. */
+struct CompiledSchema {
+	SilentMessageHandler handler;
+	QXmlSchema schema;
+};
+
+/** Loading and compiling a schema is by far the most expensive part of
+ * a validation. Therefore, compiled schemas are kept for the lifetime
+ * of the process.
+ *
+ * QXmlSchema fills internal caches while validating and must not be
+ * used by several threads at once. Instead of serializing all
+ * validations, each schema path holds a pool of compiled instances. A
+ * thread checks out one instance for the duration of a validation and
+ * returns it afterwards. Only if all instances are in use, a new one
+ * is compiled.*/
+static std::mutex schemaPoolMutex;
+static std::map<QString, std::vector<std::unique_ptr<CompiledSchema>>> schemaPool;
+
+/** Hashes of all documents successfully validated against a schema
+ * so far. Used when XMLDoc::setSkipValidatedFiles() is enabled. */
+static std::set<QByteArray> validatedDocuments;
+
+static std::unique_ptr<CompiledSchema> checkOutSchema( const QString& sSchemaPath )
+{
+	std::lock_guard<std::mutex> lock( schemaPoolMutex );
+	auto& schemas = schemaPool[ sSchemaPath ];
+	if ( schemas.empty() ) {
+		return nullptr;
+	}
+
+	auto pSchema = std::move( schemas.back() );
+	schemas.pop_back();
+	return pSchema;
+}
+
+/** Escapes @a sText the same way QDomDocument::toString() does.
+ *
+ * \param bEncodeQuotes Whether double quotes should be escaped.
+ * \param bPerformAVN Whether whitespace characters should be escaped
+ *   to survive attribute value normalization.
+ * \param bEncodeEOLs Whether carriage returns should be escaped. */
+static QString encodeText( const QString& sText, bool bEncodeQuotes,
+						   bool bPerformAVN, bool bEncodeEOLs )
+{
+	QString sEncoded;
+	sEncoded.reserve( sText.size() );
+	for ( int ii = 0; ii < sText.size(); ++ii ) {
+		const QChar c = sText.at( ii );
+		if ( c == '<' ) {
+			sEncoded.append( "&lt;" );
+		}
+		else if ( bEncodeQuotes && c == '"' ) {
+			sEncoded.append( "&quot;" );
+		}
+		else if ( c == '&' ) {
+			sEncoded.append( "&amp;" );
+		}
+		else if ( c == '>' && sEncoded.endsWith( "]]" ) ) {
+			sEncoded.append( "&gt;" );
+		}
+		else if ( bPerformAVN &&
+				  ( c == QChar( 0xA ) || c == QChar( 0xD ) ||
+					c == QChar( 0x9 ) ) ) {
+			sEncoded.append( QString( "&#x%1;" )
+							 .arg( QString::number( c.unicode(), 16 ) ) );
+		}
+		else if ( bEncodeEOLs && c == QChar( 0xD ) ) {
+			sEncoded.append( "&#xd;" );
+		}
+		else {
+			sEncoded.append( c );
+		}
+	}
+
+	return sEncoded;
+}
+
+static void checkInSchema( const QString& sSchemaPath,
+						   std::unique_ptr<CompiledSchema> pSchema )
+{
+	std::lock_guard<std::mutex> lock( schemaPoolMutex );
+	schemaPool[ sSchemaPath ].push_back( std::move( pSchema ) );
+}
 
+std::atomic<bool> XMLDoc::m_bSkipValidatedFiles( false );
 
 XMLNode::XMLNode() { }
 XMLNode::XMLNode( const QDomNode& node ) : QDomNode( node ) { }
@@ -317,44 +410,9 @@ bool XMLDoc::read( const QString& sFilePath, const QString& sSchemaPath,
 		return false;
 	}
 	
-	SilentMessageHandler handler;
-	QXmlSchema schema;
-	schema.setMessageHandler( &handler );
-	
-	bool bSchemaUsable = false;
-	
-	if ( ! sSchemaPath.isEmpty() ) {
-		QFile file( sSchemaPath );
-		if ( !file.open( QIODevice::ReadOnly ) ) {
-			ERRORLOG( QString( "Unable to open XML schema [%1] for reading." )
-					  .arg( sSchemaPath ) );
-		} else {
-			schema.load( &file, QUrl::fromLocalFile( file.fileName() ) );
-			file.close();
-			if ( schema.isValid() ) {
-				bSchemaUsable = true;
-			} else {
-				ERRORLOG( QString( "XML schema [%1] is not valid. File [%2] will not be validated" )
-						  .arg( sSchemaPath ).arg( sFilePath ) );
-			}
-		}
-	}
-	
-	if ( bSchemaUsable ) {
-		QXmlSchemaValidator validator( schema );
-		if ( !validator.validate( &file, QUrl::fromLocalFile( file.fileName() ) ) ) {
-			if ( ! bSilent ) {
-				WARNINGLOG( QString( "XML document [%1] is not valid with respect to schema [%2], loading may fail" )
-							.arg( sFilePath ).arg( sSchemaPath ) );
-			}
-			file.close();
-			return false;
-		}
-		else if ( ! bSilent ) {
-			INFOLOG( QString( "XML document [%1] is valid with respect to schema [%2]" )
-					 .arg( sFilePath ).arg( sSchemaPath ) );
-		}
-		file.seek( 0 );
+	if ( ! sSchemaPath.isEmpty() && ! validate( &file, sSchemaPath, bSilent ) ) {
+		file.close();
+		return false;
 	}
 
 	if ( Legacy::checkTinyXMLCompatMode( &file ) ) {
@@ -381,25 +439,112 @@ bool XMLDoc::read( const QString& sFilePath, const QString& sSchemaPath,
 	return true;
 }
 
-bool XMLDoc::write( const QString& filepath )
+bool XMLDoc::validate( const QString& sFilePath, const QString& sSchemaPath,
+					   bool bSilent )
 {
-	QFile file( filepath );
-	if ( !file.open( QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate ) ) {
-		ERRORLOG( QString( "Unable to open %1 for writing" ).arg( filepath ) );
+	QFile file( sFilePath );
+	if ( !file.open( QIODevice::ReadOnly ) ) {
+		ERRORLOG( QString( "Unable to open [%1] for reading" )
+				  .arg( sFilePath ) );
 		return false;
 	}
-	QTextStream out( &file );
-	out.setCodec( "UTF-8" );
-	out << toString().toUtf8();
-	out.flush();
 
-	bool rv = true;
-	if ( !toString().isEmpty() && file.size() == 0 ) {
-		rv = false;
+	const bool bValid = validate( &file, sSchemaPath, bSilent );
+	file.close();
+
+	return bValid;
+}
+
+bool XMLDoc::validate( QFile* pFile, const QString& sSchemaPath, bool bSilent )
+{
+	// Whether the very same document was already validated against
+	// the very same schema.
+	QByteArray documentHash;
+	bool bValidated = false;
+	if ( m_bSkipValidatedFiles ) {
+		QCryptographicHash hash( QCryptographicHash::Sha1 );
+		hash.addData( sSchemaPath.toUtf8() );
+		hash.addData( pFile );
+		documentHash = hash.result();
+		pFile->seek( 0 );
+
+		std::lock_guard<std::mutex> lock( schemaPoolMutex );
+		bValidated = validatedDocuments.find( documentHash ) !=
+			validatedDocuments.end();
 	}
 
-	file.close();
-	return rv;
+	std::unique_ptr<CompiledSchema> pSchema = nullptr;
+	if ( ! bValidated ) {
+		pSchema = checkOutSchema( sSchemaPath );
+		if ( pSchema == nullptr ) {
+			QFile schemaFile( sSchemaPath );
+			if ( !schemaFile.open( QIODevice::ReadOnly ) ) {
+				ERRORLOG( QString( "Unable to open XML schema [%1] for reading." )
+						  .arg( sSchemaPath ) );
+			} else {
+				pSchema = std::make_unique<CompiledSchema>();
+				pSchema->schema.setMessageHandler( &pSchema->handler );
+				pSchema->schema.load( &schemaFile,
+									  QUrl::fromLocalFile( schemaFile.fileName() ) );
+				schemaFile.close();
+				if ( ! pSchema->schema.isValid() ) {
+					ERRORLOG( QString( "XML schema [%1] is not valid. File [%2] will not be validated" )
+							  .arg( sSchemaPath ).arg( pFile->fileName() ) );
+					pSchema = nullptr;
+				}
+			}
+		}
+	}
+	
+	if ( pSchema != nullptr ) {
+		bool bValid;
+		{
+			QXmlSchemaValidator validator( pSchema->schema );
+			bValid = validator.validate( pFile, QUrl::fromLocalFile( pFile->fileName() ) );
+		}
+		checkInSchema( sSchemaPath, std::move( pSchema ) );
+
+		if ( ! bValid ) {
+			if ( ! bSilent ) {
+				WARNINGLOG( QString( "XML document [%1] is not valid with respect to schema [%2], loading may fail" )
+							.arg( pFile->fileName() ).arg( sSchemaPath ) );
+			}
+			return false;
+		}
+		else if ( ! bSilent ) {
+			INFOLOG( QString( "XML document [%1] is valid with respect to schema [%2]" )
+					 .arg( pFile->fileName() ).arg( sSchemaPath ) );
+		}
+
+		if ( ! documentHash.isEmpty() ) {
+			std::lock_guard<std::mutex> lock( schemaPoolMutex );
+			validatedDocuments.insert( documentHash );
+		}
+		pFile->seek( 0 );
+	}
+	else if ( bValidated && ! bSilent ) {
+		INFOLOG( QString( "XML document [%1] was already validated with respect to schema [%2]" )
+				 .arg( pFile->fileName() ).arg( sSchemaPath ) );
+	}
+
+	return true;
+}
+
+void XMLDoc::setSkipValidatedFiles( bool bSkip )
+{
+	m_bSkipValidatedFiles = bSkip;
+}
+
+bool XMLDoc::write( const QString& filepath )
+{
+	XMLStreamWriter writer;
+	if ( ! writer.open( filepath ) ) {
+		return false;
+	}
+
+	writer.writeChildren( *this );
+
+	return writer.commit();
 }
 
 XMLNode XMLDoc::set_root( const QString& node_name, const QString& xmlns )
@@ -416,4 +561,309 @@ XMLNode XMLDoc::set_root( const QString& node_name, const QString& xmlns )
 	return root;
 }
 
+XMLStreamReader::XMLStreamReader() { }
+
+bool XMLStreamReader::open( const QString& sFilePath, bool bSilent )
+{
+	m_file.setFileName( sFilePath );
+	if ( !m_file.open( QIODevice::ReadOnly ) ) {
+		ERRORLOG( QString( "Unable to open [%1] for reading" )
+				  .arg( sFilePath ) );
+		return false;
+	}
+
+	// Same behavior as QDomDocument::setContent() used in XMLDoc.
+	m_reader.setNamespaceProcessing( false );
+
+	if ( Legacy::checkTinyXMLCompatMode( &m_file, bSilent ) ) {
+		// Document was created using TinyXML and not using QtXML. We
+		// need to convert it first.
+		m_buffer.setData( Legacy::convertFromTinyXML( &m_file, bSilent ) );
+		m_file.close();
+		m_buffer.open( QIODevice::ReadOnly );
+		m_reader.setDevice( &m_buffer );
+	}
+	else {
+		m_file.seek( 0 );
+		m_reader.setDevice( &m_file );
+	}
+
+	if ( ! m_reader.readNextStartElement() ) {
+		ERRORLOG( QString( "Unable to read XML document [%1]: %2" )
+				  .arg( sFilePath ).arg( m_reader.errorString() ) );
+		return false;
+	}
+
+	return true;
+}
+
+QString XMLStreamReader::name() const
+{
+	return m_reader.name().toString();
+}
+
+bool XMLStreamReader::readNextChild()
+{
+	return m_reader.readNextStartElement();
+}
+
+XMLNode XMLStreamReader::readSubtree( XMLNode& parent )
+{
+	QDomDocument doc = parent.isDocument() ? parent.toDocument() :
+		parent.ownerDocument();
+	QDomElement element = doc.createElement( m_reader.name().toString() );
+	for ( const auto& attribute : m_reader.attributes() ) {
+		element.setAttribute( attribute.qualifiedName().toString(),
+							  attribute.value().toString() );
+	}
+	parent.appendChild( element );
+
+	while ( ! m_reader.atEnd() ) {
+		m_reader.readNext();
+		if ( m_reader.isStartElement() ) {
+			XMLNode child( element );
+			readSubtree( child );
+		}
+		else if ( m_reader.isEndElement() ) {
+			break;
+		}
+		else if ( m_reader.isCDATA() ) {
+			element.appendChild( doc.createCDATASection( m_reader.text().toString() ) );
+		}
+		else if ( m_reader.isCharacters() && ! m_reader.isWhitespace() ) {
+			// Whitespace-only text is dropped by QDomDocument as well.
+			element.appendChild( doc.createTextNode( m_reader.text().toString() ) );
+		}
+	}
+
+	return XMLNode( element );
+}
+
+void XMLStreamReader::skip()
+{
+	m_reader.skipCurrentElement();
+}
+
+XMLNode XMLStreamReader::createRoot( XMLDoc& doc )
+{
+	QDomElement root = doc.createElement( m_reader.name().toString() );
+	for ( const auto& attribute : m_reader.attributes() ) {
+		root.setAttribute( attribute.qualifiedName().toString(),
+						   attribute.value().toString() );
+	}
+	doc.appendChild( root );
+
+	return XMLNode( root );
+}
+
+bool XMLStreamReader::hasError() const
+{
+	return m_reader.hasError();
+}
+
+QString XMLStreamReader::errorString() const
+{
+	return m_reader.errorString();
+}
+
+XMLStreamWriter::XMLStreamWriter() { }
+
+bool XMLStreamWriter::open( const QString& sFilePath )
+{
+	m_file.setFileName( sFilePath );
+	// Files located in folders we are not allowed to create files in
+	// are still written, though not atomically.
+	m_file.setDirectWriteFallback( true );
+	if ( !m_file.open( QIODevice::WriteOnly | QIODevice::Text ) ) {
+		ERRORLOG( QString( "Unable to open %1 for writing" ).arg( sFilePath ) );
+		return false;
+	}
+
+	m_stream.setDevice( &m_file );
+	m_stream.setCodec( "UTF-8" );
+	m_openElements.clear();
+
+	return true;
+}
+
+void XMLStreamWriter::writeStartDocument( const QString& sName,
+										  const QString& sXmlns )
+{
+	// Creating the root in a document of its own ensures the header
+	// and the order of the attributes match the ones of
+	// XMLDoc::set_root().
+	XMLDoc doc;
+	XMLNode root = doc.set_root( sName, sXmlns );
+	writeNode( doc.firstChild(), 0, false, false );
+
+	writeIndent( 0 );
+	m_stream << '<' << sName;
+	writeAttributes( root );
+	m_openElements.push_back( { sName, false } );
+}
+
+void XMLStreamWriter::writeStartElement( const QString& sName )
+{
+	startChild();
+	writeIndent( m_openElements.size() );
+	m_stream << '<' << sName;
+	m_openElements.push_back( { sName, false } );
+}
+
+void XMLStreamWriter::writeEndElement()
+{
+	if ( m_openElements.empty() ) {
+		ERRORLOG( "No element to close" );
+		return;
+	}
+
+	const auto element = m_openElements.back();
+	m_openElements.pop_back();
+	if ( element.bHasChildren ) {
+		writeIndent( m_openElements.size() );
+		m_stream << "</" << element.sName << ">\n";
+	}
+	else {
+		m_stream << "/>\n";
+	}
+}
+
+void XMLStreamWriter::writeNode( const QDomNode& node )
+{
+	startChild();
+	writeNode( node, m_openElements.size(), false, false );
+}
+
+void XMLStreamWriter::writeChildren( const QDomNode& node )
+{
+	QDomNode child = node.firstChild();
+	if ( child.isNull() ) {
+		return;
+	}
+
+	startChild();
+	while ( ! child.isNull() ) {
+		writeNode( child, m_openElements.size(),
+				   child.previousSibling().isText(),
+				   child.nextSibling().isText() );
+		child = child.nextSibling();
+	}
+}
+
+bool XMLStreamWriter::commit()
+{
+	if ( ! m_openElements.empty() ) {
+		ERRORLOG( QString( "Element [%1] was not closed. Discarding [%2]" )
+				  .arg( m_openElements.back().sName ).arg( m_file.fileName() ) );
+		m_file.cancelWriting();
+	}
+
+	m_stream.flush();
+	if ( m_stream.status() != QTextStream::Ok ) {
+		ERRORLOG( QString( "Unable to write to [%1]" ).arg( m_file.fileName() ) );
+		m_file.cancelWriting();
+	}
+
+	if ( ! m_file.commit() ) {
+		ERRORLOG( QString( "Unable to write [%1]: %2" )
+				  .arg( m_file.fileName() ).arg( m_file.errorString() ) );
+		return false;
+	}
+
+	return true;
+}
+
+void XMLStreamWriter::startChild()
+{
+	// Elements written by the stream itself never hold text. Their
+	// start tag is thus always followed by a line break.
+	if ( ! m_openElements.empty() && ! m_openElements.back().bHasChildren ) {
+		m_stream << ">\n";
+		m_openElements.back().bHasChildren = true;
+	}
+}
+
+void XMLStreamWriter::writeIndent( int nDepth )
+{
+	// QDomDocument::toString() uses an indentation of one space per
+	// level by default.
+	for ( int ii = 0; ii < nDepth; ++ii ) {
+		m_stream << ' ';
+	}
+}
+
+void XMLStreamWriter::writeAttributes( const QDomNode& node )
+{
+	const QDomNamedNodeMap attributes = node.attributes();
+	for ( int ii = 0; ii < attributes.count(); ++ii ) {
+		const QDomAttr attribute = attributes.item( ii ).toAttr();
+		m_stream << ' ' << attribute.name() << "=\""
+				 << encodeText( attribute.value(), true, true, false ) << '"';
+	}
+}
+
+void XMLStreamWriter::writeNode( const QDomNode& node, int nDepth,
+								 bool bPrevIsText, bool bNextIsText )
+{
+	if ( node.isCDATASection() ) {
+		m_stream << "<![CDATA[" << node.nodeValue() << "]]>";
+	}
+	else if ( node.isText() ) {
+		m_stream << encodeText( node.nodeValue(), false, false, true );
+	}
+	else if ( node.isProcessingInstruction() ) {
+		const QDomProcessingInstruction instruction =
+			node.toProcessingInstruction();
+		m_stream << "<?" << instruction.target() << ' '
+				 << instruction.data() << "?>\n";
+	}
+	else if ( node.isComment() ) {
+		if ( ! bPrevIsText ) {
+			writeIndent( nDepth );
+		}
+		const QString sComment = node.nodeValue();
+		m_stream << "<!--" << sComment;
+		if ( sComment.endsWith( '-' ) ) {
+			m_stream << ' ';
+		}
+		m_stream << "-->";
+		if ( ! bNextIsText ) {
+			m_stream << '\n';
+		}
+	}
+	else if ( node.isElement() ) {
+		const QString sName = node.nodeName();
+		if ( ! bPrevIsText ) {
+			writeIndent( nDepth );
+		}
+		m_stream << '<' << sName;
+		writeAttributes( node );
+
+		QDomNode child = node.firstChild();
+		if ( ! child.isNull() ) {
+			m_stream << '>';
+			if ( ! child.isText() ) {
+				m_stream << '\n';
+			}
+			while ( ! child.isNull() ) {
+				writeNode( child, nDepth + 1, child.previousSibling().isText(),
+						   child.nextSibling().isText() );
+				child = child.nextSibling();
+			}
+			if ( ! node.lastChild().isText() ) {
+				writeIndent( nDepth );
+			}
+			m_stream << "</" << sName << '>';
+		}
+		else {
+			m_stream << "/>";
+		}
+		if ( ! bNextIsText ) {
+			m_stream << '\n';
+		}
+	}
+}
+
 };
+
+
@@ -24,7 +24,14 @@
 #define H2C_XML_H
 
 #include <core/Object.h>
+#include <atomic>
+#include <vector>
+#include <QtCore/QBuffer>
+#include <QtCore/QFile>
+#include <QtCore/QSaveFile>
 #include <QtCore/QString>
+#include <QtCore/QTextStream>
+#include <QtCore/QXmlStreamReader>
 #include <QColor>
 #include <QtXml/QDomDocument>
 
@@ -214,6 +221,9 @@ class XMLDoc : public H2Core::Object<XMLDoc>, public QDomDocument
 			   bool bSilent = false );
 		/**
 		 * write itself into a file
+		 *
+		 * The file is replaced atomically. In case writing fails, a
+		 * previous version of the file is left untouched.
 		 * \param filepath the path to the file to write to
 		 */
 		bool write( const QString& filepath );
@@ -223,6 +233,185 @@ class XMLDoc : public H2Core::Object<XMLDoc>, public QDomDocument
 		 * \param xmlns the xml namespace prefix to add after XMLNS_BASE
 		 */
 		XMLNode set_root( const QString& node_name, const QString& xmlns = nullptr );
+
+		/**
+		 * Compiled schemas are cached per schema path and shared by
+		 * all threads. In addition, read() can skip the validation of
+		 * documents whose content (SHA-1) was already validated
+		 * successfully against the same schema.
+		 *
+		 * \param bSkip Whether to skip those validations.
+		 */
+		static void setSkipValidatedFiles( bool bSkip );
+
+		/**
+		 * validate an xml file without building a document
+		 * \param sFilePath the path to the file to validate
+		 * \param sSchemaPath the path to the XML Schema file
+		 * \param bSilent Whether debug and info messages should be logged
+		 * \return false if the file could not be opened or does not
+		 * comply with the schema. If the schema itself can not be
+		 * used, true is returned.
+		 */
+		static bool validate( const QString& sFilePath,
+							  const QString& sSchemaPath,
+							  bool bSilent = false );
+
+	private:
+		static bool validate( QFile* pFile, const QString& sSchemaPath,
+							  bool bSilent );
+
+		static std::atomic<bool> m_bSkipValidatedFiles;
+};
+
+/**
+ * XMLStreamReader reads an xml file element by element without
+ * building a DOM of the whole document.
+ *
+ * Large lists - like the notes of a pattern or the instruments of a
+ * drumkit - can be processed one entry at a time. Each entry is
+ * converted into a small XMLNode using readSubtree() so that the
+ * existing load_from() methods, including their handling of legacy
+ * formats, can be used for it.
+ *
+ * Files written in TinyXML compatibility mode are converted using
+ * Legacy::convertFromTinyXML() just as in XMLDoc::read().
+ */
+/** \ingroup docCore*/
+class XMLStreamReader : public H2Core::Object<XMLStreamReader>
+{
+		H2_OBJECT(XMLStreamReader)
+	public:
+		XMLStreamReader();
+
+		/**
+		 * open an xml file and move to its root element
+		 * \param sFilePath the path to the file to read from
+		 * \param bSilent Whether debug and info messages should be logged
+		 */
+		bool open( const QString& sFilePath, bool bSilent = false );
+
+		/** \return name of the element the reader is located at */
+		QString name() const;
+
+		/**
+		 * move to the next child element of the element the reader
+		 * is currently in
+		 * \return false as soon as the end of the enclosing element was
+		 * reached or an error occurred
+		 */
+		bool readNextChild();
+
+		/**
+		 * read the current element including all its descendants and
+		 * append it to \a parent. Afterwards the reader is located at
+		 * the end of the element.
+		 * \param parent the node to append the element to
+		 * \return the newly created node
+		 */
+		XMLNode readSubtree( XMLNode& parent );
+
+		/** skip the current element including all its descendants */
+		void skip();
+
+		/**
+		 * create a root node in \a doc holding the name and attributes
+		 * of the current element but none of its children
+		 * \param doc the document to create the node in
+		 */
+		XMLNode createRoot( XMLDoc& doc );
+
+		bool hasError() const;
+		QString errorString() const;
+
+	private:
+		QFile m_file;
+		/** Holds documents converted from TinyXML format. */
+		QBuffer m_buffer;
+		QXmlStreamReader m_reader;
+};
+
+/**
+ * XMLStreamWriter writes an xml file element by element without
+ * building a DOM of the whole document.
+ *
+ * Small parts of a document are assembled as XMLNodes using the
+ * existing save_to() methods and written using writeNode() or
+ * writeChildren(). Large lists - like the patterns of a song - can
+ * thus be written one entry at a time.
+ *
+ * The output is identical to the one of XMLDoc::write(): indentation
+ * and escaping of QDomDocument::toString() are reproduced. This is
+ * why QXmlStreamWriter, which escapes differently, is not used.
+ *
+ * The file is written to a temporary location and moved to its final
+ * destination in commit(). If commit() is not called or fails, the
+ * previous version of the file is left untouched.
+ */
+/** \ingroup docCore*/
+class XMLStreamWriter : public H2Core::Object<XMLStreamWriter>
+{
+		H2_OBJECT(XMLStreamWriter)
+	public:
+		XMLStreamWriter();
+
+		/**
+		 * open a file for writing
+		 * \param sFilePath the path to the file to write to
+		 */
+		bool open( const QString& sFilePath );
+
+		/**
+		 * write the xml header and start the root element just like
+		 * XMLDoc::set_root()
+		 * \param sName the name of the root element
+		 * \param sXmlns the xml namespace prefix to add after XMLNS_BASE
+		 */
+		void writeStartDocument( const QString& sName,
+								 const QString& sXmlns = nullptr );
+		/**
+		 * start a new child element of the current element
+		 * \param sName the name of the element
+		 */
+		void writeStartElement( const QString& sName );
+		/** close the current element */
+		void writeEndElement();
+
+		/**
+		 * write \a node including all its descendants as a child of the
+		 * current element or - if there is none - at document level.
+		 */
+		void writeNode( const QDomNode& node );
+		/**
+		 * write all children of \a node (but not \a node itself) as
+		 * children of the current element.
+		 */
+		void writeChildren( const QDomNode& node );
+
+		/**
+		 * finish writing and replace the destination file
+		 * \return true on success
+		 */
+		bool commit();
+
+	private:
+		struct OpenElement {
+			QString sName;
+			bool bHasChildren;
+		};
+
+		/** Finishes the start tag of the current element in case it
+		 * does not have any children yet. */
+		void startChild();
+		void writeIndent( int nDepth );
+		/** Mirrors QDomNodePrivate::save() of the various node types. */
+		void writeNode( const QDomNode& node, int nDepth,
+						bool bPrevIsText, bool bNextIsText );
+		void writeAttributes( const QDomNode& node );
+
+		QSaveFile m_file;
+		QTextStream m_stream;
+		std::vector<OpenElement> m_openElements;
 };
 
 };
@@ -49,6 +49,9 @@
 #include <core/Basics/DrumkitComponent.h>
 #include <core/H2Exception.h>
 #include <core/AudioEngine/AudioEngine.h>
+#include <core/AudioEngine/RubberbandWorker.h>
+#include <core/AudioEngine/SongSwitcher.h>
+#include <core/Basics/PlaylistPrefetcher.h>
 #include <core/AudioEngine/TransportPosition.h>
 #include <core/Basics/Instrument.h>
 #include <core/Basics/InstrumentComponent.h>
@@ -124,13 +127,16 @@ Hydrogen::Hydrogen() : m_nSelectedInstrumentNumber( 0 )
 	INFOLOG( "[Hydrogen]" );
 
 	m_pSoundLibraryDatabase = std::make_shared<SoundLibraryDatabase>();
-	m_pSong = Song::getEmptySong( m_pSoundLibraryDatabase );
+	m_pSong.store( Song::getEmptySong( m_pSoundLibraryDatabase ) );
 
-	m_pTimeline = std::make_shared<Timeline>();
+	m_pTimeline.store( std::make_shared<Timeline>() );
 
 	initBeatcounter();
 
 	m_pAudioEngine = new AudioEngine();
+	m_pSongSwitcher = std::make_shared<SongSwitcher>();
+	m_pPlaylistPrefetcher = std::make_shared<PlaylistPrefetcher>();
+	m_pRubberbandWorker = std::make_shared<RubberbandWorker>();
 	m_pPlaylist = std::make_shared<Playlist>();
 
 	EventQueue::get_instance()->push_event( EVENT_STATE, static_cast<int>(AudioEngine::State::Initialized) );
@@ -165,6 +171,11 @@ Hydrogen::~Hydrogen()
 		delete pOscServer;
 	}
 #endif
+
+	// Wait for songs and drumkits still loaded in the background.
+	m_pPlaylistPrefetcher->stop();
+	m_pSongSwitcher->cancel();
+	m_pRubberbandWorker->stop();
 	
 	m_pAudioEngine->prepare();
 	
@@ -230,29 +241,32 @@ void Hydrogen::sequencerStop()
 
 Song::PlaybackTrack Hydrogen::getPlaybackTrackState() const {
 
-	if ( m_pSong == nullptr ) {
+	const auto pSong = getSong();
+	if ( pSong == nullptr ) {
 		ERRORLOG( "No song set yet" );
 		return Song::PlaybackTrack::None;
 	}
 
-	return m_pSong->getPlaybackTrackState();
+	return pSong->getPlaybackTrackState();
 }
 	
 void Hydrogen::mutePlaybackTrack( const bool bMuted )
 {
-	if ( m_pSong == nullptr ) {
+	auto pSong = getSong();
+	if ( pSong == nullptr ) {
 		ERRORLOG( "No song set yet" );
 		return;
 	}
 
-	m_pSong->setPlaybackTrackEnabled( bMuted );
+	pSong->setPlaybackTrackEnabled( bMuted );
 
 	EventQueue::get_instance()->push_event( EVENT_PLAYBACK_TRACK_CHANGED, 0 );
 }
 
 void Hydrogen::loadPlaybackTrack( const QString& sFilename )
 {
-	if ( m_pSong == nullptr ) {
+	auto pSong = getSong();
+	if ( pSong == nullptr ) {
 		ERRORLOG( "No song set yet" );
 		return;
 	}
@@ -261,12 +275,12 @@ void Hydrogen::loadPlaybackTrack( const QString& sFilename )
 		 ! Filesystem::file_exists( sFilename, true ) || sFilename.isEmpty() ) {
 		ERRORLOG( QString( "Invalid playback track filename [%1]. File does not exist or is empty." )
 				  .arg( sFilename ) );
-		m_pSong->setPlaybackTrackFilename( "" );
+		pSong->setPlaybackTrackFilename( "" );
 		INFOLOG( "Disabling playback track" );
-		m_pSong->setPlaybackTrackEnabled( false );
+		pSong->setPlaybackTrackEnabled( false );
 	}
 	else {
-		m_pSong->setPlaybackTrackFilename( sFilename );
+		pSong->setPlaybackTrackFilename( sFilename );
 	}
 
 	m_pAudioEngine->getSampler()->reinitializePlaybackTrack();
@@ -306,14 +320,25 @@ void Hydrogen::setSong( std::shared_ptr<Song> pSong )
 	// load the settings of the new song, like whether the LADSPA FX
 	// are activated, m_pSong has to be set prior to the call of
 	// AudioEngine::setSong().
-	m_pSong = pSong;
-	pSong->getDrumkit()->loadSamples();
+	m_pAudioEngine->lock( RIGHT_HERE );
+	m_pSong.store( pSong );
+	m_pAudioEngine->updateTempoMap();
+	m_pAudioEngine->unlock();
+
+	// The song is already set and we must not end up with a partially
+	// loaded kit. Since no cancellation callback is passed, this load
+	// is not aborted by other threads. Should it fail nevertheless, it
+	// is retried.
+	while ( ! pSong->getDrumkit()->loadSamples() ) {
+		WARNINGLOG( QString( "Loading samples of drumkit [%1] was cancelled. Retrying." )
+					.arg( pSong->getDrumkit()->getName() ) );
+	}
 
 	// Ensure the selected instrument is within the range of new
 	// instrument list.
-	if ( m_nSelectedInstrumentNumber >= m_pSong->getDrumkit()->getInstruments()->size() ) {
+	if ( m_nSelectedInstrumentNumber >= pSong->getDrumkit()->getInstruments()->size() ) {
 		m_nSelectedInstrumentNumber =
-			std::max( m_pSong->getDrumkit()->getInstruments()->size() - 1, 0 );
+			std::max( pSong->getDrumkit()->getInstruments()->size() - 1, 0 );
 	}
 
 	// Update the audio engine to work with the new song.
@@ -339,7 +364,6 @@ bool Hydrogen::addRealtimeNote(	int		nInstrument,
 {
 	
 	AudioEngine* pAudioEngine = m_pAudioEngine;
-	auto pSampler = pAudioEngine->getSampler();
 	Preferences *pPref = Preferences::get_instance();
 	unsigned int nRealColumn = 0;
 	unsigned res = pPref->getPatternEditorGridResolution();
@@ -355,14 +379,23 @@ bool Hydrogen::addRealtimeNote(	int		nInstrument,
 		return false;
 	}
 
-	m_pAudioEngine->lock( RIGHT_HERE );
+	// The AudioEngine has only to be locked in case the note will be
+	// recorded into a pattern. Playing it back is done by posting
+	// commands to the audio thread instead.
+	bool doRecord = pPref->getRecordEvents();
+	const bool bLocked = doRecord;
+	if ( bLocked ) {
+		m_pAudioEngine->lock( RIGHT_HERE );
+	}
 	
 	if ( ! bPlaySelectedInstrument ) {
 		if ( nInstrument >= ( int ) pSong->getDrumkit()->getInstruments()->size() ) {
 			// unused instrument
 			ERRORLOG( QString( "Provided instrument [%1] not found" )
 					  .arg( nInstrument ) );
-			pAudioEngine->unlock();
+			if ( bLocked ) {
+				pAudioEngine->unlock();
+			}
 			return false;
 		}
 	}
@@ -372,7 +405,6 @@ bool Hydrogen::addRealtimeNote(	int		nInstrument,
 	long nTickInPattern = 0;
 	const float fPan = 0;
 
-	bool doRecord = pPref->getRecordEvents();
 	if ( getMode() == Song::Mode::Song && doRecord &&
 		 pAudioEngine->getState() == AudioEngine::State::Playing ) {
 
@@ -382,7 +414,9 @@ bool Hydrogen::addRealtimeNote(	int		nInstrument,
 		int nColumn = pAudioEngine->getTransportPosition()->getColumn(); // current column
 		// or pattern group
 		if ( nColumn < 0 || nColumn >= pColumns->size() ) {
-			pAudioEngine->unlock(); // unlock the audio engine
+			if ( bLocked ) {
+				pAudioEngine->unlock();
+			}
 			ERRORLOG( QString( "Provided column [%1] out of bound [%2,%3)" )
 					  .arg( nColumn ).arg( 0 )
 					  .arg( pColumns->size() ) );
@@ -419,7 +453,9 @@ bool Hydrogen::addRealtimeNote(	int		nInstrument,
 
 		if ( ! pCurrentPattern ) {
 			ERRORLOG( "Current pattern invalid" );
-			pAudioEngine->unlock(); // unlock the audio engine
+			if ( bLocked ) {
+				pAudioEngine->unlock();
+			}
 			return false;
 		}
 
@@ -451,7 +487,9 @@ bool Hydrogen::addRealtimeNote(	int		nInstrument,
 		ERRORLOG( QString( "Unable to retrieved instrument [%1]. Plays selected instrument: [%2]" )
 				  .arg( nInstrumentNumber )
 				  .arg( bPlaySelectedInstrument ) );
-		pAudioEngine->unlock();
+		if ( bLocked ) {
+			pAudioEngine->unlock();
+		}
 		return false;
 	}
 
@@ -532,17 +570,21 @@ bool Hydrogen::addRealtimeNote(	int		nInstrument,
 		}
 	}
 
+	if ( bLocked ) {
+		m_pAudioEngine->unlock();
+	}
+
 	// Play back the note.
 	if ( ! pInstr->hasSamples() ) {
-		pAudioEngine->unlock();
 		return true;
 	}
+
+	CommandQueue::Command command;
 	
 	if ( bPlaySelectedInstrument ) {
 		if ( bNoteOff ) {
-			if ( pSampler->isInstrumentPlaying( pInstr ) ) {
-				pSampler->midiKeyboardNoteOff( nNote );
-			}
+			command.type = CommandQueue::Command::Type::KeyboardNoteOff;
+			command.nValue = nNote;
 		}
 		else { // note on
 			Note *pNote2 = new Note( pInstr, nRealColumn, fVelocity, fPan );
@@ -552,34 +594,36 @@ bool Hydrogen::addRealtimeNote(	int		nInstrument,
 			Note::Key notehigh = (Note::Key)(nNote - (12 * divider));
 
 			pNote2->set_midi_info( notehigh, octave, nNote );
-			midiNoteOn( pNote2 );
+			command.type = CommandQueue::Command::Type::NoteOn;
+			command.pNote = pNote2;
 		}
 	}
 	else {
 		if ( bNoteOff ) {
-			if ( pSampler->isInstrumentPlaying( pInstr ) ) {
-				Note *pNoteOff = new Note( pInstr );
-				pNoteOff->set_note_off( true );
-				midiNoteOn( pNoteOff );
-			}
+			Note *pNoteOff = new Note( pInstr );
+			pNoteOff->set_note_off( true );
+			command.type = CommandQueue::Command::Type::NoteOff;
+			command.pNote = pNoteOff;
 		}
 		else { // note on
 			Note *pNote2 = new Note( pInstr, nRealColumn, fVelocity, fPan );
-			midiNoteOn( pNote2 );
+			command.type = CommandQueue::Command::Type::NoteOn;
+			command.pNote = pNote2;
 		}
 	}
 
-	m_pAudioEngine->unlock(); // unlock the audio engine
+	pAudioEngine->pushCommand( command );
+
 	return true;
 }
 
 
 void Hydrogen::toggleNextPattern( int nPatternNumber ) {
-	if ( m_pSong != nullptr && getMode() == Song::Mode::Pattern ) {
-		m_pAudioEngine->lock( RIGHT_HERE );
-		m_pAudioEngine->toggleNextPattern( nPatternNumber );
-		m_pAudioEngine->unlock();
-		EventQueue::get_instance()->push_event( EVENT_NEXT_PATTERNS_CHANGED, 0 );
+	if ( getSong() != nullptr && getMode() == Song::Mode::Pattern ) {
+		CommandQueue::Command command;
+		command.type = CommandQueue::Command::Type::ToggleNextPattern;
+		command.nValue = nPatternNumber;
+		m_pAudioEngine->pushCommand( command );
 
 	} else {
 		ERRORLOG( "can't set next pattern in song mode" );
@@ -587,11 +631,11 @@ void Hydrogen::toggleNextPattern( int nPatternNumber ) {
 }
 
 bool Hydrogen::flushAndAddNextPattern( int nPatternNumber ) {
-	if ( m_pSong != nullptr && getMode() == Song::Mode::Pattern ) {
-		m_pAudioEngine->lock( RIGHT_HERE );
-		m_pAudioEngine->flushAndAddNextPattern( nPatternNumber );
-		m_pAudioEngine->unlock();
-		EventQueue::get_instance()->push_event( EVENT_NEXT_PATTERNS_CHANGED, 0 );
+	if ( getSong() != nullptr && getMode() == Song::Mode::Pattern ) {
+		CommandQueue::Command command;
+		command.type = CommandQueue::Command::Type::FlushAndAddNextPattern;
+		command.nValue = nPatternNumber;
+		m_pAudioEngine->pushCommand( command );
 
 		return true;
 
@@ -661,7 +705,8 @@ bool Hydrogen::startExportSession( int nSampleRate, int nSampleDepth )
 }
 
 /// Export a song to a wav file
-void Hydrogen::startExportSong( const QString& filename)
+void Hydrogen::startExportSong( const QString& filename,
+								const std::vector<DiskWriterDriver::Stem>& stems )
 {
 	DEBUGLOG( "" );
 	AudioEngine* pAudioEngine = m_pAudioEngine;
@@ -671,6 +716,7 @@ void Hydrogen::startExportSong( const QString& filename)
 
 	DiskWriterDriver* pDiskWriterDriver = static_cast<DiskWriterDriver*>(pAudioEngine->getAudioDriver());
 	pDiskWriterDriver->setFileName( filename );
+	pDiskWriterDriver->setStems( stems );
 	DEBUGLOG( "pre write()" );
 	pDiskWriterDriver->write();
 	DEBUGLOG( "done" );
@@ -740,7 +786,7 @@ void Hydrogen::removeInstrument( int nInstrumentNumber ) {
 		}
 
 		if ( hasJackAudioDriver() ) {
-			renameJackPorts( m_pSong );
+			renameJackPorts( pSong );
 		}
 
 		m_pAudioEngine->unlock();
@@ -1191,7 +1237,8 @@ bool Hydrogen::isUnderSessionManagement() const {
 }
 
 bool Hydrogen::isTimelineEnabled() const {
-	if ( m_pSong->getIsTimelineActivated() &&
+	const auto pSong = getSong();
+	if ( pSong != nullptr && pSong->getIsTimelineActivated() &&
 		 getMode() == Song::Mode::Song &&
 		 getJackTimebaseState() != JackAudioDriver::Timebase::Slave ) {
 		return true;
@@ -1201,9 +1248,10 @@ bool Hydrogen::isTimelineEnabled() const {
 }
 
 bool Hydrogen::isPatternEditorLocked() const {
+	const auto pSong = getSong();
 	if ( getMode() == Song::Mode::Song &&
-		 m_pSong != nullptr ) {
-		if ( m_pSong->getIsPatternEditorLocked() ) {
+		 pSong != nullptr ) {
+		if ( pSong->getIsPatternEditorLocked() ) {
 			return true;
 		}
 	}
@@ -1212,10 +1260,11 @@ bool Hydrogen::isPatternEditorLocked() const {
 }
 
 void Hydrogen::setIsPatternEditorLocked( bool bValue ) {
-	if ( m_pSong != nullptr &&
-		 bValue != m_pSong->getIsPatternEditorLocked() ) {
-		m_pSong->setIsPatternEditorLocked( bValue );
-		m_pSong->setIsModified( true );
+	auto pSong = getSong();
+	if ( pSong != nullptr &&
+		 bValue != pSong->getIsPatternEditorLocked() ) {
+		pSong->setIsPatternEditorLocked( bValue );
+		pSong->setIsModified( true );
 
 		updateSelectedPattern();
 			
@@ -1225,50 +1274,56 @@ void Hydrogen::setIsPatternEditorLocked( bool bValue ) {
 }
 
 Song::Mode Hydrogen::getMode() const {
-	if ( m_pSong != nullptr ) {
-		return m_pSong->getMode();
+	const auto pSong = getSong();
+	if ( pSong != nullptr ) {
+		return pSong->getMode();
 	}
 
 	return Song::Mode::None;
 }
 
 void Hydrogen::setMode( const Song::Mode& mode ) {
-	if ( m_pSong != nullptr && mode != m_pSong->getMode() ) {
-		m_pSong->setMode( mode );
+	auto pSong = getSong();
+	if ( pSong != nullptr && mode != pSong->getMode() ) {
+		pSong->setMode( mode );
 		EventQueue::get_instance()->push_event( EVENT_SONG_MODE_ACTIVATION,
 												( mode == Song::Mode::Song) ? 1 : 0 );
 	}
 }
 
 Song::ActionMode Hydrogen::getActionMode() const {
-	if ( m_pSong != nullptr ) {
-		return m_pSong->getActionMode();
+	const auto pSong = getSong();
+	if ( pSong != nullptr ) {
+		return pSong->getActionMode();
 	}
 	return Song::ActionMode::None;
 }
 
 void Hydrogen::setActionMode( const Song::ActionMode& mode ) {
-	if ( m_pSong != nullptr ) {
-		m_pSong->setActionMode( mode );
+	auto pSong = getSong();
+	if ( pSong != nullptr ) {
+		pSong->setActionMode( mode );
 		EventQueue::get_instance()->push_event( EVENT_ACTION_MODE_CHANGE,
 												( mode == Song::ActionMode::drawMode ) ? 1 : 0 );
 	}
 }
 
 Song::PatternMode Hydrogen::getPatternMode() const {
-	if ( getMode() == Song::Mode::Pattern ) {
-		return m_pSong->getPatternMode();
+	const auto pSong = getSong();
+	if ( pSong != nullptr && pSong->getMode() == Song::Mode::Pattern ) {
+		return pSong->getPatternMode();
 	}
 	return Song::PatternMode::None;
 }
 
 void Hydrogen::setPatternMode( const Song::PatternMode& mode )
 {
-	if ( m_pSong != nullptr &&
+	auto pSong = getSong();
+	if ( pSong != nullptr &&
 		 getPatternMode() != mode ) {
 		m_pAudioEngine->lock( RIGHT_HERE );
 
-		m_pSong->setPatternMode( mode );
+		pSong->setPatternMode( mode );
 		setIsModified( true );
 		
 		if ( m_pAudioEngine->getState() != AudioEngine::State::Playing ||
@@ -1504,12 +1559,13 @@ std::shared_ptr<Instrument> Hydrogen::getSelectedInstrument() const {
 
 	std::shared_ptr<Instrument> pInstrument = nullptr;
 	
-	if ( m_pSong != nullptr ) {
+	const auto pSong = getSong();
+	if ( pSong != nullptr ) {
 		
 		m_pAudioEngine->lock( RIGHT_HERE );
 
 		int nSelectedInstrumentNumber = m_nSelectedInstrumentNumber;
-		auto pInstrList = m_pSong->getDrumkit()->getInstruments();
+		auto pInstrList = pSong->getDrumkit()->getInstruments();
 		if ( nSelectedInstrumentNumber >= pInstrList->size() ) {
 			nSelectedInstrumentNumber = -1;
 		}
@@ -1526,11 +1582,12 @@ std::shared_ptr<Instrument> Hydrogen::getSelectedInstrument() const {
 
 void Hydrogen::updateVirtualPatterns() {
 
-	if ( m_pSong == nullptr ) {
+	auto pSong = getSong();
+	if ( pSong == nullptr ) {
 		ERRORLOG( "no song" );
 		return;
 	}
-	PatternList *pPatternList = m_pSong->getPatternList();
+	PatternList *pPatternList = pSong->getPatternList();
 	if ( pPatternList == nullptr ) {
 		ERRORLOG( "no pattern list");
 		return;
@@ -1549,11 +1606,13 @@ QString Hydrogen::toQString( const QString& sPrefix, bool bShort ) const {
 
 	QString s = Base::sPrintIndention;
 	QString sOutput;
+	const auto pSong = getSong();
+	const auto pTimeline = getTimeline();
 	if ( ! bShort ) {
 		sOutput = QString( "%1[Hydrogen]\n" ).arg( sPrefix )
 			.append( QString( "%1%2m_pSong: " ).arg( sPrefix ).arg( s ) );
-		if ( m_pSong != nullptr ) {
-			sOutput.append( QString( "%1" ).arg( m_pSong->toQString( sPrefix + s, bShort ) ) );
+		if ( pSong != nullptr ) {
+			sOutput.append( QString( "%1" ).arg( pSong->toQString( sPrefix + s, bShort ) ) );
 		} else {
 			sOutput.append( QString( "nullptr\n" ) );
 		}
@@ -1574,8 +1633,8 @@ QString Hydrogen::toQString( const QString& sPrefix, bool bShort ) const {
 			.append( QString( "%1%2m_bExportSessionIsActive: %3\n" ).arg( sPrefix ).arg( s ).arg( m_bExportSessionIsActive ) )
 			.append( QString( "%1%2m_GUIState: %3\n" ).arg( sPrefix ).arg( s ).arg( static_cast<int>( m_GUIState ) ) )
 			.append( QString( "%1%2m_pTimeline:\n" ).arg( sPrefix ).arg( s ) );
-		if ( m_pTimeline != nullptr ) {
-			sOutput.append( QString( "%1" ).arg( m_pTimeline->toQString( sPrefix + s, bShort ) ) );
+		if ( pTimeline != nullptr ) {
+			sOutput.append( QString( "%1" ).arg( pTimeline->toQString( sPrefix + s, bShort ) ) );
 		} else {
 			sOutput.append( QString( "nullptr\n" ) );
 		}
@@ -1607,8 +1666,8 @@ QString Hydrogen::toQString( const QString& sPrefix, bool bShort ) const {
 		
 		sOutput = QString( "%1[Hydrogen]" ).arg( sPrefix )
 			.append( QString( ", m_pSong: " ) );
-		if ( m_pSong != nullptr ) {
-			sOutput.append( QString( "%1" ).arg( m_pSong->toQString( sPrefix + s, bShort ) ) );
+		if ( pSong != nullptr ) {
+			sOutput.append( QString( "%1" ).arg( pSong->toQString( sPrefix + s, bShort ) ) );
 		} else {
 			sOutput.append( QString( "nullptr" ) );
 		}
@@ -1629,8 +1688,8 @@ QString Hydrogen::toQString( const QString& sPrefix, bool bShort ) const {
 			.append( QString( ", m_bExportSessionIsActive: %1" ).arg( m_bExportSessionIsActive ) )
 			.append( QString( ", m_GUIState: %1" ).arg( static_cast<int>( m_GUIState ) ) );
 		sOutput.append( QString( ", m_pTimeline: " ) );
-		if ( m_pTimeline != nullptr ) {
-			sOutput.append( QString( "%1" ).arg( m_pTimeline->toQString( sPrefix, bShort ) ) );
+		if ( pTimeline != nullptr ) {
+			sOutput.append( QString( "%1" ).arg( pTimeline->toQString( sPrefix, bShort ) ) );
 		} else {
 			sOutput.append( QString( "nullptr" ) );
 		}						 
@@ -26,7 +26,9 @@
 #include <core/Basics/Song.h>
 #include <core/Object.h>
 #include <core/Timeline.h>
+#include <core/Helpers/SharedSlot.h>
 #include <core/IO/AudioOutput.h>
+#include <core/IO/DiskWriterDriver.h>
 #include <core/IO/MidiCommon.h>
 #include <core/IO/MidiInput.h>
 #include <core/IO/MidiOutput.h>
@@ -41,7 +43,10 @@ namespace H2Core
 {
 	class AudioEngine;
 	class SoundLibraryDatabase;
+	class SongSwitcher;
 	class Playlist;
+	class PlaylistPrefetcher;
+	class RubberbandWorker;
 
 ///
 /// Hydrogen Audio Engine.
@@ -91,6 +96,15 @@ public:
 	std::shared_ptr<SoundLibraryDatabase> getSoundLibraryDatabase() const {
 		return m_pSoundLibraryDatabase;
 	}
+	std::shared_ptr<SongSwitcher> getSongSwitcher() const {
+		return m_pSongSwitcher;
+	}
+	std::shared_ptr<PlaylistPrefetcher> getPlaylistPrefetcher() const {
+		return m_pPlaylistPrefetcher;
+	}
+	std::shared_ptr<RubberbandWorker> getRubberbandWorker() const {
+		return m_pRubberbandWorker;
+	}
 	std::shared_ptr<Playlist> getPlaylist() const;
 	void setPlaylist( std::shared_ptr<Playlist> pPlaylist );
 
@@ -116,7 +130,7 @@ public:
 		 * Get the current song.
 		 * \return #m_pSong
 		 */ 	
-		std::shared_ptr<Song>			getSong() const{ return m_pSong; }
+		std::shared_ptr<Song>			getSong() const{ return m_pSong.load(); }
 		/**
 		 * Sets the current song #m_pSong to @a pNewSong.
 		 * \param pNewSong Pointer to the new Song object.
@@ -324,6 +338,7 @@ public:
 
 	void			panic();
 	std::shared_ptr<Timeline>	getTimeline() const;
+	/** Must be called while holding the #AudioEngine lock. */
 	void			setTimeline( std::shared_ptr<Timeline> );
 	
 	//export management
@@ -331,7 +346,14 @@ public:
 	/** \return true on success.*/
 	bool			startExportSession( int rate, int depth );
 	void			stopExportSession();
-	void			startExportSong( const QString& filename );
+	/**
+	 * Renders the current song into @a filename and all @a stems in
+	 * a single pass.
+	 *
+	 * In case @a filename is empty, only the stems will be written.
+	 */
+	void			startExportSong( const QString& filename,
+									 const std::vector<DiskWriterDriver::Stem>& stems = {} );
 	void			stopExportSong();
 	
 	/************************************************************/
@@ -444,6 +466,8 @@ public:
 	 * \return String presentation of current object.*/
 	QString toQString( const QString& sPrefix = "", bool bShort = true ) const override;
 
+	/** Replaces #m_pSong in AudioEngine::commitSwitch(). */
+	friend class AudioEngine;
 private:
 	/**
 	 * Static reference to the Hydrogen singleton. 
@@ -458,8 +482,12 @@ private:
 	 * Pointer to the current song. It is initialized with NULL in
 	 * the Hydrogen() constructor, set via setSong(), and accessed
 	 * via getSong().
+	 *
+	 * Since the audio thread reads it without locking and replaces
+	 * it in AudioEngine::commitSwitch(), it is held in a
+	 * #SharedSlot. All writers have to hold the #AudioEngine lock.
 	 */
-	std::shared_ptr<Song>			m_pSong;
+	SharedSlot<Song>			m_pSong;
 
 	/**
 	 * Auxiliary function setting a bunch of global variables.
@@ -504,8 +532,10 @@ private:
 	
 	/**
 	 * Local instance of the Timeline object.
+	 *
+	 * Held in a #SharedSlot just as #m_pSong.
 	 */
-	std::shared_ptr<Timeline>	m_pTimeline;
+	SharedSlot<Timeline>	m_pTimeline;
 
 	/// Deleting instruments too soon leads to potential crashes.
 	std::list<std::shared_ptr<Instrument>> 	m_instrumentDeathRow;
@@ -546,6 +576,15 @@ private:
 
 	std::shared_ptr<SoundLibraryDatabase> m_pSoundLibraryDatabase;
 
+	/** Loads songs and drumkits in the background while transport is
+	 * rolling. */
+	std::shared_ptr<SongSwitcher> m_pSongSwitcher;
+	/** Loads the upcoming songs of #m_pPlaylist in the background. */
+	std::shared_ptr<PlaylistPrefetcher> m_pPlaylistPrefetcher;
+	/** Stretches the samples of the current drumkit on tempo
+	 * changes in the background. */
+	std::shared_ptr<RubberbandWorker> m_pRubberbandWorker;
+
 	std::shared_ptr<Playlist> m_pPlaylist;
 
 		/** Controls the instrument selection within a hihat group. */
@@ -583,11 +622,11 @@ private:
  */
 inline std::shared_ptr<Timeline> Hydrogen::getTimeline() const
 {
-	return m_pTimeline;
+	return m_pTimeline.load();
 }
 inline void Hydrogen::setTimeline( std::shared_ptr<Timeline> pTimeline )
 {
-	m_pTimeline = pTimeline;
+	m_pTimeline.store( pTimeline );
 }
 
 inline bool Hydrogen::getIsExportSessionActive() const
@@ -22,17 +22,31 @@
 #include <unistd.h>
 
 
+#include <core/config.h>
 #include <core/Preferences/Preferences.h>
 #include <core/AudioEngine/AudioEngine.h>
 #include <core/EventQueue.h>
 #include <core/CoreActionController.h>
 #include <core/Hydrogen.h>
+#include <core/Basics/Drumkit.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Basics/Note.h>
 #include <core/Basics/Pattern.h>
 #include <core/Basics/PatternList.h>
+#include <core/Basics/Song.h>
+#include <core/FX/Effects.h>
 #include <core/IO/DiskWriterDriver.h>
+#include <core/IO/SoundFileWriter.h>
 
 #include <pthread.h>
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstring>
+
+#include <QDir>
+#include <QFileInfo>
 
 #if defined(WIN32) || _DOXYGEN_
 #include <windows.h>
@@ -62,102 +76,56 @@ void* diskWriterDriver_thread( void* param )
 	
 	__INFOLOG( "DiskWriterDriver thread start" );
 
+	const auto startTime = std::chrono::steady_clock::now();
+
 	// always rolling, no user interaction
 	pAudioEngine->play();
-	SF_INFO soundInfo;
-	soundInfo.samplerate = pDriver->m_nSampleRate;
-//	soundInfo.frames = -1;//getNFrames();		///\todo: da terminare
-	soundInfo.channels = 2;
-	//default format
-	int sfformat = 0x010000; //wav format (default)
-	int bits = 0x0002; //16 bit PCM (default)
-	//sf_format switch
-	if( pDriver->m_sFilename.endsWith(".aiff") || pDriver->m_sFilename.endsWith(".AIFF") ){
-		sfformat =  0x020000; //Apple/SGI AIFF format (big endian)
-	}
-	if( pDriver->m_sFilename.endsWith(".flac") || pDriver->m_sFilename.endsWith(".FLAC") ){
-		sfformat =  0x170000; //FLAC lossless file format
-	}
-	if( ( pDriver->m_nSampleDepth == 8 ) && ( pDriver->m_sFilename.endsWith(".aiff") || pDriver->m_sFilename.endsWith(".AIFF") ) ){
-		bits = 0x0001; //Signed 8 bit data works with aiff
-	}
-	if( ( pDriver->m_nSampleDepth == 8 ) && ( pDriver->m_sFilename.endsWith(".wav") || pDriver->m_sFilename.endsWith(".WAV") ) ){
-		bits = 0x0005; //Unsigned 8 bit data needed for Microsoft WAV format
-	}
-	if( pDriver->m_nSampleDepth == 16 ){
-		bits = 0x0002; //Signed 16 bit data
-	}
-	if( pDriver->m_nSampleDepth == 24 ){
-		bits = 0x0003; //Signed 24 bit data
-	}
-	if( pDriver->m_nSampleDepth == 32 ){
-		bits = 0x0004; ////Signed 32 bit data
-	}
 
-	soundInfo.format =  sfformat|bits;
+	float *pData_L = pDriver->m_pOut_L;
+	float *pData_R = pDriver->m_pOut_R;
 
-//	#ifdef HAVE_OGGVORBIS
+	// Encoding is done in separate threads - one for the main mix and
+	// one for each stem - while the next block is rendered.
+	std::vector<std::unique_ptr<SoundFileWriter>> writers;
+	std::vector<std::pair<float*, float*>> writerInputs;
+	auto closeWriters = [&](){
+		bool bSuccess = true;
+		for ( auto& pWriter : writers ) {
+			bSuccess = pWriter->close() && bSuccess;
+		}
+		return bSuccess;
+	};
+	auto addWriter = [&]( const QString& sFilename, float* pIn_L, float* pIn_R ) {
+		auto pWriter = std::make_unique<SoundFileWriter>( pDriver->m_nBufferSize );
+		if ( ! pWriter->open( sFilename, pDriver->m_nSampleRate,
+							  pDriver->m_nSampleDepth ) ) {
+			return false;
+		}
+		writers.push_back( std::move( pWriter ) );
+		writerInputs.push_back( std::make_pair( pIn_L, pIn_R ) );
+		return true;
+	};
 
-	//ogg vorbis option
-	if( pDriver->m_sFilename.endsWith( ".ogg" ) | pDriver->m_sFilename.endsWith( ".OGG" ) ) {
-		soundInfo.format = SF_FORMAT_OGG | SF_FORMAT_VORBIS;
+	bool bWritersReady = true;
+	if ( ! pDriver->m_sFilename.isEmpty() ) {
+		bWritersReady = addWriter( pDriver->m_sFilename, pData_L, pData_R );
 	}
-//	#endif
-
-
-///formats
-//          SF_FORMAT_WAV          = 0x010000,     /* Microsoft WAV format (little endian). */
-//          SF_FORMAT_AIFF         = 0x020000,     /* Apple/SGI AIFF format (big endian). */
-//          SF_FORMAT_AU           = 0x030000,     /* Sun/NeXT AU format (big endian). */
-//          SF_FORMAT_RAW          = 0x040000,     /* RAW PCM data. */
-//          SF_FORMAT_PAF          = 0x050000,     /* Ensoniq PARIS file format. */
-//          SF_FORMAT_SVX          = 0x060000,     /* Amiga IFF / SVX8 / SV16 format. */
-//          SF_FORMAT_NIST         = 0x070000,     /* Sphere NIST format. */
-//          SF_FORMAT_VOC          = 0x080000,     /* VOC files. */
-//          SF_FORMAT_IRCAM        = 0x0A0000,     /* Berkeley/IRCAM/CARL */
-//          SF_FORMAT_W64          = 0x0B0000,     /* Sonic Foundry's 64 bit RIFF/WAV */
-//          SF_FORMAT_MAT4         = 0x0C0000,     /* Matlab (tm) V4.2 / GNU Octave 2.0 */
-//          SF_FORMAT_MAT5         = 0x0D0000,     /* Matlab (tm) V5.0 / GNU Octave 2.1 */
-//          SF_FORMAT_PVF          = 0x0E0000,     /* Portable Voice Format */
-//          SF_FORMAT_XI           = 0x0F0000,     /* Fasttracker 2 Extended Instrument */
-//          SF_FORMAT_HTK          = 0x100000,     /* HMM Tool Kit format */
-//          SF_FORMAT_SDS          = 0x110000,     /* Midi Sample Dump Standard */
-//          SF_FORMAT_AVR          = 0x120000,     /* Audio Visual Research */
-//          SF_FORMAT_WAVEX        = 0x130000,     /* MS WAVE with WAVEFORMATEX */
-//          SF_FORMAT_SD2          = 0x160000,     /* Sound Designer 2 */
-//          SF_FORMAT_FLAC         = 0x170000,     /* FLAC lossless file format */
-//          SF_FORMAT_CAF          = 0x180000,     /* Core Audio File format */
-//	    SF_FORMAT_OGG
-///bits
-//          SF_FORMAT_PCM_S8       = 0x0001,       /* Signed 8 bit data */
-//          SF_FORMAT_PCM_16       = 0x0002,       /* Signed 16 bit data */
-//          SF_FORMAT_PCM_24       = 0x0003,       /* Signed 24 bit data */
-//          SF_FORMAT_PCM_32       = 0x0004,       /* Signed 32 bit data */
-///used for ogg
-//          SF_FORMAT_VORBIS
-
-	if ( !sf_format_check( &soundInfo ) ) {
-		__ERRORLOG( "Error in soundInfo" );
-		EventQueue::get_instance()->push_event( EVENT_PROGRESS, -1 );
-		pthread_exit( nullptr );
-		return nullptr;
+	for ( int nn = 0; nn < pDriver->m_stems.size() && bWritersReady; ++nn ) {
+		bWritersReady = addWriter( pDriver->m_stems[ nn ].sFilename,
+								   &pDriver->m_stemBuffers[ 2 * nn * pDriver->m_nBufferSize ],
+								   &pDriver->m_stemBuffers[ ( 2 * nn + 1 ) * pDriver->m_nBufferSize ] );
 	}
-
-	SNDFILE* m_file = sf_open( pDriver->m_sFilename.toLocal8Bit(), SFM_WRITE, &soundInfo );
-	if ( m_file == nullptr ) {
-		__ERRORLOG( QString( "Unable to open file [%1] using libsndfile: %2" )
-					.arg( pDriver->m_sFilename )
-					.arg( sf_strerror( nullptr ) ) );
+	if ( writers.size() == 0 ) {
+		__ERRORLOG( "Neither a file name nor stems were provided" );
+		bWritersReady = false;
+	}
+	if ( ! bWritersReady ) {
+		closeWriters();
 		EventQueue::get_instance()->push_event( EVENT_PROGRESS, -1 );
 		pthread_exit( nullptr );
 		return nullptr;
 	}
 
-	float *pData = new float[ pDriver->m_nBufferSize * 2 ]; // always stereo
-
-	float *pData_L = pDriver->m_pOut_L;
-	float *pData_R = pDriver->m_pOut_R;
-
 	Hydrogen* pHydrogen = Hydrogen::get_instance();
 	auto pSong = pHydrogen->getSong();
 	auto pSampler = pHydrogen->getAudioEngine()->getSampler();
@@ -167,10 +135,7 @@ void* diskWriterDriver_thread( void* param )
 
 	// Used to cleanly terminate this thread and close all handlers.
 	auto tearDown = [&](){
-		delete[] pData;
-		pData = nullptr;
-
-		sf_close( m_file );
+		closeWriters();
 
 		__INFOLOG( "DiskWriterDriver thread end" );
 
@@ -199,6 +164,15 @@ void* diskWriterDriver_thread( void* param )
 		int nFrameNumber = 0;
 		int nLastRun = 0;
 		int nSuccessiveZeros = 0;
+
+		// Frame within the last pattern at which counting of silent
+		// frames starts. It is aligned to the buffer size set in the
+		// Preferences in order to make the length of the exported
+		// file independent of the size of the blocks rendered.
+		const int nCountZerosFrom =
+			( nPatternLengthInFrames / static_cast<int>(pDriver->m_nPeriodSize) ) *
+			static_cast<int>(pDriver->m_nPeriodSize);
+		
 		while ( ( patternPosition < nColumns - 1 && // render all
 													// frames in
 													// pattern 
@@ -222,10 +196,22 @@ void* diskWriterDriver_thread( void* param )
 				nUsedBuffer = nLastRun;
 			};
 
-			// Check whether the driver was stopped (since
-			// AudioEngine::stopAudioDrivers() locks the audio engine
-			// and the call to pDriver->m_processCallback) can not
-			// acquire the lock).
+			// Within the tail of the last pattern we fall back to
+			// blocks of the period size. This way both the start of
+			// the silent frame detection and the point at which we
+			// stop due to the Sampler being done rendering are the
+			// same as in realtime.
+			if ( patternPosition == nColumns - 1 ) {
+				if ( nFrameNumber < nCountZerosFrom ) {
+					nUsedBuffer = std::min( nUsedBuffer,
+											nCountZerosFrom - nFrameNumber );
+				} else {
+					nUsedBuffer = pDriver->m_nPeriodSize;
+				}
+			}
+
+			// Check whether the driver was stopped, e.g. by
+			// AudioEngine::stopAudioDrivers().
 			if ( ! pDriver->m_bIsRunning ) {
 				__ERRORLOG( "Driver was stop before export was completed." );
 				EventQueue::get_instance()->push_event( EVENT_PROGRESS, -1 );
@@ -233,27 +219,11 @@ void* diskWriterDriver_thread( void* param )
 				return nullptr;
 			}
 			
-			int ret = pDriver->m_processCallback( nUsedBuffer, nullptr );
-
-			// Only try a reasonable amount of times.
-			int nMutexLockAttempts = 0;
-			
-			// In case the DiskWriter couldn't acquire the lock of the AudioEngine.
-			while( ret == 2 ) {
-				ret = pDriver->m_processCallback( nUsedBuffer, nullptr );
-
-				// No need for a sleep() statement in here because the
-				// AudioEngine::tryLockFor() in the processCallback
-				// already introduces a delay.
-				nMutexLockAttempts++;
-				if ( nMutexLockAttempts > 30 ) {
-					__ERRORLOG( "Too many attempts to lock the AudioEngine. Aborting." );
-					
-					EventQueue::get_instance()->push_event( EVENT_PROGRESS, -1 );
-					tearDown();
-					return nullptr;
-				}
-			}
+			// Since we do not have to keep up with realtime, the
+			// callback waits for the lock of the AudioEngine as long
+			// as it takes. No thread holding it waits for us in
+			// return, see stop().
+			pDriver->m_processCallback( nUsedBuffer, nullptr );
 
 			if ( patternPosition == nColumns - 1 &&
 				 nPatternLengthInFrames - nFrameNumber < nUsedBuffer ) {
@@ -273,7 +243,6 @@ void* diskWriterDriver_thread( void* param )
 				// arbitrary point within the buffer).
 				nBufferWriteLength = 0;
 
-				int nSilentFrames = 0;
 				for ( int ii = 0; ii < nUsedBuffer; ++ii ) {
 					++nBufferWriteLength;
 					
@@ -291,32 +260,14 @@ void* diskWriterDriver_thread( void* param )
 			}
 			
 			nFrameNumber += nBufferWriteLength;
-			
-			for ( unsigned ii = 0; ii < nBufferWriteLength; ii++ ) {
-				if( pData_L[ ii ] > 1 ) {
-					pData[ ii * 2 ] = 1;
-				} else if( pData_L[ ii ] < -1 ) {
-					pData[ ii * 2 ] = -1;
-				} else {
-					pData[ ii * 2 ] = pData_L[ ii ];
-				}
-				
-				if( pData_R[ ii ] > 1 ){
-					pData[ ii * 2 + 1 ] = 1;
-				} else if ( pData_R[ ii ] < -1 ) {
-					pData[ ii * 2 + 1 ] = -1;
-				} else {
-					pData[ ii * 2 + 1 ] = pData_R[ ii ];
-				}
+
+			bool bWritten = true;
+			for ( int nn = 0; nn < writers.size(); ++nn ) {
+				bWritten = writers[ nn ]->write( writerInputs[ nn ].first,
+												 writerInputs[ nn ].second,
+												 nBufferWriteLength ) && bWritten;
 			}
-			
-			const int res = sf_writef_float( m_file, pData, nBufferWriteLength );
-			if ( res != ( int )nBufferWriteLength ) {
-				__ERRORLOG( QString( "Error during sf_write_float. Floats written: [%1], target: [%2]. %3" )
-							.arg( res )
-							.arg( nBufferWriteLength )
-							.arg( sf_strerror( nullptr ) ) );
-					
+			if ( ! bWritten ) {
 				EventQueue::get_instance()->push_event( EVENT_PROGRESS, -1 );
 				tearDown();
 				return nullptr;
@@ -338,6 +289,23 @@ void* diskWriterDriver_thread( void* param )
 		}
 	}
 
+	if ( ! closeWriters() ) {
+		EventQueue::get_instance()->push_event( EVENT_PROGRESS, -1 );
+		tearDown();
+		return nullptr;
+	}
+
+	const double fElapsed = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - startTime ).count();
+	pDriver->m_fExportedSeconds = static_cast<double>(writers[ 0 ]->getFrames()) /
+		static_cast<double>(pDriver->m_nSampleRate);
+	pDriver->m_fRealtimeFactor = fElapsed > 0 ?
+		pDriver->m_fExportedSeconds / fElapsed : 0;
+	__INFOLOG( QString( "Exported [%1] seconds of audio into [%2] file(s) in [%3] seconds ([%4]x realtime)" )
+			   .arg( pDriver->m_fExportedSeconds, 0, 'f', 2 )
+			   .arg( writers.size() ).arg( fElapsed, 0, 'f', 2 )
+			   .arg( pDriver->m_fRealtimeFactor, 0, 'f', 1 ) );
+
 	// Explicitly mark export as finished.
 	EventQueue::get_instance()->push_event( EVENT_PROGRESS, 100 );
 	
@@ -355,7 +323,11 @@ DiskWriterDriver::DiskWriterDriver( audioProcessCallback processCallback )
 		, m_nBufferSize( 1024 )
 		, m_pOut_L( nullptr )
 		, m_pOut_R( nullptr )
-		, m_bIsRunning( false ) {
+		, m_bIsRunning( false )
+		, m_nPeriodSize( 1024 )
+		, m_fExportedSeconds( 0 )
+		, m_fRealtimeFactor( 0 )
+		, m_bThreadJoinable( false ) {
 }
 
 
@@ -367,9 +339,16 @@ DiskWriterDriver::~DiskWriterDriver() {
 
 int DiskWriterDriver::init( unsigned nBufferSize )
 {
-	INFOLOG( QString( "Init, buffer size: %1" ).arg( nBufferSize ) );
-
-	m_nBufferSize = nBufferSize;
+	// Since there is no realtime constraint, we render the largest
+	// blocks the Sampler is able to handle. To keep the blocks
+	// aligned with the ones used in realtime, their size is a
+	// multiple of the provided one.
+	m_nPeriodSize = std::clamp( nBufferSize, 1u,
+								static_cast<unsigned>(MAX_BUFFER_SIZE) );
+	m_nBufferSize = ( MAX_BUFFER_SIZE / m_nPeriodSize ) * m_nPeriodSize;
+
+	INFOLOG( QString( "Init, buffer size: %1, period size: %2" )
+			 .arg( m_nBufferSize ).arg( m_nPeriodSize ) );
 	
 	m_pOut_L = new float[ m_nBufferSize ];
 	m_pOut_R = new float[ m_nBufferSize ];
@@ -387,21 +366,34 @@ void DiskWriterDriver::write()
 	INFOLOG( "" );
 
 	m_bIsRunning = true;
+	m_fExportedSeconds = 0;
+	m_fRealtimeFactor = 0;
 	
 	pthread_attr_t attr;
 	pthread_attr_init( &attr );
 
-	pthread_create( &diskWriterDriverThread, &attr, diskWriterDriver_thread, this );
+	if ( pthread_create( &diskWriterDriverThread, &attr,
+						 diskWriterDriver_thread, this ) == 0 ) {
+		m_bThreadJoinable = true;
+	}
+}
+
+void DiskWriterDriver::stop()
+{
+	m_bIsRunning = false;
+
+	if ( m_bThreadJoinable ) {
+		pthread_join( diskWriterDriverThread, nullptr );
+		m_bThreadJoinable = false;
+	}
 }
 
 /// disconnect
 void DiskWriterDriver::disconnect()
 {
 	INFOLOG( "" );
-	
-	m_bIsRunning = false;
 
-	pthread_join( diskWriterDriverThread, nullptr );
+	stop();
 
 	delete[] m_pOut_L;
 	m_pOut_L = nullptr;
@@ -415,4 +407,115 @@ unsigned DiskWriterDriver::getSampleRate()
 {
 	return m_nSampleRate;
 }
+
+void DiskWriterDriver::setStems( const std::vector<Stem>& stems ) {
+	m_stems = stems;
+	m_stemBuffers.assign( 2 * m_stems.size() * m_nBufferSize, 0 );
+
+	m_stemIndices.clear();
+	for ( int nn = 0; nn < m_stems.size(); ++nn ) {
+		if ( m_stems[ nn ].pInstrument != nullptr ) {
+			m_stemIndices[ m_stems[ nn ].pInstrument->get_id() ] = nn;
+		}
+	}
+}
+
+int DiskWriterDriver::findStem( std::shared_ptr<Instrument> pInstrument ) const {
+	if ( pInstrument == nullptr ) {
+		return -1;
+	}
+	const auto it = m_stemIndices.find( pInstrument->get_id() );
+	if ( it == m_stemIndices.end() ) {
+		return -1;
+	}
+	return it->second;
+}
+
+float* DiskWriterDriver::getStemOut_L( std::shared_ptr<Instrument> pInstrument ) {
+	const int nStem = findStem( pInstrument );
+	if ( nStem == -1 ) {
+		return nullptr;
+	}
+	return &m_stemBuffers[ 2 * nStem * m_nBufferSize ];
+}
+
+float* DiskWriterDriver::getStemOut_R( std::shared_ptr<Instrument> pInstrument ) {
+	const int nStem = findStem( pInstrument );
+	if ( nStem == -1 ) {
+		return nullptr;
+	}
+	return &m_stemBuffers[ ( 2 * nStem + 1 ) * m_nBufferSize ];
+}
+
+void DiskWriterDriver::clearStemBuffers( uint32_t nFrames ) {
+	for ( int nn = 0; nn < 2 * m_stems.size(); ++nn ) {
+		memset( &m_stemBuffers[ nn * m_nBufferSize ], 0, nFrames * sizeof( float ) );
+	}
+}
+
+std::vector<DiskWriterDriver::Stem> DiskWriterDriver::createStems( std::shared_ptr<Song> pSong,
+																   const QString& sFilename ) {
+	std::vector<Stem> stems;
+	if ( pSong == nullptr || pSong->getDrumkit() == nullptr ) {
+		return stems;
+	}
+
+	const QFileInfo info( sFilename );
+	const QString sSuffix = info.suffix().isEmpty() ? "" :
+		QString( ".%1" ).arg( info.suffix() );
+	const QString sBase = info.dir().absoluteFilePath( info.completeBaseName() );
+
+	auto pInstrumentList = pSong->getDrumkit()->getInstruments();
+	for ( const auto& pInstrument : *pInstrumentList ) {
+		if ( pInstrument == nullptr ) {
+			continue;
+		}
+
+		// Instruments without notes would only result in empty files.
+		bool bHasNotes = false;
+		for ( const auto& pPattern : *pSong->getPatternList() ) {
+			for ( const auto& [ _, pNote ] : *pPattern->get_notes() ) {
+				if ( pNote != nullptr && pNote->get_instrument() == pInstrument ) {
+					bHasNotes = true;
+					break;
+				}
+			}
+			if ( bHasNotes ) {
+				break;
+			}
+		}
+		if ( ! bHasNotes ) {
+			continue;
+		}
+
+		QString sName = pInstrument->get_name();
+		int nOccurrences = 0;
+		for ( const auto& ppInstrument : *pInstrumentList ) {
+			if ( ppInstrument != nullptr && ppInstrument->get_name() == sName ) {
+				++nOccurrences;
+			}
+		}
+		if ( nOccurrences > 1 ) {
+			sName.append( QString( "_%1" ).arg( pInstrument->get_id() ) );
+		}
+		sName.replace( '/', '_' );
+
+		stems.push_back( { pInstrument,
+				QString( "%1-%2%3" ).arg( sBase ).arg( sName ).arg( sSuffix ) } );
+	}
+
+	return stems;
+}
+
+bool DiskWriterDriver::canRenderStemsInOnePass() {
+#ifdef H2CORE_HAVE_LADSPA
+	for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+		auto pFX = Effects::get_instance()->getLadspaFX( nFX );
+		if ( pFX != nullptr && pFX->isEnabled() ) {
+			return false;
+		}
+	}
+#endif
+	return true;
+}
 };
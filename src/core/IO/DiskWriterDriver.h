@@ -23,9 +23,11 @@
 #ifndef DISK_WRITER_DRIVER_H
 #define DISK_WRITER_DRIVER_H
 
-#include <sndfile.h>
-
+#include <atomic>
 #include <inttypes.h>
+#include <map>
+#include <memory>
+#include <vector>
 
 #include <core/IO/AudioOutput.h>
 #include <core/Object.h>
@@ -33,16 +35,37 @@
 namespace H2Core
 {
 
+class Instrument;
+class Song;
+
 	void* diskWriterDriver_thread( void *param );
 ///
 /// Driver for export audio to disk
 ///
-/** \ingroup docCore docAudioDriver */
+/**
+ * The song is rendered offline as fast as possible. In contrast to
+ * the realtime drivers, blocks of up to #MAX_BUFFER_SIZE frames are
+ * processed, the export thread waits for the lock of the
+ * #AudioEngine as long as it takes instead of dropping audio, and
+ * encoding of the resulting file is done by a #SoundFileWriter in a
+ * separate thread.
+ *
+ * Along with the main mix the driver can write the output of
+ * individual instruments into separate files (stems) in the very
+ * same pass. Each of them is encoded in a thread of its own.
+ *
+ * \ingroup docCore docAudioDriver */
 class DiskWriterDriver : public Object<DiskWriterDriver>, public AudioOutput
 {
 	H2_OBJECT(DiskWriterDriver)
 	public:
 
+		/** File containing the output of a single instrument. */
+		struct Stem {
+			std::shared_ptr<Instrument> pInstrument;
+			QString sFilename;
+		};
+
 		unsigned				m_nSampleRate;
 		QString					m_sFilename;
 		unsigned				m_nBufferSize;
@@ -50,7 +73,15 @@ class DiskWriterDriver : public Object<DiskWriterDriver>, public AudioOutput
 		audioProcessCallback	m_processCallback;
 		float*					m_pOut_L;
 		float*					m_pOut_R;
-		bool					 m_bIsRunning;
+		std::atomic<bool>		m_bIsRunning;
+		/** Buffer size provided in init(). The size of the blocks
+		 * rendered, #m_nBufferSize, is a multiple of it. */
+		unsigned				m_nPeriodSize;
+		/** Length of the last export in seconds. */
+		double					m_fExportedSeconds;
+		/** Length of the last export divided by the time it took to
+		 * render it. */
+		double					m_fRealtimeFactor;
 
 		DiskWriterDriver( audioProcessCallback processCallback );
 		~DiskWriterDriver();
@@ -61,6 +92,14 @@ class DiskWriterDriver : public Object<DiskWriterDriver>, public AudioOutput
 		virtual void disconnect() override;
 
 		void write();
+		/**
+		 * Stops the export thread and waits for it to finish.
+		 *
+		 * Since the thread acquires the #AudioEngine lock for each
+		 * block it renders, this must not be called while holding
+		 * it.
+		 */
+		void stop();
 
 		virtual unsigned getBufferSize() override {
 			return m_nBufferSize;
@@ -85,8 +124,72 @@ class DiskWriterDriver : public Object<DiskWriterDriver>, public AudioOutput
 			m_sFilename = sFilename;
 		}
 
-	private:
+		double getExportedSeconds() const {
+			return m_fExportedSeconds;
+		}
+		double getRealtimeFactor() const {
+			return m_fRealtimeFactor;
+		}
+
+		/**
+		 * Sets the stems written during the next call to write().
+		 *
+		 * In case #m_sFilename is empty, only the stems will be
+		 * written. Must not be called during an export.
+		 */
+		void setStems( const std::vector<Stem>& stems );
+		const std::vector<Stem>& getStems() const {
+			return m_stems;
+		}
+
+		/**
+		 * Buffers the #Sampler mixes the post-fader output of @a
+		 * pInstrument into in addition to the main output.
+		 *
+		 * \return nullptr in case there is no stem for @a pInstrument.
+		 */
+		float* getStemOut_L( std::shared_ptr<Instrument> pInstrument );
+		float* getStemOut_R( std::shared_ptr<Instrument> pInstrument );
+
+		/** Resets the buffers of all stems. */
+		void clearStemBuffers( uint32_t nFrames );
+
+		/**
+		 * Creates a stem for every instrument of @a pSong used in at
+		 * least one of its patterns.
+		 *
+		 * The name of each file is derived from @a sFilename by
+		 * appending the name of the instrument - and its id in case
+		 * the name is not unique - to its base name.
+		 */
+		static std::vector<Stem> createStems( std::shared_ptr<Song> pSong,
+											  const QString& sFilename );
+
+		/**
+		 * Whether the stems rendered in a single pass are identical to
+		 * the ones obtained by exporting each instrument on its own.
+		 *
+		 * This is not the case when using LADSPA effects since they
+		 * are applied to the mix of all instruments and their output
+		 * can not be attributed to individual ones.
+		 */
+		static bool canRenderStemsInOnePass();
 
+	private:
+		friend void* diskWriterDriver_thread( void* param );
+
+		/** Position of the stem of @a pInstrument in #m_stems or -1. */
+		int findStem( std::shared_ptr<Instrument> pInstrument ) const;
+
+		std::vector<Stem>		m_stems;
+		/** Maps the id of each instrument to the position of its stem
+		 * in #m_stems. */
+		std::map<int, int>		m_stemIndices;
+		/** Left and right buffer of each stem stored consecutively. */
+		std::vector<float>		m_stemBuffers;
+		/** Whether the export thread was started by write() and not
+		 * joined yet. */
+		bool					m_bThreadJoinable;
 };
 
 };
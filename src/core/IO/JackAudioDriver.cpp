@@ -622,7 +622,7 @@ float* JackAudioDriver::getOut_R()
 
 float* JackAudioDriver::getTrackOut_L( unsigned nTrack )
 {
-	if ( nTrack > static_cast<unsigned>(m_nTrackPortCount) ) {
+	if ( nTrack >= static_cast<unsigned>(m_nTrackPortCount) ) {
 		return nullptr;
 	}
 	
@@ -636,7 +636,7 @@ float* JackAudioDriver::getTrackOut_L( unsigned nTrack )
 
 float* JackAudioDriver::getTrackOut_R( unsigned nTrack )
 {
-	if( nTrack > static_cast<unsigned>(m_nTrackPortCount) ) {
+	if( nTrack >= static_cast<unsigned>(m_nTrackPortCount) ) {
 		return nullptr;
 	}
 	
@@ -648,14 +648,35 @@ float* JackAudioDriver::getTrackOut_R( unsigned nTrack )
 	return out;
 }
 
+int JackAudioDriver::getTrack( std::shared_ptr<Instrument> instr, std::shared_ptr<InstrumentComponent> pCompo ) const
+{
+	// Preview and metronome instrument (negative ids) are not
+	// assigned a port of their own.
+	const int nId = instr->get_id();
+	const int nComponent = pCompo->get_drumkit_componentID();
+	if ( nId < 0 || nId >= MAX_INSTRUMENTS ||
+		 nComponent < 0 || nComponent >= MAX_COMPONENTS ) {
+		return -1;
+	}
+	return m_trackMap[nId][nComponent];
+}
+
 float* JackAudioDriver::getTrackOut_L( std::shared_ptr<Instrument> instr, std::shared_ptr<InstrumentComponent> pCompo)
 {
-	return getTrackOut_L(m_trackMap[instr->get_id()][pCompo->get_drumkit_componentID()]);
+	const int nTrack = getTrack( instr, pCompo );
+	if ( nTrack < 0 ) {
+		return nullptr;
+	}
+	return getTrackOut_L( static_cast<unsigned>(nTrack) );
 }
 
 float* JackAudioDriver::getTrackOut_R( std::shared_ptr<Instrument> instr, std::shared_ptr<InstrumentComponent> pCompo)
 {
-	return getTrackOut_R(m_trackMap[instr->get_id()][pCompo->get_drumkit_componentID()]);
+	const int nTrack = getTrack( instr, pCompo );
+	if ( nTrack < 0 ) {
+		return nullptr;
+	}
+	return getTrackOut_R( static_cast<unsigned>(nTrack) );
 }
 
 
@@ -887,7 +908,7 @@ void JackAudioDriver::makeTrackOutputs( std::shared_ptr<Song> pSong )
 
 	for( int i = 0 ; i < MAX_INSTRUMENTS ; i++ ){
 		for ( int j = 0 ; j < MAX_COMPONENTS ; j++ ){
-			m_trackMap[i][j] = 0;
+			m_trackMap[i][j] = -1;
 		}
 	}
 	// Creates a new output track or reassigns an existing one for
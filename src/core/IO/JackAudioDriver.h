@@ -198,21 +198,23 @@ public:
 	/**
 	 * Get content of left output port of a specific track.
 	 *
-	 * \param nTrack Track number. Must not be bigger than
+	 * \param nTrack Track number. Must be smaller than
 	 * #m_nTrackPortCount.
 	 *
 	 * \return Pointer to buffer content of type
-	 * _jack_default_audio_sample_t*_ (jack/types.h)
+	 * _jack_default_audio_sample_t*_ (jack/types.h) or nullptr for
+	 * an invalid @a nTrack.
 	 */
 	float* getTrackOut_L( unsigned nTrack );
 	/**
 	 * Get content of right output port of a specific track.
 	 *
-	 * \param nTrack Track number. Must not be bigger than
+	 * \param nTrack Track number. Must be smaller than
 	 * #m_nTrackPortCount.
 	 *
 	 * \return Pointer to buffer content of type
-	 * _jack_default_audio_sample_t*_ (jack/types.h)
+	 * _jack_default_audio_sample_t*_ (jack/types.h) or nullptr for
+	 * an invalid @a nTrack.
 	 */
 	float* getTrackOut_R( unsigned nTrack );
 	/** 
@@ -443,6 +445,14 @@ private:
 	 * \param pSong Pointer to the corresponding Song.
 	 */
 	void setTrackOutput( int n, std::shared_ptr<Instrument> instr, std::shared_ptr<InstrumentComponent> pCompo, std::shared_ptr<Song> pSong );
+	/**
+	 * Looks up the track number of a component of an instrument in
+	 * #m_trackMap.
+	 *
+	 * \return Track number or -1 in case no port is assigned to
+	 *   @a pCompo of @a instr.
+	 */
+	int getTrack( std::shared_ptr<Instrument> instr, std::shared_ptr<InstrumentComponent> pCompo ) const;
 	/** Main process callback. */
 	JackProcessCallback		m_processCallback;
 	/**
@@ -470,7 +480,7 @@ private:
 	 * output of the second component of the third instrument is
 	 * assigned the seventh output port. Since its total size is
 	 * defined by #MAX_INSTRUMENTS and #MAX_COMPONENTS, most of its
-	 * entries will be zero.
+	 * entries will be -1, indicating no port was assigned.
 	 */
 	int				m_trackMap[MAX_INSTRUMENTS][MAX_COMPONENTS];
 	/**
@@ -0,0 +1,248 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+
+#include <core/IO/SoundFileWriter.h>
+
+#include <algorithm>
+
+namespace H2Core
+{
+
+SoundFileWriter::SoundFileWriter( int nBlockSize, int nBlocks )
+	: m_nBlockSize( std::max( nBlockSize, 1 ) )
+	, m_nFillBlock( 0 )
+	, m_nEncodeBlock( 0 )
+	, m_nQueuedBlocks( 0 )
+	, m_bClosing( false )
+	, m_bError( false )
+	, m_pFile( nullptr )
+	, m_nFrames( 0 )
+{
+	m_blocks.resize( std::max( nBlocks, 1 ) );
+	for ( auto& block : m_blocks ) {
+		block.data.resize( m_nBlockSize * 2 ); // always stereo
+		block.nFrames = 0;
+	}
+}
+
+SoundFileWriter::~SoundFileWriter()
+{
+	close();
+}
+
+int SoundFileWriter::formatFromFilename( const QString& sFilename,
+										 int nSampleDepth ) {
+	const QString sLower = sFilename.toLower();
+
+	if ( sLower.endsWith( ".ogg" ) ) {
+		return SF_FORMAT_OGG | SF_FORMAT_VORBIS;
+	}
+
+	int nFormat = SF_FORMAT_WAV;
+	if ( sLower.endsWith( ".aiff" ) ) {
+		nFormat = SF_FORMAT_AIFF;
+	}
+	else if ( sLower.endsWith( ".flac" ) ) {
+		nFormat = SF_FORMAT_FLAC;
+	}
+
+	int nBits = SF_FORMAT_PCM_16;
+	if ( nSampleDepth == 8 ) {
+		if ( nFormat == SF_FORMAT_AIFF ) {
+			// Signed 8 bit data works with aiff
+			nBits = SF_FORMAT_PCM_S8;
+		}
+		else if ( sLower.endsWith( ".wav" ) ) {
+			// Unsigned 8 bit data needed for Microsoft WAV format
+			nBits = SF_FORMAT_PCM_U8;
+		}
+	}
+	else if ( nSampleDepth == 24 ) {
+		nBits = SF_FORMAT_PCM_24;
+	}
+	else if ( nSampleDepth == 32 ) {
+		nBits = SF_FORMAT_PCM_32;
+	}
+
+	return nFormat | nBits;
+}
+
+bool SoundFileWriter::open( const QString& sFilename, int nSampleRate,
+							int nSampleDepth ) {
+	if ( m_pFile != nullptr ) {
+		ERRORLOG( QString( "[%1] is still open" ).arg( m_sFilename ) );
+		return false;
+	}
+
+	SF_INFO soundInfo;
+	soundInfo.samplerate = nSampleRate;
+	soundInfo.channels = 2;
+	soundInfo.format = formatFromFilename( sFilename, nSampleDepth );
+
+	if ( ! sf_format_check( &soundInfo ) ) {
+		ERRORLOG( QString( "Unsupported format for [%1] at sample rate [%2] and depth [%3]" )
+				  .arg( sFilename ).arg( nSampleRate ).arg( nSampleDepth ) );
+		return false;
+	}
+
+	m_pFile = sf_open( sFilename.toLocal8Bit(), SFM_WRITE, &soundInfo );
+	if ( m_pFile == nullptr ) {
+		ERRORLOG( QString( "Unable to open file [%1] using libsndfile: %2" )
+				  .arg( sFilename )
+				  .arg( sf_strerror( nullptr ) ) );
+		return false;
+	}
+
+	m_sFilename = sFilename;
+	m_nFillBlock = 0;
+	m_nEncodeBlock = 0;
+	m_nQueuedBlocks = 0;
+	m_bClosing = false;
+	m_bError = false;
+	m_nFrames = 0;
+
+	m_thread = std::thread( &SoundFileWriter::encoderLoop, this );
+
+	return true;
+}
+
+bool SoundFileWriter::write( const float* pData_L, const float* pData_R,
+							 int nFrames ) {
+	if ( m_pFile == nullptr || m_bError ) {
+		return false;
+	}
+
+	int nOffset = 0;
+	while ( nOffset < nFrames ) {
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_freeCondition.wait( lock, [&]{
+				return m_nQueuedBlocks < static_cast<int>(m_blocks.size()); } );
+		}
+
+		// The block is not accessed by the encoder thread till it
+		// was queued.
+		auto& block = m_blocks[ m_nFillBlock ];
+		const int nBlockFrames = std::min( nFrames - nOffset, m_nBlockSize );
+		float* pData = block.data.data();
+		for ( int ii = 0; ii < nBlockFrames; ++ii ) {
+			pData[ ii * 2 ] =
+				std::clamp( pData_L[ nOffset + ii ], -1.0f, 1.0f );
+			pData[ ii * 2 + 1 ] =
+				std::clamp( pData_R[ nOffset + ii ], -1.0f, 1.0f );
+		}
+		block.nFrames = nBlockFrames;
+
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			++m_nQueuedBlocks;
+		}
+		m_queuedCondition.notify_one();
+
+		m_nFillBlock = ( m_nFillBlock + 1 ) % m_blocks.size();
+		nOffset += nBlockFrames;
+		m_nFrames += nBlockFrames;
+	}
+
+	return ! m_bError;
+}
+
+void SoundFileWriter::encoderLoop() {
+	while ( true ) {
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_queuedCondition.wait( lock, [&]{
+				return m_nQueuedBlocks > 0 || m_bClosing; } );
+			if ( m_nQueuedBlocks == 0 ) {
+				// Closing and all blocks are encoded.
+				return;
+			}
+		}
+
+		const auto& block = m_blocks[ m_nEncodeBlock ];
+		if ( ! m_bError ) {
+			const sf_count_t nWritten =
+				sf_writef_float( m_pFile, block.data.data(), block.nFrames );
+			if ( nWritten != block.nFrames ) {
+				ERRORLOG( QString( "Error while writing [%1]. Frames written: [%2], target: [%3]. %4" )
+						  .arg( m_sFilename ).arg( nWritten )
+						  .arg( block.nFrames ).arg( sf_strerror( m_pFile ) ) );
+				m_bError = true;
+			}
+		}
+		m_nEncodeBlock = ( m_nEncodeBlock + 1 ) % m_blocks.size();
+
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+			--m_nQueuedBlocks;
+		}
+		m_freeCondition.notify_one();
+	}
+}
+
+bool SoundFileWriter::close() {
+	if ( m_pFile == nullptr ) {
+		return true;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_bClosing = true;
+	}
+	m_queuedCondition.notify_one();
+	if ( m_thread.joinable() ) {
+		m_thread.join();
+	}
+
+	if ( sf_close( m_pFile ) != 0 ) {
+		ERRORLOG( QString( "Unable to close [%1]: %2" )
+				  .arg( m_sFilename ).arg( sf_strerror( nullptr ) ) );
+		m_bError = true;
+	}
+	m_pFile = nullptr;
+
+	return ! m_bError;
+}
+
+QString SoundFileWriter::toQString( const QString& sPrefix, bool bShort ) const {
+	QString s = Base::sPrintIndention;
+	QString sOutput;
+	if ( ! bShort ) {
+		sOutput = QString( "%1[SoundFileWriter]\n" ).arg( sPrefix )
+			.append( QString( "%1%2m_sFilename: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( m_sFilename ) )
+			.append( QString( "%1%2m_nBlockSize: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( m_nBlockSize ) )
+			.append( QString( "%1%2m_blocks.size(): %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( m_blocks.size() ) )
+			.append( QString( "%1%2m_nFrames: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( m_nFrames ) );
+	} else {
+		sOutput = QString( "[SoundFileWriter] m_sFilename: %1" ).arg( m_sFilename )
+			.append( QString( ", m_nBlockSize: %1" ).arg( m_nBlockSize ) )
+			.append( QString( ", m_blocks.size(): %1" ).arg( m_blocks.size() ) )
+			.append( QString( ", m_nFrames: %1" ).arg( m_nFrames ) );
+	}
+	return sOutput;
+}
+
+};
@@ -0,0 +1,134 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+#ifndef H2C_SOUND_FILE_WRITER_H
+#define H2C_SOUND_FILE_WRITER_H
+
+#include <sndfile.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <core/Object.h>
+
+namespace H2Core
+{
+
+/**
+ * Encodes stereo audio into a file using libsndfile on a dedicated
+ * thread.
+ *
+ * write() clips and interleaves the provided channels into one of a
+ * fixed number of preallocated blocks and hands it over to the
+ * encoding thread. This way rendering the next block overlaps with
+ * encoding the previous one. In case all blocks are still waiting to
+ * be encoded write() blocks until one of them becomes available
+ * again.
+ *
+ * write() and close() must always be called from the same thread.
+ *
+ * \ingroup docCore docAudioDriver
+ */
+class SoundFileWriter : public H2Core::Object<SoundFileWriter>
+{
+	H2_OBJECT(SoundFileWriter)
+public:
+	/**
+	 * \param nBlockSize Number of frames per block.
+	 * \param nBlocks Number of blocks which can be queued at once.
+	 */
+	SoundFileWriter( int nBlockSize, int nBlocks = 4 );
+	~SoundFileWriter();
+
+	/**
+	 * Opens @a sFilename and starts the encoding thread.
+	 *
+	 * The file format is derived from the suffix of @a sFilename.
+	 *
+	 * \return true on success.
+	 */
+	bool open( const QString& sFilename, int nSampleRate, int nSampleDepth );
+
+	/**
+	 * Enqueues @a nFrames frames of @a pData_L and @a pData_R.
+	 *
+	 * \return false in case encoding of a previous block failed.
+	 */
+	bool write( const float* pData_L, const float* pData_R, int nFrames );
+
+	/**
+	 * Encodes all remaining blocks, stops the encoding thread, and
+	 * closes the file.
+	 *
+	 * \return false in case any of the blocks could not be written.
+	 */
+	bool close();
+
+	/** Number of frames passed to write() so far. */
+	long long getFrames() const;
+
+	/**
+	 * Format of a file written to @a sFilename in libsndfile's
+	 * notation.
+	 */
+	static int formatFromFilename( const QString& sFilename, int nSampleDepth );
+
+	QString toQString( const QString& sPrefix = "", bool bShort = true ) const override;
+
+private:
+	struct Block {
+		std::vector<float> data;
+		int nFrames;
+	};
+
+	void encoderLoop();
+
+	const int m_nBlockSize;
+	std::vector<Block> m_blocks;
+	/** Index of the next block to fill in write(). */
+	int m_nFillBlock;
+	/** Index of the next block to encode. */
+	int m_nEncodeBlock;
+	/** Number of blocks filled but not encoded yet. */
+	int m_nQueuedBlocks;
+
+	std::mutex m_mutex;
+	std::condition_variable m_queuedCondition;
+	std::condition_variable m_freeCondition;
+	bool m_bClosing;
+	std::atomic<bool> m_bError;
+
+	std::thread m_thread;
+	SNDFILE* m_pFile;
+	QString m_sFilename;
+	long long m_nFrames;
+};
+
+inline long long SoundFileWriter::getFrames() const {
+	return m_nFrames;
+}
+
+};
+
+#endif
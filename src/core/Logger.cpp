@@ -23,10 +23,13 @@
 #include "core/Logger.h"
 #include "core/Helpers/Filesystem.h"
 
+#include <cmath>
 #include <cstdio>
 #include <chrono>
 #include <thread>
+#include <time.h>
 #include <QtCore/QDir>
+#include <QtCore/QStringList>
 
 #ifdef WIN32
 #include <windows.h>
@@ -62,22 +65,45 @@ void* loggerThread_func( void* param ) {
 	}
 	Logger::queue_t* queue = &logger->__msg_queue;
 	Logger::queue_t::iterator it, last;
+	QStringList realtimeMessages;
+
+	auto write = [&]( const QString& sMsg ) {
+		if ( logger->m_bUseStdout ) {
+			fprintf( stdout, "%s", sMsg.toLocal8Bit().data() );
+			fflush( stdout );
+		}
+		if( log_file ) {
+			fprintf( log_file, "%s", sMsg.toLocal8Bit().data() );
+			fflush( log_file );
+		}
+	};
 
 	while ( logger->__running ) {
+		// The audio thread does not signal the condition variable when
+		// logging. We have to check for realtime messages on a regular
+		// basis.
+		struct timespec timeout;
+		clock_gettime( CLOCK_REALTIME, &timeout );
+		timeout.tv_nsec += 50 * 1000 * 1000;
+		if ( timeout.tv_nsec >= 1000 * 1000 * 1000 ) {
+			timeout.tv_nsec -= 1000 * 1000 * 1000;
+			timeout.tv_sec += 1;
+		}
 		pthread_mutex_lock( &logger->__mutex );
-		pthread_cond_wait( &logger->__messages_available, &logger->__mutex );
+		pthread_cond_timedwait( &logger->__messages_available, &logger->__mutex,
+								&timeout );
 		pthread_mutex_unlock( &logger->__mutex );
+
+		logger->popRealtimeMessages( &realtimeMessages );
+		for ( const auto& sMsg : realtimeMessages ) {
+			write( sMsg );
+		}
+		realtimeMessages.clear();
+
 		if( !queue->empty() ) {
 			for( it = last = queue->begin() ; it != queue->end() ; ++it ) {
 				last = it;
-				if ( logger->m_bUseStdout ) {
-					fprintf( stdout, "%s", it->toLocal8Bit().data() );
-					fflush( stdout );
-				}
-				if( log_file ) {
-					fprintf( log_file, "%s", it->toLocal8Bit().data() );
-					fflush( log_file );
-				}
+				write( *it );
 			}
 			// remove all in front of last
 			pthread_mutex_lock( &logger->__mutex );
@@ -113,9 +139,16 @@ Logger::Logger( const QString& sLogFilePath, bool bUseStdout ) :
 	__use_file( true ),
 	__running( true ),
 	m_sLogFilePath( sLogFilePath ),
-	m_bUseStdout( bUseStdout ) {
+	m_bUseStdout( bUseStdout ),
+	m_nRealtimeWriteIndex( 0 ),
+	m_nRealtimeReadIndex( 0 ),
+	m_nRealtimeDropped( 0 ) {
 	__instance = this;
 
+	for ( unsigned ii = 0; ii < nRealtimeRecords; ++ii ) {
+		m_realtimeRecords[ ii ].nSequence = ii;
+	}
+
 	// Sanity checks.
 	QFileInfo fiLogFile( m_sLogFilePath );
 	QFileInfo fiParentFolder( fiLogFile.absolutePath() );
@@ -147,6 +180,16 @@ void Logger::log( unsigned level, const QString& class_name, const char* func_na
 		return;
 	}
 
+	QString tmp = formatMessage( level, class_name, func_name, msg );
+
+	pthread_mutex_lock( &__mutex );
+	__msg_queue.push_back( tmp );
+	pthread_mutex_unlock( &__mutex );
+	pthread_cond_broadcast( &__messages_available );
+}
+
+QString Logger::formatMessage( unsigned level, const QString& sClassName,
+							   const char* sFuncName, const QString& sMsg ) {
 	const char* prefix[] = { "", "(E) ", "(W) ", "(I) ", "(D) ", "(C)", "(L) " };
 #ifdef WIN32
 	const char* color[] = { "", "", "", "", "", "", "" };
@@ -179,24 +222,127 @@ void Logger::log( unsigned level, const QString& class_name, const char* func_na
 		break;
 	}
 
-	QString tmp = QString( "%1%2%3::%4 %5\033[0m\n" )
-				  .arg( color[i] )
-				  .arg( prefix[i] )
-				  .arg( class_name )
-				  .arg( func_name )
-				  .arg( msg );
+	return QString( "%1%2%3::%4 %5\033[0m\n" )
+		.arg( color[i] )
+		.arg( prefix[i] )
+		.arg( sClassName )
+		.arg( sFuncName )
+		.arg( sMsg );
+}
 
-	pthread_mutex_lock( &__mutex );
-	__msg_queue.push_back( tmp );
-	pthread_mutex_unlock( &__mutex );
-	pthread_cond_broadcast( &__messages_available );
+void Logger::pushRealtimeRecord( unsigned level, const char* sClassName,
+								 const char* sFuncName, const char* sFormat,
+								 const double* pArgs, int nArgs ) {
+	if ( level == None ) {
+		return;
+	}
+
+	unsigned nPosition = m_nRealtimeWriteIndex.load( std::memory_order_relaxed );
+	RealtimeRecord* pRecord;
+	while ( true ) {
+		pRecord = &m_realtimeRecords[ nPosition % nRealtimeRecords ];
+		const unsigned nSequence =
+			pRecord->nSequence.load( std::memory_order_acquire );
+		const int nDiff = static_cast<int>( nSequence - nPosition );
+		if ( nDiff == 0 ) {
+			if ( m_nRealtimeWriteIndex.compare_exchange_weak(
+					 nPosition, nPosition + 1, std::memory_order_relaxed ) ) {
+				break;
+			}
+		}
+		else if ( nDiff < 0 ) {
+			++m_nRealtimeDropped;
+			return;
+		}
+		else {
+			nPosition = m_nRealtimeWriteIndex.load( std::memory_order_relaxed );
+		}
+	}
+
+	pRecord->nLevel = level;
+	pRecord->sClassName = sClassName;
+	pRecord->sFuncName = sFuncName;
+	pRecord->sFormat = sFormat;
+	pRecord->nArgs = nArgs;
+	for ( int ii = 0; ii < nArgs; ++ii ) {
+		pRecord->args[ ii ] = pArgs[ ii ];
+	}
+	pRecord->timestamp = std::chrono::steady_clock::now();
+	pRecord->nSequence.store( nPosition + 1, std::memory_order_release );
+}
+
+void Logger::popRealtimeMessages( QStringList* pMessages ) {
+	const auto now = std::chrono::steady_clock::now();
+
+	// Report call sites which were silenced during their last window.
+	for ( auto& [ sFormat, callSite ] : m_realtimeCallSites ) {
+		if ( callSite.nSuppressed > 0 &&
+			 now - callSite.windowStart >= std::chrono::seconds( 1 ) ) {
+			pMessages->append(
+				formatMessage( Warning, "Logger", __FUNCTION__,
+							   QString( "Suppressed [%1] further messages: %2" )
+							   .arg( callSite.nSuppressed ).arg( sFormat ) ) );
+			callSite.nSuppressed = 0;
+		}
+	}
+
+	unsigned nReadIndex = m_nRealtimeReadIndex.load();
+	while ( true ) {
+		RealtimeRecord* pRecord =
+			&m_realtimeRecords[ nReadIndex % nRealtimeRecords ];
+		if ( pRecord->nSequence.load( std::memory_order_acquire ) !=
+			 nReadIndex + 1 ) {
+			break;
+		}
+
+		const RealtimeRecord& record = *pRecord;
+		auto& callSite = m_realtimeCallSites[ record.sFormat ];
+		if ( callSite.nMessages == 0 ||
+			 record.timestamp - callSite.windowStart >= std::chrono::seconds( 1 ) ) {
+			callSite.windowStart = record.timestamp;
+			callSite.nMessages = 0;
+		}
+
+		if ( callSite.nMessages < nRealtimeMessagesPerSecond ) {
+			++callSite.nMessages;
+
+			QString sMsg( record.sFormat );
+			for ( int ii = 0; ii < record.nArgs; ++ii ) {
+				const double fArg = record.args[ ii ];
+				if ( std::trunc( fArg ) == fArg && std::abs( fArg ) < 1e15 ) {
+					sMsg = sMsg.arg( static_cast<long long>( fArg ) );
+				} else {
+					sMsg = sMsg.arg( fArg );
+				}
+			}
+			pMessages->append( formatMessage( record.nLevel, record.sClassName,
+											  record.sFuncName, sMsg ) );
+		}
+		else {
+			++callSite.nSuppressed;
+		}
+
+		pRecord->nSequence.store( nReadIndex + nRealtimeRecords,
+								  std::memory_order_release );
+		++nReadIndex;
+	}
+	m_nRealtimeReadIndex.store( nReadIndex );
+
+	const int nDropped = m_nRealtimeDropped.exchange( 0 );
+	if ( nDropped > 0 ) {
+		pMessages->append(
+			formatMessage( Error, "Logger", __FUNCTION__,
+						   QString( "Realtime log buffer full. [%1] messages lost" )
+						   .arg( nDropped ) ) );
+	}
 }
 
 void Logger::flush() const {
 
 	int nTimeout = 100;
 	for ( int ii = 0; ii < nTimeout; ++ii ) {
-		if ( __msg_queue.empty() ) {
+		if ( __msg_queue.empty() &&
+			 m_nRealtimeWriteIndex.load() == m_nRealtimeReadIndex ) {
 			break;
 		}
 
@@ -23,8 +23,11 @@
 #ifndef H2C_LOGGER_H
 #define H2C_LOGGER_H
 
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <list>
+#include <map>
 #include <pthread.h>
 #include <memory>
 #include <QtCore/QString>
@@ -119,6 +122,37 @@ class Logger {
 		 * \param msg the message to log
 		 */
 		void log( unsigned level, const QString& class_name, const char* func_name, const QString& msg );
+		/**
+		 * Realtime safe version of log() intended to be used by the
+		 * audio thread.
+		 *
+		 * Instead of formatting the message right away, only the
+		 * provided pointers and numerical arguments are written
+		 * into the preallocated ring buffer #m_realtimeRecords. This
+		 * neither allocates memory nor locks. Formatting, rate
+		 * limiting, and I/O is done by the logger thread.
+		 *
+		 * \param level used to output the corresponding level string
+		 * \param sClassName the name of the calling class. Must be a
+		 *   string literal.
+		 * \param sFuncName the name of the calling function/method
+		 * \param sFormat Message containing up to #nRealtimeArgs
+		 *   placeholders (%1, %2, ...). Must be a string literal.
+		 * \param args Numerical values the placeholders will be
+		 *   replaced with.
+		 */
+		template<typename... Args>
+		void logRealtime( unsigned level, const char* sClassName,
+						  const char* sFuncName, const char* sFormat,
+						  Args... args );
+
+		/** Maximum number of numerical arguments supported by
+		 * logRealtime(). */
+		static constexpr int nRealtimeArgs = 6;
+		/** Number of messages of a particular call site logged via
+		 * logRealtime() which are printed per second. All further
+		 * ones are suppressed. */
+		static constexpr int nRealtimeMessagesPerSecond = 5;
 		/**
 		 * needed for being able to access logger internal
 		 * \param param is a pointer to the logger instance
@@ -147,6 +181,40 @@ class Logger {
 		};
 
 	private:
+		/** Fixed-size entry written by logRealtime(). */
+		struct RealtimeRecord {
+			/** Sequence number used to hand the record over between
+			 * the producers and the logger thread. */
+			std::atomic<unsigned> nSequence;
+			unsigned nLevel;
+			const char* sClassName;
+			const char* sFuncName;
+			const char* sFormat;
+			int nArgs;
+			double args[ nRealtimeArgs ];
+			std::chrono::steady_clock::time_point timestamp;
+		};
+		static constexpr unsigned nRealtimeRecords = 1024;
+
+		/** Rate limiting state for a single call site of
+		 * logRealtime(). Only accessed by the logger thread. */
+		struct RealtimeCallSite {
+			std::chrono::steady_clock::time_point windowStart;
+			int nMessages;
+			int nSuppressed;
+		};
+
+		void pushRealtimeRecord( unsigned level, const char* sClassName,
+								 const char* sFuncName, const char* sFormat,
+								 const double* pArgs, int nArgs );
+		/**
+		 * Formats all records pushed by logRealtime() and applies
+		 * rate limiting. Only called by the logger thread.
+		 */
+		void popRealtimeMessages( QStringList* pMessages );
+		static QString formatMessage( unsigned level, const QString& sClassName,
+									  const char* sFuncName, const QString& sMsg );
+
 		/**
 		 * Object holding the current H2Core::Logger
 		 * singleton. It is initialized with NULL, set with
@@ -164,6 +232,16 @@ class Logger {
 	QString m_sLogFilePath;
 	bool m_bUseStdout;
 
+		/** Ring buffer of messages emitted by logRealtime(). */
+		RealtimeRecord m_realtimeRecords[ nRealtimeRecords ];
+		std::atomic<unsigned> m_nRealtimeWriteIndex;
+		/** Only written by the logger thread. */
+		std::atomic<unsigned> m_nRealtimeReadIndex;
+		/** Number of realtime messages lost because the logger thread
+		 * did not keep up. */
+		std::atomic<int> m_nRealtimeDropped;
+		std::map<const char*, RealtimeCallSite> m_realtimeCallSites;
+
 		thread_local static QString *pCrashContext;
 
 		/** constructor */
@@ -180,6 +258,18 @@ class Logger {
 #endif // HAVE_SSCANF
 };
 
+template<typename... Args>
+inline void Logger::logRealtime( unsigned level, const char* sClassName,
+								 const char* sFuncName, const char* sFormat,
+								 Args... args ) {
+	static_assert( sizeof...( args ) <= nRealtimeArgs,
+				   "Too many arguments for realtime log message" );
+	// Leading element ensures the array is never empty.
+	const double argsArray[] = { 0.0, static_cast<double>( args )... };
+	pushRealtimeRecord( level, sClassName, sFuncName, sFormat,
+						&argsArray[ 1 ], sizeof...( args ) );
+}
+
 };
 
 #endif // H2C_LOGGER_H
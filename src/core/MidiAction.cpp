@@ -22,6 +22,7 @@
 #include <QObject>
 
 #include <core/AudioEngine/AudioEngine.h>
+#include <core/AudioEngine/SongSwitcher.h>
 #include <core/AudioEngine/TransportPosition.h>
 #include <core/EventQueue.h>
 #include <core/CoreActionController.h>
@@ -1137,8 +1138,21 @@ bool MidiActionManager::setSongFromPlaylist( int nSongNumber, Hydrogen* pHydroge
 			auto pSong = CoreActionController::loadSong(
 				pPlaylist->getSongFilenameByNumber( nSongNumber ) );
 
-			if ( pSong == nullptr ||
-				 ! CoreActionController::setSong( pSong ) ) {
+			// While transport is rolling, the new song takes over at
+			// the boundary chosen for playlists. In case it was
+			// prefetched, this only requires swapping pointers.
+			bool bSongSet = false;
+			const auto boundary =
+				Preferences::get_instance()->m_playlistSwitchBoundary;
+			auto pSongSwitcher = pHydrogen->getSongSwitcher();
+			if ( pSong != nullptr && pSongSwitcher->isApplicable( boundary ) ) {
+				bSongSet = pSongSwitcher->switchSong( pSong, boundary );
+			}
+			else if ( pSong != nullptr ) {
+				bSongSet = CoreActionController::setSong( pSong );
+			}
+
+			if ( ! bSongSet ) {
 				ERRORLOG( QString( "Unable to set song [%1] of playlist" )
 						  .arg( nSongNumber ) );
 				return false;
@@ -231,6 +231,7 @@ template<typename T> atomic_obj_cpt_t Object<T>::counters;
 #define __LOG_OBJ(      lvl, msg )  if( __object->logger()->should_log( (lvl) ) )       { __object->logger()->log( (lvl), 0, __PRETTY_FUNCTION__, QString( "%1" ).arg( msg ) ); }
 #define __LOG_STATIC(   lvl, msg )  if( H2Core::Logger::get_instance()->should_log( (lvl) ) )   { H2Core::Logger::get_instance()->log( (lvl), 0, __PRETTY_FUNCTION__, QString( "%1" ).arg( msg ) ); }
 #define __LOG( logger,  lvl, msg )  if( (logger)->should_log( (lvl) ) )                 { (logger)->log( (lvl), 0, 0, QString( "%1" ).arg( msg ) ); }
+#define __LOG_REALTIME( lvl, ... )  if( __logger->should_log( (lvl) ) )                 { __logger->logRealtime( (lvl), _class_name(), __FUNCTION__, __VA_ARGS__ ); }
 
 // Object instance method logging macros
 #define DEBUGLOG(x)     __LOG_METHOD( H2Core::Logger::Debug,   (x) );
@@ -256,6 +257,13 @@ template<typename T> atomic_obj_cpt_t Object<T>::counters;
 #define ___WARNINGLOG(x) __LOG_STATIC(H2Core::Logger::Warning,  (x) );
 #define ___ERRORLOG(x)  __LOG_STATIC( H2Core::Logger::Error,    (x) );
 
+// Realtime safe object class method logging macros. They take a
+// string literal containing up to Logger::nRealtimeArgs placeholders
+// followed by numerical arguments.
+#define RT_INFOLOG(...)     __LOG_REALTIME( H2Core::Logger::Info,    __VA_ARGS__ );
+#define RT_WARNINGLOG(...)  __LOG_REALTIME( H2Core::Logger::Warning, __VA_ARGS__ );
+#define RT_ERRORLOG(...)    __LOG_REALTIME( H2Core::Logger::Error,   __VA_ARGS__ );
+
 // Can be called without or with a single argument
 #define CLOCK(...)      __LOG_METHOD( H2Core::Logger::Debug, base_clock( QString( "%1" ).arg( #__VA_ARGS__ ) ) );
 #define CLOCKIN(...)    __LOG_METHOD( H2Core::Logger::Debug, base_clock_in( QString( "%1" ).arg( #__VA_ARGS__ ) ) );
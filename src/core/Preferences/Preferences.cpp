@@ -59,6 +59,7 @@ void Preferences::create_instance()
 
 		// Propagate loaded settings
 		InstrumentComponent::setMaxLayers( __instance->getMaxLayers() );
+		XMLDoc::setSkipValidatedFiles( __instance->m_bSkipXmlRevalidation );
 
 	}
 }
@@ -152,6 +153,14 @@ Preferences::Preferences()
 	m_bUseMetronome = false;
 	m_fMetronomeVolume = 0.5;
 	m_nMaxNotes = 256;
+	m_voiceStealing = VoiceStealing::oldest;
+	m_nRenderThreads = 1;
+	m_bUseSampleCache = true;
+	m_bSkipXmlRevalidation = false;
+	m_switchBoundary = SwitchBoundary::stop;
+	m_nPlaylistPrefetchSongs = 1;
+	m_nPlaylistPrefetchMemory = 512;
+	m_playlistSwitchBoundary = SwitchBoundary::nextBar;
 	m_nBufferSize = 1024;
 	m_nSampleRate = 44100;
 
@@ -366,6 +375,17 @@ bool Preferences::loadPreferences( bool bGlobal )
 			m_nLastOpenTab = rootNode.read_int( "lastOpenTab", 0, false, false );
 			m_bUseRelativeFilenamesForPlaylists = rootNode.read_bool( "useRelativeFilenamesForPlaylists", false, false, false );
 			m_bHideKeyboardCursor = rootNode.read_bool( "hideKeyboardCursorWhenUnused", false, false, false );
+			m_bSkipXmlRevalidation = rootNode.read_bool( "skipXmlRevalidation", m_bSkipXmlRevalidation, false, false );
+			m_switchBoundary = readSwitchBoundary(
+				rootNode, "switchBoundary", SwitchBoundary::stop );
+			m_nPlaylistPrefetchSongs = std::clamp(
+				rootNode.read_int( "playlistPrefetchSongs",
+								   m_nPlaylistPrefetchSongs, false, false ), 0, 2 );
+			m_nPlaylistPrefetchMemory = std::max(
+				rootNode.read_int( "playlistPrefetchMemory",
+								   m_nPlaylistPrefetchMemory, false, false ), 0 );
+			m_playlistSwitchBoundary = readSwitchBoundary(
+				rootNode, "playlistSwitchBoundary", SwitchBoundary::nextBar );
 
 			//restore the right m_bsetlash value
 			m_bsetLash = m_bUseLash;
@@ -455,6 +475,18 @@ bool Preferences::loadPreferences( bool bGlobal )
 				m_bUseMetronome = audioEngineNode.read_bool( "use_metronome", m_bUseMetronome, false, false );
 				m_fMetronomeVolume = audioEngineNode.read_float( "metronome_volume", 0.5f, false, false );
 				m_nMaxNotes = audioEngineNode.read_int( "maxNotes", m_nMaxNotes, false, false );
+				const int nVoiceStealing = audioEngineNode.read_int(
+					"voiceStealing", static_cast<int>(m_voiceStealing), false, false );
+				if ( nVoiceStealing >= static_cast<int>(VoiceStealing::oldest) &&
+					 nVoiceStealing <= static_cast<int>(VoiceStealing::sameInstrument) ) {
+					m_voiceStealing = static_cast<VoiceStealing>(nVoiceStealing);
+				} else {
+					WARNINGLOG( QString( "Unknown voiceStealing value [%1]. Using [%2] instead." )
+								.arg( nVoiceStealing )
+								.arg( static_cast<int>(m_voiceStealing) ) );
+				}
+				m_nRenderThreads = audioEngineNode.read_int( "renderThreads", m_nRenderThreads, false, false );
+				m_bUseSampleCache = audioEngineNode.read_bool( "useSampleCache", m_bUseSampleCache, false, false );
 				m_nBufferSize = audioEngineNode.read_int( "buffer_size", m_nBufferSize, false, false );
 				m_nSampleRate = audioEngineNode.read_int( "samplerate", m_nSampleRate, false, false );
 
@@ -903,6 +935,12 @@ bool Preferences::savePreferences() const
 
 	rootNode.write_bool( "useRelativeFilenamesForPlaylists", m_bUseRelativeFilenamesForPlaylists );
 	rootNode.write_bool( "hideKeyboardCursorWhenUnused", m_bHideKeyboardCursor );
+	rootNode.write_bool( "skipXmlRevalidation", m_bSkipXmlRevalidation );
+	rootNode.write_int( "switchBoundary", static_cast<int>(m_switchBoundary) );
+	rootNode.write_int( "playlistPrefetchSongs", m_nPlaylistPrefetchSongs );
+	rootNode.write_int( "playlistPrefetchMemory", m_nPlaylistPrefetchMemory );
+	rootNode.write_int( "playlistSwitchBoundary",
+						static_cast<int>(m_playlistSwitchBoundary) );
 	
 	// instrument input mode
 	rootNode.write_bool( "instrumentInputMode", __playselectedinstrument );
@@ -974,6 +1012,9 @@ bool Preferences::savePreferences() const
 		audioEngineNode.write_bool( "use_metronome", m_bUseMetronome );
 		audioEngineNode.write_float( "metronome_volume", m_fMetronomeVolume );
 		audioEngineNode.write_int( "maxNotes", m_nMaxNotes );
+		audioEngineNode.write_int( "voiceStealing", static_cast<int>(m_voiceStealing) );
+		audioEngineNode.write_int( "renderThreads", m_nRenderThreads );
+		audioEngineNode.write_bool( "useSampleCache", m_bUseSampleCache );
 		audioEngineNode.write_int( "buffer_size", m_nBufferSize );
 		audioEngineNode.write_int( "samplerate", m_nSampleRate );
 
@@ -1303,6 +1344,30 @@ WindowProperties Preferences::loadWindowPropertiesFrom( const XMLNode& parent, c
 
 
 
+/// Read a SwitchBoundary stored as plain integer
+Preferences::SwitchBoundary Preferences::readSwitchBoundary( const XMLNode& parent,
+															 const QString& sNodeName,
+															 SwitchBoundary defaultBoundary )
+{
+	const int nBoundary = parent.read_int(
+		sNodeName, static_cast<int>(defaultBoundary), false, false );
+	switch ( nBoundary ) {
+	case 0:
+		return SwitchBoundary::stop;
+	case 1:
+		return SwitchBoundary::immediately;
+	case 2:
+		return SwitchBoundary::nextBar;
+	case 3:
+		return SwitchBoundary::patternEnd;
+	default:
+		WARNINGLOG( QString( "Unknown %1 value [%2]. Using [%3] instead." )
+					.arg( sNodeName ).arg( nBoundary )
+					.arg( static_cast<int>(defaultBoundary) ) );
+		return defaultBoundary;
+	}
+}
+
 /// Write the xml nodes related to window properties
 void Preferences::saveWindowPropertiesTo( XMLNode& parent, const QString& windowName, const WindowProperties& prop )
 {
@@ -191,6 +191,61 @@ public:
 	float				m_fMetronomeVolume;
 	/// max notes
 	unsigned			m_nMaxNotes;
+	/** Voice chosen by the #Sampler to make room for a new note once
+	 * #m_nMaxNotes notes are playing. See Sampler::noteOn(). */
+	enum class VoiceStealing {
+		/** The note playing the longest. */
+		oldest = 0,
+		/** The note with the lowest current ADSR value. */
+		quietest = 1,
+		/** A note already in its release phase. Falls back to the
+		 * oldest one. */
+		released = 2,
+		/** The oldest note of the same instrument. Falls back to the
+		 * oldest one overall. */
+		sameInstrument = 3 };
+	VoiceStealing		m_voiceStealing;
+	/** Number of threads used by the #Sampler to render notes -
+	 * including the audio thread itself. 1 renders all notes
+	 * serially. See Sampler::setRenderThreads(). */
+	int					m_nRenderThreads;
+	/** Whether processed samples are stored on disk and mapped into
+	 * memory on subsequent loads. See SampleCache. */
+	bool				m_bUseSampleCache;
+	/** Whether XML documents already validated successfully during
+	 * this session are not validated again as long as their content
+	 * is unchanged. See XMLDoc::setSkipValidatedFiles(). */
+	bool				m_bSkipXmlRevalidation;
+
+	/** Point in time a song or drumkit loaded while transport is
+	 * rolling replaces the current one. See SongSwitcher. */
+	enum class SwitchBoundary {
+		/** Transport is stopped and the new song or kit is loaded
+		 * right away (legacy behavior). */
+		stop = 0,
+		/** Samples are loaded in the background and the new song or
+		 * kit takes over as soon as they are ready. */
+		immediately = 1,
+		/** Samples are loaded in the background and the new song or
+		 * kit takes over at the beginning of the next bar. */
+		nextBar = 2,
+		/** Samples are loaded in the background and the new song or
+		 * kit takes over once the current pattern has ended. */
+		patternEnd = 3 };
+
+	/** Point in time a song or drumkit loaded while transport is
+	 * rolling replaces the current one. */
+	SwitchBoundary		m_switchBoundary;
+	/** Number of songs following the active one in the current
+	 * #Playlist which are loaded - including their samples - in the
+	 * background. 0 disables prefetching. See PlaylistPrefetcher. */
+	int					m_nPlaylistPrefetchSongs;
+	/** Maximum amount of sample data in MiB held by all prefetched
+	 * playlist songs combined. */
+	int					m_nPlaylistPrefetchMemory;
+	/** Point in time a playlist song selected via MIDI or OSC
+	 * replaces the current one while transport is rolling. */
+	SwitchBoundary		m_playlistSwitchBoundary;
 	/** 
 	 * Buffer size of the audio.
 	 *
@@ -784,6 +839,9 @@ private:
 													  const WindowProperties& defaultProp );
 	static void saveWindowPropertiesTo( XMLNode& parent, const QString& sWindowName,
 										const WindowProperties& prop );
+	static SwitchBoundary readSwitchBoundary( const XMLNode& parent,
+											  const QString& sNodeName,
+											  SwitchBoundary defaultBoundary );
 
 	bool m_bLoadingSuccessful;
 };
@@ -0,0 +1,559 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+
+#include <core/Sampler/Resample.h>
+
+#include <algorithm>
+#include <atomic>
+
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+  #define H2_RESAMPLE_X86
+  #include <immintrin.h>
+  #define H2_TARGET_SSE2 __attribute__((target("sse2")))
+  #define H2_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(__GNUC__) && defined(__aarch64__)
+  #define H2_RESAMPLE_NEON
+  #include <arm_neon.h>
+#endif
+
+namespace H2Core
+{
+
+namespace Resample
+{
+
+/// Renders as many frames as possible - but not more than @a nFrames -
+/// using vectorized instructions and returns their number. All four
+/// taps around each position must be within the sample data.
+typedef int (*FastKernel)( float* pBuffer_L, float* pBuffer_R,
+						   const float* pSample_data_L, const float* pSample_data_R,
+						   int nFrames, double fSamplePos, float fStep );
+
+/// Whether interpolation of @a mode requires the outer taps y0 and y3
+/// as well.
+template < Interpolation::InterpolateMode mode >
+static constexpr bool usesFourTaps() {
+	return mode != Interpolation::InterpolateMode::Linear &&
+		mode != Interpolation::InterpolateMode::Cosine;
+}
+
+/// Acquiring the frames to interpolate from the input sample data in a safe
+/// manner is surprisingly costly since up to 4 input frames must be fetched
+/// for each output frame, and each must be bounds-checked.
+///
+/// To handle this efficiently, we define a "safe" frame acquisition method
+/// with bounds checking on each frame and providing a silent frame outside
+/// the sample data boundaries, as well as a "fast" path which assumes
+/// it can read all the necessary samples without bounds checking or flow
+/// control.
+///
+/// The output frames are partitioned into three ranges, corresponding to the
+/// beginning, "middle" and end of the input sample data, so that the fast
+/// method can be used for the majority of the sample, and the safe method for
+/// the beginning and ends.
+///
+/// Although not all input frames are needed for each interpolation method
+/// (linear requires only two), the interpolation mode is a constant parameter
+/// and so the compiler wil remove accesses and some unnecessary bounds
+/// checking where it's not needed, without having to hand-write
+/// specialisations for each.
+///
+/// If provided, @a fastKernel is used to render the "middle" range
+/// while the remainder is handled by the scalar code.
+///
+/// In case the sample data is surrounded by @a nGuardFrames zeroed
+/// frames on both sides, the unconditional lookup is extended into
+/// them. This yields the same result as the bounds checked code.
+///
+template < Interpolation::InterpolateMode mode >
+static void resampleWith( FastKernel fastKernel,
+						  float *__restrict__ pBuffer_L, float *__restrict__ pBuffer_R,
+						  const float *__restrict__ pSample_data_L,
+						  const float *__restrict__ pSample_data_R,
+						  int nFrames, double &fSamplePos, float fStep, int nSampleFrames,
+						  int nGuardFrames )
+{
+	auto getSampleFrames = [&](	int nSamplePos,
+								float &l0, float &l1, float &l2, float &l3,
+								float &r0, float &r1, float &r2, float &r3 ) {
+		l0 = l1 = l2 = l3 = r0 = r1 = r2 = r3 = 0.0;
+		// Some required frames are off the beginning or end of the sample.
+		if ( nSamplePos >= 1 && nSamplePos < nSampleFrames + 1 ) {
+			l0 = pSample_data_L[ nSamplePos-1 ];
+			r0 = pSample_data_R[ nSamplePos-1 ];
+		}
+		// Each successive frame may be past the end of the sample so check individually.
+		if ( nSamplePos < nSampleFrames ) {
+			l1 = pSample_data_L[ nSamplePos ];
+			r1 = pSample_data_R[ nSamplePos ];
+			if ( nSamplePos+1 < nSampleFrames ) {
+				l2 = pSample_data_L[ nSamplePos+1 ];
+				r2 = pSample_data_R[ nSamplePos+1 ];
+				if ( nSamplePos+2 < nSampleFrames ) {
+					l3 = pSample_data_L[ nSamplePos+2 ];
+					r3 = pSample_data_R[ nSamplePos+2 ];
+				}
+			}
+		}
+	};
+
+	float fVal_L, fVal_R;
+	int nFrame;
+	float l0, l1, l2, l3, r0, r1, r2, r3;
+
+	// Initial safe iterations to avoid reading off the beginning of
+	// the sample. A single guard frame already covers the first tap.
+	for ( nFrame = 0; nFrame < nFrames; nFrame++) {
+		int nSamplePos = static_cast<int>(fSamplePos);
+		if ( nSamplePos >= 1 || ( nGuardFrames > 0 && fSamplePos >= 0 ) )
+			break;
+		double fDiff = fSamplePos - nSamplePos;
+		getSampleFrames( 0, l0, l1, l2, l3, r0, r1, r2, r3);
+
+		fVal_L = Interpolation::interpolate<mode>( l0, l1, l2, l3, fDiff );
+		fVal_R = Interpolation::interpolate<mode>( r0, r1, r2, r3, fDiff );
+		pBuffer_L[nFrame] = fVal_L;
+		pBuffer_R[nFrame] = fVal_R;
+		fSamplePos += fStep;
+	}
+
+	// Fast iterations for main body of sample, with unconditional sample lookup
+	int nFastFrames = std::min( nFrames,
+								static_cast<int>( ( nSampleFrames + nGuardFrames - 2 - fSamplePos ) /  fStep ) );
+	if ( fastKernel != nullptr && nFastFrames > nFrame ) {
+		const int nRendered = fastKernel( &pBuffer_L[ nFrame ], &pBuffer_R[ nFrame ],
+										  pSample_data_L, pSample_data_R,
+										  nFastFrames - nFrame, fSamplePos, fStep );
+		fSamplePos += nRendered * static_cast<double>(fStep);
+		nFrame += nRendered;
+	}
+	for ( ; nFrame < nFastFrames; nFrame++) {
+		int nSamplePos = static_cast<int>(fSamplePos);
+		double fDiff = fSamplePos - nSamplePos;
+		// Gather frame samples
+		l0 = pSample_data_L[ nSamplePos-1 ];
+		l1 = pSample_data_L[ nSamplePos ];
+		l2 = pSample_data_L[ nSamplePos+1 ];
+		l3 = pSample_data_L[ nSamplePos+2 ];
+		r0 = pSample_data_R[ nSamplePos-1 ];
+		r1 = pSample_data_R[ nSamplePos ];
+		r2 = pSample_data_R[ nSamplePos+1 ];
+		r3 = pSample_data_R[ nSamplePos+2 ];
+		fVal_L = Interpolation::interpolate<mode>( l0, l1, l2, l3, fDiff );
+		fVal_R = Interpolation::interpolate<mode>( r0, r1, r2, r3, fDiff );
+		pBuffer_L[nFrame] = fVal_L;
+		pBuffer_R[nFrame] = fVal_R;
+		fSamplePos += fStep;
+	}
+
+	for ( ; nFrame < nFrames; nFrame++ ) {
+		int nSamplePos = static_cast<int>(fSamplePos);
+		double fDiff = fSamplePos - nSamplePos;
+		getSampleFrames( nSamplePos, l0, l1, l2, l3, r0, r1, r2, r3);
+		fVal_L = Interpolation::interpolate<mode>( l0, l1, l2, l3, fDiff );
+		fVal_R = Interpolation::interpolate<mode>( r0, r1, r2, r3, fDiff );
+		pBuffer_L[nFrame] = fVal_L;
+		pBuffer_R[nFrame] = fVal_R;
+		fSamplePos += fStep;
+	}
+}
+
+#if defined(H2_RESAMPLE_X86) || defined(H2_RESAMPLE_NEON)
+
+/// Single precision counterpart of Interpolation::interpolate() working
+/// on all lanes of the native vector type @a V at once.
+///
+/// It relies on the generic vector extension of GCC and Clang for the
+/// arithmetic and is always inlined. This way the very same code is
+/// compiled into the instruction set of the calling kernel.
+template < typename V, Interpolation::InterpolateMode mode >
+inline __attribute__((always_inline)) void interpolate(
+	V& out, const V& y0, const V& y1, const V& y2, const V& y3, const V& mu )
+{
+	if constexpr ( mode == Interpolation::InterpolateMode::Linear ) {
+		out = y1 * ( 1.0f - mu ) + y2 * mu;
+	}
+	else if constexpr ( mode == Interpolation::InterpolateMode::Cosine ) {
+		// cos( mu * pi ) = sin( pi / 2 - mu * pi ) using a Taylor
+		// polynomial of sin accurate to ~6e-8 on [-pi/2, pi/2].
+		const V t = 1.57079633f - mu * 3.14159f;
+		const V t2 = t * t;
+		const V fCos = t * ( 1.0f + t2 * ( -1.66666667e-1f +
+			t2 * ( 8.33333333e-3f + t2 * ( -1.98412698e-4f +
+			t2 * ( 2.75573192e-6f + t2 * -2.50521084e-8f ) ) ) ) );
+		const V mu2 = ( 1.0f - fCos ) * 0.5f;
+		out = y1 * ( 1.0f - mu2 ) + y2 * mu2;
+	}
+	else if constexpr ( mode == Interpolation::InterpolateMode::Third ) {
+		const V c1 = ( y2 - y0 ) * 0.5f;
+		const V c3 = ( y1 - y2 ) * 1.5f + ( y3 - y0 ) * 0.5f;
+		const V c2 = y0 - y1 + c1 - c3;
+		out = ( ( c3 * mu + c2 ) * mu + c1 ) * mu + y1;
+	}
+	else if constexpr ( mode == Interpolation::InterpolateMode::Cubic ) {
+		const V a0 = y3 - y2 - y0 + y1;
+		const V a1 = y0 - y1 - a0;
+		const V a2 = y2 - y0;
+		out = ( ( a0 * mu + a1 ) * mu + a2 ) * mu + y1;
+	}
+	else if constexpr ( mode == Interpolation::InterpolateMode::Hermite ) {
+		const V a0 = ( y3 - y0 ) * 0.5f + ( y1 - y2 ) * 1.5f;
+		const V a1 = y0 - y1 * 2.5f + y2 * 2.0f - y3 * 0.5f;
+		const V a2 = ( y2 - y0 ) * 0.5f;
+		out = ( ( a0 * mu + a1 ) * mu + a2 ) * mu + y1;
+	}
+}
+
+#endif
+
+#ifdef H2_RESAMPLE_X86
+
+/// Loads the four taps around each of the four positions in @a pIndices
+/// and transposes them into one vector per tap.
+H2_TARGET_SSE2 inline __attribute__((always_inline)) void gatherTapsSSE2(
+	__m128& y0, __m128& y1, __m128& y2, __m128& y3,
+	const float* pData, const int* pIndices )
+{
+	y0 = _mm_loadu_ps( &pData[ pIndices[ 0 ] - 1 ] );
+	y1 = _mm_loadu_ps( &pData[ pIndices[ 1 ] - 1 ] );
+	y2 = _mm_loadu_ps( &pData[ pIndices[ 2 ] - 1 ] );
+	y3 = _mm_loadu_ps( &pData[ pIndices[ 3 ] - 1 ] );
+	_MM_TRANSPOSE4_PS( y0, y1, y2, y3 );
+}
+
+template < Interpolation::InterpolateMode mode >
+H2_TARGET_SSE2 static int resampleSSE2(
+	float* pBuffer_L, float* pBuffer_R,
+	const float* pSample_data_L, const float* pSample_data_R,
+	int nFrames, double fSamplePos, float fStep )
+{
+	const double fStepD = fStep;
+	const __m128d vOffsetsLo = _mm_setr_pd( 0.0, fStepD );
+	const __m128d vOffsetsHi = _mm_setr_pd( 2.0 * fStepD, 3.0 * fStepD );
+	alignas( 16 ) int indices[ 4 ];
+
+	int nFrame = 0;
+	for ( ; nFrame + 4 <= nFrames; nFrame += 4 ) {
+		// Positions are kept in double precision to not loose
+		// accuracy for long samples.
+		const __m128d vBase = _mm_set1_pd( fSamplePos + nFrame * fStepD );
+		const __m128d vPosLo = _mm_add_pd( vBase, vOffsetsLo );
+		const __m128d vPosHi = _mm_add_pd( vBase, vOffsetsHi );
+		const __m128i vIdxLo = _mm_cvttpd_epi32( vPosLo );
+		const __m128i vIdxHi = _mm_cvttpd_epi32( vPosHi );
+		const __m128 vMu = _mm_movelh_ps(
+			_mm_cvtpd_ps( _mm_sub_pd( vPosLo, _mm_cvtepi32_pd( vIdxLo ) ) ),
+			_mm_cvtpd_ps( _mm_sub_pd( vPosHi, _mm_cvtepi32_pd( vIdxHi ) ) ) );
+		_mm_store_si128( reinterpret_cast<__m128i*>( indices ),
+						 _mm_unpacklo_epi64( vIdxLo, vIdxHi ) );
+
+		__m128 l0, l1, l2, l3, r0, r1, r2, r3;
+		gatherTapsSSE2( l0, l1, l2, l3, pSample_data_L, indices );
+		gatherTapsSSE2( r0, r1, r2, r3, pSample_data_R, indices );
+
+		__m128 vOut_L, vOut_R;
+		interpolate<__m128, mode>( vOut_L, l0, l1, l2, l3, vMu );
+		interpolate<__m128, mode>( vOut_R, r0, r1, r2, r3, vMu );
+		_mm_storeu_ps( &pBuffer_L[ nFrame ], vOut_L );
+		_mm_storeu_ps( &pBuffer_R[ nFrame ], vOut_R );
+	}
+
+	return nFrame;
+}
+
+template < Interpolation::InterpolateMode mode >
+H2_TARGET_AVX2 static int resampleAVX2(
+	float* pBuffer_L, float* pBuffer_R,
+	const float* pSample_data_L, const float* pSample_data_R,
+	int nFrames, double fSamplePos, float fStep )
+{
+	const double fStepD = fStep;
+	const __m256d vOffsetsLo = _mm256_setr_pd( 0.0, fStepD, 2.0 * fStepD, 3.0 * fStepD );
+	const __m256d vOffsetsHi = _mm256_setr_pd( 4.0 * fStepD, 5.0 * fStepD,
+											   6.0 * fStepD, 7.0 * fStepD );
+	const __m256i vOne = _mm256_set1_epi32( 1 );
+	const __m256i vTwo = _mm256_set1_epi32( 2 );
+
+	int nFrame = 0;
+	for ( ; nFrame + 8 <= nFrames; nFrame += 8 ) {
+		const __m256d vBase = _mm256_set1_pd( fSamplePos + nFrame * fStepD );
+		const __m256d vPosLo = _mm256_add_pd( vBase, vOffsetsLo );
+		const __m256d vPosHi = _mm256_add_pd( vBase, vOffsetsHi );
+		const __m128i vIdxLo = _mm256_cvttpd_epi32( vPosLo );
+		const __m128i vIdxHi = _mm256_cvttpd_epi32( vPosHi );
+		const __m256 vMu = _mm256_insertf128_ps(
+			_mm256_castps128_ps256(
+				_mm256_cvtpd_ps( _mm256_sub_pd( vPosLo, _mm256_cvtepi32_pd( vIdxLo ) ) ) ),
+			_mm256_cvtpd_ps( _mm256_sub_pd( vPosHi, _mm256_cvtepi32_pd( vIdxHi ) ) ), 1 );
+		const __m256i vIdx = _mm256_insertf128_si256(
+			_mm256_castsi128_si256( vIdxLo ), vIdxHi, 1 );
+		const __m256i vIdxNext = _mm256_add_epi32( vIdx, vOne );
+
+		__m256 l0, l1, l2, l3, r0, r1, r2, r3;
+		l1 = _mm256_i32gather_ps( pSample_data_L, vIdx, 4 );
+		l2 = _mm256_i32gather_ps( pSample_data_L, vIdxNext, 4 );
+		r1 = _mm256_i32gather_ps( pSample_data_R, vIdx, 4 );
+		r2 = _mm256_i32gather_ps( pSample_data_R, vIdxNext, 4 );
+		if constexpr ( usesFourTaps<mode>() ) {
+			const __m256i vIdxPrev = _mm256_sub_epi32( vIdx, vOne );
+			const __m256i vIdxNextNext = _mm256_add_epi32( vIdx, vTwo );
+			l0 = _mm256_i32gather_ps( pSample_data_L, vIdxPrev, 4 );
+			l3 = _mm256_i32gather_ps( pSample_data_L, vIdxNextNext, 4 );
+			r0 = _mm256_i32gather_ps( pSample_data_R, vIdxPrev, 4 );
+			r3 = _mm256_i32gather_ps( pSample_data_R, vIdxNextNext, 4 );
+		} else {
+			l0 = l3 = r0 = r3 = _mm256_setzero_ps();
+		}
+
+		__m256 vOut_L, vOut_R;
+		interpolate<__m256, mode>( vOut_L, l0, l1, l2, l3, vMu );
+		interpolate<__m256, mode>( vOut_R, r0, r1, r2, r3, vMu );
+		_mm256_storeu_ps( &pBuffer_L[ nFrame ], vOut_L );
+		_mm256_storeu_ps( &pBuffer_R[ nFrame ], vOut_R );
+	}
+
+	return nFrame;
+}
+
+#endif // H2_RESAMPLE_X86
+
+#ifdef H2_RESAMPLE_NEON
+
+/// Loads the four taps around each of the four positions in @a pIndices
+/// and transposes them into one vector per tap.
+inline __attribute__((always_inline)) void gatherTapsNEON(
+	float32x4_t& y0, float32x4_t& y1, float32x4_t& y2, float32x4_t& y3,
+	const float* pData, const int* pIndices )
+{
+	const float32x4x2_t t01 = vtrnq_f32( vld1q_f32( &pData[ pIndices[ 0 ] - 1 ] ),
+										 vld1q_f32( &pData[ pIndices[ 1 ] - 1 ] ) );
+	const float32x4x2_t t23 = vtrnq_f32( vld1q_f32( &pData[ pIndices[ 2 ] - 1 ] ),
+										 vld1q_f32( &pData[ pIndices[ 3 ] - 1 ] ) );
+	y0 = vcombine_f32( vget_low_f32( t01.val[ 0 ] ), vget_low_f32( t23.val[ 0 ] ) );
+	y1 = vcombine_f32( vget_low_f32( t01.val[ 1 ] ), vget_low_f32( t23.val[ 1 ] ) );
+	y2 = vcombine_f32( vget_high_f32( t01.val[ 0 ] ), vget_high_f32( t23.val[ 0 ] ) );
+	y3 = vcombine_f32( vget_high_f32( t01.val[ 1 ] ), vget_high_f32( t23.val[ 1 ] ) );
+}
+
+template < Interpolation::InterpolateMode mode >
+static int resampleNEON(
+	float* pBuffer_L, float* pBuffer_R,
+	const float* pSample_data_L, const float* pSample_data_R,
+	int nFrames, double fSamplePos, float fStep )
+{
+	const double fStepD = fStep;
+	const float64x2_t vOffsetsLo = { 0.0, fStepD };
+	const float64x2_t vOffsetsHi = { 2.0 * fStepD, 3.0 * fStepD };
+	int indices[ 4 ];
+
+	int nFrame = 0;
+	for ( ; nFrame + 4 <= nFrames; nFrame += 4 ) {
+		const float64x2_t vBase = vdupq_n_f64( fSamplePos + nFrame * fStepD );
+		const float64x2_t vPosLo = vaddq_f64( vBase, vOffsetsLo );
+		const float64x2_t vPosHi = vaddq_f64( vBase, vOffsetsHi );
+		const int64x2_t vIdxLo = vcvtq_s64_f64( vPosLo );
+		const int64x2_t vIdxHi = vcvtq_s64_f64( vPosHi );
+		const float32x4_t vMu = vcombine_f32(
+			vcvt_f32_f64( vsubq_f64( vPosLo, vcvtq_f64_s64( vIdxLo ) ) ),
+			vcvt_f32_f64( vsubq_f64( vPosHi, vcvtq_f64_s64( vIdxHi ) ) ) );
+		indices[ 0 ] = static_cast<int>( vgetq_lane_s64( vIdxLo, 0 ) );
+		indices[ 1 ] = static_cast<int>( vgetq_lane_s64( vIdxLo, 1 ) );
+		indices[ 2 ] = static_cast<int>( vgetq_lane_s64( vIdxHi, 0 ) );
+		indices[ 3 ] = static_cast<int>( vgetq_lane_s64( vIdxHi, 1 ) );
+
+		float32x4_t l0, l1, l2, l3, r0, r1, r2, r3;
+		gatherTapsNEON( l0, l1, l2, l3, pSample_data_L, indices );
+		gatherTapsNEON( r0, r1, r2, r3, pSample_data_R, indices );
+
+		float32x4_t vOut_L, vOut_R;
+		interpolate<float32x4_t, mode>( vOut_L, l0, l1, l2, l3, vMu );
+		interpolate<float32x4_t, mode>( vOut_R, r0, r1, r2, r3, vMu );
+		vst1q_f32( &pBuffer_L[ nFrame ], vOut_L );
+		vst1q_f32( &pBuffer_R[ nFrame ], vOut_R );
+	}
+
+	return nFrame;
+}
+
+#endif // H2_RESAMPLE_NEON
+
+template < Interpolation::InterpolateMode mode >
+static FastKernel fastKernel( const Kernel& kernel )
+{
+	switch ( kernel ) {
+#ifdef H2_RESAMPLE_X86
+	case Kernel::SSE2:
+		// Without a gather instruction, assembling the two taps
+		// required for linear interpolation costs more than the
+		// interpolation itself. The scalar code is faster here.
+		if constexpr ( mode == Interpolation::InterpolateMode::Linear ) {
+			return nullptr;
+		}
+		return resampleSSE2< mode >;
+	case Kernel::AVX2:
+		return resampleAVX2< mode >;
+#endif
+#ifdef H2_RESAMPLE_NEON
+	case Kernel::NEON:
+		return resampleNEON< mode >;
+#endif
+	default:
+		return nullptr;
+	}
+}
+
+QString KernelToQString( const Kernel& kernel )
+{
+	switch ( kernel ) {
+	case Kernel::Scalar:
+		return "Scalar";
+	case Kernel::SSE2:
+		return "SSE2";
+	case Kernel::AVX2:
+		return "AVX2";
+	case Kernel::NEON:
+		return "NEON";
+	default:
+		return "<unknown>";
+	}
+}
+
+bool isSupported( const Kernel& kernel )
+{
+	switch ( kernel ) {
+	case Kernel::Scalar:
+		return true;
+#ifdef H2_RESAMPLE_X86
+	case Kernel::SSE2:
+  #ifdef __x86_64__
+		// Part of the base line of x86_64.
+		return true;
+  #else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports( "sse2" );
+  #endif
+	case Kernel::AVX2:
+		__builtin_cpu_init();
+		return __builtin_cpu_supports( "avx2" );
+#endif
+#ifdef H2_RESAMPLE_NEON
+	case Kernel::NEON:
+		// Part of the base line of aarch64.
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+Kernel detectKernel()
+{
+	for ( const auto& kernel : { Kernel::AVX2, Kernel::SSE2, Kernel::NEON } ) {
+		if ( isSupported( kernel ) ) {
+			return kernel;
+		}
+	}
+	return Kernel::Scalar;
+}
+
+static std::atomic<Kernel>& currentKernel()
+{
+	static std::atomic<Kernel> kernel( detectKernel() );
+	return kernel;
+}
+
+Kernel getKernel()
+{
+	return currentKernel();
+}
+
+bool setKernel( const Kernel& kernel )
+{
+	if ( ! isSupported( kernel ) ) {
+		return false;
+	}
+	currentKernel() = kernel;
+	return true;
+}
+
+void resample( Interpolation::InterpolateMode mode,
+			   float *__restrict__ pBuffer_L, float *__restrict__ pBuffer_R,
+			   const float *__restrict__ pSample_data_L,
+			   const float *__restrict__ pSample_data_R,
+			   int nFrames, double &fSamplePos, float fStep, int nSampleFrames,
+			   int nGuardFrames )
+{
+	resample( currentKernel().load( std::memory_order_relaxed ), mode,
+			  pBuffer_L, pBuffer_R, pSample_data_L, pSample_data_R,
+			  nFrames, fSamplePos, fStep, nSampleFrames, nGuardFrames );
+}
+
+void resample( const Kernel& kernel, Interpolation::InterpolateMode mode,
+			   float *__restrict__ pBuffer_L, float *__restrict__ pBuffer_R,
+			   const float *__restrict__ pSample_data_L,
+			   const float *__restrict__ pSample_data_R,
+			   int nFrames, double &fSamplePos, float fStep, int nSampleFrames,
+			   int nGuardFrames )
+{
+	// Guard against kernels passed in directly which are not
+	// supported by the host CPU.
+	const Kernel usedKernel =
+		( kernel == Kernel::Scalar || kernel == getKernel() || isSupported( kernel ) ) ?
+		kernel : Kernel::Scalar;
+
+	switch (mode) {
+	case Interpolation::InterpolateMode::Linear:
+		resampleWith< Interpolation::InterpolateMode::Linear >
+			( fastKernel< Interpolation::InterpolateMode::Linear >( usedKernel ),
+			  pBuffer_L, pBuffer_R, pSample_data_L, pSample_data_R,
+			  nFrames, fSamplePos, fStep, nSampleFrames, nGuardFrames );
+		break;
+	case Interpolation::InterpolateMode::Cosine:
+		resampleWith< Interpolation::InterpolateMode::Cosine >
+			( fastKernel< Interpolation::InterpolateMode::Cosine >( usedKernel ),
+			  pBuffer_L, pBuffer_R, pSample_data_L, pSample_data_R,
+			  nFrames, fSamplePos, fStep, nSampleFrames, nGuardFrames );
+		break;
+	case Interpolation::InterpolateMode::Third:
+		resampleWith< Interpolation::InterpolateMode::Third >
+			( fastKernel< Interpolation::InterpolateMode::Third >( usedKernel ),
+			  pBuffer_L, pBuffer_R, pSample_data_L, pSample_data_R,
+			  nFrames, fSamplePos, fStep, nSampleFrames, nGuardFrames );
+		break;
+	case Interpolation::InterpolateMode::Cubic:
+		resampleWith< Interpolation::InterpolateMode::Cubic >
+			( fastKernel< Interpolation::InterpolateMode::Cubic >( usedKernel ),
+			  pBuffer_L, pBuffer_R, pSample_data_L, pSample_data_R,
+			  nFrames, fSamplePos, fStep, nSampleFrames, nGuardFrames );
+		break;
+	case Interpolation::InterpolateMode::Hermite:
+		resampleWith< Interpolation::InterpolateMode::Hermite >
+			( fastKernel< Interpolation::InterpolateMode::Hermite >( usedKernel ),
+			  pBuffer_L, pBuffer_R, pSample_data_L, pSample_data_R,
+			  nFrames, fSamplePos, fStep, nSampleFrames, nGuardFrames );
+		break;
+	}
+}
+
+};
+
+};
@@ -0,0 +1,115 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+
+#ifndef H2C_RESAMPLE_H
+#define H2C_RESAMPLE_H
+
+#include <core/Sampler/Interpolation.h>
+
+#include <QString>
+
+namespace H2Core
+{
+
+/**
+ * Conversion of stereo sample data into an audio buffer of different
+ * frame rate.
+ *
+ * Next to the portable scalar implementation there are vectorized
+ * kernels rendering four (SSE2, NEON) or eight (AVX2) frames at once.
+ * The best kernel supported by the host CPU is determined at runtime
+ * and used by resample() unless overridden via setKernel().
+ *
+ * The vectorized kernels evaluate the interpolation in single
+ * precision and are thus not bit-identical to the scalar path. The
+ * deviation stays below 1e-5 of the full scale.
+ *
+ * \ingroup docCore docAudioEngine
+ */
+namespace Resample
+{
+	enum class Kernel { Scalar = 0,
+						SSE2 = 1,
+						AVX2 = 2,
+						NEON = 3 };
+
+	QString KernelToQString( const Kernel& kernel );
+
+	/** Whether @a kernel was compiled in and is supported by the
+	 * host CPU. */
+	bool isSupported( const Kernel& kernel );
+	/** Fastest kernel supported by the host CPU. */
+	Kernel detectKernel();
+
+	/** Kernel used by resample(). Defaults to detectKernel(). */
+	Kernel getKernel();
+	/**
+	 * Selects the kernel used by resample().
+	 *
+	 * \return false in case @a kernel is not supported. The
+	 * current kernel is retained in that case.
+	 */
+	bool setKernel( const Kernel& kernel );
+
+	/**
+	 * Interpolate stereo samples into audio buffer of different
+	 * frame rate.
+	 *
+	 * \param pBuffer_L Output buffer (left channel) holding at
+	 *   least @a nFrames frames.
+	 * \param pBuffer_R Output buffer (right channel) holding at
+	 *   least @a nFrames frames.
+	 * \param pSample_data_L Sample data (left channel).
+	 * \param pSample_data_R Sample data (right channel).
+	 * \param nFrames Number of frames to render.
+	 * \param fSamplePos Position within the sample data. Will be
+	 *   advanced by @a nFrames times @a fStep.
+	 * \param fStep Ratio between the sample rate of the sample data
+	 *   and the output (including pitch shifts).
+	 * \param nSampleFrames Size of the sample data in frames. Data
+	 *   outside of the sample is treated as silence.
+	 * \param nGuardFrames Number of zeroed frames readable in front
+	 *   of and past the sample data, like those of
+	 *   Sample::Buffer. They allow the vectorized kernels to cover the
+	 *   whole sample instead of only its interior.
+	 */
+	void resample( Interpolation::InterpolateMode mode,
+				   float *__restrict__ pBuffer_L, float *__restrict__ pBuffer_R,
+				   const float *__restrict__ pSample_data_L,
+				   const float *__restrict__ pSample_data_R,
+				   int nFrames, double &fSamplePos, float fStep, int nSampleFrames,
+				   int nGuardFrames = 0 );
+
+	/** Same as resample() but using @a kernel instead of the
+	 * globally selected one. Unsupported kernels fall back to
+	 * Kernel::Scalar. */
+	void resample( const Kernel& kernel, Interpolation::InterpolateMode mode,
+				   float *__restrict__ pBuffer_L, float *__restrict__ pBuffer_R,
+				   const float *__restrict__ pSample_data_L,
+				   const float *__restrict__ pSample_data_R,
+				   int nFrames, double &fSamplePos, float fStep, int nSampleFrames,
+				   int nGuardFrames = 0 );
+};
+
+};
+
+#endif // H2C_RESAMPLE_H
@@ -0,0 +1,346 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+#include <core/Sampler/SampleStream.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace H2Core
+{
+
+/** Time the reader thread sleeps in case there is nothing to read. */
+static constexpr int nReaderPollMilliseconds = 5;
+/** Maximum time read() waits for data when rendering offline. */
+static constexpr int nWaitForDataMilliseconds = 5000;
+
+std::shared_ptr<SampleStream> SampleStream::open( const QString& sFilepath )
+{
+	SF_INFO info = {0};
+	SNDFILE* pFile = sf_open( sFilepath.toLocal8Bit(), SFM_READ, &info );
+	if ( pFile == nullptr ) {
+		ERRORLOG( QString( "Unable to open [%1]: %2" )
+				  .arg( sFilepath ).arg( sf_strerror( nullptr ) ) );
+		return nullptr;
+	}
+
+	if ( info.frames <= 0 || info.channels <= 0 || info.samplerate <= 0 ) {
+		ERRORLOG( QString( "[%1] does not contain any audio" ).arg( sFilepath ) );
+		sf_close( pFile );
+		return nullptr;
+	}
+
+	// Constructor is private.
+	return std::shared_ptr<SampleStream>(
+		new SampleStream( sFilepath, pFile, info ) );
+}
+
+SampleStream::SampleStream( const QString& sFilepath, SNDFILE* pFile,
+							const SF_INFO& info )
+	: m_sFilepath( sFilepath )
+	, m_pFile( pFile )
+	, m_nFrames( info.frames )
+	, m_nSampleRate( info.samplerate )
+	, m_nChannels( info.channels )
+	, m_nReadFrame( 0 )
+	, m_nRingStartFrame( 0 )
+	, m_nWriteFrame( 0 )
+	, m_nSeekFrame( 0 )
+	, m_nSeekRequests( 0 )
+	, m_nSeeksHandled( 0 )
+	, m_nUnderrunFrames( 0 )
+	, m_bShutdown( false )
+{
+	m_nPreloadFrames = std::min(
+		m_nFrames,
+		static_cast<long long>( m_nSampleRate ) * nPreloadMilliseconds / 1000 );
+	m_nRingFrames = std::max(
+		static_cast<long long>( m_nSampleRate ) * nRingMilliseconds / 1000,
+		static_cast<long long>( 4 * nReadChunkFrames ) );
+
+	m_preload_L.resize( m_nPreloadFrames );
+	m_preload_R.resize( m_nPreloadFrames );
+	m_peaks.resize( ( m_nFrames + nPeakFrames - 1 ) / nPeakFrames, 0 );
+	m_ring_L.resize( m_nRingFrames );
+	m_ring_R.resize( m_nRingFrames );
+	m_readBuffer.resize( nReadChunkFrames * m_nChannels );
+
+	// Walk through the whole file once in order to fill the preload
+	// buffer and to create the waveform overview. Only a single chunk
+	// is held in memory at a time.
+	std::vector<float> chunk_L( nReadChunkFrames );
+	std::vector<float> chunk_R( nReadChunkFrames );
+	long long nFrame = 0;
+	while ( nFrame < m_nFrames ) {
+		const int nRead = readFromFile( chunk_L.data(), chunk_R.data(),
+										nReadChunkFrames );
+		if ( nRead <= 0 ) {
+			WARNINGLOG( QString( "[%1] holds only [%2] of [%3] frames" )
+						.arg( m_sFilepath ).arg( nFrame ).arg( m_nFrames ) );
+			m_nFrames = nFrame;
+			m_nPreloadFrames = std::min( m_nPreloadFrames, m_nFrames );
+			break;
+		}
+
+		if ( nFrame < m_nPreloadFrames ) {
+			const int nPreload = static_cast<int>(
+				std::min( static_cast<long long>( nRead ),
+						  m_nPreloadFrames - nFrame ) );
+			memcpy( &m_preload_L[ nFrame ], chunk_L.data(),
+					nPreload * sizeof( float ) );
+			memcpy( &m_preload_R[ nFrame ], chunk_R.data(),
+					nPreload * sizeof( float ) );
+		}
+
+		for ( int ii = 0; ii < nRead; ++ii ) {
+			float& fPeak = m_peaks[ ( nFrame + ii ) / nPeakFrames ];
+			fPeak = std::max( fPeak, chunk_L[ ii ] );
+		}
+
+		nFrame += nRead;
+	}
+
+	// Streaming starts right after the preloaded part.
+	sf_seek( m_pFile, m_nPreloadFrames, SEEK_SET );
+	m_nReadFrame = m_nPreloadFrames;
+	m_nRingStartFrame = m_nPreloadFrames;
+	m_nWriteFrame = m_nPreloadFrames;
+	m_nSeekFrame = m_nPreloadFrames;
+
+	m_readerThread = std::thread( &SampleStream::readerLoop, this );
+}
+
+SampleStream::~SampleStream()
+{
+	m_bShutdown = true;
+	if ( m_readerThread.joinable() ) {
+		m_readerThread.join();
+	}
+	sf_close( m_pFile );
+}
+
+int SampleStream::readFromFile( float* pBuffer_L, float* pBuffer_R,
+								int nFrames )
+{
+	nFrames = std::min( nFrames, nReadChunkFrames );
+	const sf_count_t nRead = sf_readf_float( m_pFile, m_readBuffer.data(),
+											 nFrames );
+	if ( nRead <= 0 ) {
+		return 0;
+	}
+
+	const float* pData = m_readBuffer.data();
+	if ( m_nChannels == 1 ) {
+		memcpy( pBuffer_L, pData, nRead * sizeof( float ) );
+		memcpy( pBuffer_R, pData, nRead * sizeof( float ) );
+	}
+	else {
+		// Only the first two channels are used.
+		for ( sf_count_t ii = 0; ii < nRead; ++ii ) {
+			pBuffer_L[ ii ] = pData[ ii * m_nChannels ];
+			pBuffer_R[ ii ] = pData[ ii * m_nChannels + 1 ];
+		}
+	}
+
+	return static_cast<int>( nRead );
+}
+
+void SampleStream::readerLoop()
+{
+	while ( ! m_bShutdown ) {
+		const unsigned nRequests = m_nSeekRequests.load( std::memory_order_acquire );
+		if ( nRequests != m_nSeeksHandled.load( std::memory_order_relaxed ) ) {
+			const long long nFrame = m_nSeekFrame.load( std::memory_order_relaxed );
+			if ( sf_seek( m_pFile, nFrame, SEEK_SET ) < 0 ) {
+				ERRORLOG( QString( "Unable to seek [%1] to frame [%2]" )
+						  .arg( m_sFilepath ).arg( nFrame ) );
+			}
+			m_nRingStartFrame.store( nFrame, std::memory_order_relaxed );
+			m_nWriteFrame.store( nFrame, std::memory_order_relaxed );
+			m_nSeeksHandled.store( nRequests, std::memory_order_release );
+			continue;
+		}
+
+		if ( ! fillRing() ) {
+			std::this_thread::sleep_for(
+				std::chrono::milliseconds( nReaderPollMilliseconds ) );
+		}
+	}
+}
+
+bool SampleStream::fillRing()
+{
+	const long long nReadFrame = m_nReadFrame.load( std::memory_order_acquire );
+	const long long nWriteFrame = m_nWriteFrame.load( std::memory_order_relaxed );
+
+	// Frames prior to nReadFrame were consumed and may be overwritten
+	// while the ones after it must be kept.
+	const long long nSlot = nWriteFrame % m_nRingFrames;
+	const long long nFrames = std::min( { nReadFrame + m_nRingFrames - nWriteFrame,
+										  m_nFrames - nWriteFrame,
+										  m_nRingFrames - nSlot,
+										  static_cast<long long>( nReadChunkFrames ) } );
+	if ( nFrames <= 0 ) {
+		return false;
+	}
+
+	const int nRead = readFromFile( &m_ring_L[ nSlot ], &m_ring_R[ nSlot ],
+									static_cast<int>( nFrames ) );
+	if ( nRead <= 0 ) {
+		return false;
+	}
+
+	m_nWriteFrame.store( nWriteFrame + nRead, std::memory_order_release );
+	return true;
+}
+
+void SampleStream::requestSeek( long long nFrame )
+{
+	m_nReadFrame.store( nFrame, std::memory_order_release );
+	m_nSeekFrame.store( nFrame, std::memory_order_relaxed );
+	m_nSeekRequests.fetch_add( 1, std::memory_order_release );
+}
+
+int SampleStream::read( long long nStartFrame, int nFrames,
+						float* pBuffer_L, float* pBuffer_R,
+						bool bWaitForData )
+{
+	long long nMissing = readAvailable( nStartFrame, nFrames,
+										pBuffer_L, pBuffer_R );
+	if ( bWaitForData ) {
+		const auto timeout = std::chrono::steady_clock::now() +
+			std::chrono::milliseconds( nWaitForDataMilliseconds );
+		while ( nMissing > 0 && std::chrono::steady_clock::now() < timeout ) {
+			std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+			nMissing = readAvailable( nStartFrame, nFrames,
+									  pBuffer_L, pBuffer_R );
+		}
+	}
+
+	if ( nMissing > 0 ) {
+		m_nUnderrunFrames.fetch_add( nMissing, std::memory_order_relaxed );
+	}
+	return static_cast<int>( nMissing );
+}
+
+long long SampleStream::readAvailable( long long nStartFrame, int nFrames,
+									   float* pBuffer_L, float* pBuffer_R )
+{
+	memset( pBuffer_L, 0, nFrames * sizeof( float ) );
+	memset( pBuffer_R, 0, nFrames * sizeof( float ) );
+
+	const long long nEndFrame = nStartFrame + nFrames;
+
+	// Preloaded part
+	const long long nPreloadStart = std::max( nStartFrame, 0LL );
+	const long long nPreloadEnd = std::min( nEndFrame, m_nPreloadFrames );
+	if ( nPreloadStart < nPreloadEnd ) {
+		memcpy( &pBuffer_L[ nPreloadStart - nStartFrame ],
+				&m_preload_L[ nPreloadStart ],
+				( nPreloadEnd - nPreloadStart ) * sizeof( float ) );
+		memcpy( &pBuffer_R[ nPreloadStart - nStartFrame ],
+				&m_preload_R[ nPreloadStart ],
+				( nPreloadEnd - nPreloadStart ) * sizeof( float ) );
+	}
+
+	// Streamed part. Even if all requested frames are preloaded, the
+	// ring buffer is kept positioned at the end of the preloaded part.
+	const long long nStreamStart = std::max( nStartFrame, m_nPreloadFrames );
+	const long long nStreamEnd = std::min( nEndFrame, m_nFrames );
+	if ( nStreamStart >= m_nFrames ) {
+		return 0;
+	}
+
+	// How far ahead of the data already read a position may be to be
+	// caught up with by the reader thread instead of seeking.
+	const long long nSeekThreshold = m_nRingFrames / 2;
+	const long long nRequested = std::max( nStreamEnd - nStreamStart, 0LL );
+
+	const unsigned nRequests = m_nSeekRequests.load( std::memory_order_relaxed );
+	if ( m_nSeeksHandled.load( std::memory_order_acquire ) != nRequests ) {
+		// Reader thread is still busy with the last relocation.
+		const long long nSeekFrame = m_nSeekFrame.load( std::memory_order_relaxed );
+		if ( nStreamStart < nSeekFrame ||
+			 nStreamStart > nSeekFrame + nSeekThreshold ) {
+			requestSeek( nStreamStart );
+		}
+		return nRequested;
+	}
+
+	const long long nRingStart = std::max(
+		m_nRingStartFrame.load( std::memory_order_relaxed ),
+		m_nReadFrame.load( std::memory_order_relaxed ) );
+	const long long nWriteFrame = m_nWriteFrame.load( std::memory_order_acquire );
+	if ( nStreamStart < nRingStart ||
+		 nStreamStart > nWriteFrame + nSeekThreshold ) {
+		// Relocation
+		requestSeek( nStreamStart );
+		return nRequested;
+	}
+
+	long long nFrame = nStreamStart;
+	const long long nAvailableEnd = std::min( nStreamEnd, nWriteFrame );
+	while ( nFrame < nAvailableEnd ) {
+		const long long nSlot = nFrame % m_nRingFrames;
+		const long long nCopy = std::min( nAvailableEnd - nFrame,
+										  m_nRingFrames - nSlot );
+		memcpy( &pBuffer_L[ nFrame - nStartFrame ], &m_ring_L[ nSlot ],
+				nCopy * sizeof( float ) );
+		memcpy( &pBuffer_R[ nFrame - nStartFrame ], &m_ring_R[ nSlot ],
+				nCopy * sizeof( float ) );
+		nFrame += nCopy;
+	}
+
+	// Release all frames prior to the current position.
+	m_nReadFrame.store( std::min( nStreamStart, nWriteFrame ),
+						std::memory_order_release );
+
+	return std::max( nStreamEnd - nAvailableEnd, 0LL );
+}
+
+QString SampleStream::toQString( const QString& sPrefix, bool bShort ) const {
+	QString s = Base::sPrintIndention;
+	QString sOutput;
+	if ( ! bShort ) {
+		sOutput = QString( "%1[SampleStream]\n" ).arg( sPrefix )
+			.append( QString( "%1%2m_sFilepath: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( m_sFilepath ) )
+			.append( QString( "%1%2m_nFrames: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( m_nFrames ) )
+			.append( QString( "%1%2m_nSampleRate: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( m_nSampleRate ) )
+			.append( QString( "%1%2m_nPreloadFrames: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( m_nPreloadFrames ) )
+			.append( QString( "%1%2m_nRingFrames: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( m_nRingFrames ) )
+			.append( QString( "%1%2m_nUnderrunFrames: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( getUnderrunFrames() ) );
+	} else {
+		sOutput = QString( "[SampleStream] m_sFilepath: %1, m_nFrames: %2, m_nSampleRate: %3, m_nPreloadFrames: %4, m_nRingFrames: %5, m_nUnderrunFrames: %6" )
+			.arg( m_sFilepath ).arg( m_nFrames ).arg( m_nSampleRate )
+			.arg( m_nPreloadFrames ).arg( m_nRingFrames )
+			.arg( getUnderrunFrames() );
+	}
+	return sOutput;
+}
+
+};
@@ -0,0 +1,195 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+#ifndef H2C_SAMPLE_STREAM_H
+#define H2C_SAMPLE_STREAM_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <core/Object.h>
+
+#include <sndfile.h>
+
+namespace H2Core
+{
+
+/**
+ * Plays back a long audio file without decoding it into memory as a
+ * whole.
+ *
+ * The first #nPreloadMilliseconds of the file are kept in memory
+ * while the remainder is streamed from disk by a read-ahead thread
+ * into a ring buffer holding #nRingMilliseconds of audio.
+ *
+ * read() is meant to be called by the audio thread. It neither
+ * locks nor allocates nor touches the disk. Frames not available in
+ * time are rendered as silence. Whenever read() is asked for frames
+ * not matching the current read-ahead position - e.g. after a
+ * relocation - the reader thread is told to seek to the new
+ * position.
+ *
+ * read() must always be called from the same thread.
+ *
+ * Only the playback track is streamed so far. Drumkit samples - long
+ * ones included - are still decoded into memory as a whole. They are
+ * played by many voices at once with pitch shifting and random
+ * access, which a single read-ahead position does not cover.
+ *
+ * \ingroup docCore docAudioEngine
+ */
+class SampleStream : public H2Core::Object<SampleStream>
+{
+	H2_OBJECT(SampleStream)
+public:
+	/** Audio kept in memory starting from the very first frame. */
+	static constexpr int nPreloadMilliseconds = 2000;
+	/** Audio buffered ahead of the current read position. */
+	static constexpr int nRingMilliseconds = 4000;
+	/** Number of frames read from disk at once by the reader thread. */
+	static constexpr int nReadChunkFrames = 8192;
+	/** Number of frames covered by a single value of getPeaks(). */
+	static constexpr int nPeakFrames = 256;
+
+	/**
+	 * Opens @a sFilepath, preloads its beginning, computes the
+	 * waveform overview, and starts the read-ahead thread.
+	 *
+	 * \return nullptr in case the file could not be opened.
+	 */
+	static std::shared_ptr<SampleStream> open( const QString& sFilepath );
+
+	/** Stops and joins the read-ahead thread. This may take as long
+	 * as a pending disk access. The last reference to a stream must
+	 * therefore neither be dropped by the audio thread nor while
+	 * holding the AudioEngine lock. */
+	~SampleStream();
+
+	/**
+	 * Copies @a nFrames frames starting at @a nStartFrame of the
+	 * file into @a pBuffer_L and @a pBuffer_R.
+	 *
+	 * @a nStartFrame may be negative or exceed the length of the
+	 * file. Frames outside of the file are silent.
+	 *
+	 * In case @a bWaitForData is set, read() waits for the reader
+	 * thread to provide the frames. This must only be used when
+	 * rendering offline, like while exporting a song.
+	 *
+	 * \return Number of requested frames within the file which
+	 *   were not available yet and had to be replaced by silence.
+	 */
+	int read( long long nStartFrame, int nFrames,
+			  float* pBuffer_L, float* pBuffer_R,
+			  bool bWaitForData = false );
+
+	const QString& getFilepath() const;
+	long long getFrames() const;
+	int getSampleRate() const;
+	long long getPreloadFrames() const;
+	/** Maximum of the left channel - clamped to 0 from below - for
+	 * each #nPeakFrames consecutive frames of the file. */
+	const std::vector<float>& getPeaks() const;
+	/** Number of frames rendered as silence since they were not
+	 * read from disk in time. */
+	long long getUnderrunFrames() const;
+
+	QString toQString( const QString& sPrefix = "", bool bShort = true ) const override;
+
+private:
+	SampleStream( const QString& sFilepath, SNDFILE* pFile,
+				  const SF_INFO& info );
+
+	void readerLoop();
+	/** Fills the ring buffer as far as possible. Returns false if
+	 * nothing was read. */
+	bool fillRing();
+	/** Reads up to @a nFrames frames at the current file position
+	 * into @a pBuffer_L and @a pBuffer_R and returns their number. */
+	int readFromFile( float* pBuffer_L, float* pBuffer_R, int nFrames );
+	void requestSeek( long long nFrame );
+	/** Performs a single attempt of read() and returns the number
+	 * of missing frames. */
+	long long readAvailable( long long nStartFrame, int nFrames,
+							 float* pBuffer_L, float* pBuffer_R );
+
+	QString m_sFilepath;
+	SNDFILE* m_pFile;
+	long long m_nFrames;
+	int m_nSampleRate;
+	int m_nChannels;
+
+	std::vector<float> m_preload_L;
+	std::vector<float> m_preload_R;
+	long long m_nPreloadFrames;
+	std::vector<float> m_peaks;
+
+	/** Ring buffer indexed by frame modulo #m_nRingFrames. */
+	std::vector<float> m_ring_L;
+	std::vector<float> m_ring_R;
+	long long m_nRingFrames;
+	/** Interleaved scratch buffer used by the reader thread. */
+	std::vector<float> m_readBuffer;
+
+	/** Frames before this one may be overwritten by the reader
+	 * thread. Written by the audio thread only. */
+	std::atomic<long long> m_nReadFrame;
+	/** The ring holds all frames in [#m_nRingStartFrame,
+	 * #m_nWriteFrame). Written by the reader thread only. */
+	std::atomic<long long> m_nRingStartFrame;
+	std::atomic<long long> m_nWriteFrame;
+
+	/** Seeks requested by read() and handled by the reader
+	 * thread. The ring content is only valid in case both match. */
+	std::atomic<long long> m_nSeekFrame;
+	std::atomic<unsigned> m_nSeekRequests;
+	std::atomic<unsigned> m_nSeeksHandled;
+
+	std::atomic<long long> m_nUnderrunFrames;
+
+	std::atomic<bool> m_bShutdown;
+	std::thread m_readerThread;
+};
+
+inline const QString& SampleStream::getFilepath() const {
+	return m_sFilepath;
+}
+inline long long SampleStream::getFrames() const {
+	return m_nFrames;
+}
+inline int SampleStream::getSampleRate() const {
+	return m_nSampleRate;
+}
+inline long long SampleStream::getPreloadFrames() const {
+	return m_nPreloadFrames;
+}
+inline const std::vector<float>& SampleStream::getPeaks() const {
+	return m_peaks;
+}
+inline long long SampleStream::getUnderrunFrames() const {
+	return m_nUnderrunFrames.load( std::memory_order_relaxed );
+}
+
+};
+
+#endif
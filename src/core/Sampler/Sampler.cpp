@@ -25,6 +25,7 @@
 #include <cstdlib>
 
 #include <core/IO/AudioOutput.h>
+#include <core/IO/DiskWriterDriver.h>
 #include <core/IO/JackAudioDriver.h>
 
 #include <core/Basics/Adsr.h>
@@ -48,7 +49,12 @@
 #include <core/EventQueue.h>
 
 #include <core/FX/Effects.h>
+#include <core/Sampler/Resample.h>
+#include <core/Sampler/SampleStream.h>
 #include <core/Sampler/Sampler.h>
+#include <core/Sampler/SamplerWorkerPool.h>
+
+#include <algorithm>
 
 #include <iostream>
 #include <QDebug>
@@ -72,6 +78,11 @@ Sampler::Sampler()
 		: m_pMainOut_L( nullptr )
 		, m_pMainOut_R( nullptr )
 		, m_pPreviewInstrument( nullptr )
+		, m_pWorkerPool( nullptr )
+		, m_nRenderFrames( 0 )
+		, m_pOldestVoice( nullptr )
+		, m_pNewestVoice( nullptr )
+		, m_nVoices( 0 )
 		, m_interpolateMode( Interpolation::InterpolateMode::Linear )
 {
 	
@@ -79,8 +90,26 @@ Sampler::Sampler()
 	m_pMainOut_L = new float[ MAX_BUFFER_SIZE ];
 	m_pMainOut_R = new float[ MAX_BUFFER_SIZE ];
 
+	m_serialTarget.pMainOut_L = m_pMainOut_L;
+	m_serialTarget.pMainOut_R = m_pMainOut_R;
+#ifdef H2CORE_HAVE_LADSPA
+	for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+		m_serialTarget.pFXOut_L[ nFX ] = nullptr;
+		m_serialTarget.pFXOut_R[ nFX ] = nullptr;
+	}
+#endif
+	m_serialTarget.bDeferred = false;
+	m_serialTarget.nMidiNoteOns = 0;
+
+	// Sizes the note queues and rendering buffers upfront to avoid
+	// allocations within the realtime thread.
+	setRenderThreads( Preferences::get_instance()->m_nRenderThreads );
+
 	m_nMaxLayers = InstrumentComponent::getMaxLayers();
 
+	INFOLOG( QString( "Using [%1] resample kernel" )
+			 .arg( Resample::KernelToQString( Resample::getKernel() ) ) );
+
 	QString sEmptySampleFilename = Filesystem::empty_sample_path();
 
 	// instrument used in file preview
@@ -97,6 +126,8 @@ Sampler::~Sampler()
 {
 	INFOLOG( "DESTROY" );
 
+	delete m_pWorkerPool;
+
 	delete[] m_pMainOut_L;
 	delete[] m_pMainOut_R;
 
@@ -109,6 +140,94 @@ Sampler::~Sampler()
  */
 float const Sampler::K_NORM_DEFAULT = 1.33333333333333;
 
+void Sampler::setRenderThreads( int nThreads )
+{
+	nThreads = std::clamp( nThreads, 1, 64 );
+	const int nMaxNotes = Preferences::get_instance()->m_nMaxNotes;
+
+	if ( nThreads != getRenderThreads() ) {
+		delete m_pWorkerPool;
+		m_pWorkerPool = nullptr;
+		m_renderTargets.clear();
+
+		if ( nThreads > 1 ) {
+			m_pWorkerPool = new SamplerWorkerPool( nThreads );
+		}
+	}
+
+	// Stolen voices are still fading out while the notes replacing
+	// them are already played.
+	m_playingNotesQueue.reserve( 2 * nMaxNotes );
+	m_queuedNoteOffs.reserve( 2 * nMaxNotes );
+
+	if ( m_pWorkerPool == nullptr ) {
+		return;
+	}
+
+	// All buffers touched during parallel rendering are allocated
+	// upfront.
+#ifdef H2CORE_HAVE_LADSPA
+	const int nBuffers = 2 + 2 * MAX_FX;
+#else
+	const int nBuffers = 2;
+#endif
+	while ( static_cast<int>(m_renderTargets.size()) < nThreads ) {
+		RenderTarget target;
+		if ( m_renderTargets.size() == 0 ) {
+			// The audio thread mixes right into the main output of
+			// the Sampler and the buffers of the effects.
+			target.pMainOut_L = m_pMainOut_L;
+			target.pMainOut_R = m_pMainOut_R;
+#ifdef H2CORE_HAVE_LADSPA
+			for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+				target.pFXOut_L[ nFX ] = nullptr;
+				target.pFXOut_R[ nFX ] = nullptr;
+			}
+#endif
+		} else {
+			target.storage.resize( nBuffers * MAX_BUFFER_SIZE );
+			target.pMainOut_L = &target.storage[ 0 ];
+			target.pMainOut_R = &target.storage[ MAX_BUFFER_SIZE ];
+#ifdef H2CORE_HAVE_LADSPA
+			for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+				target.pFXOut_L[ nFX ] =
+					&target.storage[ ( 2 + 2 * nFX ) * MAX_BUFFER_SIZE ];
+				target.pFXOut_R[ nFX ] =
+					&target.storage[ ( 3 + 2 * nFX ) * MAX_BUFFER_SIZE ];
+			}
+#endif
+		}
+		target.bDeferred = true;
+		target.nMidiNoteOns = 0;
+		target.componentPeaks.reserve( MAX_COMPONENTS );
+		m_renderTargets.push_back( std::move( target ) );
+	}
+
+	// Including the stolen voices still fading out.
+	for ( auto& target : m_renderTargets ) {
+		target.notes.reserve( 2 * nMaxNotes );
+	}
+	m_renderedNoteEnded.resize( std::max( static_cast<int>(m_renderedNoteEnded.size()),
+										  2 * nMaxNotes ) );
+	m_renderedNoteMidiNoteOns.resize( m_renderedNoteEnded.size() );
+	m_instrumentLoads.reserve( nMaxNotes );
+	m_targetLoads.resize( m_renderTargets.size() );
+}
+
+void Sampler::invalidateRenderScheduling()
+{
+	if ( m_pWorkerPool != nullptr ) {
+		m_pWorkerPool->invalidateScheduling();
+	}
+}
+
+int Sampler::getRenderThreads() const {
+	if ( m_pWorkerPool == nullptr ) {
+		return 1;
+	}
+	return m_pWorkerPool->getThreads();
+}
+
 void Sampler::process( uint32_t nFrames )
 {
 	auto pHydrogen = Hydrogen::get_instance();
@@ -121,60 +240,254 @@ void Sampler::process( uint32_t nFrames )
 	memset( m_pMainOut_L, 0, nFrames * sizeof( float ) );
 	memset( m_pMainOut_R, 0, nFrames * sizeof( float ) );
 
-	// Max notes limit
-	int nMaxNotes = Preferences::get_instance()->m_nMaxNotes;
-	while ( ( int )m_playingNotesQueue.size() > nMaxNotes ) {
-		Note * pOldNote = m_playingNotesQueue[ 0 ];
-		m_playingNotesQueue.erase( m_playingNotesQueue.begin() );
-		pOldNote->get_instrument()->dequeue();
-		WARNINGLOG( QString( "Number of playing notes [%1] exceeds maximum [%2]. Dropping note [%3]" )
-					.arg( m_playingNotesQueue.size() ).arg( nMaxNotes )
-					.arg( pOldNote->toQString() ) );
-		delete  pOldNote;	// FIXME: send note-off instead of removing the note from the list?
-	}
-
-	// Render next `nFrames` audio frames of all playing notes.
-	unsigned i = 0;
-	Note* pNote;
-	while ( i < m_playingNotesQueue.size() ) {
-		pNote = m_playingNotesQueue[ i ];
-		if ( renderNote( pNote, nFrames ) ) {
+	auto pNotePool = pHydrogen->getAudioEngine()->getNotePool();
+
+	// Max notes limit. noteOn() already keeps the number of voices
+	// within Preferences::m_nMaxNotes by fading out stolen ones. Only
+	// in case notes are triggered faster than those fade out, the
+	// oldest ones are dropped right away.
+	const int nMaxQueuedNotes = 2 * Preferences::get_instance()->m_nMaxNotes;
+	const int nExcessNotes = static_cast<int>(m_playingNotesQueue.size()) - nMaxQueuedNotes;
+	if ( nExcessNotes > 0 ) {
+		RT_WARNINGLOG( "Number of playing notes [%1] exceeds maximum [%2]. Dropping [%3] oldest notes",
+					   m_playingNotesQueue.size(), nMaxQueuedNotes, nExcessNotes );
+		for ( int nn = 0; nn < nExcessNotes; ++nn ) {
+			Note* pOldNote = m_playingNotesQueue[ nn ];
+			unlinkVoice( pOldNote );
+			pOldNote->get_instrument()->dequeue();
+			pNotePool->release( pOldNote );
+		}
+		m_playingNotesQueue.erase( m_playingNotesQueue.begin(),
+								   m_playingNotesQueue.begin() + nExcessNotes );
+	}
+
+	// Render next `nFrames` audio frames of all playing notes. Finished
+	// notes are moved to the queued note offs while the remaining ones
+	// are compacted in place preserving their order.
+	if ( m_pWorkerPool != nullptr ) {
+		m_pWorkerPool->updateScheduling();
+	}
+	const bool bParallel = m_pWorkerPool != nullptr &&
+		! m_pWorkerPool->isSerial() &&
+		m_playingNotesQueue.size() > 1 &&
+		m_playingNotesQueue.size() <= m_renderedNoteEnded.size();
+	if ( bParallel ) {
+		renderNotesParallel( nFrames );
+	}
+
+	size_t nKept = 0;
+	for ( size_t ii = 0; ii < m_playingNotesQueue.size(); ++ii ) {
+		Note* pNote = m_playingNotesQueue[ ii ];
+		bool bEnded;
+		if ( bParallel ) {
+			bEnded = m_renderedNoteEnded[ ii ];
+		} else {
+			bEnded = renderNote( pNote, nFrames, m_serialTarget );
+		}
+
+		if ( bEnded ) {
 			// End of note was reached during rendering.
-			m_playingNotesQueue.erase( m_playingNotesQueue.begin() + i );
+			unlinkVoice( pNote );
 			pNote->get_instrument()->dequeue();
 			m_queuedNoteOffs.push_back( pNote );
 		} else {
-			// As finished notes are poped above 
-			++i;
+			m_playingNotesQueue[ nKept ] = pNote;
+			++nKept;
 		}
 	}
+	m_playingNotesQueue.resize( nKept );
 
 	if ( m_queuedNoteOffs.size() > 0 ) {
 		MidiOutput* pMidiOut = pHydrogen->getMidiOutput();
-		if ( pMidiOut != nullptr ) {
+		for ( const auto& pNote : m_queuedNoteOffs ) {
 			//Queue midi note off messages for notes that have a length specified for them
-			while ( ! m_queuedNoteOffs.empty() ) {
-				pNote =  m_queuedNoteOffs[0];
-		
-				if ( ! pNote->get_instrument()->is_muted() ){
-					pMidiOut->handleQueueNoteOff(
-						pNote->get_instrument()->get_midi_out_channel(), 
-						pNote->get_midi_key(),
-						pNote->get_midi_velocity() );
+			if ( pMidiOut != nullptr && ! pNote->get_instrument()->is_muted() ){
+				pMidiOut->handleQueueNoteOff(
+					pNote->get_instrument()->get_midi_out_channel(), 
+					pNote->get_midi_key(),
+					pNote->get_midi_velocity() );
+			}
+
+			pNotePool->release( pNote );
+		}
+		m_queuedNoteOffs.clear();
+	}
+
+	processPlaybackTrack(nFrames);
+}
+
+void Sampler::renderNotesParallel( uint32_t nFrames )
+{
+	const int nNotes = m_playingNotesQueue.size();
+	const int nTargets = m_renderTargets.size();
+
+	for ( const auto& pNote : m_playingNotesQueue ) {
+		selectLayers( pNote );
+	}
+
+	// Distribute the instruments among the targets. The ones with the
+	// most work are handled first and assigned to the target with the
+	// least work so far (longest processing time first). Sorting
+	// ties by the position of their first note keeps the assignment
+	// deterministic.
+	//
+	// Instruments are grouped by their id since the JACK per track
+	// output ports are assigned by id too. This way an instrument of
+	// a replaced drumkit still fading out is rendered by the same
+	// thread as the one of the new kit writing into the same port.
+	m_instrumentLoads.clear();
+	for ( int ii = 0; ii < nNotes; ++ii ) {
+		auto pInstr = m_playingNotesQueue[ ii ]->get_instrument();
+		const int nLoad = std::max( pInstr->get_components()->size(),
+									static_cast<size_t>(1) );
+		bool bFound = false;
+		for ( auto& load : m_instrumentLoads ) {
+			if ( load.nId == pInstr->get_id() ) {
+				load.nLoad += nLoad;
+				bFound = true;
+				break;
+			}
+		}
+		if ( ! bFound ) {
+			m_instrumentLoads.push_back( { pInstr->get_id(), ii, nLoad, 0 } );
+		}
+	}
+	std::sort( m_instrumentLoads.begin(), m_instrumentLoads.end(),
+			   []( const InstrumentLoad& a, const InstrumentLoad& b ) {
+				   if ( a.nLoad != b.nLoad ) {
+					   return a.nLoad > b.nLoad;
+				   }
+				   return a.nFirstNote < b.nFirstNote; } );
+
+	for ( int nn = 0; nn < nTargets; ++nn ) {
+		m_targetLoads[ nn ] = 0;
+		m_renderTargets[ nn ].notes.clear();
+		m_renderTargets[ nn ].componentPeaks.clear();
+	}
+	for ( auto& load : m_instrumentLoads ) {
+		if ( load.nId < 0 ) {
+			// Preview and metronome instrument are not assigned a JACK
+			// per track output port. Render them on the audio thread.
+			load.nTarget = 0;
+		} else {
+			load.nTarget = static_cast<int>(
+				std::min_element( m_targetLoads.begin(), m_targetLoads.end() ) -
+				m_targetLoads.begin() );
+		}
+		m_targetLoads[ load.nTarget ] += load.nLoad;
+	}
+	for ( int ii = 0; ii < nNotes; ++ii ) {
+		const int nId = m_playingNotesQueue[ ii ]->get_instrument()->get_id();
+		for ( const auto& load : m_instrumentLoads ) {
+			if ( load.nId == nId ) {
+				m_renderTargets[ load.nTarget ].notes.push_back( ii );
+				break;
+			}
+		}
+	}
+
+	m_nRenderFrames = nFrames;
+	m_pWorkerPool->run( &Sampler::renderWorker, this );
+
+	// Gather the results in the order of the playing notes queue.
+#ifdef H2CORE_HAVE_LADSPA
+	auto pEffects = Effects::get_instance();
+#endif
+	for ( int nn = 0; nn < nTargets; ++nn ) {
+		auto& target = m_renderTargets[ nn ];
+		if ( target.notes.size() == 0 ) {
+			continue;
+		}
+
+		if ( nn > 0 ) {
+			for ( uint32_t ii = 0; ii < nFrames; ++ii ) {
+				m_pMainOut_L[ ii ] += target.pMainOut_L[ ii ];
+				m_pMainOut_R[ ii ] += target.pMainOut_R[ ii ];
+			}
+#ifdef H2CORE_HAVE_LADSPA
+			for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+				auto pFX = pEffects->getLadspaFX( nFX );
+				if ( pFX == nullptr ) {
+					continue;
 				}
-		
-				m_queuedNoteOffs.erase( m_queuedNoteOffs.begin() );
-		
-				if ( pNote != nullptr ){
-					delete pNote;
+				for ( uint32_t ii = 0; ii < nFrames; ++ii ) {
+					pFX->m_pBuffer_L[ ii ] += target.pFXOut_L[ nFX ][ ii ];
+					pFX->m_pBuffer_R[ ii ] += target.pFXOut_R[ nFX ][ ii ];
 				}
-		
-				pNote = nullptr;
 			}
+#endif
+		}
+
+		for ( const auto& peak : target.componentPeaks ) {
+			peak.pComponent->set_peak_l(
+				std::max( peak.pComponent->get_peak_l(), peak.fPeak_L ) );
+			peak.pComponent->set_peak_r(
+				std::max( peak.pComponent->get_peak_r(), peak.fPeak_R ) );
 		}
 	}
 
-	processPlaybackTrack(nFrames);
+	auto pMidiOut = Hydrogen::get_instance()->getMidiOutput();
+	if ( pMidiOut != nullptr ) {
+		for ( int ii = 0; ii < nNotes; ++ii ) {
+			for ( int nn = 0; nn < m_renderedNoteMidiNoteOns[ ii ]; ++nn ) {
+				pMidiOut->handleQueueNote( m_playingNotesQueue[ ii ] );
+			}
+		}
+	}
+}
+
+void Sampler::renderWorker( int nWorker, void* pSampler )
+{
+	auto pThis = static_cast<Sampler*>( pSampler );
+	auto& target = pThis->m_renderTargets[ nWorker ];
+	const uint32_t nFrames = pThis->m_nRenderFrames;
+
+	if ( target.notes.size() == 0 ) {
+		return;
+	}
+
+	if ( nWorker > 0 ) {
+		memset( target.pMainOut_L, 0, nFrames * sizeof( float ) );
+		memset( target.pMainOut_R, 0, nFrames * sizeof( float ) );
+#ifdef H2CORE_HAVE_LADSPA
+		auto pEffects = Effects::get_instance();
+		for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
+			if ( pEffects->getLadspaFX( nFX ) != nullptr ) {
+				memset( target.pFXOut_L[ nFX ], 0, nFrames * sizeof( float ) );
+				memset( target.pFXOut_R[ nFX ], 0, nFrames * sizeof( float ) );
+			}
+		}
+#endif
+	}
+
+	for ( const int nIndex : target.notes ) {
+		target.nMidiNoteOns = 0;
+		pThis->m_renderedNoteEnded[ nIndex ] =
+			pThis->renderNote( pThis->m_playingNotesQueue[ nIndex ], nFrames,
+							   target );
+		pThis->m_renderedNoteMidiNoteOns[ nIndex ] = target.nMidiNoteOns;
+	}
+}
+
+void Sampler::selectLayers( Note* pNote )
+{
+	auto pInstr = pNote->get_instrument();
+	if ( pInstr == nullptr ) {
+		return;
+	}
+
+	for ( const auto& pCompo : *pInstr->get_components() ) {
+		if ( pCompo == nullptr ) {
+			continue;
+		}
+		if ( pNote->get_specific_compo_id() != -1 &&
+			 pNote->get_specific_compo_id() != pCompo->get_drumkit_componentID() ) {
+			continue;
+		}
+
+		// Selects a layer in case none was selected yet.
+		pNote->getSample( pCompo->get_drumkit_componentID() );
+	}
 }
 
 bool Sampler::isRenderingNotes() const {
@@ -216,10 +529,145 @@ void Sampler::noteOn(Note *pNote )
 
 	pInstr->enqueue();
 	if ( ! pNote->get_note_off() ){
+		// Make room for the new note.
+		if ( pInstr->m_nMaxVoices > 0 ) {
+			while ( pInstr->m_nVoices >= pInstr->m_nMaxVoices ) {
+				stealVoice( pInstr->m_pOldestVoice );
+			}
+		}
+		const int nMaxNotes = Preferences::get_instance()->m_nMaxNotes;
+		while ( m_nVoices >= nMaxNotes && m_pOldestVoice != nullptr ) {
+			stealVoice( findVoiceToSteal( pInstr ) );
+		}
+
+		linkVoice( pNote );
 		m_playingNotesQueue.push_back( pNote );
 	}
 }
 
+void Sampler::linkVoice( Note* pNote )
+{
+	auto pInstr = pNote->get_instrument();
+
+	pNote->m_bStolen = false;
+	pNote->m_pPrevVoice = m_pNewestVoice;
+	pNote->m_pNextVoice = nullptr;
+	if ( m_pNewestVoice != nullptr ) {
+		m_pNewestVoice->m_pNextVoice = pNote;
+	} else {
+		m_pOldestVoice = pNote;
+	}
+	m_pNewestVoice = pNote;
+	++m_nVoices;
+
+	pNote->m_pPrevInstrumentVoice = pInstr->m_pNewestVoice;
+	pNote->m_pNextInstrumentVoice = nullptr;
+	if ( pInstr->m_pNewestVoice != nullptr ) {
+		pInstr->m_pNewestVoice->m_pNextInstrumentVoice = pNote;
+	} else {
+		pInstr->m_pOldestVoice = pNote;
+	}
+	pInstr->m_pNewestVoice = pNote;
+	++pInstr->m_nVoices;
+}
+
+void Sampler::unlinkVoice( Note* pNote )
+{
+	if ( pNote->m_bStolen ) {
+		return;
+	}
+	auto pInstr = pNote->get_instrument();
+
+	if ( pNote->m_pPrevVoice != nullptr ) {
+		pNote->m_pPrevVoice->m_pNextVoice = pNote->m_pNextVoice;
+	} else {
+		m_pOldestVoice = pNote->m_pNextVoice;
+	}
+	if ( pNote->m_pNextVoice != nullptr ) {
+		pNote->m_pNextVoice->m_pPrevVoice = pNote->m_pPrevVoice;
+	} else {
+		m_pNewestVoice = pNote->m_pPrevVoice;
+	}
+	--m_nVoices;
+
+	if ( pNote->m_pPrevInstrumentVoice != nullptr ) {
+		pNote->m_pPrevInstrumentVoice->m_pNextInstrumentVoice =
+			pNote->m_pNextInstrumentVoice;
+	} else {
+		pInstr->m_pOldestVoice = pNote->m_pNextInstrumentVoice;
+	}
+	if ( pNote->m_pNextInstrumentVoice != nullptr ) {
+		pNote->m_pNextInstrumentVoice->m_pPrevInstrumentVoice =
+			pNote->m_pPrevInstrumentVoice;
+	} else {
+		pInstr->m_pNewestVoice = pNote->m_pPrevInstrumentVoice;
+	}
+	--pInstr->m_nVoices;
+
+	pNote->m_pPrevVoice = nullptr;
+	pNote->m_pNextVoice = nullptr;
+	pNote->m_pPrevInstrumentVoice = nullptr;
+	pNote->m_pNextInstrumentVoice = nullptr;
+}
+
+Note* Sampler::findVoiceToSteal( std::shared_ptr<Instrument> pInstr ) const
+{
+	switch ( Preferences::get_instance()->m_voiceStealing ) {
+	case Preferences::VoiceStealing::released: {
+		int nCandidates = 0;
+		for ( Note* pVoice = m_pOldestVoice;
+			  pVoice != nullptr && nCandidates < nStealCandidates;
+			  pVoice = pVoice->m_pNextVoice, ++nCandidates ) {
+			if ( pVoice->get_adsr()->getState() == ADSR::State::Release ) {
+				return pVoice;
+			}
+		}
+		break;
+	}
+
+	case Preferences::VoiceStealing::quietest: {
+		Note* pQuietest = nullptr;
+		int nCandidates = 0;
+		for ( Note* pVoice = m_pOldestVoice;
+			  pVoice != nullptr && nCandidates < nStealCandidates;
+			  pVoice = pVoice->m_pNextVoice, ++nCandidates ) {
+			// The envelope of notes not rendered yet does not tell
+			// anything about their loudness.
+			if ( ! pVoice->isPartiallyRendered() ) {
+				continue;
+			}
+			if ( pQuietest == nullptr ||
+				 pVoice->get_adsr()->getValue() <
+				 pQuietest->get_adsr()->getValue() ) {
+				pQuietest = pVoice;
+			}
+		}
+		if ( pQuietest != nullptr ) {
+			return pQuietest;
+		}
+		break;
+	}
+
+	case Preferences::VoiceStealing::sameInstrument:
+		if ( pInstr->m_pOldestVoice != nullptr ) {
+			return pInstr->m_pOldestVoice;
+		}
+		break;
+
+	case Preferences::VoiceStealing::oldest:
+		break;
+	}
+
+	return m_pOldestVoice;
+}
+
+void Sampler::stealVoice( Note* pNote )
+{
+	unlinkVoice( pNote );
+	pNote->m_bStolen = true;
+	pNote->get_adsr()->fadeOut( nStealFadeFrames );
+}
+
 void Sampler::midiKeyboardNoteOff( int key )
 {
 	for ( const auto& pNote: m_playingNotesQueue ) {
@@ -508,7 +956,7 @@ void Sampler::handleSongSizeChange() {
 
 //------------------------------------------------------------------
 
-bool Sampler::renderNote( Note* pNote, unsigned nBufferSize )
+bool Sampler::renderNote( Note* pNote, unsigned nBufferSize, RenderTarget& target )
 {
 	auto pHydrogen = Hydrogen::get_instance();
 	auto pSong = pHydrogen->getSong();
@@ -563,9 +1011,9 @@ bool Sampler::renderNote( Note* pNote, unsigned nBufferSize )
 			
 			if ( nBufferSize < nInitialBufferPos ) {
 				// this note is not valid. it's in the future...let's skip it....
-				ERRORLOG( QString( "Note pos in the future?? nFrame: %1, note start: %2, nInitialBufferPos: %3, nBufferSize: %4" )
-						  .arg( nFrame ).arg( pNote->getNoteStart() )
-						  .arg( nInitialBufferPos ).arg( nBufferSize ) );
+				RT_ERRORLOG( "Note pos in the future?? nFrame: %1, note start: %2, nInitialBufferPos: %3, nBufferSize: %4",
+							 nFrame, pNote->getNoteStart(),
+							 nInitialBufferPos, nBufferSize );
 
 				return true;
 			}
@@ -682,9 +1130,9 @@ bool Sampler::renderNote( Note* pNote, unsigned nBufferSize )
 			// harmful. So, we just log a warning if the difference is
 			// larger, which might be caused by a different problem.
 			if ( pSelectedLayer->fSamplePosition >= pSample->get_frames() + 3 ) {
-				WARNINGLOG( QString( "sample position [%1] out of bounds [0,%2]. The layer has been resized during note play?" )
-							.arg( pSelectedLayer->fSamplePosition )
-							.arg( pSample->get_frames() ) );
+				RT_WARNINGLOG( "sample position [%1] out of bounds [0,%2]. The layer has been resized during note play?",
+							   pSelectedLayer->fSamplePosition,
+							   pSample->get_frames() );
 			}
 			returnValues[ ii ] = true;
 			continue;
@@ -766,13 +1214,16 @@ bool Sampler::renderNote( Note* pNote, unsigned nBufferSize )
 		// Once the Sampler does start rendering a note we also push
 		// it to all connected MIDI devices.
 		if ( (int) pSelectedLayer->fSamplePosition == 0  && ! pInstr->is_muted() ) {
-			if ( pHydrogen->getMidiOutput() != nullptr ){
+			if ( target.bDeferred ) {
+				++target.nMidiNoteOns;
+			}
+			else if ( pHydrogen->getMidiOutput() != nullptr ){
 				pHydrogen->getMidiOutput()->handleQueueNote( pNote );
 			}
 		}
 
 		// Actual rendering.
-		returnValues[ ii ] = renderNoteResample( pSample, pNote, pSelectedLayer, pCompo, pMainCompo, nBufferSize, nInitialBufferPos, fCost_L, fCost_R, fCostTrack_L, fCostTrack_R, fLayerPitch );
+		returnValues[ ii ] = renderNoteResample( pSample, pNote, pSelectedLayer, pCompo, pMainCompo, nBufferSize, nInitialBufferPos, fCost_L, fCost_R, fCostTrack_L, fCostTrack_R, fLayerPitch, target );
 	}
 
 	for ( const auto& bReturnValue : returnValues ) {
@@ -805,147 +1256,6 @@ void copySample( float *__restrict__ pBuffer_L, float *__restrict__ pBuffer_R,
 	}
 }
 
-/// Interpolate stereo samples into audio buffer of different frame rate.
-///
-/// Acquiring the frames to interpolate from the input sample data in a safe
-/// manner is surprisingly costly since up to 4 input frames must be fetched
-/// for each output frame, and each must be bounds-checked.
-///
-/// To handle this efficiently, we define a "safe" frame acquisition method
-/// with bounds checking on each frame and providing a silent frame outside
-/// the sample data boundaries, as well as a "fast" path which assumes
-/// it can read all the necessary samples without bounds checking or flow
-/// control.
-///
-/// The output frames are partitioned into three ranges, corresponding to the
-/// beginning, "middle" and end of the input sample data, so that the fast
-/// method can be used for the majority of the sample, and the safe method for
-/// the beginning and ends.
-///
-/// Although not all input frames are needed for each interpolation method
-/// (linear requires only two), the interpolation mode is a constant parameter
-/// and so the compiler wil remove accesses and some unnecessary bounds
-/// checking where it's not needed, without having to hand-write
-/// specialisations for each.
-///
-template < Interpolation::InterpolateMode mode >
-void resample( float *__restrict__ pBuffer_L, float *__restrict__ pBuffer_R,
-			   float *__restrict__ pSample_data_L, float *__restrict__ pSample_data_R,
-			   int nFrames, double &fSamplePos, float fStep, int nSampleFrames )
-{
-	auto getSampleFrames = [&](	int nSamplePos,
-								float &l0, float &l1, float &l2, float &l3,
-								float &r0, float &r1, float &r2, float &r3 ) {
-		l0 = l1 = l2 = l3 = r0 = r1 = r2 = r3 = 0.0;
-		// Some required frames are off the beginning or end of the sample.
-		if ( nSamplePos >= 1 && nSamplePos < nSampleFrames + 1 ) {
-			l0 = pSample_data_L[ nSamplePos-1 ];
-			r0 = pSample_data_R[ nSamplePos-1 ];
-		}
-		// Each successive frame may be past the end of the sample so check individually.
-		if ( nSamplePos < nSampleFrames ) {
-			l1 = pSample_data_L[ nSamplePos ];
-			r1 = pSample_data_R[ nSamplePos ];
-			if ( nSamplePos+1 < nSampleFrames ) {
-				l2 = pSample_data_L[ nSamplePos+1 ];
-				r2 = pSample_data_R[ nSamplePos+1 ];
-				if ( nSamplePos+2 < nSampleFrames ) {
-					l3 = pSample_data_L[ nSamplePos+2 ];
-					r3 = pSample_data_R[ nSamplePos+2 ];
-				}
-			}
-		}
-	};
-
-	float fVal_L, fVal_R;
-	int nFrame;
-	float l0, l1, l2, l3, r0, r1, r2, r3;
-
-	// Initial safe iterations to avoid reading off the beginning of the sample
-	for ( nFrame = 0; nFrame < nFrames; nFrame++) {
-		int nSamplePos = static_cast<int>(fSamplePos);
-		if (nSamplePos >= 1)
-			break;
-		double fDiff = fSamplePos - nSamplePos;
-		getSampleFrames( 0, l0, l1, l2, l3, r0, r1, r2, r3);
-
-		fVal_L = Interpolation::interpolate<mode>( l0, l1, l2, l3, fDiff );
-		fVal_R = Interpolation::interpolate<mode>( r0, r1, r2, r3, fDiff );
-		pBuffer_L[nFrame] = fVal_L;
-		pBuffer_R[nFrame] = fVal_R;
-		fSamplePos += fStep;
-	}
-
-	// Fast iterations for main body of sample, with unconditional sample lookup
-	int nFastFrames = std::min( nFrames,
-								static_cast<int>( ( nSampleFrames - 2 - fSamplePos ) /  fStep ) );
-	for ( ; nFrame < nFastFrames; nFrame++) {
-		int nSamplePos = static_cast<int>(fSamplePos);
-		double fDiff = fSamplePos - nSamplePos;
-		// Gather frame samples
-		l0 = pSample_data_L[ nSamplePos-1 ];
-		l1 = pSample_data_L[ nSamplePos ];
-		l2 = pSample_data_L[ nSamplePos+1 ];
-		l3 = pSample_data_L[ nSamplePos+2 ];
-		r0 = pSample_data_R[ nSamplePos-1 ];
-		r1 = pSample_data_R[ nSamplePos ];
-		r2 = pSample_data_R[ nSamplePos+1 ];
-		r3 = pSample_data_R[ nSamplePos+2 ];
-		fVal_L = Interpolation::interpolate<mode>( l0, l1, l2, l3, fDiff );
-		fVal_R = Interpolation::interpolate<mode>( r0, r1, r2, r3, fDiff );
-		pBuffer_L[nFrame] = fVal_L;
-		pBuffer_R[nFrame] = fVal_R;
-		fSamplePos += fStep;
-	}
-
-	for ( ; nFrame < nFrames; nFrame++ ) {
-		int nSamplePos = static_cast<int>(fSamplePos);
-		double fDiff = fSamplePos - nSamplePos;
-		getSampleFrames( nSamplePos, l0, l1, l2, l3, r0, r1, r2, r3);
-		fVal_L = Interpolation::interpolate<mode>( l0, l1, l2, l3, fDiff );
-		fVal_R = Interpolation::interpolate<mode>( r0, r1, r2, r3, fDiff );
-		pBuffer_L[nFrame] = fVal_L;
-		pBuffer_R[nFrame] = fVal_R;
-		fSamplePos += fStep;
-	}
-}
-
-/// Resample with runtime-selection of interpolation mode
-void resample( Interpolation::InterpolateMode mode,
-			   float *__restrict__ pBuffer_L, float *__restrict__ pBuffer_R,
-			   float *__restrict__ pSample_data_L, float *__restrict__ pSample_data_R,
-			   int nFrames, double &fSamplePos, float fStep, int nSampleFrames )
-{
-
-	switch (mode) {
-	case Interpolation::InterpolateMode::Linear:
-		resample< Interpolation::InterpolateMode::Linear >
-			( pBuffer_L, pBuffer_R, pSample_data_L, pSample_data_R,
-			  nFrames, fSamplePos, fStep, nSampleFrames );
-		break;
-	case Interpolation::InterpolateMode::Cosine:
-		resample< Interpolation::InterpolateMode::Cosine >
-			( pBuffer_L, pBuffer_R, pSample_data_L, pSample_data_R,
-			  nFrames, fSamplePos, fStep, nSampleFrames );
-		break;
-	case Interpolation::InterpolateMode::Third:
-		resample< Interpolation::InterpolateMode::Third >
-			( pBuffer_L, pBuffer_R, pSample_data_L, pSample_data_R,
-			  nFrames, fSamplePos, fStep, nSampleFrames );
-		break;
-	case Interpolation::InterpolateMode::Cubic:
-		resample< Interpolation::InterpolateMode::Cubic >
-			( pBuffer_L, pBuffer_R, pSample_data_L, pSample_data_R,
-			  nFrames, fSamplePos, fStep, nSampleFrames );
-		break;
-	case Interpolation::InterpolateMode::Hermite:
-		resample< Interpolation::InterpolateMode::Hermite >
-			( pBuffer_L, pBuffer_R, pSample_data_L, pSample_data_R,
-			  nFrames, fSamplePos, fStep, nSampleFrames );
-		break;
-	}
-}
-
 bool Sampler::processPlaybackTrack(int nBufferSize)
 {
 	Hydrogen* pHydrogen = Hydrogen::get_instance();
@@ -970,26 +1280,15 @@ bool Sampler::processPlaybackTrack(int nBufferSize)
 		return true;
 	}
 
-	const auto pCompo = m_pPlaybackTrackInstrument->get_components()->front();
-	if ( pCompo == nullptr ) {
-		ERRORLOG( "Invalid component of playback instrument" );
-		return true;
-	}
-
-	auto pSample = pCompo->get_layer(0)->get_sample();
-	if ( pSample == nullptr ) {
-		ERRORLOG( "Unable to process playback track" );
-		EventQueue::get_instance()->push_event( EVENT_ERROR,
-												Hydrogen::ErrorMessages::PLAYBACK_TRACK_INVALID );
-		// Disable the playback track
-		pHydrogen->loadPlaybackTrack( "" );
-		reinitializePlaybackTrack();
+	// Opened and swapped in reinitializePlaybackTrack() while holding
+	// the AudioEngine lock. No reference is taken in here. This way
+	// the stream - which joins its reader thread on destruction - is
+	// never released by the audio thread.
+	SampleStream* pStream = m_pPlaybackTrackStream.get();
+	if ( pStream == nullptr ) {
 		return true;
 	}
 
-	auto pSample_data_L = pSample->get_data_l();
-	auto pSample_data_R = pSample->get_data_r();
-
 	int nAvail_bytes = 0;
 	int	nInitialBufferPos = 0;
 
@@ -997,11 +1296,11 @@ bool Sampler::processPlaybackTrack(int nBufferSize)
 	const long long nFrameOffset =
 		pAudioEngine->getTransportPosition()->getFrameOffsetTempo();
 
-	int nSampleFrames = pSample->get_frames();
-	float fStep = ( float )pSample->get_sample_rate() / pAudioDriver->getSampleRate(); // Adjust for audio driver sample rate
+	const long long nSampleFrames = pStream->getFrames();
+	float fStep = ( float )pStream->getSampleRate() / pAudioDriver->getSampleRate(); // Adjust for audio driver sample rate
 	double fSamplePos = ( nFrame - nFrameOffset ) * fStep;
 
-	nAvail_bytes = std::min( ( int )( ( float )( pSample->get_frames() - fSamplePos ) / fStep ),
+	nAvail_bytes = std::min( ( int )( ( float )( nSampleFrames - fSamplePos ) / fStep ),
 							 nBufferSize );
 
 	int nFinalBufferPos = nInitialBufferPos + nAvail_bytes;
@@ -1010,13 +1309,43 @@ bool Sampler::processPlaybackTrack(int nBufferSize)
 	float buffer_L[ nBufferSize ];
 	float buffer_R[ nBufferSize ];
 
-	if ( pSample->get_sample_rate() == pAudioDriver->getSampleRate() ) {
-		copySample( &buffer_L[ nInitialBufferPos ], &buffer_R[ nInitialBufferPos ], pSample_data_L, pSample_data_R,
-					nBufferSize, fSamplePos, fStep, nSampleFrames );
+	// When exporting a song there is no deadline to meet and the
+	// Sampler waits for the data to be read from disk instead.
+	const bool bOffline = dynamic_cast<DiskWriterDriver*>( pAudioDriver ) != nullptr;
+
+	int nMissingFrames;
+	if ( pStream->getSampleRate() == pAudioDriver->getSampleRate() ) {
+		nMissingFrames = pStream->read(
+			static_cast<long long>( fSamplePos ), nBufferSize,
+			&buffer_L[ nInitialBufferPos ], &buffer_R[ nInitialBufferPos ],
+			bOffline );
 	} else {
-		resample( m_interpolateMode,
-				  &buffer_L[ nInitialBufferPos ], &buffer_R[ nInitialBufferPos ], pSample_data_L, pSample_data_R,
-				  nBufferSize, fSamplePos, fStep, nSampleFrames );
+		// Fetch all frames covered by this cycle - including the ones
+		// required by the interpolation at its borders - from the
+		// stream and resample relative to the first of them.
+		const int nGuardFrames = Sample::Buffer::nGuardFrames;
+		const long long nWindowStart = static_cast<long long>( fSamplePos );
+		const int nWindowFrames =
+			static_cast<int>( std::ceil( nBufferSize * fStep ) ) + 4;
+		float window_L[ nWindowFrames + 2 * nGuardFrames ];
+		float window_R[ nWindowFrames + 2 * nGuardFrames ];
+		nMissingFrames = pStream->read(
+			nWindowStart - nGuardFrames, nWindowFrames + 2 * nGuardFrames,
+			window_L, window_R, bOffline );
+
+		double fWindowPos = fSamplePos - nWindowStart;
+		Resample::resample( m_interpolateMode,
+				  &buffer_L[ nInitialBufferPos ], &buffer_R[ nInitialBufferPos ],
+				  &window_L[ nGuardFrames ], &window_R[ nGuardFrames ],
+				  nBufferSize, fWindowPos, fStep,
+				  static_cast<int>( std::clamp( nSampleFrames - nWindowStart, 0LL,
+												static_cast<long long>( nWindowFrames ) ) ),
+				  nGuardFrames );
+	}
+
+	if ( nMissingFrames > 0 ) {
+		RT_WARNINGLOG( "Playback track not read from disk in time. [%1] frames are missing",
+					   nMissingFrames );
 	}
 
 	// Track peaks and mix in to main output
@@ -1050,7 +1379,8 @@ bool Sampler::renderNoteResample(
 	float fCost_R,
 	float fCostTrack_L,
 	float fCostTrack_R,
-	float fLayerPitch
+	float fLayerPitch,
+	RenderTarget& target
 )
 {
 	auto pHydrogen = Hydrogen::get_instance();
@@ -1094,8 +1424,9 @@ bool Sampler::renderNoteResample(
 		fStep = 1;
 	}
 
-	auto pSample_data_L = pSample->get_data_l();
-	auto pSample_data_R = pSample->get_data_r();
+	const auto& sampleBuffer = pSample->getBuffer();
+	auto pSample_data_L = sampleBuffer.left();
+	auto pSample_data_R = sampleBuffer.right();
 	const int nSampleFrames = pSample->get_frames();
 	// The number of frames of the sample left to process.
 	const int nRemainingFrames = static_cast<int>(
@@ -1153,10 +1484,10 @@ bool Sampler::renderNoteResample(
 				// In case resonance filtering is active the sampler stops
 				// rendering of the sample at the custom note length but lets
 				// the filter itself ring on.
-				ERRORLOG( QString( "Note end located within the previous processing cycle. nNoteEnd: %1, nNoteLength: %2, fSamplePosition: %3, nFinalBufferPos: %4, fStep: %5")
-						  .arg( nNoteEnd ).arg( pSelectedLayerInfo->nNoteLength )
-						  .arg( pSelectedLayerInfo->fSamplePosition )
-						  .arg( nFinalBufferPos ).arg( fStep ) );
+				RT_ERRORLOG( "Note end located within the previous processing cycle. nNoteEnd: %1, nNoteLength: %2, fSamplePosition: %3, nFinalBufferPos: %4, fStep: %5",
+							 nNoteEnd, pSelectedLayerInfo->nNoteLength,
+							 pSelectedLayerInfo->fSamplePosition,
+							 nFinalBufferPos, fStep );
 			}
 			nNoteEnd = 0;
 		}
@@ -1185,13 +1516,26 @@ bool Sampler::renderNoteResample(
 	}
 #endif
 
+	// Per-instrument output written to separate files during export.
+	float* pStemOutL = nullptr;
+	float* pStemOutR = nullptr;
+	if ( pHydrogen->getIsExportSessionActive() ) {
+		auto pDiskWriterDriver = dynamic_cast<DiskWriterDriver*>( pAudioDriver );
+		if ( pDiskWriterDriver != nullptr &&
+			 pDiskWriterDriver->getStems().size() > 0 ) {
+			pStemOutL = pDiskWriterDriver->getStemOut_L( pInstrument );
+			pStemOutR = pDiskWriterDriver->getStemOut_R( pInstrument );
+		}
+	}
+
 	float buffer_L[ nBufferSize ];
 	float buffer_R[ nBufferSize ];
 
 	if ( bResample ) {
-		resample( m_interpolateMode,
+		Resample::resample( m_interpolateMode,
 				  &buffer_L[ nInitialBufferPos ], &buffer_R[ nInitialBufferPos ], pSample_data_L, pSample_data_R,
-				  nFinalBufferPos - nInitialBufferPos, fSamplePos, fStep, nSampleFrames );
+				  nFinalBufferPos - nInitialBufferPos, fSamplePos, fStep, nSampleFrames,
+				  Sample::Buffer::nGuardFrames );
 	} else {
 		copySample( &buffer_L[ nInitialBufferPos ], &buffer_R[ nInitialBufferPos ], pSample_data_L, pSample_data_R,
 					nFinalBufferPos - nInitialBufferPos, fSamplePos, fStep, nSampleFrames );
@@ -1238,12 +1582,17 @@ bool Sampler::renderNoteResample(
 		fVal_L *= fCost_L;
 		fVal_R *= fCost_R;
 
+		if ( pStemOutL != nullptr ) {
+			pStemOutL[nBufferPos] += fVal_L;
+			pStemOutR[nBufferPos] += fVal_R;
+		}
+
 		fSamplePeak_L = std::max( fSamplePeak_L, fVal_L );
 		fSamplePeak_R = std::max( fSamplePeak_R, fVal_R );
 
 		// to main mix
-		m_pMainOut_L[nBufferPos] += fVal_L;
-		m_pMainOut_R[nBufferPos] += fVal_R;
+		target.pMainOut_L[nBufferPos] += fVal_L;
+		target.pMainOut_R[nBufferPos] += fVal_R;
 
 	}
 
@@ -1252,8 +1601,24 @@ bool Sampler::renderNoteResample(
 	pInstrument->set_peak_r( std::max( pInstrument->get_peak_r(), fSamplePeak_R ) );
 
 	// Component peak
-	pDrumCompo->set_peak_l( std::max( pDrumCompo->get_peak_l(), fSamplePeak_L ) );
-	pDrumCompo->set_peak_r( std::max( pDrumCompo->get_peak_r(), fSamplePeak_R ) );
+	if ( target.bDeferred ) {
+		bool bFound = false;
+		for ( auto& peak : target.componentPeaks ) {
+			if ( peak.pComponent == pDrumCompo.get() ) {
+				peak.fPeak_L = std::max( peak.fPeak_L, fSamplePeak_L );
+				peak.fPeak_R = std::max( peak.fPeak_R, fSamplePeak_R );
+				bFound = true;
+				break;
+			}
+		}
+		if ( ! bFound ) {
+			target.componentPeaks.push_back(
+				{ pDrumCompo.get(), fSamplePeak_L, fSamplePeak_R } );
+		}
+	} else {
+		pDrumCompo->set_peak_l( std::max( pDrumCompo->get_peak_l(), fSamplePeak_L ) );
+		pDrumCompo->set_peak_r( std::max( pDrumCompo->get_peak_r(), fSamplePeak_R ) );
+	}
 
 	if ( pInstrument->is_filter_active() && pNote->filter_sustain() ) {
 		// Note is still ringing, do not end.
@@ -1276,8 +1641,10 @@ bool Sampler::renderNoteResample(
 		if ( pFX != nullptr && fLevel != 0.0 ) {
 			fLevel = fLevel * pFX->getVolume();
 
-			float *pBuf_L = pFX->m_pBuffer_L;
-			float *pBuf_R = pFX->m_pBuffer_R;
+			float *pBuf_L = target.pFXOut_L[ nFX ] != nullptr ?
+				target.pFXOut_L[ nFX ] : pFX->m_pBuffer_L;
+			float *pBuf_R = target.pFXOut_R[ nFX ] != nullptr ?
+				target.pFXOut_R[ nFX ] : pFX->m_pBuffer_R;
 
 			float fFXCost_L = fLevel * masterVol;
 			float fFXCost_R = fLevel * masterVol;
@@ -1301,23 +1668,28 @@ bool Sampler::renderNoteResample(
 
 void Sampler::stopPlayingNotes( std::shared_ptr<Instrument> pInstr )
 {
+	auto pNotePool = Hydrogen::get_instance()->getAudioEngine()->getNotePool();
+
 	if ( pInstr ) { // stop all notes using this instrument
 		for ( unsigned i = 0; i < m_playingNotesQueue.size(); ) {
 			Note *pNote = m_playingNotesQueue[ i ];
 			assert( pNote );
 			if ( pNote->get_instrument() == pInstr ) {
-				delete pNote;
+				unlinkVoice( pNote );
 				pInstr->dequeue();
+				pNotePool->release( pNote );
 				m_playingNotesQueue.erase( m_playingNotesQueue.begin() + i );
+			} else {
+				++i;
 			}
-			++i;
 		}
 	} else { // stop all notes
-		// delete all copied notes in the playing notes queue
+		// hand all copied notes in the playing notes queue back
 		for ( unsigned i = 0; i < m_playingNotesQueue.size(); ++i ) {
 			Note *pNote = m_playingNotesQueue[i];
+			unlinkVoice( pNote );
 			pNote->get_instrument()->dequeue();
-			delete pNote;
+			pNotePool->release( pNote );
 		}
 		m_playingNotesQueue.clear();
 	}
@@ -1399,6 +1771,7 @@ void Sampler::reinitializePlaybackTrack()
 	Hydrogen*	pHydrogen = Hydrogen::get_instance();
 	std::shared_ptr<Song> pSong = pHydrogen->getSong();
 	std::shared_ptr<Sample>	pSample;
+	std::shared_ptr<SampleStream> pStream;
 
 	if ( pSong == nullptr ) {
 		ERRORLOG( "No song set yet" );
@@ -1406,13 +1779,35 @@ void Sampler::reinitializePlaybackTrack()
 	}
 
 	if( pHydrogen->getPlaybackTrackState() != Song::PlaybackTrack::Unavailable ){
-		pSample = Sample::load( pSong->getPlaybackTrackFilename() );
+		pStream = SampleStream::open( pSong->getPlaybackTrackFilename() );
+		if ( pStream == nullptr ) {
+			ERRORLOG( "Unable to process playback track" );
+			EventQueue::get_instance()->push_event( EVENT_ERROR,
+													Hydrogen::ErrorMessages::PLAYBACK_TRACK_INVALID );
+			// Disable the playback track
+			pSong->setPlaybackTrackFilename( "" );
+			pSong->setPlaybackTrackEnabled( false );
+		}
+		else {
+			// The audio data is streamed and the sample does not hold
+			// any frames. Length and sample rate are provided by the
+			// stream.
+			pSample = std::make_shared<Sample>( pStream->getFilepath() );
+		}
 	}
 	
 	auto  pPlaybackTrackLayer = std::make_shared<InstrumentLayer>( pSample );
 
+	auto pAudioEngine = pHydrogen->getAudioEngine();
+	pAudioEngine->lock( RIGHT_HERE );
 	m_pPlaybackTrackInstrument->get_components()->front()->set_layer( pPlaybackTrackLayer, 0 );
+	std::swap( m_pPlaybackTrackStream, pStream );
 	m_nPlayBackSamplePosition = 0;
+	pAudioEngine->unlock();
+
+	// The previous stream - and its reader thread - is destroyed
+	// outside of the lock.
+	pStream = nullptr;
 }
 
 };
@@ -24,6 +24,7 @@
 #ifndef SAMPLER_H
 #define SAMPLER_H
 
+#include <core/config.h>
 #include <core/Object.h>
 #include <core/Globals.h>
 #include <core/Sampler/Interpolation.h>
@@ -38,10 +39,12 @@ namespace H2Core
 class Note;
 class Song;
 class Sample;
+class SampleStream;
 class DrumkitComponent;
 class Instrument;
 struct SelectedLayerInfo;
 class InstrumentComponent;
+class SamplerWorkerPool;
 
 ///
 /// Waveform based sampler.
@@ -179,7 +182,14 @@ public:
 	 */
 	bool isRenderingNotes() const;
 	
-	/// Start playing a note
+	/**
+	 * Start playing a note
+	 *
+	 * In case Instrument::m_nMaxVoices notes of the same instrument
+	 * or Preferences::m_nMaxNotes notes in total are already playing,
+	 * a voice chosen according to Preferences::m_voiceStealing is
+	 * faded out to make room for @a pNote.
+	 */
 	void noteOn( Note * pNote );
 
 	/// Stop playing a note.
@@ -209,17 +219,48 @@ public:
 		return m_pPlaybackTrackInstrument;
 	}
 
+	std::shared_ptr<SampleStream> getPlaybackTrackStream() const {
+		return m_pPlaybackTrackStream;
+	}
+
 	Interpolation::InterpolateMode getInterpolateMode() const {
 		return m_interpolateMode;
 	}
 
+	/**
+	 * Sets the number of threads used to render the playing notes,
+	 * including the audio thread itself. With a single thread all
+	 * notes are rendered serially.
+	 *
+	 * Notes are distributed among the threads per instrument id.
+	 * This way all state of an instrument - like its peaks or JACK
+	 * per track output ports - is only accessed by a single thread
+	 * while each thread mixes into a private main out and FX send
+	 * buffer.
+	 *
+	 * Also adapts the internal buffers to
+	 * Preferences::m_nMaxNotes. Allocates memory and spawns threads
+	 * and must thus be called while holding the #AudioEngine lock.
+	 */
+	void setRenderThreads( int nThreads );
+	int getRenderThreads() const;
+	/** Makes the render threads adopt the scheduling of the audio
+	 * thread anew. Has to be called whenever the audio driver was
+	 * started while holding the #AudioEngine lock. */
+	void invalidateRenderScheduling();
+
 	/**
 	 * Loading of the playback track.
 	 *
-	 * The playback track is added to #m_pPlaybackTrackInstrument as a
-	 * new InstrumentLayer containing the loaded Sample. If
-	 * Song::__playback_track_filename is empty, the layer will be
-	 * loaded with a nullptr instead.
+	 * The playback track is not decoded into memory but streamed from
+	 * disk by #m_pPlaybackTrackStream, which also provides its length
+	 * and sample rate. #m_pPlaybackTrackInstrument gets a new
+	 * InstrumentLayer containing an empty Sample which only holds the
+	 * path of the file. If Song::__playback_track_filename is empty or
+	 * can not be opened, the layer will be loaded with a nullptr
+	 * instead.
+	 *
+	 * Must not be called while holding the #AudioEngine lock.
 	 */
 	void reinitializePlaybackTrack();
 
@@ -239,11 +280,16 @@ public:
 	const std::vector<Note*>& getPlayingNotesQueue() const;
 	
 private:
+	/** Inspects the voices. */
+	friend class AudioEngineTests;
+
 	std::vector<Note*> m_playingNotesQueue;
 	std::vector<Note*> m_queuedNoteOffs;
 	
 	/// Instrument used for the playback track feature.
 	std::shared_ptr<Instrument> m_pPlaybackTrackInstrument;
+	/// Streams the audio of the playback track from disk.
+	std::shared_ptr<SampleStream> m_pPlaybackTrackStream;
 
 	/// Instrument used for the preview feature.
 	std::shared_ptr<Instrument> m_pPreviewInstrument;
@@ -256,6 +302,103 @@ private:
 	int m_nMaxLayers;
 	
 	int m_nPlayBackSamplePosition;
+
+	/** Peak of a DrumkitComponent encountered while rendering. */
+	struct ComponentPeak {
+		DrumkitComponent* pComponent;
+		float fPeak_L;
+		float fPeak_R;
+	};
+
+	/**
+	 * Destination of the notes rendered by renderNote().
+	 *
+	 * When rendering serially, the #Sampler mixes right into
+	 * #m_pMainOut_L, #m_pMainOut_R, and the buffers of the LADSPA
+	 * effects. When using several threads, each one of them gets a
+	 * private target which is summed up by process() once all
+	 * threads are done.
+	 */
+	struct RenderTarget {
+		float* pMainOut_L;
+		float* pMainOut_R;
+#ifdef H2CORE_HAVE_LADSPA
+		/** Private FX send buffers. nullptr in case those of the
+		 * LadspaFX are used directly. */
+		float* pFXOut_L[ MAX_FX ];
+		float* pFXOut_R[ MAX_FX ];
+#endif
+		/** Whether peaks of drumkit components - which might be
+		 * shared among instruments - as well as MIDI note on
+		 * messages are recorded in #componentPeaks and
+		 * #nMidiNoteOns instead of being applied right away. This
+		 * keeps them deterministic. */
+		bool bDeferred;
+		std::vector<ComponentPeak> componentPeaks;
+		/** Number of MIDI note on messages deferred for the note
+		 * currently rendered. */
+		int nMidiNoteOns;
+		/** Indices of the notes in #m_playingNotesQueue assigned to
+		 * this target. */
+		std::vector<int> notes;
+		/** Memory backing the private buffers. */
+		std::vector<float> storage;
+	};
+
+	/** Used for serial rendering. */
+	RenderTarget m_serialTarget;
+	/** One target per thread of #m_pWorkerPool. The first one is
+	 * used by the audio thread and mixes into #m_pMainOut_L and
+	 * #m_pMainOut_R directly. */
+	std::vector<RenderTarget> m_renderTargets;
+	SamplerWorkerPool* m_pWorkerPool;
+	/** Whether the note with the same index in #m_playingNotesQueue
+	 * did end during parallel rendering. */
+	std::vector<char> m_renderedNoteEnded;
+	/** Number of MIDI note on messages to send for the note with the
+	 * same index in #m_playingNotesQueue. */
+	std::vector<int> m_renderedNoteMidiNoteOns;
+	/** Scratch space used to distribute notes per instrument id. */
+	struct InstrumentLoad {
+		int nId;
+		int nFirstNote;
+		int nLoad;
+		int nTarget;
+	};
+	std::vector<InstrumentLoad> m_instrumentLoads;
+	/** Scratch space holding the work assigned to each of
+	 * #m_renderTargets. */
+	std::vector<int> m_targetLoads;
+	/** Size of the buffer rendered by the worker threads. */
+	uint32_t m_nRenderFrames;
+
+	/** Oldest and newest note in #m_playingNotesQueue not stolen
+	 * yet. The notes in between are linked via Note::m_pNextVoice. */
+	Note* m_pOldestVoice;
+	Note* m_pNewestVoice;
+	/** Number of notes linked in between #m_pOldestVoice and
+	 * #m_pNewestVoice. Notes still fading out after being stolen do
+	 * not count towards Preferences::m_nMaxNotes. */
+	int m_nVoices;
+	/** Number of the oldest voices considered when stealing the
+	 * quietest or a released one. Keeps the cost of noteOn()
+	 * independent of the number of playing notes. */
+	static constexpr int nStealCandidates = 8;
+	/** Length in frames of the fade-out applied to stolen voices. */
+	static constexpr unsigned int nStealFadeFrames = 256;
+
+	/** Appends @a pNote to the voices of the #Sampler and its
+	 * instrument. */
+	void linkVoice( Note* pNote );
+	/** Removes @a pNote from the voices of the #Sampler and its
+	 * instrument. Has no effect for stolen notes. */
+	void unlinkVoice( Note* pNote );
+	/** Picks the voice to make room for a note of @a pInstr according
+	 * to Preferences::m_voiceStealing. */
+	Note* findVoiceToSteal( std::shared_ptr<Instrument> pInstr ) const;
+	/** Unlinks @a pNote and fades it out within #nStealFadeFrames. It
+	 * stays in #m_playingNotesQueue till the fade is done. */
+	void stealVoice( Note* pNote );
 	
 	/** function to direct the computation to the selected pan law function
 	 */
@@ -265,12 +408,30 @@ private:
 
 	bool processPlaybackTrack(int nBufferSize);
 
+	/**
+	 * Renders all notes in #m_playingNotesQueue using #m_pWorkerPool.
+	 *
+	 * Finished notes are marked in #m_renderedNoteEnded.
+	 */
+	void renderNotesParallel( uint32_t nFrames );
+	/** Job executed by each thread of #m_pWorkerPool. */
+	static void renderWorker( int nWorker, void* pSampler );
+	/**
+	 * Selects the layers of all components of @a pNote not selected
+	 * yet.
+	 *
+	 * Layer selection involves random numbers and round robin
+	 * counters shared among instruments. Prior to parallel rendering
+	 * it is thus done upfront and in order.
+	 */
+	void selectLayers( Note* pNote );
+
     /**
 	 * Render a note
 	 *
 	 * @return false - the note is not ended, true - the note is ended
 	 */
-	bool renderNote( Note* pNote, unsigned nBufferSize );
+	bool renderNote( Note* pNote, unsigned nBufferSize, RenderTarget& target );
 
 	Interpolation::InterpolateMode m_interpolateMode;
 
@@ -286,7 +447,8 @@ private:
 		float cost_R,
 		float cost_track_L,
 		float cost_track_R,
-		float fLayerPitch
+		float fLayerPitch,
+		RenderTarget& target
 	);
 };
 
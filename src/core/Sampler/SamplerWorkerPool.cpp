@@ -0,0 +1,263 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+
+#include <core/Sampler/SamplerWorkerPool.h>
+
+#include <algorithm>
+
+#if defined(WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace H2Core
+{
+
+SamplerWorkerPool::Semaphore::Semaphore()
+{
+#if defined(WIN32)
+	m_semaphore = CreateSemaphore( nullptr, 0, LONG_MAX, nullptr );
+#elif defined(__APPLE__)
+	m_semaphore = dispatch_semaphore_create( 0 );
+#else
+	sem_init( &m_semaphore, 0, 0 );
+#endif
+}
+
+SamplerWorkerPool::Semaphore::~Semaphore()
+{
+#if defined(WIN32)
+	CloseHandle( m_semaphore );
+#elif defined(__APPLE__)
+	dispatch_release( m_semaphore );
+#else
+	sem_destroy( &m_semaphore );
+#endif
+}
+
+void SamplerWorkerPool::Semaphore::post()
+{
+#if defined(WIN32)
+	ReleaseSemaphore( m_semaphore, 1, nullptr );
+#elif defined(__APPLE__)
+	dispatch_semaphore_signal( m_semaphore );
+#else
+	sem_post( &m_semaphore );
+#endif
+}
+
+void SamplerWorkerPool::Semaphore::wait()
+{
+#if defined(WIN32)
+	WaitForSingleObject( m_semaphore, INFINITE );
+#elif defined(__APPLE__)
+	dispatch_semaphore_wait( m_semaphore, DISPATCH_TIME_FOREVER );
+#else
+	// Retry in case we got interrupted by a signal.
+	while ( sem_wait( &m_semaphore ) != 0 ) {
+	}
+#endif
+}
+
+SamplerWorkerPool::SamplerWorkerPool( int nThreads )
+	: m_nThreads( std::max( nThreads, 1 ) )
+	, m_bShutdown( false )
+	, m_job( nullptr )
+	, m_pArg( nullptr )
+	, m_nPending( 0 )
+	, m_bSchedulingAdopted( false )
+	, m_bSerial( false )
+{
+	// Worker 0 is the thread calling run().
+	m_starts.reserve( m_nThreads - 1 );
+	m_threads.reserve( m_nThreads - 1 );
+	for ( int nn = 1; nn < m_nThreads; ++nn ) {
+		m_starts.push_back( std::make_unique<Semaphore>() );
+	}
+#if defined(WIN32)
+	m_handles.resize( m_nThreads - 1, nullptr );
+#endif
+	for ( int nn = 1; nn < m_nThreads; ++nn ) {
+		m_threads.emplace_back( &SamplerWorkerPool::workerLoop, this, nn );
+	}
+#if defined(WIN32)
+	// Wait till all workers did register their handles.
+	for ( int nn = 1; nn < m_nThreads; ++nn ) {
+		m_done.wait();
+	}
+#endif
+	INFOLOG( QString( "Rendering notes using [%1] threads" ).arg( m_nThreads ) );
+}
+
+SamplerWorkerPool::~SamplerWorkerPool()
+{
+	m_bShutdown = true;
+	for ( auto& pStart : m_starts ) {
+		pStart->post();
+	}
+	for ( auto& thread : m_threads ) {
+		thread.join();
+	}
+#if defined(WIN32)
+	for ( auto& handle : m_handles ) {
+		if ( handle != nullptr ) {
+			CloseHandle( handle );
+		}
+	}
+#endif
+}
+
+int SamplerWorkerPool::getAvailableCores()
+{
+	return std::max( static_cast<int>(std::thread::hardware_concurrency()), 1 );
+}
+
+void SamplerWorkerPool::updateScheduling()
+{
+	// The thread id covers drivers handing the processing to another
+	// thread. Since ids may be reused, a restart of the driver is
+	// reported via invalidateScheduling() as well.
+	if ( ! m_bSchedulingAdopted ||
+		 m_schedulingThread != std::this_thread::get_id() ) {
+		adoptScheduling();
+	}
+}
+
+void SamplerWorkerPool::run( Job job, void* pArg )
+{
+	if ( m_nThreads == 1 || m_bSerial ) {
+		for ( int nn = 0; nn < m_nThreads; ++nn ) {
+			job( nn, pArg );
+		}
+		return;
+	}
+
+	// Posting the semaphores publishes the job to the workers.
+	m_job = job;
+	m_pArg = pArg;
+	m_nPending.store( m_nThreads - 1, std::memory_order_release );
+	for ( auto& pStart : m_starts ) {
+		pStart->post();
+	}
+
+	job( 0, pArg );
+
+	// The workers run with the same priority as we do. Sleeping
+	// till the last one is done does thus not invert priorities.
+	m_done.wait();
+}
+
+void SamplerWorkerPool::adoptScheduling()
+{
+	m_bSchedulingAdopted = true;
+	m_schedulingThread = std::this_thread::get_id();
+	m_bSerial = false;
+	if ( m_nThreads == 1 ) {
+		return;
+	}
+
+#if defined(WIN32)
+	const int nPriority = GetThreadPriority( GetCurrentThread() );
+	if ( nPriority == THREAD_PRIORITY_ERROR_RETURN ) {
+		m_bSerial = true;
+	}
+	else {
+		for ( auto& handle : m_handles ) {
+			if ( handle == nullptr ||
+				 ! SetThreadPriority( static_cast<HANDLE>(handle), nPriority ) ) {
+				m_bSerial = true;
+				break;
+			}
+		}
+	}
+
+	if ( m_bSerial ) {
+		RT_WARNINGLOG( "Unable to set priority [%1] of the render workers. Rendering notes serially.",
+					   nPriority );
+	}
+#else
+	struct sched_param param;
+	param.sched_priority = 0;
+	int nPolicy = 0;
+	if ( pthread_getschedparam( pthread_self(), &nPolicy, &param ) != 0 ) {
+		m_bSerial = true;
+	}
+	else {
+		for ( auto& thread : m_threads ) {
+			if ( pthread_setschedparam( thread.native_handle(), nPolicy,
+										&param ) != 0 ) {
+				m_bSerial = true;
+				break;
+			}
+		}
+	}
+
+	if ( m_bSerial ) {
+		RT_WARNINGLOG( "Unable to set scheduling policy [%1] and priority [%2] of the render workers. Rendering notes serially.",
+					   nPolicy, param.sched_priority );
+	}
+#endif
+}
+
+void SamplerWorkerPool::workerLoop( int nWorker )
+{
+	auto& start = *m_starts[ nWorker - 1 ];
+#if defined(WIN32)
+	HANDLE handle = nullptr;
+	if ( ! DuplicateHandle( GetCurrentProcess(), GetCurrentThread(),
+							GetCurrentProcess(), &handle, 0, FALSE,
+							DUPLICATE_SAME_ACCESS ) ) {
+		handle = nullptr;
+	}
+	m_handles[ nWorker - 1 ] = handle;
+	m_done.post();
+#endif
+	while ( true ) {
+		start.wait();
+		if ( m_bShutdown ) {
+			return;
+		}
+
+		m_job( nWorker, m_pArg );
+		if ( m_nPending.fetch_sub( 1, std::memory_order_acq_rel ) == 1 ) {
+			m_done.post();
+		}
+	}
+}
+
+QString SamplerWorkerPool::toQString( const QString& sPrefix, bool bShort ) const {
+	QString s = Base::sPrintIndention;
+	QString sOutput;
+	if ( ! bShort ) {
+		sOutput = QString( "%1[SamplerWorkerPool]\n" ).arg( sPrefix )
+			.append( QString( "%1%2m_nThreads: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( m_nThreads ) );
+	} else {
+		sOutput = QString( "[SamplerWorkerPool] m_nThreads: %1" )
+			.arg( m_nThreads );
+	}
+	return sOutput;
+}
+
+};
@@ -0,0 +1,173 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+#ifndef H2C_SAMPLER_WORKER_POOL_H
+#define H2C_SAMPLER_WORKER_POOL_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if defined(WIN32)
+// HANDLE is stored as void* to keep windows.h out of this header.
+#elif defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#else
+#include <semaphore.h>
+#endif
+
+#include <core/Object.h>
+
+namespace H2Core
+{
+
+/**
+ * Set of threads helping the #Sampler to render its playing notes.
+ *
+ * The thread calling run() does take part in the rendering itself
+ * and acts as worker 0. A pool of @a nThreads threads does therefore
+ * only spawn @a nThreads - 1 additional ones. They sleep on a
+ * semaphore while the Sampler is idle. Handing out a job and waiting
+ * for its completion does neither lock a mutex nor allocate.
+ *
+ * updateScheduling() applies the scheduling policy and priority of
+ * the calling thread - usually the realtime audio thread - to all
+ * workers. On Windows only the thread priority is adopted. In case
+ * this fails, waiting for the workers would result in a priority
+ * inversion and run() executes all parts of a job serially in the
+ * calling thread instead (see isSerial()).
+ *
+ * run() must always be called from the same thread. When the audio
+ * driver is restarted, invalidateScheduling() has to be called so
+ * that the scheduling of the new audio thread is adopted.
+ *
+ * \ingroup docCore docAudioEngine
+ */
+class SamplerWorkerPool : public H2Core::Object<SamplerWorkerPool>
+{
+	H2_OBJECT(SamplerWorkerPool)
+public:
+	/** Job executed by every worker. @a nWorker is in [0, getThreads()). */
+	typedef void (*Job)( int nWorker, void* pArg );
+
+	/**
+	 * \param nThreads Total number of threads including the calling
+	 *   one. Values smaller than 1 are treated as 1.
+	 */
+	SamplerWorkerPool( int nThreads );
+	~SamplerWorkerPool();
+
+	int getThreads() const;
+	/** Whether the workers could not adopt the scheduling of the
+	 * thread calling run() and all jobs are executed serially. */
+	bool isSerial() const;
+
+	/**
+	 * Applies the scheduling of the calling thread to all workers
+	 * unless this was already done for this thread and not
+	 * invalidated since. Has to be called by the thread calling run()
+	 * prior to isSerial() and run(). Does neither allocate nor lock
+	 * in case nothing changed.
+	 */
+	void updateScheduling();
+	/** Causes the next call to updateScheduling() to adopt the
+	 * scheduling again. Has to be called while holding the
+	 * #AudioEngine lock. */
+	void invalidateScheduling();
+
+	/**
+	 * Executes @a job on all workers and returns once all of them
+	 * are done. Does neither allocate nor lock.
+	 */
+	void run( Job job, void* pArg );
+
+	/** Number of cores available on the host or 1 if unknown. */
+	static int getAvailableCores();
+
+	QString toQString( const QString& sPrefix = "", bool bShort = true ) const override;
+
+private:
+	/** Thin wrapper around the native counting semaphore of the
+	 * platform. Posting it is safe within realtime threads. */
+	class Semaphore {
+	public:
+		Semaphore();
+		~Semaphore();
+		void post();
+		void wait();
+	private:
+#if defined(WIN32)
+		void* m_semaphore;
+#elif defined(__APPLE__)
+		dispatch_semaphore_t m_semaphore;
+#else
+		sem_t m_semaphore;
+#endif
+	};
+
+	void workerLoop( int nWorker );
+	/** Applies the scheduling of the calling thread to all workers.
+	 * Sets #m_bSerial on failure. */
+	void adoptScheduling();
+#if defined(WIN32)
+	/** Real handles of the workers. Each worker duplicates its own
+	 * pseudo handle on startup since std::thread does not provide a
+	 * native HANDLE with all toolchains. */
+	std::vector<void*> m_handles;
+#endif
+
+	int m_nThreads;
+	std::vector<std::thread> m_threads;
+
+	/** One per worker started by us. Posted for each job. */
+	std::vector<std::unique_ptr<Semaphore>> m_starts;
+	/** Posted by the last worker done with the current job. */
+	Semaphore m_done;
+	std::atomic<bool> m_bShutdown;
+
+	/** Written by run() before posting #m_starts. */
+	Job m_job;
+	void* m_pArg;
+	/** Number of workers not done with the current job yet. */
+	std::atomic<int> m_nPending;
+
+	bool m_bSchedulingAdopted;
+	/** Thread whose scheduling was adopted most recently. */
+	std::thread::id m_schedulingThread;
+	bool m_bSerial;
+};
+
+inline int SamplerWorkerPool::getThreads() const {
+	return m_nThreads;
+}
+
+inline bool SamplerWorkerPool::isSerial() const {
+	return m_bSerial;
+}
+
+inline void SamplerWorkerPool::invalidateScheduling() {
+	m_bSchedulingAdopted = false;
+}
+
+};
+
+#endif
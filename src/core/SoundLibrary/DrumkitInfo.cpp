@@ -0,0 +1,192 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+
+#include <core/SoundLibrary/DrumkitInfo.h>
+
+#include <core/Basics/DrumkitComponent.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentList.h>
+#include <core/Helpers/Xml.h>
+
+namespace H2Core
+{
+
+DrumkitInfo::DrumkitInfo() : m_type( Drumkit::Type::User )
+{
+}
+
+DrumkitInfo::~DrumkitInfo()
+{
+}
+
+std::shared_ptr<DrumkitInfo> DrumkitInfo::fromDrumkit( std::shared_ptr<Drumkit> pDrumkit )
+{
+	if ( pDrumkit == nullptr ) {
+		ERRORLOG( "Invalid drumkit" );
+		return nullptr;
+	}
+
+	auto pInfo = std::make_shared<DrumkitInfo>();
+	pInfo->m_sPath = pDrumkit->getPath();
+	pInfo->m_sName = pDrumkit->getName();
+	pInfo->m_sAuthor = pDrumkit->getAuthor();
+	pInfo->m_sInfo = pDrumkit->getInfo();
+	pInfo->m_license = pDrumkit->getLicense();
+	pInfo->m_sExportName = pDrumkit->getExportName();
+	pInfo->m_type = pDrumkit->getType();
+
+	for ( const auto& pInstrument : *pDrumkit->getInstruments() ) {
+		if ( pInstrument != nullptr ) {
+			pInfo->m_instruments.push_back(
+				{ pInstrument->get_id(), pInstrument->get_name() } );
+		}
+	}
+	for ( const auto& pComponent : *pDrumkit->getComponents() ) {
+		if ( pComponent != nullptr ) {
+			pInfo->m_components << pComponent->get_name();
+		}
+	}
+	for ( const auto& ssType : pDrumkit->getDrumkitMap().getAllTypes() ) {
+		pInfo->m_types.push_back( ssType );
+	}
+	for ( const auto& ssType : pDrumkit->getDrumkitMapFallback().getAllTypes() ) {
+		pInfo->m_types.push_back( ssType );
+	}
+
+	return pInfo;
+}
+
+std::shared_ptr<DrumkitInfo> DrumkitInfo::loadFrom( const XMLNode& node )
+{
+	auto pInfo = std::make_shared<DrumkitInfo>();
+	pInfo->m_sPath = node.read_string( "path", "", false, false, true );
+	pInfo->m_sName = node.read_string( "name", "", false, false, true );
+	if ( pInfo->m_sPath.isEmpty() || pInfo->m_sName.isEmpty() ) {
+		return nullptr;
+	}
+
+	pInfo->m_sAuthor = node.read_string( "author", "", true, true, true );
+	pInfo->m_sInfo = node.read_string( "info", "", true, true, true );
+	pInfo->m_license = License( node.read_string( "license", "", true, true, true ),
+								pInfo->m_sAuthor );
+	pInfo->m_sExportName = node.read_string( "exportName", "", true, true, true );
+
+	// The type depends on the current data folders and permissions
+	// rather than the kit itself. It is not stored in the index.
+	pInfo->m_type = Drumkit::DetermineType( pInfo->m_sPath );
+
+	XMLNode instrumentListNode = node.firstChildElement( "instrumentList" );
+	XMLNode instrumentNode = instrumentListNode.firstChildElement( "instrument" );
+	while ( ! instrumentNode.isNull() ) {
+		pInfo->m_instruments.push_back(
+			{ instrumentNode.read_int( "id", EMPTY_INSTR_ID, false, false, true ),
+			  instrumentNode.read_string( "name", "", false, true, true ) } );
+		instrumentNode = instrumentNode.nextSiblingElement( "instrument" );
+	}
+
+	XMLNode componentListNode = node.firstChildElement( "componentList" );
+	XMLNode componentNode = componentListNode.firstChildElement( "component" );
+	while ( ! componentNode.isNull() ) {
+		pInfo->m_components << componentNode.read_text( true, true );
+		componentNode = componentNode.nextSiblingElement( "component" );
+	}
+
+	XMLNode typeListNode = node.firstChildElement( "typeList" );
+	XMLNode typeNode = typeListNode.firstChildElement( "type" );
+	while ( ! typeNode.isNull() ) {
+		pInfo->m_types.push_back( typeNode.read_text( true, true ) );
+		typeNode = typeNode.nextSiblingElement( "type" );
+	}
+
+	return pInfo;
+}
+
+void DrumkitInfo::saveTo( XMLNode& node ) const
+{
+	node.write_string( "path", m_sPath );
+	node.write_string( "name", m_sName );
+	node.write_string( "author", m_sAuthor );
+	node.write_string( "info", m_sInfo );
+	node.write_string( "license", m_license.getLicenseString() );
+	node.write_string( "exportName", m_sExportName );
+
+	XMLNode instrumentListNode = node.createNode( "instrumentList" );
+	for ( const auto& [ nnId, ssName ] : m_instruments ) {
+		XMLNode instrumentNode = instrumentListNode.createNode( "instrument" );
+		instrumentNode.write_int( "id", nnId );
+		instrumentNode.write_string( "name", ssName );
+	}
+
+	XMLNode componentListNode = node.createNode( "componentList" );
+	for ( const auto& ssComponent : m_components ) {
+		componentListNode.write_string( "component", ssComponent );
+	}
+
+	XMLNode typeListNode = node.createNode( "typeList" );
+	for ( const auto& ssType : m_types ) {
+		typeListNode.write_string( "type", ssType );
+	}
+}
+
+QString DrumkitInfo::toQString( const QString& sPrefix, bool bShort ) const {
+	QString s = Base::sPrintIndention;
+	QString sOutput;
+	if ( ! bShort ) {
+		sOutput = QString( "%1[DrumkitInfo]\n" ).arg( sPrefix )
+			.append( QString( "%1%2m_sPath: %3\n" ).arg( sPrefix ).arg( s ).arg( m_sPath ) )
+			.append( QString( "%1%2m_sName: %3\n" ).arg( sPrefix ).arg( s ).arg( m_sName ) )
+			.append( QString( "%1%2m_sAuthor: %3\n" ).arg( sPrefix ).arg( s ).arg( m_sAuthor ) )
+			.append( QString( "%1%2m_sInfo: %3\n" ).arg( sPrefix ).arg( s ).arg( m_sInfo ) )
+			.append( QString( "%1%2m_license:\n%3" ).arg( sPrefix ).arg( s )
+					 .arg( m_license.toQString( sPrefix + s + s, bShort ) ) )
+			.append( QString( "%1%2m_sExportName: %3\n" ).arg( sPrefix ).arg( s ).arg( m_sExportName ) )
+			.append( QString( "%1%2m_type: %3\n" ).arg( sPrefix ).arg( s )
+					 .arg( Drumkit::TypeToString( m_type ) ) )
+			.append( QString( "%1%2m_instruments:\n" ).arg( sPrefix ).arg( s ) );
+		for ( const auto& [ nnId, ssName ] : m_instruments ) {
+			sOutput.append( QString( "%1%2%2[%3] %4\n" ).arg( sPrefix ).arg( s )
+							.arg( nnId ).arg( ssName ) );
+		}
+		sOutput.append( QString( "%1%2m_components: %3\n" ).arg( sPrefix ).arg( s )
+						.arg( m_components.join( ", " ) ) )
+			.append( QString( "%1%2m_types:\n" ).arg( sPrefix ).arg( s ) );
+		for ( const auto& ssType : m_types ) {
+			sOutput.append( QString( "%1%2%2%3\n" ).arg( sPrefix ).arg( s ).arg( ssType ) );
+		}
+	}
+	else {
+		sOutput = QString( "[DrumkitInfo]" )
+			.append( QString( " m_sPath: %1" ).arg( m_sPath ) )
+			.append( QString( ", m_sName: %1" ).arg( m_sName ) )
+			.append( QString( ", m_sAuthor: %1" ).arg( m_sAuthor ) )
+			.append( QString( ", m_license: %1" ).arg( m_license.getLicenseString() ) )
+			.append( QString( ", m_sExportName: %1" ).arg( m_sExportName ) )
+			.append( QString( ", m_type: %1" ).arg( Drumkit::TypeToString( m_type ) ) )
+			.append( QString( ", m_instruments: %1" ).arg( m_instruments.size() ) )
+			.append( QString( ", m_components: [%1]" ).arg( m_components.join( ", " ) ) )
+			.append( QString( ", m_types: %1\n" ).arg( m_types.size() ) );
+	}
+
+	return sOutput;
+}
+
+};
@@ -0,0 +1,137 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+#ifndef H2C_DRUMKIT_INFO_H
+#define H2C_DRUMKIT_INFO_H
+
+#include <core/Basics/Drumkit.h>
+#include <core/Basics/DrumkitMap.h>
+#include <core/License.h>
+#include <core/Object.h>
+
+#include <QStringList>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace H2Core
+{
+
+class XMLNode;
+
+/**
+ * Metadata of a drumkit as stored in the index of the
+ * #SoundLibraryDatabase.
+ *
+ * It holds everything required to list and filter a kit without
+ * constructing the corresponding #Drumkit - which requires parsing
+ * and validating the whole drumkit.xml as well as creating all its
+ * instruments, components, and layers.
+ */
+/** \ingroup docCore docDataStructure */
+class DrumkitInfo : public H2Core::Object<DrumkitInfo>
+{
+		H2_OBJECT(DrumkitInfo)
+	public:
+		DrumkitInfo();
+		~DrumkitInfo();
+
+		/** Collects the metadata of an already loaded kit. */
+		static std::shared_ptr<DrumkitInfo> fromDrumkit( std::shared_ptr<Drumkit> pDrumkit );
+
+		/** Restores an entry written by saveTo().
+		 *
+		 * \return nullptr in case @a node does not contain a valid
+		 *   entry. */
+		static std::shared_ptr<DrumkitInfo> loadFrom( const XMLNode& node );
+		void saveTo( XMLNode& node ) const;
+
+		const QString& getPath() const;
+		const QString& getName() const;
+		const QString& getAuthor() const;
+		const QString& getInfo() const;
+		const License& getLicense() const;
+		/** Basename used for the drumkit map files of this kit (see
+		 * Drumkit::getExportName()). */
+		const QString& getExportName() const;
+		const Drumkit::Type& getType() const;
+		void setType( const Drumkit::Type& type );
+		/** ID and name of all instruments of the kit. */
+		const std::vector<std::pair<int, QString>>& getInstruments() const;
+		const QStringList& getComponents() const;
+		/** Types of both the drumkit map and its fallback. Duplicates
+		 * are retained on purpose in order to allow
+		 * SoundLibraryDatabase::getAllTypes() to rank them by
+		 * occurrence. */
+		const std::vector<DrumkitMap::Type>& getTypes() const;
+
+		QString toQString( const QString& sPrefix = "", bool bShort = true ) const override;
+
+	private:
+		QString m_sPath;
+		QString m_sName;
+		QString m_sAuthor;
+		QString m_sInfo;
+		License m_license;
+		QString m_sExportName;
+		Drumkit::Type m_type;
+		std::vector<std::pair<int, QString>> m_instruments;
+		QStringList m_components;
+		std::vector<DrumkitMap::Type> m_types;
+};
+
+inline const QString& DrumkitInfo::getPath() const {
+	return m_sPath;
+}
+inline const QString& DrumkitInfo::getName() const {
+	return m_sName;
+}
+inline const QString& DrumkitInfo::getAuthor() const {
+	return m_sAuthor;
+}
+inline const QString& DrumkitInfo::getInfo() const {
+	return m_sInfo;
+}
+inline const License& DrumkitInfo::getLicense() const {
+	return m_license;
+}
+inline const QString& DrumkitInfo::getExportName() const {
+	return m_sExportName;
+}
+inline const Drumkit::Type& DrumkitInfo::getType() const {
+	return m_type;
+}
+inline void DrumkitInfo::setType( const Drumkit::Type& type ) {
+	m_type = type;
+}
+inline const std::vector<std::pair<int, QString>>& DrumkitInfo::getInstruments() const {
+	return m_instruments;
+}
+inline const QStringList& DrumkitInfo::getComponents() const {
+	return m_components;
+}
+inline const std::vector<DrumkitMap::Type>& DrumkitInfo::getTypes() const {
+	return m_types;
+}
+
+};
+
+#endif // H2C_DRUMKIT_INFO_H
@@ -23,18 +23,24 @@
 #include <map>
 #include <set>
 
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+
 #include <core/SoundLibrary/SoundLibraryDatabase.h>
 
 #include <core/Basics/Drumkit.h>
 #include <core/EventQueue.h>
 #include <core/Helpers/Filesystem.h>
+#include <core/Helpers/ParallelFor.h>
 #include <core/Helpers/Xml.h>
 
 namespace H2Core
 {
 
-SoundLibraryDatabase::SoundLibraryDatabase()
+SoundLibraryDatabase::SoundLibraryDatabase() : m_bIndexChanged( false )
 {
+	loadIndex();
 	update();
 }
 
@@ -74,8 +80,6 @@ void SoundLibraryDatabase::update()
 
 void SoundLibraryDatabase::updateDrumkits( bool bTriggerEvent ) {
 
-	m_drumkitDatabase.clear();
-
 	QStringList drumkitPaths;
 	// system drumkits
 	for ( const auto& sDrumkitName : Filesystem::sys_drumkit_list() ) {
@@ -103,27 +107,87 @@ void SoundLibraryDatabase::updateDrumkits( bool bTriggerEvent ) {
 		}
 	}
 
+	// Reuse all kits which did not change since they were indexed. All
+	// others are scanned again.
+	std::map<QString, std::shared_ptr<DrumkitInfo>> drumkitInfos;
+	QStringList changedPaths;
 	for ( const auto& sDrumkitPath : drumkitPaths ) {
-		auto pDrumkit = Drumkit::load( sDrumkitPath );
-		if ( pDrumkit != nullptr ) {
-			if ( m_drumkitDatabase.find( sDrumkitPath ) !=
-				 m_drumkitDatabase.end() ) {
-				ERRORLOG( QString( "A drumkit was already loaded from [%1]. Something went wrong." )
-						  .arg( sDrumkitPath ) );
-				continue;
-			}
+		if ( drumkitInfos.find( sDrumkitPath ) != drumkitInfos.end() ||
+			 changedPaths.contains( sDrumkitPath ) ) {
+			ERRORLOG( QString( "A drumkit was already loaded from [%1]. Something went wrong." )
+					  .arg( sDrumkitPath ) );
+			continue;
+		}
 
-			INFOLOG( QString( "Drumkit [%1] loaded from [%2]" )
-					 .arg( pDrumkit->getName() ).arg( sDrumkitPath ) );
+		const auto it = m_drumkitInfos.find( sDrumkitPath );
+		if ( it != m_drumkitInfos.end() && it->second != nullptr &&
+			 m_signatures[ sDrumkitPath ] ==
+			 drumkitSignature( sDrumkitPath, it->second->getExportName() ) ) {
+			it->second->setType( Drumkit::DetermineType( sDrumkitPath ) );
+			drumkitInfos[ sDrumkitPath ] = it->second;
+		}
+		else {
+			changedPaths << sDrumkitPath;
+		}
+	}
 
-			m_drumkitDatabase[ sDrumkitPath ] = pDrumkit;
-			registerUniqueLabel( sDrumkitPath, pDrumkit );
+	// Kits are independent of each other and are scanned in
+	// parallel. The resulting Drumkit objects are discarded right
+	// away. They will be loaded again once required.
+	const int nChanged = changedPaths.size();
+	std::vector<std::shared_ptr<DrumkitInfo>> scannedInfos( nChanged );
+	std::vector<QString> scannedSignatures( nChanged );
+	parallelFor( nChanged, [&]( int nKit ) {
+		auto pDrumkit = Drumkit::load( changedPaths[ nKit ] );
+		if ( pDrumkit != nullptr ) {
+			scannedInfos[ nKit ] = DrumkitInfo::fromDrumkit( pDrumkit );
+			// Determined after loading as the kit might have been
+			// upgraded in the process.
+			scannedSignatures[ nKit ] = drumkitSignature(
+				changedPaths[ nKit ], pDrumkit->getExportName() );
+		}
+	} );
+
+	for ( int ii = 0; ii < nChanged; ++ii ) {
+		const QString& sDrumkitPath = changedPaths[ ii ];
+		if ( scannedInfos[ ii ] != nullptr ) {
+			INFOLOG( QString( "Drumkit [%1] indexed from [%2]" )
+					 .arg( scannedInfos[ ii ]->getName() ).arg( sDrumkitPath ) );
+			drumkitInfos[ sDrumkitPath ] = scannedInfos[ ii ];
+			m_signatures[ sDrumkitPath ] = scannedSignatures[ ii ];
 		}
 		else {
 			ERRORLOG( QString( "Unable to load drumkit at [%1]" ).arg( sDrumkitPath ) );
+			m_signatures.erase( sDrumkitPath );
 		}
+		// Drop an outdated version.
+		m_drumkitDatabase.erase( sDrumkitPath );
 	}
 
+	// Kits not present on disk anymore
+	for ( const auto& [ ssPath, _ ] : m_drumkitInfos ) {
+		if ( drumkitInfos.find( ssPath ) == drumkitInfos.end() ) {
+			m_drumkitDatabase.erase( ssPath );
+			m_signatures.erase( ssPath );
+			m_bIndexChanged = true;
+		}
+	}
+
+	m_drumkitInfos = drumkitInfos;
+	// Labels are assigned in the order of the paths to keep them
+	// stable across updates.
+	for ( const auto& sDrumkitPath : drumkitPaths ) {
+		const auto it = m_drumkitInfos.find( sDrumkitPath );
+		if ( it != m_drumkitInfos.end() ) {
+			registerUniqueLabel( sDrumkitPath, it->second );
+		}
+	}
+
+	if ( nChanged > 0 ) {
+		m_bIndexChanged = true;
+	}
+	saveIndex();
+
 	if ( bTriggerEvent ) {
 		EventQueue::get_instance()->push_event( EVENT_SOUND_LIBRARY_CHANGED, 0 );
 	}
@@ -133,8 +197,15 @@ void SoundLibraryDatabase::updateDrumkit( const QString& sDrumkitPath, bool bTri
 
 	auto pDrumkit = Drumkit::load( sDrumkitPath );
 	if ( pDrumkit != nullptr ) {
+		auto pInfo = DrumkitInfo::fromDrumkit( pDrumkit );
 		m_drumkitDatabase[ sDrumkitPath ] = pDrumkit;
-		registerUniqueLabel( sDrumkitPath, pDrumkit );
+		m_drumkitInfos[ sDrumkitPath ] = pInfo;
+		m_signatures[ sDrumkitPath ] =
+			drumkitSignature( sDrumkitPath, pInfo->getExportName() );
+		registerUniqueLabel( sDrumkitPath, pInfo );
+
+		m_bIndexChanged = true;
+		saveIndex();
 	}
 	else {
 		ERRORLOG( QString( "Unable to load drumkit at [%1]" ).arg( sDrumkitPath ) );
@@ -170,41 +241,49 @@ std::shared_ptr<Drumkit> SoundLibraryDatabase::getDrumkit( const QString& sDrumk
 		return nullptr;
 	}
 
-	if ( m_drumkitDatabase.find( sDrumkitPath ) ==
-		 m_drumkitDatabase.end() ) {
-
-		// Drumkit is not present in database yet. We attempt to load
-		// and add it.
-		auto pDrumkit = Drumkit::load( sDrumkitPath,
-									   true, // upgrade
-									   false // bSilent
-									   );
-		if ( pDrumkit == nullptr ) {
-			return nullptr;
-		}
+	const auto it = m_drumkitDatabase.find( sDrumkitPath );
+	if ( it != m_drumkitDatabase.end() ) {
+		return it->second;
+	}
 
-		m_customDrumkitPaths << sDrumkitPath;
+	// Drumkit was not materialized yet. We attempt to load it.
+	auto pDrumkit = Drumkit::load( sDrumkitPath,
+								   true, // upgrade
+								   false // bSilent
+								   );
+	if ( pDrumkit == nullptr ) {
+		return nullptr;
+	}
 
-		m_drumkitDatabase[ sDrumkitPath ] = pDrumkit;
-		registerUniqueLabel( sDrumkitPath, pDrumkit );
-		
-		INFOLOG( QString( "Session Drumkit [%1] loaded from [%2]" )
-				  .arg( pDrumkit->getName() )
-				  .arg( sDrumkitPath ) );
+	m_drumkitDatabase[ sDrumkitPath ] = pDrumkit;
 
-		EventQueue::get_instance()->push_event( EVENT_SOUND_LIBRARY_CHANGED, 0 );
-		
+	if ( m_drumkitInfos.find( sDrumkitPath ) != m_drumkitInfos.end() ) {
+		// Kit is already indexed.
 		return pDrumkit;
 	}
-	
-	return m_drumkitDatabase.at( sDrumkitPath );
+
+	m_customDrumkitPaths << sDrumkitPath;
+
+	auto pInfo = DrumkitInfo::fromDrumkit( pDrumkit );
+	m_drumkitInfos[ sDrumkitPath ] = pInfo;
+	m_signatures[ sDrumkitPath ] =
+		drumkitSignature( sDrumkitPath, pInfo->getExportName() );
+	registerUniqueLabel( sDrumkitPath, pInfo );
+
+	INFOLOG( QString( "Session Drumkit [%1] loaded from [%2]" )
+			  .arg( pDrumkit->getName() )
+			  .arg( sDrumkitPath ) );
+
+	EventQueue::get_instance()->push_event( EVENT_SOUND_LIBRARY_CHANGED, 0 );
+
+	return pDrumkit;
 }
 
 void SoundLibraryDatabase::registerUniqueLabel( const QString& sDrumkitPath,
-												std::shared_ptr<Drumkit> pDrumkit ) {
+												std::shared_ptr<DrumkitInfo> pInfo ) {
 
-	QString sLabel = pDrumkit->getName();
-	const auto drumkitType = pDrumkit->getType();
+	QString sLabel = pInfo->getName();
+	const auto drumkitType = pInfo->getType();
 
 	if ( drumkitType == Drumkit::Type::System ) {
 		/*: suffix appended to a drumkit name in order to make in unique.*/
@@ -272,10 +351,10 @@ std::vector<DrumkitMap::Type> SoundLibraryDatabase::getAllTypes() const {
 
 	// All types available
 	std::multiset<DrumkitMap::Type> allTypes;
-	for ( const auto& [ _, ppDrumkit ] : m_drumkitDatabase ) {
-		if ( ppDrumkit != nullptr ) {
-			allTypes.merge( ppDrumkit->getDrumkitMap().getAllTypes() );
-			allTypes.merge( ppDrumkit->getDrumkitMapFallback().getAllTypes() );
+	for ( const auto& [ _, ppInfo ] : m_drumkitInfos ) {
+		if ( ppInfo != nullptr ) {
+			allTypes.insert( ppInfo->getTypes().begin(),
+							 ppInfo->getTypes().end() );
 		}
 	}
 
@@ -321,6 +400,22 @@ void SoundLibraryDatabase::updatePatterns( bool bTriggerEvent )
 	// search patterns user directory
 	loadPatternFromDirectory( Filesystem::patterns_dir() );
 
+	// Drop patterns not present on disk anymore from the index.
+	std::set<QString> patternPaths;
+	for ( const auto& pPatternInfo : m_patternInfoVector ) {
+		patternPaths.insert( pPatternInfo->getPath() );
+	}
+	for ( auto it = m_patternIndex.begin(); it != m_patternIndex.end(); ) {
+		if ( patternPaths.find( it->first ) == patternPaths.end() ) {
+			m_signatures.erase( it->first );
+			it = m_patternIndex.erase( it );
+			m_bIndexChanged = true;
+		} else {
+			++it;
+		}
+	}
+	saveIndex();
+
 	if ( bTriggerEvent ) {
 		EventQueue::get_instance()->push_event( EVENT_SOUND_LIBRARY_CHANGED, 0 );
 	}
@@ -330,10 +425,26 @@ void SoundLibraryDatabase::loadPatternFromDirectory( const QString& sPatternDir
 {
 	foreach ( const QString& sName, Filesystem::pattern_list( sPatternDir ) ) {
 		QString sFile = sPatternDir + sName;
+		const QString sSignature = fileSignature( sFile );
+
+		const auto it = m_patternIndex.find( sFile );
+		if ( it != m_patternIndex.end() &&
+			 m_signatures[ sFile ] == sSignature ) {
+			m_patternInfoVector.push_back( it->second );
+			if ( ! m_patternCategories.contains( it->second->getCategory() ) ) {
+				m_patternCategories << it->second->getCategory();
+			}
+			continue;
+		}
+
 		std::shared_ptr<SoundLibraryInfo> pInfo =
 			std::make_shared<SoundLibraryInfo>();
 
 		if ( pInfo->load( sFile ) ) {
+			m_patternIndex[ sFile ] = pInfo;
+			m_signatures[ sFile ] = sSignature;
+			m_bIndexChanged = true;
+
 			INFOLOG( QString( "Pattern [%1] of category [%2] loaded from [%3]" )
 					 .arg( pInfo->getName() ).arg( pInfo->getCategory() )
 					 .arg( sFile ) );
@@ -347,6 +458,127 @@ void SoundLibraryDatabase::loadPatternFromDirectory( const QString& sPatternDir
 	}
 }
 
+void SoundLibraryDatabase::loadIndex()
+{
+	const QString sIndexFile = Filesystem::sound_library_index_file();
+	if ( ! Filesystem::file_exists( sIndexFile, true ) ) {
+		return;
+	}
+
+	XMLDoc doc;
+	if ( ! doc.read( sIndexFile, nullptr, true ) ) {
+		WARNINGLOG( QString( "Unable to read sound library index [%1]. All items will be scanned again." )
+					.arg( sIndexFile ) );
+		return;
+	}
+
+	XMLNode rootNode = doc.firstChildElement( "sound_library_index" );
+	if ( rootNode.isNull() ||
+		 rootNode.read_int( "version", 0, false, false, true ) != nIndexVersion ) {
+		INFOLOG( QString( "Discarding outdated sound library index [%1]" )
+				 .arg( sIndexFile ) );
+		return;
+	}
+
+	XMLNode drumkitListNode = rootNode.firstChildElement( "drumkitList" );
+	XMLNode drumkitNode = drumkitListNode.firstChildElement( "drumkit" );
+	while ( ! drumkitNode.isNull() ) {
+		auto pInfo = DrumkitInfo::loadFrom( drumkitNode );
+		if ( pInfo != nullptr ) {
+			m_drumkitInfos[ pInfo->getPath() ] = pInfo;
+			m_signatures[ pInfo->getPath() ] =
+				drumkitNode.read_string( "signature", "", false, false, true );
+		}
+		drumkitNode = drumkitNode.nextSiblingElement( "drumkit" );
+	}
+
+	XMLNode patternListNode = rootNode.firstChildElement( "patternList" );
+	XMLNode patternNode = patternListNode.firstChildElement( "pattern" );
+	while ( ! patternNode.isNull() ) {
+		auto pInfo = std::make_shared<SoundLibraryInfo>();
+		if ( pInfo->loadFrom( patternNode ) ) {
+			m_patternIndex[ pInfo->getPath() ] = pInfo;
+			m_signatures[ pInfo->getPath() ] =
+				patternNode.read_string( "signature", "", false, false, true );
+		}
+		patternNode = patternNode.nextSiblingElement( "pattern" );
+	}
+}
+
+void SoundLibraryDatabase::saveIndex()
+{
+	if ( ! m_bIndexChanged ) {
+		return;
+	}
+
+	XMLDoc doc;
+	XMLNode rootNode = doc.set_root( "sound_library_index" );
+	rootNode.write_int( "version", nIndexVersion );
+
+	XMLNode drumkitListNode = rootNode.createNode( "drumkitList" );
+	for ( const auto& [ ssPath, ppInfo ] : m_drumkitInfos ) {
+		if ( ppInfo != nullptr ) {
+			XMLNode drumkitNode = drumkitListNode.createNode( "drumkit" );
+			ppInfo->saveTo( drumkitNode );
+			drumkitNode.write_string( "signature", m_signatures[ ssPath ] );
+		}
+	}
+
+	XMLNode patternListNode = rootNode.createNode( "patternList" );
+	for ( const auto& [ ssPath, ppInfo ] : m_patternIndex ) {
+		if ( ppInfo != nullptr ) {
+			XMLNode patternNode = patternListNode.createNode( "pattern" );
+			ppInfo->saveTo( patternNode );
+			patternNode.write_string( "signature", m_signatures[ ssPath ] );
+		}
+	}
+
+	if ( ! doc.write( Filesystem::sound_library_index_file() ) ) {
+		ERRORLOG( QString( "Unable to write sound library index [%1]" )
+				  .arg( Filesystem::sound_library_index_file() ) );
+		return;
+	}
+
+	m_bIndexChanged = false;
+}
+
+QString SoundLibraryDatabase::drumkitSignature( const QString& sDrumkitPath,
+												const QString& sExportName )
+{
+	// All files Drumkit::load() reads its metadata from.
+	QStringList files;
+	files << Filesystem::drumkit_file( sDrumkitPath );
+
+	QDir drumkitDir( sDrumkitPath );
+	for ( const auto& ssMapFile :
+			  drumkitDir.entryList( { "*" + Filesystem::drumkit_map_ext },
+									QDir::Files, QDir::Name ) ) {
+		files << drumkitDir.filePath( ssMapFile );
+	}
+	files << Filesystem::usr_drumkit_maps_dir() + sExportName +
+		Filesystem::drumkit_map_ext;
+	files << Filesystem::sys_drumkit_maps_dir() + sExportName +
+		Filesystem::drumkit_map_ext;
+
+	QStringList signatures;
+	for ( const auto& ssFile : files ) {
+		signatures << fileSignature( ssFile );
+	}
+
+	return signatures.join( ";" );
+}
+
+QString SoundLibraryDatabase::fileSignature( const QString& sPath )
+{
+	const QFileInfo info( sPath );
+	if ( ! info.exists() ) {
+		return QString();
+	}
+
+	return QString( "%1:%2" )
+		.arg( info.lastModified().toMSecsSinceEpoch() ).arg( info.size() );
+}
+
 QString SoundLibraryDatabase::toQString( const QString& sPrefix, bool bShort ) const {
 	QString s = Base::sPrintIndention;
 	QString sOutput;
@@ -358,6 +590,11 @@ QString SoundLibraryDatabase::toQString( const QString& sPrefix, bool bShort ) c
 							.arg( ssPath ).arg( ddrumkit->toQString( "", true ) ) )
 				.append( QString( "%1%2%2%2mapping:\n" ).arg( sPrefix ).arg( s ) );
 		}
+		sOutput.append( QString( "%1%2m_drumkitInfos:\n" ).arg( sPrefix ).arg( s ) );
+		for ( const auto& [ ssPath, ppInfo ] : m_drumkitInfos ) {
+			sOutput.append( QString( "%1\n" )
+							.arg( ppInfo->toQString( sPrefix + s + s, bShort ) ) );
+		}
 		sOutput.append( QString( "%1%2m_drumkitUniqueLabels:\n" ).arg( sPrefix ).arg( s ) );
 		for ( const auto& [ ssPath, ssLabel ] : m_drumkitUniqueLabels ) {
 			sOutput.append( QString( "%1%2%2%3: %4\n" ).arg( sPrefix ).arg( s )
@@ -389,6 +626,11 @@ QString SoundLibraryDatabase::toQString( const QString& sPrefix, bool bShort ) c
 			sOutput.append( QString( "%1%2%2%3: %4\n" ).arg( sPrefix ).arg( s )
 							.arg( ssPath ).arg( ppDrumkit->getName() ) );
 		}
+		sOutput.append( QString( "%1%2m_drumkitInfos:\n" ).arg( sPrefix ).arg( s ) );
+		for ( const auto& [ ssPath, ppInfo ] : m_drumkitInfos ) {
+			sOutput.append( QString( "%1%2%2%3: %4\n" ).arg( sPrefix ).arg( s )
+							.arg( ssPath ).arg( ppInfo->getName() ) );
+		}
 		sOutput.append( QString( "%1%2m_drumkitUniqueLabels:\n" ).arg( sPrefix ).arg( s ) );
 		for ( const auto& [ ssPath, ssLabel ] : m_drumkitUniqueLabels ) {
 			sOutput.append( QString( "%1%2%2%3: %4\n" ).arg( sPrefix ).arg( s )
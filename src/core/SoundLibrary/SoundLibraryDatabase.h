@@ -25,6 +25,7 @@
 
 #include <core/Basics/Drumkit.h>
 #include <core/Basics/DrumkitMap.h>
+#include <core/SoundLibrary/DrumkitInfo.h>
 #include <core/SoundLibrary/SoundLibraryInfo.h>
 #include <core/Object.h>
 #include <QStringList>
@@ -41,6 +42,12 @@ namespace H2Core
 *
 * This class organizes the metadata of all locally installed soundlibrary items.
 *
+* The metadata of drumkits and patterns is persisted in
+* Filesystem::sound_library_index_file(). During an update only items
+* whose files changed since they were indexed - based on modification
+* time and size - are parsed again. Full #Drumkit objects are only
+* created once they are requested via getDrumkit().
+*
 * @author Sebastian Moors
 *
 */
@@ -73,8 +80,10 @@ class SoundLibraryDatabase :    public H2Core::Object<SoundLibraryDatabase>
 	 *   (containing a drumkit.xml) file as unique identifier.
 	 */
 	std::shared_ptr<Drumkit> getDrumkit( const QString& sDrumkitPath );
-	const std::map<QString, std::shared_ptr<Drumkit>>& getDrumkitDatabase() const {
-		return m_drumkitDatabase;
+	/** Metadata of all drumkits known to the database using their
+	 * absolute paths as keys. */
+	const std::map<QString, std::shared_ptr<DrumkitInfo>>& getDrumkitInfos() const {
+		return m_drumkitInfos;
 	}
 		/** Retrieves an unique label for the kit associated with @a
 		 * sDrumkitPath. This may serve as a more accessible alternative to the
@@ -112,7 +121,9 @@ class SoundLibraryDatabase :    public H2Core::Object<SoundLibraryDatabase>
 	QString toQString( const QString& sPrefix = "", bool bShort = true ) const override;
 
 private:
+	/** Drumkits already materialized by getDrumkit(). */
 	std::map<QString, std::shared_ptr<Drumkit>> m_drumkitDatabase;
+	std::map<QString, std::shared_ptr<DrumkitInfo>> m_drumkitInfos;
 		/** The absolute path to a drumkit folder is not the most accessible way
 		 * to refer to a kit in the GUI. Instead, each kit will also have an
 		 * unique label. It is derived from the name of the drumkit. But as
@@ -126,6 +137,9 @@ private:
 
 	std::vector<std::shared_ptr<SoundLibraryInfo>> m_patternInfoVector;
 	QStringList m_patternCategories;
+		/** Metadata of all indexed patterns using their absolute path as
+		 * key. */
+		std::map<QString, std::shared_ptr<SoundLibraryInfo>> m_patternIndex;
 
 	/**
 	 * List of drumkits the user supplied via CLI or OSC command but
@@ -140,8 +154,27 @@ private:
 		 * system and user drumkti folder. */
 		QStringList m_customDrumkitFolders;
 
+		/** Signatures of all indexed drumkits and patterns using
+		 * their absolute path as key. If the signature of an item
+		 * differs from the one found on disk, it has to be scanned
+		 * again. */
+		std::map<QString, QString> m_signatures;
+		/** Whether the index has to be written to disk. */
+		bool m_bIndexChanged;
+
 		void registerUniqueLabel( const QString& sDrumkitPath,
-							  std::shared_ptr<Drumkit> pDrumkit );
+								  std::shared_ptr<DrumkitInfo> pInfo );
+
+		void loadIndex();
+		void saveIndex();
+		/** Modification time and size of all files the metadata of
+		 * the kit located at @a sDrumkitPath are read from. */
+		static QString drumkitSignature( const QString& sDrumkitPath,
+										 const QString& sExportName );
+		static QString fileSignature( const QString& sPath );
+
+		/** Increment in case the layout of the index file changes. */
+		static constexpr int nIndexVersion = 1;
 };
 }; // namespace H2Core
 
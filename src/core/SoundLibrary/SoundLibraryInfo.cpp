@@ -109,6 +109,40 @@ bool SoundLibraryInfo::load( const QString& sPath ) {
 	return true;
 }
 
+bool SoundLibraryInfo::loadFrom( const XMLNode& node ) {
+	setPath( node.read_string( "path", "", false, false, true ) );
+	setType( node.read_string( "type", "", false, false, true ) );
+	if ( getPath().isEmpty() || getType().isEmpty() ) {
+		return false;
+	}
+
+	setName( node.read_string( "name", "", true, true, true ) );
+	setUrl( node.read_string( "url", "", true, true, true ) );
+	setInfo( node.read_string( "info", "", true, true, true ) );
+	setAuthor( node.read_string( "author", "", true, true, true ) );
+	setCategory( node.read_string( "category", "", true, true, true ) );
+	setLicense( H2Core::License( node.read_string( "license", "", true, true, true ) ) );
+	setImage( node.read_string( "image", "", true, true, true ) );
+	setImageLicense( H2Core::License( node.read_string( "imageLicense", "", true, true, true ) ) );
+	setDrumkitName( node.read_string( "drumkit_name", "", true, true, true ) );
+
+	return true;
+}
+
+void SoundLibraryInfo::saveTo( XMLNode& node ) const {
+	node.write_string( "path", m_sPath );
+	node.write_string( "type", m_sType );
+	node.write_string( "name", m_sName );
+	node.write_string( "url", m_sURL );
+	node.write_string( "info", m_sInfo );
+	node.write_string( "author", m_sAuthor );
+	node.write_string( "category", m_sCategory );
+	node.write_string( "license", m_license.getLicenseString() );
+	node.write_string( "image", m_sImage );
+	node.write_string( "imageLicense", m_imageLicense.getLicenseString() );
+	node.write_string( "drumkit_name", m_sDrumkitName );
+}
+
 SoundLibraryInfo::~SoundLibraryInfo()
 {
 	//default deconstructor
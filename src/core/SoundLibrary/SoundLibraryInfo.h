@@ -30,6 +30,8 @@
 namespace H2Core
 {
 
+class XMLNode;
+
 /**
 * @class SoundLibraryInfo
 *
@@ -57,6 +59,14 @@ class SoundLibraryInfo : public H2Core::Object<SoundLibraryInfo>
 	 * @return `true` on success
 	 */
 		bool load( const QString& sPath );
+	/**
+	 * Reads an entry written by saveTo(). Used to restore the index
+	 * of the #SoundLibraryDatabase without parsing @a sPath again.
+	 *
+	 * @return `true` on success
+	 */
+		bool loadFrom( const XMLNode& node );
+		void saveTo( XMLNode& node ) const;
 
 		const QString& getName() const {
 			return m_sName;
@@ -200,6 +200,15 @@ void AudioEngineInfoForm::updateInfo()
 	// SAMPLER
 	Sampler *pSampler = pAudioEngine->getSampler();
 	sampler_playingNotesLbl->setText(QString( "%1 / %2" ).arg(pSampler->getPlayingNotesNumber()).arg(Preferences::get_instance()->m_nMaxNotes));
+
+	const auto pNotePool = pAudioEngine->getNotePool();
+	sampler_notePoolLbl->setText( QString( "%1 / %2 (%3 %4, %5 %6)" )
+								  .arg( pNotePool->getInUse() )
+								  .arg( pNotePool->getCapacity() )
+								  .arg( tr( "peak" ) )
+								  .arg( pNotePool->getHighWaterMark() )
+								  .arg( tr( "exhausted" ) )
+								  .arg( pNotePool->getExhaustedCount() ) );
 }
 
 
@@ -106,7 +106,7 @@ void SampleWaveDisplay::updateDisplay( const QString& filename )
 
 		float fGain = height() / 2.0 * 1.0;
 
-		auto pSampleData = pNewSample->get_data_l();
+		auto pSampleData = pNewSample->getBuffer().left();
 
 		int nSamplePos =0;
 		int nVal;
@@ -69,6 +69,7 @@ class EventListener
 	virtual void nextShotEvent(){}
 	virtual void midiMapChangedEvent(){}
 	virtual void playlistChangedEvent( int nValue ){ UNUSED( nValue ); }
+	virtual void sampleLoadingProgressEvent( int nValue ){ UNUSED( nValue ); }
 
 		virtual ~EventListener() {}
 };
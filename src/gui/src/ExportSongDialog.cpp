@@ -43,6 +43,7 @@
 #include <core/Timeline.h>
 #include <core/IO/AudioOutput.h>
 #include <core/AudioEngine/AudioEngine.h>
+#include <core/AudioEngine/RubberbandWorker.h>
 #include <core/AudioEngine/TransportPosition.h>
 #include <core/Sampler/Sampler.h>
 #include <core/EventQueue.h>
@@ -306,7 +307,10 @@ void ExportSongDialog::on_okBtn_clicked()
 
 	auto pCommonStrings = HydrogenApp::get_instance()->getCommonStrings();
 
-	QFileInfo fileInfo( exportNameTxt->text() );
+	// The main mix and the stems rendered alongside of it are named
+	// after the validated input.
+	const QString filename = exportNameTxt->text();
+	QFileInfo fileInfo( filename );
 	if ( ! Filesystem::dir_writable( fileInfo.absoluteDir().absolutePath(), false ) ) {
 		QMessageBox::warning( this, "Hydrogen",
 							  pCommonStrings->getFileDialogMissingWritePermissions(),
@@ -395,7 +399,6 @@ void ExportSongDialog::on_okBtn_clicked()
 	if( exportTypeCombo->currentIndex() == EXPORT_TO_SINGLE_TRACK || exportTypeCombo->currentIndex() == EXPORT_TO_BOTH ){
 		m_bExportTrackouts = false;
 
-		QString filename = exportNameTxt->text();
 		if ( fileInfo.exists() == true && m_bQfileDialog == false ) {
 
 			int res;
@@ -414,8 +417,18 @@ void ExportSongDialog::on_okBtn_clicked()
 			}
 		}
 
+		// Unless effects are involved, the separate tracks are
+		// written along with the main mix in a single pass.
+		std::vector<DiskWriterDriver::Stem> stems;
 		if( exportTypeCombo->currentIndex() == EXPORT_TO_BOTH ){
-			m_bExportTrackouts = true;
+			if ( DiskWriterDriver::canRenderStemsInOnePass() ) {
+				stems = DiskWriterDriver::createStems( pSong, filename );
+				if ( ! confirmOverwriteStems( stems ) ) {
+					return;
+				}
+			} else {
+				m_bExportTrackouts = true;
+			}
 		}
 		
 		/* arm all tracks for export */
@@ -429,10 +442,35 @@ void ExportSongDialog::on_okBtn_clicked()
 								   pCommonStrings->getExportSongFailure() );
 			return;
 		}
-		m_pHydrogen->startExportSong( filename );
+		m_pHydrogen->startExportSong( filename, stems );
 		return;
 	}
 
+	if( exportTypeCombo->currentIndex() == EXPORT_TO_SEPARATE_TRACKS &&
+		DiskWriterDriver::canRenderStemsInOnePass() ){
+		const auto stems = DiskWriterDriver::createStems( pSong, filename );
+		if ( stems.size() == 0 || ! confirmOverwriteStems( stems ) ) {
+			return;
+		}
+
+		/* arm all tracks for export */
+		for (auto i = 0; i < pInstrumentList->size(); i++) {
+			pInstrumentList->get(i)->set_currently_exported( true );
+		}
+
+		if ( ! m_pHydrogen->startExportSession( sampleRateCombo->currentText().toInt(),
+												sampleDepthCombo->currentText().toInt()) ) {
+			QMessageBox::critical( this, "Hydrogen",
+								   pCommonStrings->getExportSongFailure() );
+			return;
+		}
+		m_pHydrogen->startExportSong( "", stems );
+		return;
+	}
+
+	// Effects are applied to the mix of all instruments. To get them
+	// into the separate tracks, each instrument is exported in a
+	// pass of its own.
 	if( exportTypeCombo->currentIndex() == EXPORT_TO_SEPARATE_TRACKS ){
 		m_bExportTrackouts = true;
 		m_pHydrogen->startExportSession(sampleRateCombo->currentText().toInt(), sampleDepthCombo->currentText().toInt());
@@ -545,6 +583,24 @@ void ExportSongDialog::exportTracks()
     
 }
 
+bool ExportSongDialog::confirmOverwriteStems( const std::vector<DiskWriterDriver::Stem>& stems )
+{
+	for ( const auto& stem : stems ) {
+		if ( QFile( stem.sFilename ).exists() && ! m_bQfileDialog &&
+			 ! m_bOverwriteFiles ) {
+			int res = QMessageBox::information( this, "Hydrogen", tr( "The file %1 exists. \nOverwrite the existing file?").arg( stem.sFilename ), QMessageBox::Yes | QMessageBox::No | QMessageBox::YesToAll );
+			if ( res == QMessageBox::No ) {
+				return false;
+			}
+			if ( res == QMessageBox::YesToAll ) {
+				m_bOverwriteFiles = true;
+			}
+		}
+	}
+
+	return true;
+}
+
 void ExportSongDialog::closeEvent( QCloseEvent *event ) {
 	UNUSED( event );
 	closeExport();
@@ -561,10 +617,9 @@ void ExportSongDialog::closeExport() {
 	m_bExporting = false;
 	
 	if( m_pPreferences->getRubberBandBatchMode() ){
-		m_pHydrogen->getAudioEngine()->lock( RIGHT_HERE );
-		m_pHydrogen->getSong()->getDrumkit()->recalculateRubberband(
+		m_pHydrogen->getRubberbandWorker()->request(
 			m_pHydrogen->getAudioEngine()->getTransportPosition()->getBpm() );
-		m_pHydrogen->getAudioEngine()->unlock();
+		m_pHydrogen->getRubberbandWorker()->wake();
 	}
 	m_pPreferences->setRubberBandBatchMode( m_bOldRubberbandBatchMode );
 	m_pHydrogen->setIsTimelineActivated( m_bOldTimeLineBPMMode );
@@ -29,6 +29,7 @@
 #include "ui_ExportSongDialog_UI.h"
 #include "EventListener.h"
 #include <core/Object.h>
+#include <core/IO/DiskWriterDriver.h>
 #include <core/Sampler/Sampler.h>
 
 using InterpolateMode = H2Core::Interpolation::InterpolateMode;
@@ -78,6 +79,11 @@ private:
 	QString		findUniqueExportFilenameForInstrument( std::shared_ptr<H2Core::Instrument> pInstrument );
 
 	void		exportTracks();
+	/** Asks the user whether existing files of @a stems should be
+	 * overwritten.
+	 *
+	 * \return false in case the export should be aborted. */
+	bool		confirmOverwriteStems( const std::vector<H2Core::DiskWriterDriver::Stem>& stems );
 	bool 		validateUserInput();
 	QString		createDefaultFilename();
 
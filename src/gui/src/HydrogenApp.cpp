@@ -23,6 +23,7 @@
 #include <core/config.h>
 #include <core/Version.h>
 #include <core/Hydrogen.h>
+#include <core/AudioEngine/SongSwitcher.h>
 #include <core/EventQueue.h>
 #include <core/FX/LadspaFX.h>
 #include <core/Preferences/Preferences.h>
@@ -825,6 +826,16 @@ void HydrogenApp::drumkitLoadedEvent(){
 	}
 }
 
+void HydrogenApp::sampleLoadingProgressEvent( int nValue ) {
+	if ( nValue < 0 ) {
+		showStatusBarMessage( tr( "Loading samples cancelled" ) );
+	}
+	else if ( nValue < 100 ) {
+		showStatusBarMessage( QString( tr( "Loading samples: %1%" ) )
+							  .arg( nValue ) );
+	}
+}
+
 void HydrogenApp::songModifiedEvent()
 {
 	updateWindowTitle();
@@ -843,6 +854,12 @@ void HydrogenApp::onEventQueueTimer()
 
 	Event event;
 	while ( ( event = pQueue->pop_event() ).type != EVENT_NONE ) {
+
+		if ( event.type == EVENT_SWITCH_COMMITTED ) {
+			// Completes a song or drumkit switch in the GUI thread.
+			Hydrogen::get_instance()->getSongSwitcher()->finish();
+			continue;
+		}
 		
 		// Provide the event to all EventListeners registered to
 		// HydrogenApp. By registering itself as EventListener and
@@ -1016,6 +1033,10 @@ void HydrogenApp::onEventQueueTimer()
 				pListener->playlistChangedEvent( event.value );
 				break;
 
+			case EVENT_SAMPLE_LOADING_PROGRESS:
+				pListener->sampleLoadingProgressEvent( event.value );
+				break;
+
 			default:
 				ERRORLOG( QString("[onEventQueueTimer] Unhandled event: %1").arg( event.type ) );
 			}
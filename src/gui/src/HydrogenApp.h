@@ -263,6 +263,7 @@ private slots:
 		 */
 		virtual void updateSongEvent( int nValue ) override;
 	virtual void drumkitLoadedEvent() override;
+	virtual void sampleLoadingProgressEvent( int nValue ) override;
 		void playlistChangedEvent( int nValue ) override;
 		void playlistLoadSongEvent() override;
 	
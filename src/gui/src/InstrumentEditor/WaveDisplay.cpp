@@ -140,7 +140,7 @@ void WaveDisplay::updateDisplay( std::shared_ptr<H2Core::InstrumentLayer> pLayer
 
 		float fGain = height() / 2.0 * pLayer->get_gain();
 
-		auto pSampleData = pLayer->get_sample()->get_data_l();
+		auto pSampleData = pLayer->get_sample()->getBuffer().left();
 
 		int nSamplePos =0;
 		int nVal;
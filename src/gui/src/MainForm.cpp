@@ -99,6 +99,7 @@ MainForm::MainForm( QApplication * pQApplication, const QString& sSongFilename,
 					const QString& sPlaylistFilename )
 	: QMainWindow( nullptr )
 	, m_sPreviousAutoSaveSongFile( "" )
+	, m_nAutosavedSongRevision( -1 )
 {
 	auto pPref = H2Core::Preferences::get_instance();
 	auto pHydrogen = H2Core::Hydrogen::get_instance();
@@ -226,6 +227,8 @@ MainForm::MainForm( QApplication * pQApplication, const QString& sSongFilename,
 
 MainForm::~MainForm()
 {
+	waitForSongAutosave();
+
 	auto pHydrogen = Hydrogen::get_instance();
 	if ( pHydrogen->getAudioEngine()->getState() ==
 		 H2Core::AudioEngine::State::Playing ) {
@@ -756,6 +759,7 @@ void MainForm::action_file_new()
 	// not attempt to recover the autosave file generated while last
 	// working on an empty song but, instead, remove the corresponding
 	// autosave file in order to start fresh.
+	waitForSongAutosave();
 	QFileInfo fileInfo( Filesystem::empty_path( Filesystem::Type::Song ) );
 	QString sBaseName( fileInfo.completeBaseName() );
 	if ( sBaseName.startsWith( "." ) ) {
@@ -896,6 +900,10 @@ bool MainForm::action_file_save( const QString& sNewFilename )
 	if ( pSong == nullptr ) {
 		return false;
 	}
+
+	// Ensure a pending autosave does not end up more recent than the
+	// song itself.
+	waitForSongAutosave();
 	
 	QString sFilename = pSong->getFilename();
 
@@ -2019,9 +2027,20 @@ void MainForm::onAutoSaveTimer()
 	auto pSong = pHydrogen->getSong();
 	auto pPlaylist = pHydrogen->getPlaylist();
 
-	if ( pSong != nullptr && pSong->getIsModified() ) {
-		const QString sOldFilename = pSong->getFilename();
+	// In case the previous autosave is still being written, we try
+	// again next time.
+	bool bSongAutosavePending = false;
+	if ( m_songAutosave.valid() ) {
+		if ( m_songAutosave.wait_for( std::chrono::seconds( 0 ) ) ==
+			 std::future_status::ready ) {
+			waitForSongAutosave();
+		} else {
+			bSongAutosavePending = true;
+		}
+	}
 
+	if ( ! bSongAutosavePending && pSong != nullptr && pSong->getIsModified() &&
+		 pSong->getRevision() != m_nAutosavedSongRevision ) {
 		const QString sAutoSaveFilename = Filesystem::getAutoSaveFilename(
 			Filesystem::Type::Song, pSong->getFilename() );
 		if ( sAutoSaveFilename != m_sPreviousAutoSaveSongFile ) {
@@ -2031,11 +2050,15 @@ void MainForm::onAutoSaveTimer()
 			}
 			m_sPreviousAutoSaveSongFile = sAutoSaveFilename;
 		}
-			
-		pSong->save( sAutoSaveFilename );
 
-		pSong->setFilename( sOldFilename );
-		pSong->setIsModified( true );
+		// Only copying the song is done in the GUI thread.
+		// Serializing and writing it happens in the background.
+		auto pSnapshot = pSong->createSnapshot();
+		m_nAutosavedSongRevision = pSnapshot->getRevision();
+		m_songAutosave = std::async( std::launch::async,
+									 [ pSnapshot, sAutoSaveFilename ]() {
+										 return pSnapshot->save( sAutoSaveFilename );
+									 } );
 	}
 
 	if ( pPlaylist != nullptr && pPlaylist->getIsModified() ) {
@@ -2060,6 +2083,15 @@ void MainForm::onAutoSaveTimer()
 }
 
 
+void MainForm::waitForSongAutosave()
+{
+	if ( m_songAutosave.valid() && ! m_songAutosave.get() ) {
+		// Writing failed. Retry next time even if the song did not
+		// change.
+		m_nAutosavedSongRevision = -1;
+	}
+}
+
 void MainForm::onPlaylistDisplayTimer()
 {
 	auto pHydrogen = Hydrogen::get_instance();
@@ -26,6 +26,7 @@
 #include <QtGui>
 #include <QtWidgets>
 
+#include <future>
 #include <map>
 #include <unistd.h>
 
@@ -312,6 +313,17 @@ public slots:
 	QString m_sPreviousAutoSaveSongFile;
 	QString m_sPreviousAutoSavePlaylistFile;
 
+	/** Writes a snapshot of the current song to its autosave file
+	 * in the background. Reports whether writing succeeded. */
+	std::future<bool> m_songAutosave;
+	/** H2Core::Song::getRevision() of the song snapshot written by
+	 * #m_songAutosave. Used to skip autosaving unchanged songs. */
+	long m_nAutosavedSongRevision;
+	/** Blocks till a pending background autosave of the song is
+	 * written. Has to be called before touching autosave files or
+	 * the song file itself. */
+	void waitForSongAutosave();
+
 	/**
 	 * Maps an incoming @a pKeyEvent to actions via #Shortcuts
 	 *
@@ -51,7 +51,9 @@
 #include <math.h>
 #include <cassert>
 #include <algorithm>
+#include <map>
 #include <stack>
+#include <vector>
 
 using namespace H2Core;
 
@@ -399,9 +401,9 @@ void DrumPatternEditor::addOrDeleteNoteAction(	int nColumn,
 	if ( isDelete ) {
 
 		// Find and delete an existing (matching) note.
-		Pattern::notes_t *notes = (Pattern::notes_t *)pPattern->get_notes();
+		const Pattern::notes_t *notes = pPattern->get_notes();
 		bool bFound = false;
-		FOREACH_NOTE_IT_BOUND_END( notes, it, nColumn ) {
+		FOREACH_NOTE_CST_IT_BOUND_END( notes, it, nColumn ) {
 			Note *pNote = it->second;
 			if ( pNote == nullptr ) {
 				ERRORLOG( "Invalid note" );
@@ -413,7 +415,7 @@ void DrumPatternEditor::addOrDeleteNoteAction(	int nColumn,
 					 pNote->get_octave() == oldOctaveKeyVal &&
 					 pNote->get_velocity() == oldVelocity &&
 					 pNote->get_probability() == fProbability ) ) ) {
-				notes->erase( it );
+				pPattern->remove_note( pNote );
 				delete pNote;
 				bFound = true;
 				break;
@@ -1498,13 +1500,15 @@ void DrumPatternEditor::functionClearNotesUndoAction( const std::list< H2Core::N
 		return;
 	}
 
-	std::list < H2Core::Note *>::const_iterator pos;
-	for ( pos = noteList.begin(); pos != noteList.end(); ++pos){
-		Note *pNote;
-		pNote = new Note(*pos);
-		assert( pNote );
-		pPattern->insert_note( pNote );
+	std::vector<Note*> notes;
+	notes.reserve( noteList.size() );
+	for ( const auto& pNote : noteList ) {
+		notes.push_back( new Note( pNote ) );
 	}
+
+	m_pAudioEngine->lock( RIGHT_HERE );	// lock the audio engine
+	pPattern->insert_notes( notes );
+	m_pAudioEngine->unlock();	// unlock the audio engine
 	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
 
 	m_pPatternEditorPanel->updateEditors();
@@ -1530,6 +1534,7 @@ void DrumPatternEditor::functionPasteNotesUndoAction( std::list<H2Core::Pattern*
 		if (pat != nullptr)
 		{
 			// Remove all notes of applied pattern from destination pattern
+			std::vector<Note*> removed;
 			const Pattern::notes_t* notes = pApplied->get_notes();
 			FOREACH_NOTE_CST_IT_BEGIN_END(notes, it)
 			{
@@ -1538,18 +1543,25 @@ void DrumPatternEditor::functionPasteNotesUndoAction( std::list<H2Core::Pattern*
 				assert(pNote);
 
 				// Check if note is not present
-				Pattern::notes_t* notes = (Pattern::notes_t *)pat->get_notes();
-				FOREACH_NOTE_IT_BOUND_END(notes, it, pNote->get_position())
+				const Pattern::notes_t* notes = pat->get_notes();
+				FOREACH_NOTE_CST_IT_BOUND_END(notes, it, pNote->get_position())
 				{
 					Note *pFoundNote = it->second;
-					if (pFoundNote->get_instrument() == pNote->get_instrument())
+					if (pFoundNote->get_instrument() == pNote->get_instrument() &&
+						std::find( removed.begin(), removed.end(),
+								   pFoundNote ) == removed.end() )
 					{
-						notes->erase(it);
-						delete pFoundNote;
+						removed.push_back( pFoundNote );
 						break;
 					}
 				}
 			}
+
+			// The note index is rebuilt just once.
+			pat->remove_notes( removed );
+			for ( auto pNote : removed ) {
+				delete pNote;
+			}
 		}
 
 		// Remove applied pattern;
@@ -1590,6 +1602,8 @@ void DrumPatternEditor::functionPasteNotesRedoAction( const std::list<H2Core::Pa
 
 			// Add all notes of source pattern to destination pattern
 			// and store all applied notes in applied pattern
+			std::vector<Note*> appliedNotes;
+			std::vector<Note*> storedNotes;
 			const Pattern::notes_t* notes = pPattern->get_notes();
 			FOREACH_NOTE_CST_IT_BEGIN_END(notes, it)
 			{
@@ -1613,10 +1627,12 @@ void DrumPatternEditor::functionPasteNotesRedoAction( const std::list<H2Core::Pa
 				// Apply note and store it as applied
 				if (!noteExists)
 				{
-					pat->insert_note(new Note(pNote));
-					pApplied->insert_note(new Note(pNote));
+					appliedNotes.push_back(new Note(pNote));
+					storedNotes.push_back(new Note(pNote));
 				}
 			}
+			pat->insert_notes( appliedNotes );
+			pApplied->insert_notes( storedNotes );
 
 			// Add applied pattern to applied list
 			appliedList.push_back(pApplied);
@@ -1654,22 +1670,29 @@ void DrumPatternEditor::functionFillNotesUndoAction( const QStringList& noteList
 
 	m_pAudioEngine->lock( RIGHT_HERE );	// lock the audio engine
 
+	std::vector<Note*> removed;
 	for (int i = 0; i < noteList.size(); i++ ) {
 		int nColumn  = noteList.value(i).toInt();
-		Pattern::notes_t* notes = (Pattern::notes_t*)pPattern->get_notes();
-		FOREACH_NOTE_IT_BOUND_END(notes,it,nColumn) {
+		const Pattern::notes_t* notes = pPattern->get_notes();
+		FOREACH_NOTE_CST_IT_BOUND_END(notes,it,nColumn) {
 			Note *pNote = it->second;
 			assert( pNote );
-			if ( pNote->get_instrument() == pSelectedInstrument ) {
+			if ( pNote->get_instrument() == pSelectedInstrument &&
+				 std::find( removed.begin(), removed.end(),
+							pNote ) == removed.end() ) {
 				// the note exists...remove it!
-				notes->erase( it );
-				delete pNote;
+				removed.push_back( pNote );
 				break;
 			}
 		}
 	}
+	pPattern->remove_notes( removed );
 	m_pAudioEngine->unlock();	// unlock the audio engine
 
+	for ( auto pNote : removed ) {
+		delete pNote;
+	}
+
 	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
 	m_pPatternEditorPanel->updateEditors();
 }
@@ -1696,14 +1719,17 @@ void DrumPatternEditor::functionFillNotesRedoAction( const QStringList& noteList
 		return;
 	}
 
-	m_pAudioEngine->lock( RIGHT_HERE );	// lock the audio engine
+	std::vector<Note*> notes;
+	notes.reserve( noteList.size() );
 	for (int i = 0; i < noteList.size(); i++ ) {
 
 		// create the new note
 		int position = noteList.value(i).toInt();
-		Note *pNote = new Note( pSelectedInstrument, position );
-		pPattern->insert_note( pNote );
+		notes.push_back( new Note( pSelectedInstrument, position ) );
 	}
+
+	m_pAudioEngine->lock( RIGHT_HERE );	// lock the audio engine
+	pPattern->insert_notes( notes );
 	m_pAudioEngine->unlock();	// unlock the audio engine
 
 	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
@@ -1898,18 +1924,20 @@ void DrumPatternEditor::functionDeleteInstrumentUndoAction( const std::list< H2C
 	EventQueue::get_instance()->push_event( EVENT_SELECTED_INSTRUMENT_CHANGED, -1 );
 
 	//restore all deleted instrument notes
+	// Grouped by pattern to rebuild each note index only once.
+	std::map<Pattern*, std::vector<Note*>> restoredNotes;
+	for ( const auto& ppNote : noteList ){
+		assert( ppNote );
+		Note *pNewNote = new Note( ppNote, pNewInstrument );
+		assert( pNewNote );
+		pPattern = pPatternList->get( pNewNote->get_pattern_idx() );
+		assert (pPattern);
+		restoredNotes[ pPattern ].push_back( pNewNote );
+	}
+
 	m_pAudioEngine->lock( RIGHT_HERE );
-	if(noteList.size() > 0 ){
-		std::list < H2Core::Note *>::const_iterator pos;
-		for ( const auto& ppNote : noteList ){
-			assert( ppNote );
-			Note *pNewNote = new Note( *pos, pNewInstrument );
-			assert( pNewNote );
-			pPattern = pPatternList->get( pNewNote->get_pattern_idx() );
-			assert (pPattern);
-			pPattern->insert_note( pNewNote );
-			//delete pNote;
-		}
+	for ( const auto& [ ppPattern, notes ] : restoredNotes ) {
+		ppPattern->insert_notes( notes );
 	}
 	m_pAudioEngine->unlock();	// unlock the audio engine
 }
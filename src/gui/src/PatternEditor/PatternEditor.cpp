@@ -47,6 +47,8 @@
 #include <core/AudioEngine/AudioEngine.h>
 #include <core/Helpers/Xml.h>
 
+#include <algorithm>
+
 
 using namespace std;
 using namespace H2Core;
@@ -715,27 +717,34 @@ void PatternEditor::deselectAndOverwriteNotes( const std::vector< H2Core::Note *
 	// Iterate over all the notes in 'selected' and 'overwrite' by erasing any *other* notes occupying the
 	// same position.
 	m_pAudioEngine->lock( RIGHT_HERE );
-	Pattern::notes_t *pNotes = const_cast< Pattern::notes_t *>( m_pPattern->get_notes() );
+	const Pattern::notes_t *pNotes = m_pPattern->get_notes();
+	std::vector<Note*> overwritten;
 	for ( auto pSelectedNote : selected ) {
 		m_selection.removeFromSelection( pSelectedNote, /* bCheck=*/false );
 		bool bFoundExact = false;
 		int nPosition = pSelectedNote->get_position();
-		for ( auto it = pNotes->lower_bound( nPosition ); it != pNotes->end() && it->first == nPosition; ) {
+		for ( auto it = pNotes->lower_bound( nPosition ); it != pNotes->end() && it->first == nPosition; ++it ) {
 			Note *pNote = it->second;
+			if ( std::find( overwritten.begin(), overwritten.end(),
+							pNote ) != overwritten.end() ) {
+				// Already overwritten by another selected note.
+				continue;
+			}
 			if ( !bFoundExact && notesMatchExactly( pNote, pSelectedNote ) ) {
 				// Found an exact match. We keep this.
 				bFoundExact = true;
-				++it;
 			} else if ( pSelectedNote->match( pNote ) && pNote->get_position() == pSelectedNote->get_position() ) {
 				// Something else occupying the same position (which may or may not be an exact duplicate)
-				it = pNotes->erase( it );
-				delete pNote;
-			} else {
-				// Any other note
-				++it;
+				overwritten.push_back( pNote );
 			}
 		}
 	}
+	// Removed via the pattern at once to rebuild its note index only
+	// a single time.
+	m_pPattern->remove_notes( overwritten );
+	for ( auto pNote : overwritten ) {
+		delete pNote;
+	}
 	Hydrogen::get_instance()->setIsModified( true );
 	m_pAudioEngine->unlock();
 }
@@ -751,10 +760,12 @@ void PatternEditor::undoDeselectAndOverwriteNotes( const std::vector< H2Core::No
 	// Restore previously-overwritten notes, and select notes that were selected before.
 	m_selection.clearSelection( /* bCheck=*/false );
 	m_pAudioEngine->lock( RIGHT_HERE );
+	std::vector<Note*> restored;
+	restored.reserve( overwritten.size() );
 	for ( auto pNote : overwritten ) {
-		Note *pNewNote = new Note( pNote );
-		m_pPattern->insert_note( pNewNote );
+		restored.push_back( new Note( pNote ) );
 	}
+	m_pPattern->insert_notes( restored );
 	// Select the previously-selected notes
 	for ( auto pNote : selected ) {
 		FOREACH_NOTE_CST_IT_BOUND_END( m_pPattern->get_notes(), it, pNote->get_position() ) {
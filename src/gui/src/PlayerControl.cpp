@@ -47,6 +47,7 @@ https://www.gnu.org/licenses
 #include <core/Basics/Song.h>
 #include <core/CoreActionController.h>
 #include <core/AudioEngine/AudioEngine.h>
+#include <core/AudioEngine/RubberbandWorker.h>
 #include <core/AudioEngine/TransportPosition.h>
 #include <core/IO/JackAudioDriver.h>
 #include <core/EventQueue.h>
@@ -812,21 +813,13 @@ void PlayerControl::rubberbandButtonToggle()
 	Preferences *pPref = Preferences::get_instance();
 	auto pHydrogen = H2Core::Hydrogen::get_instance();
 	if ( m_pRubberBPMChange->isChecked() ) {
-		auto pSong = pHydrogen->getSong();
-
-		if ( pSong != nullptr ) {
-			auto pDrumkit = pSong->getDrumkit();
-			if ( pDrumkit != nullptr ) {
-				// Recalculate all samples ones just to be safe since the
-				// recalculation is just triggered if there is a tempo change
-				// in the audio engine.
-				pHydrogen->getAudioEngine()->lock( RIGHT_HERE );
-				pDrumkit->recalculateRubberband(
-					pHydrogen->getAudioEngine()->getTransportPosition()->getBpm() );
-				pHydrogen->getAudioEngine()->unlock();
-			}
-		}
 		pPref->setRubberBandBatchMode(true);
+		// Recalculate all samples ones just to be safe since the
+		// recalculation is just triggered if there is a tempo change
+		// in the audio engine.
+		pHydrogen->getRubberbandWorker()->request(
+			pHydrogen->getAudioEngine()->getTransportPosition()->getBpm() );
+		pHydrogen->getRubberbandWorker()->wake();
 		(HydrogenApp::get_instance())->showStatusBarMessage( tr("Recalculate all samples using Rubberband ON") );
 	}
 	else {
@@ -44,6 +44,7 @@
 #include <core/AudioEngine/AudioEngine.h>
 #include <core/Helpers/Translations.h>
 #include <core/Sampler/Sampler.h>
+#include <core/Sampler/SamplerWorkerPool.h>
 #include "../SongEditor/SongEditor.h"
 #include "../SongEditor/SongEditorPanel.h"
 #include "../Widgets/LCDSpinBox.h"
@@ -338,6 +339,11 @@ PreferencesDialog::PreferencesDialog(QWidget* parent)
 	maxVoicesTxt->setSize( audioTabWidgetSizeBottom );
 	maxVoicesTxt->setValue( pPref->m_nMaxNotes );
 
+	// Audio tab - render threads
+	renderThreadsSpinBox->setSize( audioTabWidgetSizeBottom );
+	renderThreadsSpinBox->setMaximum( SamplerWorkerPool::getAvailableCores() );
+	renderThreadsSpinBox->setValue( pPref->m_nRenderThreads );
+
 	resampleComboBox->setSize( audioTabWidgetSizeBottom );
 	resampleComboBox->setCurrentIndex( static_cast<int>(pHydrogen->getAudioEngine()->getSampler()->getInterpolateMode() ) );
 
@@ -873,6 +879,25 @@ void PreferencesDialog::on_okBtn_clicked()
 	// Polyphony
 	if ( pPref->m_nMaxNotes != maxVoicesTxt->value() ) {
 		pPref->m_nMaxNotes = maxVoicesTxt->value();
+
+		// Grow the pool of preallocated notes accordingly.
+		auto pAudioEngine = pHydrogen->getAudioEngine();
+		pAudioEngine->lock( RIGHT_HERE );
+		pAudioEngine->getNotePool()->reserve(
+			NotePool::capacityForMaxNotes( pPref->m_nMaxNotes ) );
+		pAudioEngine->getSampler()->setRenderThreads( pPref->m_nRenderThreads );
+		pAudioEngine->unlock();
+		bAudioOptionAltered = true;
+	}
+
+	// Render threads
+	if ( pPref->m_nRenderThreads != renderThreadsSpinBox->value() ) {
+		pPref->m_nRenderThreads = renderThreadsSpinBox->value();
+
+		auto pAudioEngine = pHydrogen->getAudioEngine();
+		pAudioEngine->lock( RIGHT_HERE );
+		pAudioEngine->getSampler()->setRenderThreads( pPref->m_nRenderThreads );
+		pAudioEngine->unlock();
 		bAudioOptionAltered = true;
 	}
 
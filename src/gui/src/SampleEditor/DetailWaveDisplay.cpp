@@ -140,8 +140,8 @@ void DetailWaveDisplay::updateDisplay( const QString& filename )
 
 		float fGain = height() / 4.0 * 1.0;
 
-		auto pSampleDatal = pNewSample->get_data_l();
-		auto pSampleDatar = pNewSample->get_data_r();
+		auto pSampleDatal = pNewSample->getBuffer().left();
+		auto pSampleDatar = pNewSample->getBuffer().right();
 
 		for ( int i = 0; i < mSampleLength; i++ ){
 			m_pPeakDatal[ i ] = static_cast<int>( pSampleDatal[ i ] * fGain );
@@ -184,8 +184,8 @@ void MainSampleWaveDisplay::updateDisplay( const QString& filename )
 
 		float fGain = height() / 4.0 * 1.0;
 
-		auto pSampleDatal = pNewSample->get_data_l();
-		auto pSampleDatar = pNewSample->get_data_r();
+		auto pSampleDatal = pNewSample->getBuffer().left();
+		auto pSampleDatar = pNewSample->getBuffer().right();
 
 		unsigned nSamplePos = 0;
 		int nVall = 0;
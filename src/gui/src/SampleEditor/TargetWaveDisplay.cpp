@@ -215,8 +215,8 @@ void TargetWaveDisplay::updateDisplay( std::shared_ptr<H2Core::InstrumentLayer>
 
 		float fGain = (height() - 8) / 2.0 * pLayer->get_gain();
 
-		auto pSampleDatal = pLayer->get_sample()->get_data_l();
-		auto pSampleDatar = pLayer->get_sample()->get_data_r();
+		auto pSampleDatal = pLayer->get_sample()->getBuffer().left();
+		auto pSampleDatar = pLayer->get_sample()->getBuffer().right();
 		int nSamplePos = 0;
 		int nVall;
 		int nValr;
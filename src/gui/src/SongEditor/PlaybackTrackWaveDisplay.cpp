@@ -28,6 +28,9 @@
 #include <core/Basics/InstrumentLayer.h>
 #include <core/Basics/PatternList.h>
 #include <core/Basics/Pattern.h>
+#include <core/AudioEngine/AudioEngine.h>
+#include <core/Sampler/Sampler.h>
+#include <core/Sampler/SampleStream.h>
 using namespace H2Core;
 
 
@@ -127,15 +130,23 @@ void PlaybackTrackWaveDisplay::updateDisplay( std::shared_ptr<H2Core::Instrument
 	//initialise everything with 0..	
 	memset( m_pPeakData, 0, currentWidth * sizeof(m_pPeakData[0]) );	
 	
-	if ( pLayer && pLayer->get_sample() ) {
+	// The playback track is streamed from disk and not held in
+	// memory. Its length and waveform are provided by the stream.
+	auto	pStream = Hydrogen::get_instance()->getAudioEngine()->
+		getSampler()->getPlaybackTrackStream();
+	if ( pLayer && pLayer->get_sample() && pStream != nullptr &&
+		 pStream->getFilepath() == pLayer->get_sample()->get_filepath() &&
+		 pStream->getSampleRate() > 0 ) {
 		std::shared_ptr<Song> pSong = Hydrogen::get_instance()->getSong();
 		
 		m_pLayer = pLayer;
 		m_sSampleName = m_pLayer->get_sample()->get_filename();
 		
-		auto	pSampleData = pLayer->get_sample()->get_data_l();
-		int		nSampleLength = m_pLayer->get_sample()->get_frames();
-		float	fLengthOfPlaybackTrackInSecs = ( float )( nSampleLength / (float) m_pLayer->get_sample()->get_sample_rate() );
+		const std::vector<float>& peaks = pStream->getPeaks();
+		const long long nPeakFrames =
+			static_cast<long long>( peaks.size() ) * SampleStream::nPeakFrames;
+		int		nSampleLength = pStream->getFrames();
+		float	fLengthOfPlaybackTrackInSecs = ( float )( nSampleLength / (float) pStream->getSampleRate() );
 		float	fRemainingLengthOfPlaybackTrack = fLengthOfPlaybackTrackInSecs;		
 		float	fGain = height() / 2.0 * pLayer->get_gain();
 		int		nSamplePos = 0;
@@ -191,8 +202,8 @@ void PlaybackTrackWaveDisplay::updateDisplay( std::shared_ptr<H2Core::Instrument
 						
 						int nSamplesToRenderInThisStep =  (nSamplesToRender / nSongEditorGridWith);
 						for ( int j = 0; j < nSamplesToRenderInThisStep; ++j ) {
-							if ( nSamplePos < nSampleLength ) {
-								int newVal = (int)( pSampleData[ nSamplePos ] * fGain );
+							if ( nSamplePos < nSampleLength && nSamplePos < nPeakFrames ) {
+								int newVal = (int)( peaks[ nSamplePos / SampleStream::nPeakFrames ] * fGain );
 								if ( newVal > nVal ) {
 									nVal = newVal;
 								}
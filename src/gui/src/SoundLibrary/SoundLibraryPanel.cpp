@@ -197,13 +197,13 @@ void SoundLibraryPanel::updateTree()
 	// drumkit list
 	m_drumkitRegister.clear();
 	m_drumkitLabels.clear();
-	for ( const auto& [ssPath, ppDrumkit] : pSoundLibraryDatabase->getDrumkitDatabase() ) {
-		if ( ppDrumkit == nullptr ) {
+	for ( const auto& [ssPath, ppInfo] : pSoundLibraryDatabase->getDrumkitInfos() ) {
+		if ( ppInfo == nullptr ) {
 			continue;
 		}
 
 		const QString sItemLabel = pSoundLibraryDatabase->getUniqueLabel( ssPath );
-		const auto drumkitType = ppDrumkit->getType();
+		const auto drumkitType = ppInfo->getType();
 
 		QTreeWidgetItem* pDrumkitItem;
 		if ( drumkitType == Drumkit::Type::System ) {
@@ -245,15 +245,11 @@ void SoundLibraryPanel::updateTree()
 		pDrumkitItem->setText( 0, sItemLabel );
 		pDrumkitItem->setToolTip( 0, ssPath );
 		if ( ! m_bInItsOwnDialog ) {
-			auto pInstrList = ppDrumkit->getInstruments();
-			for ( const auto& pInstrument : *ppDrumkit->getInstruments() ) {
-				if ( pInstrument != nullptr ) {
-					QTreeWidgetItem* pInstrumentItem = new QTreeWidgetItem( pDrumkitItem );
-					pInstrumentItem->setText( 0, QString( "[%1] %2" )
-											  .arg( pInstrument->get_id() )
-											  .arg( pInstrument->get_name() ) );
-					pInstrumentItem->setToolTip( 0, pInstrument->get_name() );
-				}
+			for ( const auto& [ nnId, ssName ] : ppInfo->getInstruments() ) {
+				QTreeWidgetItem* pInstrumentItem = new QTreeWidgetItem( pDrumkitItem );
+				pInstrumentItem->setText( 0, QString( "[%1] %2" )
+										  .arg( nnId ).arg( ssName ) );
+				pInstrumentItem->setToolTip( 0, ssName );
 			}
 		}
 	}
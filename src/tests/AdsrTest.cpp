@@ -270,3 +270,39 @@ void ADSRTest::testRelease()
 	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, getValue( 2.0 ), delta );
 	___INFOLOG( "passed" );
 }
+
+/* Fading out during sustain must start at the current level and
+   reach zero well before the regular release would. */
+void ADSRTest::testFadeOut()
+{
+	___INFOLOG( "" );
+	const int N = 256;
+	const int nFade = N / 4;
+	const float fSustain = 0.75;
+	float a[3*N], b[3*N];
+	for ( int n = 0; n < 3*N; n++) {
+		a[n] = b[n] = 1.0;
+	}
+
+	/* Regular release taking 4N frames. Stay in sustain till the
+	   fade-out is triggered. */
+	ADSR Adsr( N, N, fSustain, 4 * N );
+	CPPUNIT_ASSERT( ! Adsr.applyADSR( a, b, 3 * N, 10 * N, 1.0 ) );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( fSustain, Adsr.getValue(), delta );
+
+	for ( int n = 0; n < 3*N; n++) {
+		a[n] = b[n] = 1.0;
+	}
+	Adsr.fadeOut( nFade );
+	CPPUNIT_ASSERT( Adsr.getState() == ADSR::State::Release );
+	CPPUNIT_ASSERT( Adsr.applyADSR( a, b, N, 10 * N, 1.0 ) );
+	checkEqual( a, b, N );
+
+	CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE( "fade starting at sustain level", fSustain, a[0], 1.0/N );
+	checkConcave( a, nFade );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL_MESSAGE( "fade ending at 0", 0.0, a[nFade - 1], 4.0/N );
+
+	/* Idle */
+	checkAllEqual( a + nFade, 0.0, N - nFade );
+	___INFOLOG( "passed" );
+}
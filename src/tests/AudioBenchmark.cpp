@@ -31,12 +31,20 @@
 #include <core/Basics/Drumkit.h>
 #include <core/Basics/InstrumentList.h>
 #include <core/Basics/InstrumentComponent.h>
+#include <core/Basics/Pattern.h>
 #include <core/Basics/PatternList.h>
+#include <core/Helpers/Xml.h>
+#include <core/Sampler/Resample.h>
+#include <core/Sampler/Sampler.h>
+#include <core/Sampler/SamplerWorkerPool.h>
 #include "TestHelper.h"
 #include "AudioBenchmark.h"
 
-#include <memory>
+#include <chrono>
+#include <cmath>
 #include <ctime>
+#include <memory>
+#include <vector>
 
 using namespace H2Core;
 #if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
@@ -146,6 +154,175 @@ void AudioBenchmark::timeADSR() {
 	out << "ADSR time: " << showTimes( times, nFrames ) << Qt::endl;
 }
 
+void AudioBenchmark::timeResample() {
+	const int nSampleFrames = 44100;
+	const int nFrames = 4096;
+	const float fStep = 1.0594631; // pitched up by a semitone
+	std::vector<float> sample_L( nSampleFrames ), sample_R( nSampleFrames );
+	std::vector<float> buffer_L( nFrames ), buffer_R( nFrames );
+	for ( int i = 0; i < nSampleFrames; i++ ) {
+		sample_L[ i ] = sin( i * 0.01 );
+		sample_R[ i ] = cos( i * 0.01 );
+	}
+
+	for ( const auto& mode : { Interpolation::InterpolateMode::Linear,
+							   Interpolation::InterpolateMode::Cosine,
+							   Interpolation::InterpolateMode::Third,
+							   Interpolation::InterpolateMode::Cubic,
+							   Interpolation::InterpolateMode::Hermite } ) {
+		double fScalarMean = 0.0;
+		for ( const auto& kernel : { Resample::Kernel::Scalar,
+									 Resample::Kernel::SSE2,
+									 Resample::Kernel::AVX2,
+									 Resample::Kernel::NEON } ) {
+			if ( ! Resample::isSupported( kernel ) ) {
+				continue;
+			}
+
+			std::vector< clock_t > times;
+			for ( int i = 0; i < 100; i++ ) {
+				std::clock_t start = std::clock();
+				// Render the whole sample in chunks of nFrames.
+				double fSamplePos = 0;
+				while ( fSamplePos < nSampleFrames ) {
+					Resample::resample( kernel, mode, buffer_L.data(), buffer_R.data(),
+										sample_L.data(), sample_R.data(), nFrames,
+										fSamplePos, fStep, nSampleFrames );
+				}
+				std::clock_t end = std::clock();
+
+				times.push_back( end - start );
+			}
+
+			double fMean;
+			const int nRenderedFrames = static_cast<int>(
+				std::ceil( nSampleFrames / fStep / nFrames ) ) * nFrames;
+			out << "Resample " << Interpolation::ModeToQString( mode )
+				<< " (" << Resample::KernelToQString( kernel ) << ") time: "
+				<< showTimes( times, nRenderedFrames, &fMean );
+			if ( kernel == Resample::Kernel::Scalar ) {
+				fScalarMean = fMean;
+			}
+			else if ( fMean > 0 ) {
+				out << QString( " (speedup %1x)" ).arg( fScalarMean / fMean, 0, 'f', 2 );
+			}
+			out << Qt::endl;
+		}
+	}
+}
+
+void AudioBenchmark::timeSongLoading() {
+	auto sSongFile = Filesystem::tmp_file_path( "benchmark.h2song" );
+	const int nCopies = 64;
+	const int nIterations = 10;
+
+	// Inflate a regular song by duplicating its patterns.
+	auto pSong = Song::load( H2TEST_FILE( "functional/test.h2song" ) );
+	CPPUNIT_ASSERT( pSong != nullptr );
+	auto pPatternList = pSong->getPatternList();
+	const int nPatterns = pPatternList->size();
+	for ( int i = 1; i < nCopies; i++ ) {
+		for ( int j = 0; j < nPatterns; j++ ) {
+			auto pPattern = new Pattern( pPatternList->get( j ) );
+			pPattern->set_name( QString( "%1 %2" )
+								.arg( pPattern->get_name() ).arg( i ) );
+			pPatternList->add( pPattern );
+		}
+	}
+	CPPUNIT_ASSERT( pSong->save( sSongFile, false, true ) );
+
+	int nNotes = 0;
+	for ( const auto& pPattern : *pPatternList ) {
+		nNotes += pPattern->get_notes()->size();
+	}
+
+	// Parsing the document into a DOM is what the song loading used
+	// to do before even starting to create the song itself.
+	std::vector< clock_t > domTimes, loadTimes, saveTimes;
+	for ( int i = 0; i < nIterations; i++ ) {
+		std::clock_t start = std::clock();
+		CPPUNIT_ASSERT( pSong->save( sSongFile, false, true ) );
+		saveTimes.push_back( std::clock() - start );
+
+		start = std::clock();
+		{
+			XMLDoc doc;
+			CPPUNIT_ASSERT( doc.read( sSongFile, nullptr, true ) );
+		}
+		domTimes.push_back( std::clock() - start );
+
+		start = std::clock();
+		auto pLoadedSong = Song::load( sSongFile, true );
+		loadTimes.push_back( std::clock() - start );
+
+		CPPUNIT_ASSERT( pLoadedSong != nullptr );
+		CPPUNIT_ASSERT( pLoadedSong->getPatternList()->size() ==
+						pPatternList->size() );
+	}
+
+	const auto meanTime = []( const std::vector< clock_t >& times ) {
+		return std::accumulate( times.begin(), times.end(), 0 ) * 1.0 /
+			CLOCKS_PER_SEC / times.size();
+	};
+	const double fDomTime = meanTime( domTimes );
+	const double fLoadTime = meanTime( loadTimes );
+	const double fSaveTime = meanTime( saveTimes );
+	out << "Song with " << pPatternList->size() << " patterns and "
+		<< nNotes << " notes" << Qt::endl;
+	out << "DOM parsing time: " << showNumber( fDomTime ) << "s" << Qt::endl;
+	out << "Song loading time: " << showNumber( fLoadTime ) << "s ("
+		<< showNumber( nNotes / fLoadTime ) << " notes/sec)" << Qt::endl;
+	out << "Song saving time: " << showNumber( fSaveTime ) << "s ("
+		<< showNumber( nNotes / fSaveTime ) << " notes/sec)" << Qt::endl;
+
+	Filesystem::rm( sSongFile );
+}
+
+void AudioBenchmark::timeRenderThreads() {
+	auto outFile = Filesystem::tmp_file_path("test.wav");
+	auto pAudioEngine = Hydrogen::get_instance()->getAudioEngine();
+	auto pSampler = pAudioEngine->getSampler();
+	const int nOldThreads = pSampler->getRenderThreads();
+	const int nIterations = 8;
+
+	// std::clock() does sum up the CPU time of all threads. Wall
+	// clock time is required to measure the scaling instead.
+	double fSerialTime = 0;
+	for ( int nThreads = 1; nThreads <= SamplerWorkerPool::getAvailableCores();
+		  nThreads *= 2 ) {
+		pAudioEngine->lock( RIGHT_HERE );
+		pSampler->setRenderThreads( nThreads );
+		pAudioEngine->unlock();
+
+		// Run through once to warm caches etc.
+		exportCurrentSong( outFile, 44100 );
+
+		long long nFrames = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for ( int i = 0; i < nIterations; i++ ) {
+			nFrames += exportCurrentSong( outFile, 44100 );
+		}
+		const double fTime = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start ).count();
+
+		out << "Render threads " << nThreads << " time: " << showNumber( fTime )
+			<< "s (" << showNumber( nFrames / fTime ) << " frames/sec)";
+		if ( nThreads == 1 ) {
+			fSerialTime = fTime;
+		}
+		else if ( fTime > 0 ) {
+			out << QString( " (speedup %1x)" ).arg( fSerialTime / fTime, 0, 'f', 2 );
+		}
+		out << Qt::endl;
+	}
+
+	pAudioEngine->lock( RIGHT_HERE );
+	pSampler->setRenderThreads( nOldThreads );
+	pAudioEngine->unlock();
+
+	Filesystem::rm( outFile );
+}
+
 double AudioBenchmark::timeExport( int nSampleRate,
 								   Interpolation::InterpolateMode interpolateMode,
 								   double fReference,
@@ -214,6 +391,12 @@ void AudioBenchmark::audioBenchmark(void)
 	out << "Benchmark ADSR method:" << Qt::endl;
 	timeADSR();
 
+	out << "\nBenchmark resample kernels:" << Qt::endl;
+	timeResample();
+
+	out << "\nBenchmark song loading:" << Qt::endl;
+	timeSongLoading();
+
 	auto songFile = H2TEST_FILE("functional/test.h2song");
 	auto songADSRFile = H2TEST_FILE("functional/test_adsr.h2song");
 
@@ -263,6 +446,9 @@ void AudioBenchmark::audioBenchmark(void)
 	timeExport( 44101, Interpolation::InterpolateMode::Cubic, fRef );
 	timeExport( 44101, Interpolation::InterpolateMode::Hermite, fRef );
 
+	out << "\nBenchmark render threads:" << Qt::endl;
+	timeRenderThreads();
+
 	out << "---" << Qt::endl;
 	___INFOLOG( "passed" );
 }
@@ -37,6 +37,9 @@ class AudioBenchmark : public CppUnit::TestCase {
 	QTextStream out;
 
 	void timeADSR();
+	void timeResample();
+	void timeSongLoading();
+	void timeRenderThreads();
 	double timeExport( int nSampleRate,
 					   H2Core::Interpolation::InterpolateMode interpolateMode,
 					   double fReference = 0.0,
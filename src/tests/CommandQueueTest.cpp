@@ -0,0 +1,131 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+#include <cppunit/extensions/HelperMacros.h>
+#include <core/AudioEngine/CommandQueue.h>
+
+#include <thread>
+#include <vector>
+
+using namespace H2Core;
+
+class CommandQueueTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( CommandQueueTest );
+	CPPUNIT_TEST( testPushPop );
+	CPPUNIT_TEST( testOverflow );
+	CPPUNIT_TEST( testThreadedAccess );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+
+	void testPushPop() {
+	___INFOLOG( "" );
+		CommandQueue queue( 5 );
+		CPPUNIT_ASSERT( queue.getCapacity() == 8 );
+
+		CommandQueue::Command command;
+		CPPUNIT_ASSERT( ! queue.pop( &command ) );
+
+		// Wrap around the ring buffer a couple of times.
+		for ( int nPass = 0; nPass < 5; nPass++ ) {
+			for ( int ii = 0; ii < 5; ii++ ) {
+				command.type = CommandQueue::Command::Type::SetNextBpm;
+				command.nValue = ii;
+				command.fValue = 100 + ii;
+				CPPUNIT_ASSERT( queue.push( command ) );
+			}
+			for ( int ii = 0; ii < 5; ii++ ) {
+				CPPUNIT_ASSERT( queue.pop( &command ) );
+				CPPUNIT_ASSERT( command.type ==
+								CommandQueue::Command::Type::SetNextBpm );
+				CPPUNIT_ASSERT( command.nValue == ii );
+				CPPUNIT_ASSERT( command.fValue == 100 + ii );
+			}
+			CPPUNIT_ASSERT( ! queue.pop( &command ) );
+		}
+	___INFOLOG( "passed" );
+	}
+
+	void testOverflow() {
+	___INFOLOG( "" );
+		CommandQueue queue( 4 );
+		CommandQueue::Command command;
+
+		for ( int ii = 0; ii < 6; ii++ ) {
+			command.nValue = ii;
+			CPPUNIT_ASSERT( queue.push( command ) == ( ii < 4 ) );
+		}
+		CPPUNIT_ASSERT( queue.getOverflowCount() == 2 );
+
+		// Commands already posted must not be overwritten.
+		for ( int ii = 0; ii < 4; ii++ ) {
+			CPPUNIT_ASSERT( queue.pop( &command ) );
+			CPPUNIT_ASSERT( command.nValue == ii );
+		}
+		CPPUNIT_ASSERT( ! queue.pop( &command ) );
+	___INFOLOG( "passed" );
+	}
+
+	void testThreadedAccess() {
+	___INFOLOG( "" );
+		const int nThreads = 8;
+		const int nCommandsPerThread = 10000;
+		CommandQueue queue( 64 );
+
+		std::vector<std::thread> threads;
+		for ( int nThread = 0; nThread < nThreads; nThread++ ) {
+			threads.push_back( std::thread( [&queue, nThread]() {
+				CommandQueue::Command command;
+				command.nValue = nThread;
+				for ( int ii = 0; ii < nCommandsPerThread; ii++ ) {
+					command.fValue = ii;
+					while ( ! queue.push( command ) ) {
+						std::this_thread::yield();
+					}
+				}
+			} ) );
+		}
+
+		// Commands of each individual producer have to arrive in order.
+		std::vector<int> counters( nThreads, 0 );
+		CommandQueue::Command command;
+		for ( int nTotal = 0; nTotal < nThreads * nCommandsPerThread; ) {
+			if ( ! queue.pop( &command ) ) {
+				std::this_thread::yield();
+				continue;
+			}
+			CPPUNIT_ASSERT( command.nValue >= 0 && command.nValue < nThreads );
+			CPPUNIT_ASSERT( command.fValue == counters[ command.nValue ] );
+			counters[ command.nValue ]++;
+			nTotal++;
+		}
+
+		for ( auto& thread : threads ) {
+			thread.join();
+		}
+		for ( const auto& nCounter : counters ) {
+			CPPUNIT_ASSERT( nCounter == nCommandsPerThread );
+		}
+		CPPUNIT_ASSERT( ! queue.pop( &command ) );
+	___INFOLOG( "passed" );
+	}
+
+};
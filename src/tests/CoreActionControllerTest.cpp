@@ -21,10 +21,18 @@
  */
 
 #include "CoreActionControllerTest.h"
+#include "TestHelper.h"
 #include <core/CoreActionController.h>
+#include <core/Basics/Drumkit.h>
+#include <core/Basics/Playlist.h>
+#include <core/Basics/PlaylistPrefetcher.h>
+#include <core/Basics/Song.h>
 #include <core/Helpers/Filesystem.h>
+#include <core/Preferences/Preferences.h>
 
+#include <chrono>
 #include <stdio.h>
+#include <thread>
 
 using namespace H2Core;
 
@@ -160,3 +168,65 @@ void CoreActionControllerTest::testIsPathValid() {
 	
 	___INFOLOG( "passed" );
 }
+
+void CoreActionControllerTest::testPlaylistPrefetch() {
+	___INFOLOG( "" );
+
+	auto pPreferences = Preferences::get_instance();
+	const int nOldPrefetchSongs = pPreferences->m_nPlaylistPrefetchSongs;
+	const int nOldPrefetchMemory = pPreferences->m_nPlaylistPrefetchMemory;
+	pPreferences->m_nPlaylistPrefetchSongs = 1;
+	pPreferences->m_nPlaylistPrefetchMemory = 512;
+
+	const QString sFirstSong = H2TEST_FILE( "song/AE_noteEnqueuing.h2song" );
+	const QString sSecondSong = H2TEST_FILE( "song/AE_loopMode.h2song" );
+
+	// The memory required is known before loading the samples.
+	auto pUnloadedSong = Song::load( sSecondSong, true );
+	CPPUNIT_ASSERT( pUnloadedSong != nullptr );
+	CPPUNIT_ASSERT( ! pUnloadedSong->getDrumkit()->areSamplesLoaded() );
+	CPPUNIT_ASSERT( PlaylistPrefetcher::sampleMemory(
+						pUnloadedSong->getDrumkit() ) == 0 );
+	const qint64 nEstimate = PlaylistPrefetcher::estimateSampleMemory(
+		pUnloadedSong->getDrumkit() );
+	CPPUNIT_ASSERT( nEstimate > 0 );
+
+	auto pPrefetcher = m_pHydrogen->getPlaylistPrefetcher();
+	auto pOldPlaylist = m_pHydrogen->getPlaylist();
+	CPPUNIT_ASSERT( CoreActionController::setPlaylist(
+						std::make_shared<Playlist>() ) );
+	CPPUNIT_ASSERT( CoreActionController::addToPlaylist(
+						std::make_shared<PlaylistEntry>( sFirstSong ) ) );
+	CPPUNIT_ASSERT( CoreActionController::addToPlaylist(
+						std::make_shared<PlaylistEntry>( sSecondSong ) ) );
+	CPPUNIT_ASSERT( CoreActionController::activatePlaylistSong( 0 ) );
+
+	// Only the song following the active one is loaded.
+	int nWaited = 0;
+	while ( ! pPrefetcher->isPrefetched( sSecondSong ) && nWaited < 10000 ) {
+		std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+		nWaited += 10;
+	}
+	CPPUNIT_ASSERT( pPrefetcher->isPrefetched( sSecondSong ) );
+	CPPUNIT_ASSERT( ! pPrefetcher->isPrefetched( sFirstSong ) );
+
+	auto pSong = CoreActionController::loadSong( sSecondSong );
+	CPPUNIT_ASSERT( pSong != nullptr );
+	CPPUNIT_ASSERT( pSong->getFilename() == sSecondSong );
+	CPPUNIT_ASSERT( pSong->getDrumkit()->areSamplesLoaded() );
+	CPPUNIT_ASSERT( PlaylistPrefetcher::estimateSampleMemory(
+						pSong->getDrumkit() ) ==
+					PlaylistPrefetcher::sampleMemory( pSong->getDrumkit() ) );
+	CPPUNIT_ASSERT( ! pPrefetcher->isPrefetched( sSecondSong ) );
+
+	// Songs not following the active one anymore are discarded.
+	CPPUNIT_ASSERT( CoreActionController::activatePlaylistSong( 1 ) );
+	CPPUNIT_ASSERT( ! pPrefetcher->isPrefetched( sSecondSong ) );
+
+	pPrefetcher->clear();
+	CPPUNIT_ASSERT( CoreActionController::setPlaylist( pOldPlaylist ) );
+	pPreferences->m_nPlaylistPrefetchSongs = nOldPrefetchSongs;
+	pPreferences->m_nPlaylistPrefetchMemory = nOldPrefetchMemory;
+
+	___INFOLOG( "passed" );
+}
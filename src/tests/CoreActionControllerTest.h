@@ -29,6 +29,7 @@ class CoreActionControllerTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST_SUITE( CoreActionControllerTest );
 	CPPUNIT_TEST( testSessionManagement );
 	CPPUNIT_TEST( testIsPathValid );
+	CPPUNIT_TEST( testPlaylistPrefetch );
 	CPPUNIT_TEST_SUITE_END();
 	
 private:
@@ -54,4 +55,8 @@ public:
 	
 	// Tests Filesystem::isPathValid()
 	void testIsPathValid();
+
+	// Tests whether CoreActionController::loadSong() picks up songs
+	// loaded in the background by PlaylistPrefetcher.
+	void testPlaylistPrefetch();
 };
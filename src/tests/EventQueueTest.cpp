@@ -41,6 +41,7 @@ class EventQueueTest : public CppUnit::TestCase {
 	CPPUNIT_TEST_SUITE( EventQueueTest );
 	CPPUNIT_TEST( testPushPop );
 	CPPUNIT_TEST( testOverflow );
+	CPPUNIT_TEST( testCoalescing );
 	CPPUNIT_TEST( testThreadedAccess );
 	CPPUNIT_TEST_SUITE_END();
 
@@ -88,21 +89,64 @@ public:
 	void testOverflow() {
 	___INFOLOG( "" );
 		Event ev;
+		const int nDroppedCount = m_pQ->getDroppedCount();
 
 		// Overfill queue
 		for ( int i = 0; i < MAX_EVENTS + 100; i++) {
 			m_pQ->push_event( EVENT_PROGRESS, i );
 		}
-		// Check that the queue contains the most recent MAX_EVENTS events
+		// Events already queued must not be overwritten. Instead, the
+		// most recent ones are dropped.
+		CPPUNIT_ASSERT( m_pQ->getDroppedCount() - nDroppedCount == 100 );
 		for ( int i = 0; i < MAX_EVENTS; i++) {
 			ev = m_pQ->pop_event();
-			CPPUNIT_ASSERT( ev.type == EVENT_PROGRESS && ev.value == i + 100);
+			CPPUNIT_ASSERT( ev.type == EVENT_PROGRESS && ev.value == i );
 		}
 		ev = m_pQ->pop_event();
 		CPPUNIT_ASSERT( ev.type == EVENT_NONE );
 	___INFOLOG( "passed" );
 	}
 
+	void testCoalescing() {
+	___INFOLOG( "" );
+		Event ev;
+		const int nCoalescedCount = m_pQ->getCoalescedCount();
+
+		m_pQ->push_event( EVENT_TEMPO_CHANGED, -1 );
+		m_pQ->push_event( EVENT_XRUN, 0 );
+		m_pQ->push_event( EVENT_TEMPO_CHANGED, -1 );
+		m_pQ->push_event( EVENT_XRUN, 0 );
+		m_pQ->push_event( EVENT_INSTRUMENT_PARAMETERS_CHANGED, 1 );
+		m_pQ->push_event( EVENT_INSTRUMENT_PARAMETERS_CHANGED, 2 );
+		m_pQ->push_event( EVENT_INSTRUMENT_PARAMETERS_CHANGED, 1 );
+		CPPUNIT_ASSERT( m_pQ->getCoalescedCount() - nCoalescedCount == 2 );
+
+		// Redundant events are merged into the first one pending while
+		// all others are kept.
+		ev = m_pQ->pop_event();
+		CPPUNIT_ASSERT( ev.type == EVENT_TEMPO_CHANGED && ev.value == -1 );
+		ev = m_pQ->pop_event();
+		CPPUNIT_ASSERT( ev.type == EVENT_XRUN );
+		ev = m_pQ->pop_event();
+		CPPUNIT_ASSERT( ev.type == EVENT_XRUN );
+		ev = m_pQ->pop_event();
+		CPPUNIT_ASSERT( ev.type == EVENT_INSTRUMENT_PARAMETERS_CHANGED &&
+						ev.value == 1 );
+		ev = m_pQ->pop_event();
+		CPPUNIT_ASSERT( ev.type == EVENT_INSTRUMENT_PARAMETERS_CHANGED &&
+						ev.value == 2 );
+		ev = m_pQ->pop_event();
+		CPPUNIT_ASSERT( ev.type == EVENT_NONE );
+
+		// Once handled, the same event has to be delivered again.
+		m_pQ->push_event( EVENT_TEMPO_CHANGED, -1 );
+		ev = m_pQ->pop_event();
+		CPPUNIT_ASSERT( ev.type == EVENT_TEMPO_CHANGED );
+		ev = m_pQ->pop_event();
+		CPPUNIT_ASSERT( ev.type == EVENT_NONE );
+	___INFOLOG( "passed" );
+	}
+
 	void testThreadedAccess() {
 	___INFOLOG( "" );
 		pthread_t threads[ nThreads ];
@@ -40,6 +40,8 @@
 #include <core/Basics/Sample.h>
 #include <core/Basics/Song.h>
 #include <core/Basics/Playlist.h>
+#include <core/AudioEngine/AudioEngine.h>
+#include <core/Sampler/Sampler.h>
 #include <core/Smf/SMF.h>
 #include "TestHelper.h"
 #include "assertions/File.h"
@@ -47,12 +49,16 @@
 
 #include <chrono>
 #include <memory>
+#include <sndfile.h>
+#include <vector>
 
 using namespace H2Core;
 
 class FunctionalTest : public CppUnit::TestCase {
 	CPPUNIT_TEST_SUITE( FunctionalTest );
 	CPPUNIT_TEST( testExportAudio );
+	CPPUNIT_TEST( testExportAudioParallel );
+	CPPUNIT_TEST( testExportStems );
 	CPPUNIT_TEST( testExportMIDISMF0 );
 	CPPUNIT_TEST( testExportMIDISMF1Single );
 	CPPUNIT_TEST( testExportMIDISMF1Multi );
@@ -101,6 +107,84 @@ public:
 	___INFOLOG( "passed" );
 	}
 
+	/** Rendering notes using several threads must yield the same
+	 * result as the serial rendering. */
+	void testExportAudioParallel()
+	{
+	___INFOLOG( "" );
+		const auto sSongFile = H2TEST_FILE("functional/test_adsr.h2song");
+		const auto sOutFile = Filesystem::tmp_file_path( "test-parallel.wav" );
+		const auto sRefFile = H2TEST_FILE( "functional/test-48000-16.ref.flac" );
+
+		auto pAudioEngine = Hydrogen::get_instance()->getAudioEngine();
+		auto pSampler = pAudioEngine->getSampler();
+		const int nOldThreads = pSampler->getRenderThreads();
+
+		for ( const int nThreads : { 2, 4 } ) {
+			pAudioEngine->lock( RIGHT_HERE );
+			pSampler->setRenderThreads( nThreads );
+			pAudioEngine->unlock();
+			CPPUNIT_ASSERT( pSampler->getRenderThreads() == nThreads );
+
+			TestHelper::exportSong( sSongFile, sOutFile, 48000, 16 );
+			H2TEST_ASSERT_AUDIO_FILES_EQUAL( sRefFile, sOutFile );
+			Filesystem::rm( sOutFile );
+		}
+
+		pAudioEngine->lock( RIGHT_HERE );
+		pSampler->setRenderThreads( nOldThreads );
+		pAudioEngine->unlock();
+	___INFOLOG( "passed" );
+	}
+
+	/** Writing stems must not alter the main mix and the stems have
+	 * to add up to the latter. */
+	void testExportStems()
+	{
+	___INFOLOG( "" );
+		const auto sSongFile = H2TEST_FILE("functional/test_adsr.h2song");
+		const auto sOutFile = Filesystem::tmp_file_path( "test-stems.wav" );
+		const auto sRefFile = H2TEST_FILE( "functional/test-48000-32.ref.flac" );
+
+		TestHelper::exportSong( sSongFile, sOutFile, 48000, 32, true );
+		H2TEST_ASSERT_AUDIO_FILES_EQUAL( sRefFile, sOutFile );
+
+		const auto stems = DiskWriterDriver::createStems(
+			Hydrogen::get_instance()->getSong(), sOutFile );
+		// Six instruments are used in the song.
+		CPPUNIT_ASSERT( stems.size() == 6 );
+
+		auto readFile = [&]( const QString& sFile ) {
+			SF_INFO info;
+			info.format = 0;
+			SNDFILE* pFile = sf_open( sFile.toLocal8Bit(), SFM_READ, &info );
+			CPPUNIT_ASSERT( pFile != nullptr );
+			CPPUNIT_ASSERT( info.channels == 2 );
+			std::vector<float> data( info.frames * info.channels );
+			CPPUNIT_ASSERT( sf_readf_float( pFile, data.data(), info.frames ) ==
+							info.frames );
+			sf_close( pFile );
+			return data;
+		};
+
+		const auto mix = readFile( sOutFile );
+		std::vector<float> sum( mix.size(), 0 );
+		for ( const auto& stem : stems ) {
+			const auto data = readFile( stem.sFilename );
+			CPPUNIT_ASSERT( data.size() == mix.size() );
+			for ( int ii = 0; ii < data.size(); ++ii ) {
+				sum[ ii ] += data[ ii ];
+			}
+			Filesystem::rm( stem.sFilename );
+		}
+		for ( int ii = 0; ii < mix.size(); ++ii ) {
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( mix[ ii ], sum[ ii ], 1e-5 );
+		}
+
+		Filesystem::rm( sOutFile );
+	___INFOLOG( "passed" );
+	}
+
 	void testExportMIDISMF1Single()
 	{
 	___INFOLOG( "" );
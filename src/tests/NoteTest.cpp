@@ -21,6 +21,8 @@
  */
 
 #include <cppunit/extensions/HelperMacros.h>
+#include <core/AudioEngine/NotePool.h>
+#include <core/Basics/Adsr.h>
 #include <core/Basics/Note.h>
 #include <core/Basics/Instrument.h>
 #include <core/Basics/InstrumentList.h>
@@ -37,6 +39,7 @@ class NoteTest : public CppUnit::TestCase {
 	CPPUNIT_TEST( testVirtualKeyboard );
 	CPPUNIT_TEST( testProbability );
 	CPPUNIT_TEST( testSerializeProbability );
+	CPPUNIT_TEST( testNotePool );
 	CPPUNIT_TEST_SUITE_END();
 
 	void testMidiDefaultOffset() {
@@ -96,5 +99,67 @@ class NoteTest : public CppUnit::TestCase {
 		delete out;
 	___INFOLOG( "passed" );
 	}
+
+	void testNotePool()
+	{
+	___INFOLOG( "" );
+		auto pSnare = std::make_shared<Instrument>( 1, "Snare", nullptr );
+		NotePool pool( 2 );
+		CPPUNIT_ASSERT_EQUAL( 2, pool.getCapacity() );
+
+		Note* pFirst = pool.acquire( pSnare, 12, 0.5f, 0.25f, 7, 1.0f );
+		pFirst->set_probability( 0.3f );
+		pFirst->set_note_off( true );
+		CPPUNIT_ASSERT( pFirst->get_instrument() == pSnare );
+		CPPUNIT_ASSERT_EQUAL( 12, pFirst->get_position() );
+		CPPUNIT_ASSERT_EQUAL( 0.5f, pFirst->get_velocity() );
+		CPPUNIT_ASSERT_EQUAL( 0.25f, pFirst->getPan() );
+		CPPUNIT_ASSERT( pFirst->get_adsr() != nullptr );
+
+		Note* pCopy = pool.acquire( pFirst );
+		CPPUNIT_ASSERT_EQUAL( 0.3f, pCopy->get_probability() );
+		CPPUNIT_ASSERT_EQUAL( 7, pCopy->get_length() );
+		CPPUNIT_ASSERT( pCopy->get_note_off() );
+		CPPUNIT_ASSERT( pCopy->get_adsr() != pFirst->get_adsr() );
+		CPPUNIT_ASSERT_EQUAL( 2, pool.getInUse() );
+
+		// Pool is exhausted. Notes are allocated on the heap instead.
+		Note* pOverflow = pool.acquire( pSnare );
+		CPPUNIT_ASSERT_EQUAL( 1, pool.getExhaustedCount() );
+		CPPUNIT_ASSERT_EQUAL( 2, pool.getInUse() );
+
+		// Heap allocated notes are not deleted by the audio thread
+		// but handed back to the non-realtime side.
+		const long nReferences = pSnare.use_count();
+		pool.release( pOverflow );
+		CPPUNIT_ASSERT_EQUAL( nReferences, pSnare.use_count() );
+		pool.freeReturnedNotes();
+		CPPUNIT_ASSERT_EQUAL( nReferences - 1, pSnare.use_count() );
+
+		// Recycled notes must not carry over any state.
+		pFirst->get_adsr()->release();
+		const ADSR* pFirstAdsr = pFirst->get_adsr().get();
+		pool.release( pFirst );
+		Note* pRecycled = pool.acquire( pSnare, 3 );
+		CPPUNIT_ASSERT( pRecycled == pFirst );
+		// The envelope is reset in place instead of being allocated
+		// anew.
+		CPPUNIT_ASSERT( pRecycled->get_adsr().get() == pFirstAdsr );
+		CPPUNIT_ASSERT( pRecycled->get_adsr()->getState() ==
+						pSnare->get_adsr()->getState() );
+		CPPUNIT_ASSERT_EQUAL( 3, pRecycled->get_position() );
+		CPPUNIT_ASSERT_EQUAL( 1.0f, pRecycled->get_probability() );
+		CPPUNIT_ASSERT_EQUAL( -1, pRecycled->get_length() );
+		CPPUNIT_ASSERT( ! pRecycled->get_note_off() );
+
+		pool.release( pRecycled );
+		pool.release( pCopy );
+		CPPUNIT_ASSERT_EQUAL( 0, pool.getInUse() );
+		CPPUNIT_ASSERT_EQUAL( 2, pool.getHighWaterMark() );
+
+		pool.reserve( 5 );
+		CPPUNIT_ASSERT_EQUAL( 5, pool.getCapacity() );
+	___INFOLOG( "passed" );
+	}
 };
 
@@ -43,3 +43,72 @@ void PatternTest::testPurgeInstrument()
 	delete pPattern;
 	___INFOLOG( "passed" );
 }
+
+void PatternTest::testNoteIndex()
+{
+	___INFOLOG( "" );
+	auto pInstrument = std::make_shared<Instrument>();
+	Pattern *pPattern = new Pattern();
+
+	CPPUNIT_ASSERT( pPattern->getNoteIndex()->getNotes( 0, MAX_NOTES ).empty() );
+
+	Note *pNote1 = new Note( pInstrument, 3 );
+	Note *pNote2 = new Note( pInstrument, 3 );
+	Note *pNote3 = new Note( pInstrument, 10 );
+	Note *pNote4 = new Note( pInstrument, 48 );
+	pPattern->insert_note( pNote4 );
+	pPattern->insert_note( pNote1 );
+	pPattern->insert_note( pNote3 );
+	pPattern->insert_note( pNote2 );
+
+	auto pNoteIndex = pPattern->getNoteIndex();
+	CPPUNIT_ASSERT_EQUAL( 4, pNoteIndex->size() );
+	// The snapshot is kept until the pattern changes.
+	CPPUNIT_ASSERT( pNoteIndex == pPattern->getNoteIndex() );
+
+	auto notes = pNoteIndex->getNotes( 3, 4 );
+	CPPUNIT_ASSERT_EQUAL( 2, notes.size() );
+	CPPUNIT_ASSERT( notes.begin()[ 0 ] == pNote1 );
+	CPPUNIT_ASSERT( notes.begin()[ 1 ] == pNote2 );
+	CPPUNIT_ASSERT( pNoteIndex->getNotes( 0, 3 ).empty() );
+	CPPUNIT_ASSERT( pNoteIndex->getNotes( 4, 10 ).empty() );
+	CPPUNIT_ASSERT_EQUAL( 3, pNoteIndex->getNotes( 0, 11 ).size() );
+	CPPUNIT_ASSERT_EQUAL( 2, pNoteIndex->getNotes( 10, MAX_NOTES ).size() );
+	CPPUNIT_ASSERT_EQUAL( 4, pNoteIndex->getNotes( -5, 1000 ).size() );
+	CPPUNIT_ASSERT( pNoteIndex->getNotes( 49, 1000 ).empty() );
+	CPPUNIT_ASSERT( pNoteIndex->getNotes( 10, 10 ).empty() );
+	CPPUNIT_ASSERT_EQUAL( 3, pNoteIndex->nextTick( 0 ) );
+	CPPUNIT_ASSERT_EQUAL( 3, pNoteIndex->nextTick( 3 ) );
+	CPPUNIT_ASSERT_EQUAL( 10, pNoteIndex->nextTick( 4 ) );
+	CPPUNIT_ASSERT_EQUAL( 48, pNoteIndex->nextTick( 11 ) );
+	CPPUNIT_ASSERT_EQUAL( std::numeric_limits<int>::max(),
+						  pNoteIndex->nextTick( 49 ) );
+
+	// Removing a note rebuilds the snapshot right away.
+	pPattern->remove_note( pNote3 );
+	CPPUNIT_ASSERT( pPattern->getNoteIndex()->getNotes( 4, 48 ).empty() );
+	CPPUNIT_ASSERT_EQUAL( 3, pPattern->getNoteIndex()->size() );
+	delete pNote3;
+
+	pPattern->purge_instrument( pInstrument );
+	CPPUNIT_ASSERT_EQUAL( 0, pPattern->getNoteIndex()->size() );
+
+	pPattern->insert_notes( { new Note( pInstrument, 7 ),
+							  new Note( pInstrument, 5 ) } );
+	CPPUNIT_ASSERT_EQUAL( 2, pPattern->getNoteIndex()->size() );
+	CPPUNIT_ASSERT_EQUAL( 5, pPattern->getNoteIndex()->nextTick( 0 ) );
+
+	std::vector<Note*> removed;
+	FOREACH_NOTE_CST_IT_BEGIN_END( pPattern->get_notes(), it ) {
+		removed.push_back( it->second );
+	}
+	pPattern->remove_notes( removed );
+	CPPUNIT_ASSERT_EQUAL( 0, pPattern->getNoteIndex()->size() );
+	CPPUNIT_ASSERT( pPattern->get_notes()->empty() );
+	for ( auto pNote : removed ) {
+		delete pNote;
+	}
+
+	delete pPattern;
+	___INFOLOG( "passed" );
+}
@@ -28,10 +28,12 @@
 class PatternTest : public CppUnit::TestCase {
 	CPPUNIT_TEST_SUITE(PatternTest);
 	CPPUNIT_TEST(testPurgeInstrument);
+	CPPUNIT_TEST(testNoteIndex);
 	CPPUNIT_TEST_SUITE_END();
 
 	public:
 		void testPurgeInstrument();
+		void testNoteIndex();
 };
 
 
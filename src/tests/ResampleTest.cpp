@@ -0,0 +1,158 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/Object.h>
+#include <core/Basics/Sample.h>
+#include <core/Sampler/Resample.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace H2Core;
+
+class ResampleTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( ResampleTest );
+	CPPUNIT_TEST( testVectorizedKernels );
+	CPPUNIT_TEST( testGuardFrames );
+	CPPUNIT_TEST_SUITE_END();
+
+	/** All vectorized kernels supported by the host have to yield the
+	 * same output as the scalar one within a small tolerance. This
+	 * includes the boundaries of the sample, which are rendered
+	 * partially by the scalar code. */
+	void testVectorizedKernels()
+	{
+	___INFOLOG( "" );
+		const int nSampleFrames = 5000;
+		const int nFrames = 1500;
+		const float fTolerance = 1e-5;
+
+		std::vector<float> sample_L( nSampleFrames ), sample_R( nSampleFrames );
+		srand( 1 );
+		for ( int ii = 0; ii < nSampleFrames; ++ii ) {
+			sample_L[ ii ] = 2.0 * rand() / RAND_MAX - 1.0;
+			sample_R[ ii ] = 2.0 * rand() / RAND_MAX - 1.0;
+		}
+
+		std::vector<float> ref_L( nFrames ), ref_R( nFrames ),
+			out_L( nFrames ), out_R( nFrames );
+
+		for ( const auto& kernel : { Resample::Kernel::SSE2,
+									 Resample::Kernel::AVX2,
+									 Resample::Kernel::NEON } ) {
+			if ( ! Resample::isSupported( kernel ) ) {
+				continue;
+			}
+
+			for ( const auto& mode : { Interpolation::InterpolateMode::Linear,
+									   Interpolation::InterpolateMode::Cosine,
+									   Interpolation::InterpolateMode::Third,
+									   Interpolation::InterpolateMode::Cubic,
+									   Interpolation::InterpolateMode::Hermite } ) {
+				for ( const float fStep : { 0.5f, 0.99997f, 1.0594631f, 2.7f } ) {
+					for ( const double fStart : { 0.0, 0.3, 123.75,
+							static_cast<double>( nSampleFrames - 400 ) } ) {
+						double fRefPos = fStart;
+						double fPos = fStart;
+						Resample::resample( Resample::Kernel::Scalar, mode,
+											ref_L.data(), ref_R.data(),
+											sample_L.data(), sample_R.data(),
+											nFrames, fRefPos, fStep, nSampleFrames );
+						Resample::resample( kernel, mode,
+											out_L.data(), out_R.data(),
+											sample_L.data(), sample_R.data(),
+											nFrames, fPos, fStep, nSampleFrames );
+
+						CPPUNIT_ASSERT_DOUBLES_EQUAL( fRefPos, fPos, 1e-6 );
+						for ( int ii = 0; ii < nFrames; ++ii ) {
+							CPPUNIT_ASSERT_DOUBLES_EQUAL( ref_L[ ii ], out_L[ ii ],
+														  fTolerance );
+							CPPUNIT_ASSERT_DOUBLES_EQUAL( ref_R[ ii ], out_R[ ii ],
+														  fTolerance );
+						}
+					}
+				}
+			}
+		}
+	___INFOLOG( "passed" );
+	}
+
+	/** Extending the unconditional lookup into the guard frames of a
+	 * Sample::Buffer must not alter the result. Short samples and
+	 * positions close to or past both ends are covered too. */
+	void testGuardFrames()
+	{
+	___INFOLOG( "" );
+		const int nFrames = 600;
+		const float fTolerance = 1e-5;
+
+		std::vector<float> ref_L( nFrames ), ref_R( nFrames ),
+			out_L( nFrames ), out_R( nFrames );
+
+		srand( 2 );
+		for ( const int nSampleFrames : { 1, 3, 250 } ) {
+			Sample::Buffer buffer( nSampleFrames );
+			for ( int ii = 0; ii < nSampleFrames; ++ii ) {
+				buffer.left()[ ii ] = 2.0 * rand() / RAND_MAX - 1.0;
+				buffer.right()[ ii ] = 2.0 * rand() / RAND_MAX - 1.0;
+			}
+
+			for ( const auto& kernel : { Resample::Kernel::Scalar,
+										 Resample::getKernel() } ) {
+				for ( const auto& mode : { Interpolation::InterpolateMode::Linear,
+										   Interpolation::InterpolateMode::Cosine,
+										   Interpolation::InterpolateMode::Third,
+										   Interpolation::InterpolateMode::Cubic,
+										   Interpolation::InterpolateMode::Hermite } ) {
+					for ( const float fStep : { 0.5f, 1.0f, 2.7f } ) {
+						for ( const double fStart : { -0.5, 0.0, 0.3,
+								nSampleFrames - 1.5 } ) {
+							double fRefPos = fStart;
+							double fPos = fStart;
+							Resample::resample( Resample::Kernel::Scalar, mode,
+												ref_L.data(), ref_R.data(),
+												buffer.left(), buffer.right(),
+												nFrames, fRefPos, fStep, nSampleFrames );
+							Resample::resample( kernel, mode,
+												out_L.data(), out_R.data(),
+												buffer.left(), buffer.right(),
+												nFrames, fPos, fStep, nSampleFrames,
+												Sample::Buffer::nGuardFrames );
+
+							CPPUNIT_ASSERT_DOUBLES_EQUAL( fRefPos, fPos, 1e-6 );
+							for ( int ii = 0; ii < nFrames; ++ii ) {
+								CPPUNIT_ASSERT_DOUBLES_EQUAL( ref_L[ ii ], out_L[ ii ],
+															  fTolerance );
+								CPPUNIT_ASSERT_DOUBLES_EQUAL( ref_R[ ii ], out_R[ ii ],
+															  fTolerance );
+							}
+						}
+					}
+				}
+			}
+		}
+	___INFOLOG( "passed" );
+	}
+};
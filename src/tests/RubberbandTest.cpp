@@ -57,7 +57,7 @@ void rubberband_test( const QString& sample_path ) {
 	___DEBUGLOG( QString( "minimum sample required: %1" ).arg( rubber->getSamplesRequired() ) );
 	
 	// study
-	float* ibuf[2];
+	const float* ibuf[2];
 	int studied = 0;
 	___DEBUGLOG( "Study ..." );
 	/*
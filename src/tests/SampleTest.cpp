@@ -24,10 +24,22 @@
 #include "TestHelper.h"
 
 #include <core/Basics/Sample.h>
+#include <core/Basics/SampleCache.h>
+#include <core/Basics/SampleRegistry.h>
+#include <core/Helpers/Filesystem.h>
+#include <core/Sampler/SampleStream.h>
+#include <chrono>
+#include <cstdint>
+#include <thread>
 
 class SampleTest : public CppUnit::TestCase {
 	CPPUNIT_TEST_SUITE( SampleTest );
 	CPPUNIT_TEST( testLoadInvalidSample );
+	CPPUNIT_TEST( testBuffer );
+	CPPUNIT_TEST( testLoadChunks );
+	CPPUNIT_TEST( testStream );
+	CPPUNIT_TEST( testCache );
+	CPPUNIT_TEST( testRegistry );
 
 	CPPUNIT_TEST_SUITE_END();
 
@@ -47,4 +59,307 @@ class SampleTest : public CppUnit::TestCase {
 		CPPUNIT_ASSERT(pSample == nullptr);
 	___INFOLOG( "passed" );
 	}
+
+	void testBuffer()
+	{
+	___INFOLOG( "" );
+		using Buffer = H2Core::Sample::Buffer;
+
+		Buffer emptyBuffer;
+		CPPUNIT_ASSERT( emptyBuffer.left() == nullptr );
+		CPPUNIT_ASSERT( emptyBuffer.right() == nullptr );
+		CPPUNIT_ASSERT( emptyBuffer.frames() == 0 );
+
+		for ( const int nFrames : { 1, 15, 16, 17, 1000 } ) {
+			Buffer buffer( nFrames );
+			CPPUNIT_ASSERT( buffer.frames() == nFrames );
+			CPPUNIT_ASSERT( reinterpret_cast<uintptr_t>( buffer.left() ) %
+							Buffer::nAlignment == 0 );
+			CPPUNIT_ASSERT( reinterpret_cast<uintptr_t>( buffer.right() ) %
+							Buffer::nAlignment == 0 );
+
+			// Data and guard frames are all silent.
+			for ( int ii = -Buffer::nGuardFrames;
+				  ii < nFrames + Buffer::nGuardFrames; ++ii ) {
+				CPPUNIT_ASSERT( buffer.left()[ ii ] == 0 );
+				CPPUNIT_ASSERT( buffer.right()[ ii ] == 0 );
+			}
+
+			// The trailing guard frames of the left channel must not
+			// overlap with the data of the right one.
+			CPPUNIT_ASSERT( buffer.right() - buffer.left() >=
+							nFrames + Buffer::nGuardFrames );
+
+			buffer.left()[ nFrames - 1 ] = 1;
+			float* pLeft = buffer.left();
+			Buffer movedBuffer( std::move( buffer ) );
+			CPPUNIT_ASSERT( buffer.left() == nullptr );
+			CPPUNIT_ASSERT( buffer.frames() == 0 );
+			CPPUNIT_ASSERT( movedBuffer.left() == pLeft );
+			CPPUNIT_ASSERT( movedBuffer.left()[ nFrames - 1 ] == 1 );
+			CPPUNIT_ASSERT( movedBuffer.left()[ nFrames ] == 0 );
+		}
+	___INFOLOG( "passed" );
+	}
+
+	void testLoadChunks()
+	{
+	___INFOLOG( "" );
+		// The sample spans several chunks read from disk and does not
+		// end at a chunk boundary.
+		const int nFrames = 2 * H2Core::Sample::nLoadChunkFrames + 123;
+		float* pData_L = new float[ nFrames ];
+		float* pData_R = new float[ nFrames ];
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			pData_L[ ii ] = static_cast<float>( ii % 1000 ) / 1000.0;
+			pData_R[ ii ] = -1 * static_cast<float>( ii % 777 ) / 777.0;
+		}
+
+		const QString sPath = H2Core::Filesystem::tmp_file_path( "chunks.wav" );
+		auto pSample = std::make_shared<H2Core::Sample>(
+			sPath, H2Core::License(), nFrames, 44100, pData_L, pData_R );
+		CPPUNIT_ASSERT( pSample->write( sPath ) );
+
+		auto pLoaded = H2Core::Sample::load( sPath );
+		CPPUNIT_ASSERT( pLoaded != nullptr );
+		CPPUNIT_ASSERT( pLoaded->get_frames() == nFrames );
+		CPPUNIT_ASSERT( pLoaded->get_sample_rate() == 44100 );
+
+		// 16 bit PCM
+		const float fTolerance = 1.0 / 16384;
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			CPPUNIT_ASSERT( std::abs( pLoaded->get_data_l()[ ii ] -
+									  pSample->get_data_l()[ ii ] ) < fTolerance );
+			CPPUNIT_ASSERT( std::abs( pLoaded->get_data_r()[ ii ] -
+									  pSample->get_data_r()[ ii ] ) < fTolerance );
+		}
+
+		H2Core::Filesystem::rm( sPath );
+	___INFOLOG( "passed" );
+	}
+
+	void testStream()
+	{
+	___INFOLOG( "" );
+		// Low sample rate in order to exceed both the preloaded part
+		// and the ring buffer with a small file.
+		const int nSampleRate = 8000;
+		const int nFrames = 100003;
+		float* pData_L = new float[ nFrames ];
+		float* pData_R = new float[ nFrames ];
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			pData_L[ ii ] = static_cast<float>( ii % 1000 ) / 1000.0;
+			pData_R[ ii ] = -1 * static_cast<float>( ii % 777 ) / 777.0;
+		}
+
+		const QString sPath = H2Core::Filesystem::tmp_file_path( "stream.wav" );
+		auto pSample = std::make_shared<H2Core::Sample>(
+			sPath, H2Core::License(), nFrames, nSampleRate, pData_L, pData_R );
+		CPPUNIT_ASSERT( pSample->write( sPath ) );
+		auto pLoaded = H2Core::Sample::load( sPath );
+		CPPUNIT_ASSERT( pLoaded != nullptr );
+
+		auto pStream = H2Core::SampleStream::open( sPath );
+		CPPUNIT_ASSERT( pStream != nullptr );
+		CPPUNIT_ASSERT( pStream->getFrames() == nFrames );
+		CPPUNIT_ASSERT( pStream->getSampleRate() == nSampleRate );
+		CPPUNIT_ASSERT( pStream->getPreloadFrames() ==
+						nSampleRate * H2Core::SampleStream::nPreloadMilliseconds / 1000 );
+
+		// Reads a block while giving the reader thread time to catch
+		// up and compares it with the fully loaded sample.
+		auto checkBlock = [&]( long long nStart, int nBlockFrames ) {
+			std::vector<float> block_L( nBlockFrames );
+			std::vector<float> block_R( nBlockFrames );
+			int nMissing = 0;
+			for ( int nn = 0; nn < 1000; ++nn ) {
+				nMissing = pStream->read( nStart, nBlockFrames,
+										  block_L.data(), block_R.data() );
+				if ( nMissing == 0 ) {
+					break;
+				}
+				std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+			}
+			CPPUNIT_ASSERT( nMissing == 0 );
+
+			for ( int ii = 0; ii < nBlockFrames; ++ii ) {
+				const long long nFrame = nStart + ii;
+				if ( nFrame < 0 || nFrame >= nFrames ) {
+					CPPUNIT_ASSERT( block_L[ ii ] == 0 );
+					CPPUNIT_ASSERT( block_R[ ii ] == 0 );
+				} else {
+					CPPUNIT_ASSERT( block_L[ ii ] == pLoaded->get_data_l()[ nFrame ] );
+					CPPUNIT_ASSERT( block_R[ ii ] == pLoaded->get_data_r()[ nFrame ] );
+				}
+			}
+		};
+
+		// Sequential playback across the end of the file
+		for ( long long nStart = -500; nStart < nFrames + 700; nStart += 999 ) {
+			checkBlock( nStart, 999 );
+		}
+
+		// Relocations back and forth, into and out of the preloaded part
+		for ( const long long nStart : { 50000, 20, 90000, 15990, 70000, 30000 } ) {
+			checkBlock( nStart, 512 );
+			checkBlock( nStart + 512, 512 );
+		}
+
+		// Waveform overview
+		const auto& peaks = pStream->getPeaks();
+		CPPUNIT_ASSERT( peaks.size() ==
+						( nFrames + H2Core::SampleStream::nPeakFrames - 1 ) /
+						H2Core::SampleStream::nPeakFrames );
+		for ( int ii = 0; ii < peaks.size(); ++ii ) {
+			float fPeak = 0;
+			for ( int nFrame = ii * H2Core::SampleStream::nPeakFrames;
+				  nFrame < std::min( ( ii + 1 ) * H2Core::SampleStream::nPeakFrames,
+									 nFrames ); ++nFrame ) {
+				fPeak = std::max( fPeak, pLoaded->get_data_l()[ nFrame ] );
+			}
+			CPPUNIT_ASSERT( peaks[ ii ] == fPeak );
+		}
+
+		pStream = nullptr;
+		H2Core::Filesystem::rm( sPath );
+	___INFOLOG( "passed" );
+	}
+
+	void testCache()
+	{
+	___INFOLOG( "" );
+		const int nFrames = 5000;
+		float* pData_L = new float[ nFrames ];
+		float* pData_R = new float[ nFrames ];
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			pData_L[ ii ] = static_cast<float>( ii % 100 ) / 100.0;
+			pData_R[ ii ] = -1 * static_cast<float>( ii % 77 ) / 77.0;
+		}
+
+		const QString sPath = H2Core::Filesystem::tmp_file_path( "cache.wav" );
+		auto pSample = std::make_shared<H2Core::Sample>(
+			sPath, H2Core::License(), nFrames, 44100, pData_L, pData_R );
+		CPPUNIT_ASSERT( pSample->write( sPath ) );
+
+		H2Core::Sample::Loops loops;
+		loops.start_frame = 100;
+		loops.loop_frame = 1000;
+		loops.end_frame = 4000;
+		loops.count = 2;
+		H2Core::Sample::VelocityEnvelope velocity;
+		velocity.push_back( H2Core::EnvelopePoint( 0, 70 ) );
+		velocity.push_back( H2Core::EnvelopePoint( 841, 20 ) );
+
+		auto createSample = [&]() {
+			auto pNewSample = std::make_shared<H2Core::Sample>( sPath );
+			pNewSample->set_loops( loops );
+			pNewSample->set_velocity_envelope( velocity );
+			return pNewSample;
+		};
+
+		auto pProcessed = createSample();
+		const QString sEntry = H2Core::SampleCache::getPath(
+			H2Core::SampleCache::getKey( pProcessed.get(), 120 ) );
+		H2Core::Filesystem::rm( sEntry, false, true );
+
+		// Decoded from disk and stored in the cache.
+		CPPUNIT_ASSERT( pProcessed->load( 120 ) );
+		CPPUNIT_ASSERT( ! pProcessed->getBuffer().isMapped() );
+		CPPUNIT_ASSERT( H2Core::Filesystem::file_exists( sEntry, true ) );
+
+		// Restored from the cache. The SampleRegistry would hand out
+		// the data of pProcessed instead.
+		H2Core::SampleRegistry::clear();
+		auto pCached = createSample();
+		CPPUNIT_ASSERT( pCached->load( 120 ) );
+#ifndef WIN32
+		CPPUNIT_ASSERT( pCached->getBuffer().isMapped() );
+#endif
+		CPPUNIT_ASSERT( pCached->get_frames() == pProcessed->get_frames() );
+		CPPUNIT_ASSERT( pCached->get_sample_rate() == pProcessed->get_sample_rate() );
+		CPPUNIT_ASSERT( pCached->get_is_modified() == pProcessed->get_is_modified() );
+		for ( int ii = 0; ii < pCached->get_frames(); ++ii ) {
+			CPPUNIT_ASSERT( pCached->get_data_l()[ ii ] == pProcessed->get_data_l()[ ii ] );
+			CPPUNIT_ASSERT( pCached->get_data_r()[ ii ] == pProcessed->get_data_r()[ ii ] );
+		}
+		// Guard frames are silent.
+		CPPUNIT_ASSERT( pCached->get_data_l()[ -1 ] == 0 );
+		CPPUNIT_ASSERT( pCached->get_data_r()[ pCached->get_frames() ] == 0 );
+
+		// Loading the entry again yields the same data.
+		H2Core::SampleRegistry::clear();
+		auto pCachedAgain = createSample();
+		CPPUNIT_ASSERT( pCachedAgain->load( 120 ) );
+		CPPUNIT_ASSERT( pCachedAgain->get_data_l()[ 0 ] == pProcessed->get_data_l()[ 0 ] );
+
+		// Different modifiers result in different entries.
+		auto pOther = createSample();
+		loops.count = 3;
+		pOther->set_loops( loops );
+		CPPUNIT_ASSERT( H2Core::SampleCache::getKey( pOther.get(), 120 ) !=
+						H2Core::SampleCache::getKey( pProcessed.get(), 120 ) );
+		// Without Rubberband the tempo does not matter.
+		CPPUNIT_ASSERT( H2Core::SampleCache::getKey( pProcessed.get(), 120 ) ==
+						H2Core::SampleCache::getKey( pProcessed.get(), 90 ) );
+
+		H2Core::SampleCache::prune( 0 );
+		CPPUNIT_ASSERT( ! H2Core::Filesystem::file_exists( sEntry, true ) );
+
+		H2Core::Filesystem::rm( sPath );
+	___INFOLOG( "passed" );
+	}
+
+	void testRegistry()
+	{
+	___INFOLOG( "" );
+		H2Core::SampleRegistry::clear();
+
+		const QString sPath = H2TEST_FILE( "drumkits/baseKit/kick.wav" );
+		auto pSample = std::make_shared<H2Core::Sample>( sPath );
+		CPPUNIT_ASSERT( pSample->load() );
+		CPPUNIT_ASSERT( H2Core::SampleRegistry::getEntries() == 1 );
+		CPPUNIT_ASSERT( H2Core::SampleRegistry::getMemoryUsage() > 0 );
+		CPPUNIT_ASSERT( H2Core::SampleRegistry::getUnusedMemory() == 0 );
+
+		// Same file and modifiers share their data.
+		auto pShared = std::make_shared<H2Core::Sample>( sPath );
+		CPPUNIT_ASSERT( pShared->load() );
+		CPPUNIT_ASSERT( pShared->get_data_l() == pSample->get_data_l() );
+		CPPUNIT_ASSERT( pShared->get_frames() == pSample->get_frames() );
+		CPPUNIT_ASSERT( pShared->getBuffer().shareCount() == 3 );
+		CPPUNIT_ASSERT( H2Core::SampleRegistry::getEntries() == 1 );
+
+		// Copies do so as well.
+		auto pCopy = std::make_shared<H2Core::Sample>( pSample );
+		CPPUNIT_ASSERT( pCopy->get_data_l() == pSample->get_data_l() );
+
+		// Different modifiers result in different data.
+		H2Core::Sample::VelocityEnvelope velocity;
+		velocity.push_back( H2Core::EnvelopePoint( 0, 50 ) );
+		auto pModified = std::make_shared<H2Core::Sample>( sPath );
+		pModified->set_velocity_envelope( velocity );
+		CPPUNIT_ASSERT( pModified->load() );
+		CPPUNIT_ASSERT( pModified->get_data_l() != pSample->get_data_l() );
+		CPPUNIT_ASSERT( H2Core::SampleRegistry::getEntries() == 2 );
+
+		// Unused data is kept until pruned.
+		const auto nBytes = H2Core::SampleRegistry::getMemoryUsage();
+		pModified = nullptr;
+		CPPUNIT_ASSERT( H2Core::SampleRegistry::getUnusedMemory() > 0 );
+		CPPUNIT_ASSERT( H2Core::SampleRegistry::getMemoryUsage() == nBytes );
+		H2Core::SampleRegistry::prune( 0 );
+		CPPUNIT_ASSERT( H2Core::SampleRegistry::getEntries() == 1 );
+		CPPUNIT_ASSERT( H2Core::SampleRegistry::getUnusedMemory() == 0 );
+
+		// Data in use is never pruned.
+		pSample = nullptr;
+		pShared = nullptr;
+		H2Core::SampleRegistry::prune( 0 );
+		CPPUNIT_ASSERT( H2Core::SampleRegistry::getEntries() == 1 );
+		pCopy = nullptr;
+		H2Core::SampleRegistry::prune( 0 );
+		CPPUNIT_ASSERT( H2Core::SampleRegistry::getEntries() == 0 );
+		CPPUNIT_ASSERT( H2Core::SampleRegistry::getMemoryUsage() == 0 );
+	___INFOLOG( "passed" );
+	}
 };
@@ -0,0 +1,86 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ * Copyright(c) 2008-2024 The hydrogen development team [hydrogen-devel@lists.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses
+ *
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <core/Helpers/Filesystem.h>
+#include <core/IO/SoundFileWriter.h>
+
+#include <sndfile.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace H2Core;
+
+class SoundFileWriterTest : public CppUnit::TestCase {
+	CPPUNIT_TEST_SUITE( SoundFileWriterTest );
+	CPPUNIT_TEST( testWrite );
+	CPPUNIT_TEST_SUITE_END();
+
+	/** Writing more frames than fit into all blocks at once must
+	 * yield the clipped and interleaved input in the right order. */
+	void testWrite()
+	{
+	___INFOLOG( "" );
+		const int nBlockSize = 64;
+		const int nFrames = 1000;
+		const int nChunk = 300;
+		const auto sFile = Filesystem::tmp_file_path( "sound-file-writer.wav" );
+
+		std::vector<float> data_L( nFrames ), data_R( nFrames );
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			data_L[ ii ] = 2.0 * ii / nFrames - 1.0;
+			data_R[ ii ] = 4.0 * ii / nFrames - 2.0;
+		}
+
+		SoundFileWriter writer( nBlockSize, 3 );
+		CPPUNIT_ASSERT( writer.open( sFile, 44100, 32 ) );
+		for ( int nOffset = 0; nOffset < nFrames; nOffset += nChunk ) {
+			CPPUNIT_ASSERT( writer.write( &data_L[ nOffset ], &data_R[ nOffset ],
+										  std::min( nChunk, nFrames - nOffset ) ) );
+		}
+		CPPUNIT_ASSERT( writer.getFrames() == nFrames );
+		CPPUNIT_ASSERT( writer.close() );
+
+		SF_INFO info;
+		info.format = 0;
+		SNDFILE* pFile = sf_open( sFile.toLocal8Bit(), SFM_READ, &info );
+		CPPUNIT_ASSERT( pFile != nullptr );
+		CPPUNIT_ASSERT( info.frames == nFrames );
+		CPPUNIT_ASSERT( info.channels == 2 );
+
+		std::vector<float> result( nFrames * 2 );
+		CPPUNIT_ASSERT( sf_readf_float( pFile, result.data(), nFrames ) == nFrames );
+		sf_close( pFile );
+
+		for ( int ii = 0; ii < nFrames; ++ii ) {
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(
+				std::clamp( data_L[ ii ], -1.0f, 1.0f ), result[ ii * 2 ], 1e-6 );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(
+				std::clamp( data_R[ ii ], -1.0f, 1.0f ), result[ ii * 2 + 1 ], 1e-6 );
+		}
+
+		Filesystem::rm( sFile );
+	___INFOLOG( "passed" );
+	}
+};
@@ -230,7 +230,7 @@ void TestHelper::varyAudioDriverConfig( int nIndex ) {
 }
 
 void TestHelper::exportSong( const QString& sSongFile, const QString& sFileName,
-							 int nSampleRate, int nSampleDepth )
+							 int nSampleRate, int nSampleDepth, bool bExportStems )
 {
 	auto t0 = std::chrono::high_resolution_clock::now();
 
@@ -247,8 +247,13 @@ void TestHelper::exportSong( const QString& sSongFile, const QString& sFileName,
 		pInstrumentList->get(i)->set_currently_exported( true );
 	}
 
+	std::vector<H2Core::DiskWriterDriver::Stem> stems;
+	if ( bExportStems ) {
+		stems = H2Core::DiskWriterDriver::createStems( pSong, sFileName );
+	}
+
 	pHydrogen->startExportSession( nSampleRate, nSampleDepth );
-	pHydrogen->startExportSong( sFileName );
+	pHydrogen->startExportSong( sFileName, stems );
 
 	bool bDone = false;
 	while ( ! bDone ) {
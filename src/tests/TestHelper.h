@@ -60,10 +60,13 @@ class TestHelper {
 	 * \param sFileName Output file name
 	 * @param nSampleRate sample rate using which to export
 	 * @param nSampleDepth sample depth using which to export
+	 * @param bExportStems whether to write each instrument into a
+	 *   separate file as well (see H2Core::DiskWriterDriver::createStems())
 	 */
 	static void exportSong( const QString& sSongFile,
 							const QString& sFileName,
-							int nSampleRate = 44100, int nSampleDepth = 16 );
+							int nSampleRate = 44100, int nSampleDepth = 16,
+							bool bExportStems = false );
 	/**
 	 * Export the current song within Hydrogen to audio file @a sFileName;
 	 *
@@ -22,9 +22,16 @@
 
 #include <core/CoreActionController.h>
 #include <core/AudioEngine/AudioEngineTests.h>
+#include <core/AudioEngine/AudioEngine.h>
+#include <core/Basics/Instrument.h>
+#include <core/Basics/InstrumentComponent.h>
+#include <core/Basics/InstrumentLayer.h>
+#include <core/Basics/Sample.h>
 #include <core/Hydrogen.h>
 #include <core/Preferences/Preferences.h>
 #include <core/Helpers/Filesystem.h>
+#include <core/Sampler/Sampler.h>
+#include <core/Sampler/SampleStream.h>
 
 #include <iostream>
 
@@ -202,6 +209,18 @@ void TransportTest::testPlaybackTrack() {
 	TestHelper::exportSong( sSongFile, sOutFile );
 	H2TEST_ASSERT_AUDIO_FILES_EQUAL( sRefFile, sOutFile );
 	Filesystem::rm( sOutFile );
+
+	// The track is streamed and its sample does not hold any audio.
+	auto pSampler = H2Core::Hydrogen::get_instance()->getAudioEngine()->getSampler();
+	auto pStream = pSampler->getPlaybackTrackStream();
+	CPPUNIT_ASSERT( pStream != nullptr );
+	CPPUNIT_ASSERT( pStream->getFrames() > 0 );
+	auto pSample = pSampler->getPlaybackTrackInstrument()->get_components()->
+		front()->get_layer( 0 )->get_sample();
+	CPPUNIT_ASSERT( pSample != nullptr );
+	CPPUNIT_ASSERT( pSample->get_filepath() == pStream->getFilepath() );
+	CPPUNIT_ASSERT( ! pSample->isLoaded() );
+	CPPUNIT_ASSERT( pSample->get_data_l() == nullptr );
 	___INFOLOG( "passed" );
 }
 
@@ -286,6 +305,32 @@ void TransportTest::testHumanization() {
 	___INFOLOG( "passed" );
 }
 
+void TransportTest::testDrumkitSwitch() {
+	___INFOLOG( "" );
+
+	auto pSong =
+		Song::load( QString( H2TEST_FILE( "song/AE_noteEnqueuing.h2song" ) ) );
+	CPPUNIT_ASSERT( pSong != nullptr );
+	H2Core::CoreActionController::setSong( pSong );
+
+	perform( &AudioEngineTests::testDrumkitSwitch );
+
+	___INFOLOG( "passed" );
+}
+
+void TransportTest::testVoiceStealing() {
+	___INFOLOG( "" );
+
+	auto pSong =
+		Song::load( QString( H2TEST_FILE( "song/AE_noteEnqueuing.h2song" ) ) );
+	CPPUNIT_ASSERT( pSong != nullptr );
+	H2Core::CoreActionController::setSong( pSong );
+
+	perform( &AudioEngineTests::testVoiceStealing );
+
+	___INFOLOG( "passed" );
+}
+
 void TransportTest::perform( std::function<void()> func ) {
 	try {
 		func();
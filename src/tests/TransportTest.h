@@ -43,6 +43,8 @@ class TransportTest : public CppUnit::TestFixture {
 	CPPUNIT_TEST( testNoteEnqueuing );
 	CPPUNIT_TEST( testNoteEnqueuingTimeline );
 	CPPUNIT_TEST( testHumanization );
+	CPPUNIT_TEST( testDrumkitSwitch );
+	CPPUNIT_TEST( testVoiceStealing );
 	CPPUNIT_TEST_SUITE_END();
 private:
 	void perform( std::function<void()> func );
@@ -72,4 +74,6 @@ public:
 	 */
 	void testNoteEnqueuingTimeline();
 	void testHumanization();
+	void testDrumkitSwitch();
+	void testVoiceStealing();
 };
@@ -26,15 +26,18 @@
 
 #include <core/Basics/Drumkit.h>
 #include <core/Basics/Pattern.h>
+#include <core/Basics/PatternList.h>
 #include <core/Basics/Instrument.h>
 #include <core/Basics/InstrumentList.h>
 #include <core/Basics/InstrumentLayer.h>
 #include <core/Basics/InstrumentComponent.h>
 #include <core/Basics/Sample.h>
 #include <core/Basics/Playlist.h>
+#include <core/Basics/Song.h>
 #include <core/Hydrogen.h>
 #include <core/License.h>
 #include <core/CoreActionController.h>
+#include <core/SoundLibrary/SoundLibraryDatabase.h>
 
 #include <QDir>
 #include <QTemporaryDir>
@@ -180,6 +183,313 @@ void XmlTest::testShippedDrumkits()
 // Expected behavior: The drumkit will be loaded successfully. 
 //					  In addition, the drumkit file will be saved with 
 //					  correct ADSR values.
+void XmlTest::testSoundLibraryIndex()
+{
+	___INFOLOG( "" );
+	auto pSoundLibraryDatabase =
+		H2Core::Hydrogen::get_instance()->getSoundLibraryDatabase();
+
+	QTemporaryDir tmpDir( H2Core::Filesystem::tmp_dir() +
+						  "testSoundLibraryIndex-XXXXXX" );
+	const QString sDrumkitPath = tmpDir.path() + "/indexKit";
+	const QString sDrumkitFile = sDrumkitPath + "/drumkit.xml";
+	CPPUNIT_ASSERT( H2Core::Filesystem::mkdir( sDrumkitPath ) );
+	const QDir baseKitDir( H2TEST_FILE( "drumkits/baseKit" ) );
+	for ( const auto& ssFile : baseKitDir.entryList( QDir::Files ) ) {
+		CPPUNIT_ASSERT( H2Core::Filesystem::file_copy(
+							baseKitDir.filePath( ssFile ),
+							sDrumkitPath + "/" + ssFile, true ) );
+	}
+
+	auto pDrumkit = H2Core::Drumkit::load( sDrumkitPath );
+	CPPUNIT_ASSERT( pDrumkit != nullptr );
+
+	pSoundLibraryDatabase->registerDrumkitFolder( tmpDir.path() );
+	pSoundLibraryDatabase->updateDrumkits( false );
+
+	// The kit is listed without being loaded.
+	auto drumkitInfos = pSoundLibraryDatabase->getDrumkitInfos();
+	CPPUNIT_ASSERT( drumkitInfos.find( sDrumkitPath ) != drumkitInfos.end() );
+	auto pInfo = drumkitInfos.at( sDrumkitPath );
+	CPPUNIT_ASSERT( pInfo->getName() == pDrumkit->getName() );
+	CPPUNIT_ASSERT( pInfo->getInstruments().size() ==
+					pDrumkit->getInstruments()->size() );
+	CPPUNIT_ASSERT( pInfo->getComponents().size() ==
+					pDrumkit->getComponents()->size() );
+	CPPUNIT_ASSERT( H2Core::Filesystem::file_exists(
+						H2Core::Filesystem::sound_library_index_file() ) );
+
+	// Unchanged kits are not scanned again.
+	pSoundLibraryDatabase->updateDrumkits( false );
+	CPPUNIT_ASSERT( pSoundLibraryDatabase->getDrumkitInfos()
+					.at( sDrumkitPath ) == pInfo );
+
+	// Modified kits are.
+	QFile drumkitFile( sDrumkitFile );
+	CPPUNIT_ASSERT( drumkitFile.open( QIODevice::ReadOnly ) );
+	QString sContent = QString::fromUtf8( drumkitFile.readAll() );
+	drumkitFile.close();
+	const QString sNameNode = QString( "<name>%1</name>" )
+		.arg( pDrumkit->getName() );
+	CPPUNIT_ASSERT( sContent.contains( sNameNode ) );
+	sContent.replace( sContent.indexOf( sNameNode ), sNameNode.size(),
+					  "<name>indexKit renamed</name>" );
+	CPPUNIT_ASSERT( drumkitFile.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+	drumkitFile.write( sContent.toUtf8() );
+	drumkitFile.close();
+
+	pSoundLibraryDatabase->updateDrumkits( false );
+	pInfo = pSoundLibraryDatabase->getDrumkitInfos().at( sDrumkitPath );
+	CPPUNIT_ASSERT( pInfo->getName() == "indexKit renamed" );
+
+	auto pDrumkitIndexed = pSoundLibraryDatabase->getDrumkit( sDrumkitPath );
+	CPPUNIT_ASSERT( pDrumkitIndexed != nullptr );
+	CPPUNIT_ASSERT( pDrumkitIndexed->getName() == "indexKit renamed" );
+
+	tmpDir.remove();
+	pSoundLibraryDatabase->updateDrumkits( false );
+	drumkitInfos = pSoundLibraryDatabase->getDrumkitInfos();
+	CPPUNIT_ASSERT( drumkitInfos.find( sDrumkitPath ) == drumkitInfos.end() );
+	___INFOLOG( "passed" );
+}
+
+void XmlTest::testSkipValidatedFiles()
+{
+	___INFOLOG( "" );
+	H2Core::XMLDoc::setSkipValidatedFiles( true );
+
+	QTemporaryDir tmpDir( H2Core::Filesystem::tmp_dir() +
+						  "testSkipValidatedFiles-XXXXXX" );
+	const QString sDrumkitFile = tmpDir.path() + "/drumkit.xml";
+	CPPUNIT_ASSERT( H2Core::Filesystem::file_copy(
+						H2TEST_FILE( "drumkits/baseKit/drumkit.xml" ),
+						sDrumkitFile, true ) );
+
+	// Validated using the compiled schema as well as using the hash of
+	// the first validation.
+	for ( int ii = 0; ii < 2; ++ii ) {
+		H2Core::XMLDoc doc;
+		CPPUNIT_ASSERT( doc.read( sDrumkitFile,
+								  H2Core::Filesystem::drumkit_xsd_path() ) );
+	}
+
+	// An element not covered by the schema.
+	QFile drumkitFile( sDrumkitFile );
+	CPPUNIT_ASSERT( drumkitFile.open( QIODevice::ReadOnly ) );
+	QString sContent = QString::fromUtf8( drumkitFile.readAll() );
+	drumkitFile.close();
+	sContent.replace( "</drumkit_info>", "<invalid/></drumkit_info>" );
+	CPPUNIT_ASSERT( drumkitFile.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+	drumkitFile.write( sContent.toUtf8() );
+	drumkitFile.close();
+
+	for ( int ii = 0; ii < 2; ++ii ) {
+		H2Core::XMLDoc doc;
+		CPPUNIT_ASSERT( ! doc.read( sDrumkitFile,
+									H2Core::Filesystem::drumkit_xsd_path() ) );
+	}
+
+	H2Core::XMLDoc::setSkipValidatedFiles( false );
+	___INFOLOG( "passed" );
+}
+
+void XmlTest::testStreamReader()
+{
+	___INFOLOG( "" );
+	auto pDrumkit = H2Core::Drumkit::load( H2TEST_FILE( "/drumkits/baseKit" ) );
+	CPPUNIT_ASSERT( pDrumkit != nullptr );
+	const QString sPatternFile = H2TEST_FILE( "/pattern/pat.h2pattern" );
+
+	H2Core::XMLDoc doc;
+	CPPUNIT_ASSERT( doc.read( sPatternFile ) );
+	H2Core::XMLNode patternNode = doc.firstChildElement( "drumkit_pattern" )
+		.firstChildElement( "pattern" );
+	auto pPatternDom = H2Core::Pattern::load_from(
+		patternNode, pDrumkit->getInstruments() );
+	auto pPatternStream = H2Core::Pattern::load_file(
+		sPatternFile, pDrumkit->getInstruments() );
+	CPPUNIT_ASSERT( pPatternDom != nullptr );
+	CPPUNIT_ASSERT( pPatternStream != nullptr );
+
+	CPPUNIT_ASSERT( pPatternDom->get_name() == pPatternStream->get_name() );
+	CPPUNIT_ASSERT( pPatternDom->get_info() == pPatternStream->get_info() );
+	CPPUNIT_ASSERT( pPatternDom->get_category() ==
+					pPatternStream->get_category() );
+	CPPUNIT_ASSERT( pPatternDom->get_length() == pPatternStream->get_length() );
+	CPPUNIT_ASSERT( pPatternDom->get_notes()->size() > 0 );
+	CPPUNIT_ASSERT( pPatternDom->get_notes()->size() ==
+					pPatternStream->get_notes()->size() );
+
+	auto itStream = pPatternStream->get_notes()->cbegin();
+	for ( const auto& [ nPosition, pNote ] : *pPatternDom->get_notes() ) {
+		CPPUNIT_ASSERT( itStream->first == nPosition );
+		CPPUNIT_ASSERT( itStream->second->get_instrument() ==
+						pNote->get_instrument() );
+		CPPUNIT_ASSERT( itStream->second->get_velocity() ==
+						pNote->get_velocity() );
+		++itStream;
+	}
+
+	delete pPatternDom;
+	delete pPatternStream;
+	___INFOLOG( "passed" );
+}
+
+void XmlTest::testStreamWriter()
+{
+	___INFOLOG( "" );
+	QTemporaryDir tmpDir( H2Core::Filesystem::tmp_dir() +
+						  "testStreamWriter-XXXXXX" );
+	const QString sOutFile = tmpDir.path() + "/out.xml";
+
+	const auto checkWrite = [&]( H2Core::XMLDoc& doc ) {
+		CPPUNIT_ASSERT( doc.write( sOutFile ) );
+		QFile outFile( sOutFile );
+		CPPUNIT_ASSERT( outFile.open( QIODevice::ReadOnly | QIODevice::Text ) );
+		CPPUNIT_ASSERT( outFile.readAll() == doc.toString().toUtf8() );
+	};
+
+	// Characters requiring escaping.
+	H2Core::XMLDoc doc;
+	H2Core::XMLNode root = doc.set_root( "root", "test" );
+	root.write_string( "text", "<a href=\"x\">b</a> & c ]]> d\r\n\te" );
+	root.write_string( "empty", "" );
+	H2Core::XMLNode node = root.createNode( "node" );
+	node.write_attribute( "attribute", "<\"a\"> & \r\n\t" );
+	root.createNode( "childless" );
+	doc.appendChild( doc.createComment( "comment-" ) );
+	checkWrite( doc );
+
+	for ( const auto& sFile : { H2TEST_FILE( "functional/test.h2song" ),
+								H2TEST_FILE( "song/test_song_1.2.2.h2song" ),
+								H2TEST_FILE( "drumkits/baseKit/drumkit.xml" ),
+								H2TEST_FILE( "pattern/pat.h2pattern" ) } ) {
+		H2Core::XMLDoc readDoc;
+		CPPUNIT_ASSERT( readDoc.read( sFile ) );
+		checkWrite( readDoc );
+	}
+
+	___INFOLOG( "passed" );
+}
+
+void XmlTest::testStreamWriterMatchesDom()
+{
+	___INFOLOG( "" );
+	QTemporaryDir tmpDir( H2Core::Filesystem::tmp_dir() +
+						  "testStreamWriterMatchesDom-XXXXXX" );
+	const QString sDomFile = tmpDir.path() + "/dom.xml";
+	const QString sStreamFile = tmpDir.path() + "/stream.xml";
+	const QString sSnapshotFile = tmpDir.path() + "/snapshot.xml";
+
+	auto pSong = H2Core::Song::load( H2TEST_FILE( "functional/test.h2song" ) );
+	CPPUNIT_ASSERT( pSong != nullptr );
+	CPPUNIT_ASSERT( pSong->getPatternList()->size() > 0 );
+
+	// Whole song with and without the trailing GPL notice.
+	for ( const auto& license : { pSong->getLicense(),
+								  H2Core::License( "GPL", "author" ) } ) {
+		pSong->setLicense( license );
+
+		// Saving sets the filename of the song. Do so first so the
+		// DOM version is created from the very same state.
+		CPPUNIT_ASSERT( pSong->save( sStreamFile ) );
+		CPPUNIT_ASSERT( pSong->createSnapshot()->save( sSnapshotFile ) );
+
+		H2Core::XMLDoc doc;
+		H2Core::XMLNode root = doc.set_root( "song" );
+		pSong->saveTo( root, false );
+		if ( license.getType() == H2Core::License::GPL ) {
+			doc.appendChild( doc.createComment(
+				H2Core::License::getGPLLicenseNotice( pSong->getAuthor() ) ) );
+		}
+		CPPUNIT_ASSERT( doc.write( sDomFile ) );
+
+		H2TEST_ASSERT_FILES_EQUAL( sDomFile, sStreamFile );
+		H2TEST_ASSERT_FILES_EQUAL( sDomFile, sSnapshotFile );
+	}
+
+	// Pattern list restricted to a single instrument.
+	auto pInstrument = pSong->getDrumkit()->getInstruments()->get( 0 );
+	{
+		H2Core::XMLStreamWriter writer;
+		CPPUNIT_ASSERT( writer.open( sStreamFile ) );
+		writer.writeStartDocument( "song" );
+		pSong->getPatternList()->save_to( writer, pInstrument );
+		writer.writeEndElement();
+		CPPUNIT_ASSERT( writer.commit() );
+
+		H2Core::XMLDoc doc;
+		H2Core::XMLNode root = doc.set_root( "song" );
+		pSong->getPatternList()->save_to( root, pInstrument );
+		CPPUNIT_ASSERT( doc.write( sDomFile ) );
+
+		H2TEST_ASSERT_FILES_EQUAL( sDomFile, sStreamFile );
+	}
+
+	// Single pattern file.
+	{
+		const auto pPattern = pSong->getPatternList()->get( 0 );
+		const H2Core::License license( "CC BY-SA", "author" );
+		CPPUNIT_ASSERT( pPattern->save_file( "dk_name", "author", license,
+											 sStreamFile, true ) );
+
+		H2Core::XMLDoc doc;
+		H2Core::XMLNode root = doc.set_root( "drumkit_pattern", "drumkit_pattern" );
+		root.write_string( "drumkit_name", "dk_name" );
+		root.write_string( "author", "author" );
+		root.write_string( "license", license.getLicenseString() );
+		pPattern->save_to( root );
+		CPPUNIT_ASSERT( doc.write( sDomFile ) );
+
+		H2TEST_ASSERT_FILES_EQUAL( sDomFile, sStreamFile );
+	}
+
+	___INFOLOG( "passed" );
+}
+
+void XmlTest::testSongSnapshot()
+{
+	___INFOLOG( "" );
+	QTemporaryDir tmpDir( H2Core::Filesystem::tmp_dir() +
+						  "testSongSnapshot-XXXXXX" );
+	const QString sSongFile = tmpDir.path() + "/song.h2song";
+	const QString sSnapshotFile = tmpDir.path() + "/snapshot.h2song";
+
+	auto pSong = H2Core::Song::load( H2TEST_FILE( "functional/test.h2song" ) );
+	CPPUNIT_ASSERT( pSong != nullptr );
+	CPPUNIT_ASSERT( pSong->save( sSongFile ) );
+
+	auto pSnapshot = pSong->createSnapshot();
+	CPPUNIT_ASSERT( pSnapshot->getRevision() == pSong->getRevision() );
+
+	pSong->setName( "modified after snapshot" );
+	pSong->setIsModified( true );
+	CPPUNIT_ASSERT( pSnapshot->getRevision() != pSong->getRevision() );
+
+	CPPUNIT_ASSERT( pSnapshot->save( sSnapshotFile ) );
+	H2TEST_ASSERT_FILES_EQUAL( sSongFile, sSnapshotFile );
+
+	// Unchanged patterns are shared with the previous snapshot while
+	// altered ones are copied again.
+	const QString sModifiedSongFile = tmpDir.path() + "/modified.h2song";
+	const QString sModifiedSnapshotFile = tmpDir.path() + "/modifiedSnapshot.h2song";
+	auto pNotes = pSong->getPatternList()->get( 0 )->get_notes();
+	CPPUNIT_ASSERT( pNotes->size() > 0 );
+	auto pNote = pNotes->begin()->second;
+	pNote->set_velocity( pNote->get_velocity() == 0.5 ? 0.25 : 0.5 );
+
+	auto pModifiedSnapshot = pSong->createSnapshot();
+	CPPUNIT_ASSERT( pModifiedSnapshot->save( sModifiedSnapshotFile ) );
+	CPPUNIT_ASSERT( pSong->save( sModifiedSongFile ) );
+	H2TEST_ASSERT_FILES_EQUAL( sModifiedSongFile, sModifiedSnapshotFile );
+
+	// The previous snapshot is not affected.
+	CPPUNIT_ASSERT( pSnapshot->save( sSnapshotFile ) );
+	H2TEST_ASSERT_FILES_EQUAL( sSongFile, sSnapshotFile );
+
+	___INFOLOG( "passed" );
+}
+
 void XmlTest::testDrumkit_UpgradeInvalidADSRValues()
 {
 	___INFOLOG( "" );
@@ -33,6 +33,12 @@ class XmlTest : public CppUnit::TestCase {
 	CPPUNIT_TEST(testPattern);
 	CPPUNIT_TEST(testPlaylist);
 	CPPUNIT_TEST(testShippedDrumkits);
+	CPPUNIT_TEST(testSoundLibraryIndex);
+	CPPUNIT_TEST(testSkipValidatedFiles);
+	CPPUNIT_TEST(testStreamReader);
+	CPPUNIT_TEST(testStreamWriter);
+	CPPUNIT_TEST(testStreamWriterMatchesDom);
+	CPPUNIT_TEST(testSongSnapshot);
 	CPPUNIT_TEST(checkTestPatterns);
 	CPPUNIT_TEST(testCompatibility);
 	CPPUNIT_TEST_SUITE_END();
@@ -48,6 +54,24 @@ class XmlTest : public CppUnit::TestCase {
 		// Check whether the drumkits provided alongside this repo can
 		// be validated against the drumkit XSD.
 		void testShippedDrumkits();
+		// Check whether the index of the SoundLibraryDatabase picks
+		// up modified kits.
+		void testSoundLibraryIndex();
+		// Documents skipped during validation because they were
+		// validated before must not hide modifications.
+		void testSkipValidatedFiles();
+		// Patterns read using the XMLStreamReader must match those
+		// read from a DOM.
+		void testStreamReader();
+		// Documents written by the XMLStreamWriter must be identical
+		// to the serialization of QDomDocument.
+		void testStreamWriter();
+		// Songs, snapshots, and patterns written by the
+		// XMLStreamWriter must match their DOM serialization.
+		void testStreamWriterMatchesDom();
+		// Songs written from a snapshot must match the ones written
+		// by Song::save() and not be affected by later changes.
+		void testSongSnapshot();
 		// Check whether the pattern used in the unit test is valid
 		// with respect to the shipped XSD file.
 		void checkTestPatterns();
@@ -27,6 +27,7 @@
 #include "AudioDriverTest.h"
 #include "AutomationPathSerializerTest.cpp"
 #include "AutomationPathTest.cpp"
+#include "CommandQueueTest.cpp"
 #include "CoreActionControllerTest.h"
 #include "EventQueueTest.cpp"
 #include "FilesystemTest.h"
@@ -40,7 +41,9 @@
 #include "NoteTest.cpp"
 #include "OscServerTest.h"
 #include "PatternTest.h"
+#include "ResampleTest.cpp"
 #include "SampleTest.cpp"
+#include "SoundFileWriterTest.cpp"
 #include "TimeTest.h"
 #include "Translations.cpp"
 #include "TransportTest.h"
@@ -51,6 +54,7 @@ CPPUNIT_TEST_SUITE_REGISTRATION( AudioBenchmark );
 CPPUNIT_TEST_SUITE_REGISTRATION( AudioDriverTest );
 CPPUNIT_TEST_SUITE_REGISTRATION( AutomationPathSerializerTest );
 CPPUNIT_TEST_SUITE_REGISTRATION( AutomationPathTest );
+CPPUNIT_TEST_SUITE_REGISTRATION( CommandQueueTest );
 CPPUNIT_TEST_SUITE_REGISTRATION( CoreActionControllerTest );
 CPPUNIT_TEST_SUITE_REGISTRATION( EventQueueTest );
 CPPUNIT_TEST_SUITE_REGISTRATION( FilesystemTest );
@@ -66,7 +70,9 @@ CPPUNIT_TEST_SUITE_REGISTRATION( NoteTest );
 CPPUNIT_TEST_SUITE_REGISTRATION( OscServerTest );
 #endif
 CPPUNIT_TEST_SUITE_REGISTRATION( PatternTest );
+CPPUNIT_TEST_SUITE_REGISTRATION( ResampleTest );
 CPPUNIT_TEST_SUITE_REGISTRATION( SampleTest );
+CPPUNIT_TEST_SUITE_REGISTRATION( SoundFileWriterTest );
 CPPUNIT_TEST_SUITE_REGISTRATION( TimeTest );
 CPPUNIT_TEST_SUITE_REGISTRATION( TransportTest );
 CPPUNIT_TEST_SUITE_REGISTRATION( UITranslationTest );